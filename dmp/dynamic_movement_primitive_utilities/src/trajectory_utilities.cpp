@@ -503,23 +503,26 @@ bool TrajectoryUtilities::resample(dmp_lib::Trajectory& trajectory,
   }
 
   vector<vector<double> > positions_resampled;
-  positions_resampled.resize(trajectory_dimension);
-  vector<double> position_target_vector;
-  position_target_vector.resize(trajectory_length);
+  vector<vector<double> > position_target_vectors;
+  position_target_vectors.resize(trajectory_dimension, vector<double>(trajectory_length));
   for (int i = 0; i < trajectory_dimension; ++i)
   {
     for (int j = 0; j < trajectory_length; ++j)
     {
       double position = 0;
       ROS_VERIFY(trajectory.getTrajectoryPosition(j, i, position));
-      position_target_vector[j] = position;
-      // ROS_INFO("input y: %f", position_target_vector[j]);
-    }
-    if(!usc_utilities::resample(input_vector, position_target_vector, cutoff_wave_length, input_querry, positions_resampled[i], false))
-    {
-      ROS_ERROR("Could not rescale position trajectory, splining failed.");
-      return false;
+      position_target_vectors[i][j] = position;
+      // ROS_INFO("input y: %f", position_target_vectors[i][j]);
     }
+  }
+  if(!usc_utilities::resample(input_vector, position_target_vectors, cutoff_wave_length, input_querry, positions_resampled, false))
+  {
+    ROS_ERROR("Could not rescale position trajectory, splining failed.");
+    return false;
+  }
+  ROS_ASSERT((int)positions_resampled.size() == trajectory_dimension);
+  for (int i = 0; i < trajectory_dimension; ++i)
+  {
     ROS_ASSERT(new_trajectory_length == (int)positions_resampled[i].size());
   }
 
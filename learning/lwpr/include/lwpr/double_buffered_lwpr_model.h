@@ -0,0 +1,224 @@
+/*********************************************************************
+ Computational Learning and Motor Control Lab
+ University of Southern California
+ Prof. Stefan Schaal
+ *********************************************************************
+ \remarks   Wraps an LWPRModel such that one training thread can keep
+            updating it while any number of threads predict from
+            published snapshots without taking a lock.
+
+ \file    double_buffered_lwpr_model.h
+
+ *********************************************************************/
+
+#ifndef DOUBLE_BUFFERED_LWPR_MODEL_H_
+#define DOUBLE_BUFFERED_LWPR_MODEL_H_
+
+// system includes
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <ros/ros.h>
+#include <ros/atomic.h>
+
+#include <lwpr_lib/lwpr.hh>
+
+// local includes
+#include <lwpr/lwpr_model.h>
+
+namespace lwpr
+{
+
+/*!
+ * The training thread owns an LWPRModel and calls update() on it. publish() copies the
+ * trained model into an immutable snapshot and hands it to every Predictor.
+ *
+ * Predicting from an LWPR object uses scratch space inside the object, so a single copy
+ * cannot be shared by concurrent predictions. Each Predictor therefore owns a triple
+ * buffer of snapshots:
+ * - publish() writes the back buffer and swaps it with the middle one.
+ * - The predictor swaps the middle buffer with its front buffer whenever a newer
+ *   snapshot is available.
+ * Both swaps are a single atomic exchange. Predictions never block on updates or
+ * publishing, and snapshots are only allocated and freed by the training thread.
+ *
+ * update(), publish() and writeToDisc() must only be called from the training thread.
+ * Each predicting thread has to use its own Predictor.
+ */
+class DoubleBufferedLWPRModel
+{
+
+public:
+
+  class Predictor;
+  typedef boost::shared_ptr<Predictor> PredictorPtr;
+
+  /*! Constructor
+   */
+  DoubleBufferedLWPRModel();
+  /*! Destructor
+   */
+  virtual ~DoubleBufferedLWPRModel() {};
+
+  /*! Initializes the trained model (see LWPRModel::initialize) and publishes the first snapshot.
+   * Reads the number of updates between two automatic publishes from "publish_interval",
+   * 0 (default) only publishes on explicit calls to publish().
+   * @return True on success, False otherwise
+   */
+  bool initialize(ros::NodeHandle node_handle, const int index = 1);
+  bool isInitialized() const;
+
+  /*! \brief Updates the trained model with a given input/output pair (x,y), publishes a snapshot
+   * every publish_interval updates.
+   * @param x input
+   * @param y output
+   * @param prediction Current prediction of the trained model, useful for tracking the training error.
+   * @return True on success, False otherwise
+   */
+  bool update(const double& x,
+              const double& y,
+              double& prediction);
+
+  /*! \brief Publishes a snapshot of the trained model to all predictors.
+   * @return True on success, False otherwise
+   */
+  bool publish();
+
+  /*!
+   * @param file_name
+   * @return True on success, False otherwise
+   */
+  bool writeToDisc(const std::string& file_name);
+
+  /*! \brief Creates a predictor that starts out with the latest snapshot. Can be called from any thread.
+   * @return The predictor, or an empty pointer if the model is not initialized
+   */
+  PredictorPtr createPredictor();
+
+  /*! Can be called from any thread.
+   * @return Number of snapshots published so far
+   */
+  unsigned int getVersion() const;
+
+  /*! Buffers of destroyed predictors are only dropped on the next publish(). Can be called from any thread.
+   * @return Number of predictors that publish() still hands snapshots to
+   */
+  unsigned int getNumPredictors() const;
+
+  /*!
+   * Lock-free predictions from the latest snapshot that has been published. Not thread safe
+   * itself, every predicting thread needs its own instance.
+   */
+  class Predictor
+  {
+  public:
+
+    /*! \brief Computes the prediction of the latest snapshot given an input x.
+     * @param x input
+     * @param y output
+     * @return True on success, False otherwise
+     */
+    bool predict(const double& x,
+                 double& y);
+
+    /*! \brief Computes the prediction of the latest snapshot given an input x.
+     * @param x input
+     * @param y output
+     * @param conf confidence
+     * @return True on success, False otherwise
+     */
+    bool predict(const double& x,
+                 double& y,
+                 double& conf);
+
+    /*! \brief Computes the predictions for a batch of query points, all from the same snapshot.
+     * @param x inputs
+     * @param y outputs, resized to the number of inputs
+     * @return True on success, False otherwise
+     */
+    bool predict(const std::vector<double>& x,
+                 std::vector<double>& y);
+
+    /*! \brief Computes the predictions for a batch of query points, all from the same snapshot.
+     * @param x inputs
+     * @param y outputs, resized to the number of inputs
+     * @param conf confidences, resized to the number of inputs
+     * @return True on success, False otherwise
+     */
+    bool predict(const std::vector<double>& x,
+                 std::vector<double>& y,
+                 std::vector<double>& conf);
+
+    /*!
+     * @return Version of the snapshot that the last prediction used
+     */
+    unsigned int getVersion() const;
+
+  private:
+
+    friend class DoubleBufferedLWPRModel;
+
+    struct Snapshot
+    {
+      boost::shared_ptr<lwpr_lib::LWPR_Object> lwpr_object_;
+      unsigned int version_;
+    };
+
+    enum
+    {
+      INDEX_MASK = 3,
+      FRESH = 4
+    };
+
+    /*! Shared between the predictor and the training thread.
+     */
+    struct Buffer
+    {
+      Snapshot snapshots_[3];
+      /*! index of the middle snapshot, FRESH if it has not been picked up yet */
+      ros::atomic_uint32_t middle_;
+      /*! only accessed by the training thread */
+      int back_;
+    };
+
+    Predictor(boost::shared_ptr<Buffer> buffer, const double cutoff);
+
+    /*! Swaps in the latest snapshot if there is one
+     */
+    lwpr_lib::LWPR_Object& acquire();
+
+    boost::shared_ptr<Buffer> buffer_;
+    int front_;
+    double cutoff_;
+
+    lwpr_lib::doubleVec input_;
+    lwpr_lib::doubleVec output_;
+    lwpr_lib::doubleVec confidence_;
+  };
+
+private:
+
+  bool initialized_;
+  int publish_interval_;
+  int num_updates_since_publish_;
+
+  LWPRModel lwpr_model_;
+
+  /*! guards the list of buffers and the latest snapshot, never taken by predictions */
+  mutable boost::mutex mutex_;
+  std::vector<boost::shared_ptr<Predictor::Buffer> > buffers_;
+  Predictor::Snapshot latest_;
+
+};
+
+// inline functions follow
+inline bool DoubleBufferedLWPRModel::isInitialized() const
+{
+  return initialized_;
+}
+
+}
+
+#endif /* DOUBLE_BUFFERED_LWPR_MODEL_H_ */
@@ -82,6 +82,16 @@ public:
                double& y,
                double& conf);
 
+  /*!
+   * @return The LWPR object that is trained, e.g. to copy it
+   */
+  const lwpr_lib::LWPR_Object& getLWPRObject() const;
+
+  /*!
+   * @return Cutoff used for predictions
+   */
+  double getCutoff() const;
+
 private:
 
   bool initialized_;
@@ -103,6 +113,18 @@ private:
 };
 
 // inline functions follow
+inline bool LWPRModel::isInitialized() const
+{
+  return initialized_;
+}
+inline const lwpr_lib::LWPR_Object& LWPRModel::getLWPRObject() const
+{
+  return *lwpr_object_;
+}
+inline double LWPRModel::getCutoff() const
+{
+  return parameters_.cutoff_;
+}
 
 }
 
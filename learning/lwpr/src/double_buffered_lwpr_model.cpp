@@ -0,0 +1,249 @@
+/*********************************************************************
+ Computational Learning and Motor Control Lab
+ University of Southern California
+ Prof. Stefan Schaal
+ *********************************************************************
+ \remarks   ...
+
+ \file    double_buffered_lwpr_model.cpp
+
+ *********************************************************************/
+
+// system includes
+#include <ros/ros.h>
+#include <usc_utilities/assert.h>
+
+// local includes
+#include <lwpr/double_buffered_lwpr_model.h>
+
+using namespace lwpr_lib;
+
+namespace lwpr
+{
+
+DoubleBufferedLWPRModel::DoubleBufferedLWPRModel() :
+  initialized_(false), publish_interval_(0), num_updates_since_publish_(0)
+{
+  latest_.version_ = 0;
+}
+
+bool DoubleBufferedLWPRModel::initialize(ros::NodeHandle node_handle, const int index)
+{
+  initialized_ = false;
+  if (!lwpr_model_.initialize(node_handle, index))
+  {
+    return false;
+  }
+  node_handle.param("publish_interval", publish_interval_, 0);
+  if (publish_interval_ < 0)
+  {
+    ROS_ERROR("Publish interval >%i< is invalid.", publish_interval_);
+    return false;
+  }
+  num_updates_since_publish_ = 0;
+  initialized_ = true;
+  if (!publish())
+  {
+    return (initialized_ = false);
+  }
+  return true;
+}
+
+bool DoubleBufferedLWPRModel::update(const double& x, const double& y, double& prediction)
+{
+  ROS_ASSERT(initialized_);
+  if (!lwpr_model_.update(x, y, prediction))
+  {
+    return false;
+  }
+  if (publish_interval_ > 0 && ++num_updates_since_publish_ >= publish_interval_)
+  {
+    return publish();
+  }
+  return true;
+}
+
+bool DoubleBufferedLWPRModel::publish()
+{
+  ROS_ASSERT(initialized_);
+  num_updates_since_publish_ = 0;
+
+  boost::mutex::scoped_lock lock(mutex_);
+  try
+  {
+    latest_.lwpr_object_.reset(new LWPR_Object(lwpr_model_.getLWPRObject()));
+    latest_.version_++;
+
+    std::vector<boost::shared_ptr<Predictor::Buffer> >::iterator it = buffers_.begin();
+    while (it != buffers_.end())
+    {
+      // the predictor has been destroyed
+      if (it->unique())
+      {
+        it = buffers_.erase(it);
+        continue;
+      }
+      Predictor::Buffer& buffer = **it;
+      Predictor::Snapshot& snapshot = buffer.snapshots_[buffer.back_];
+      snapshot.lwpr_object_.reset(new LWPR_Object(*latest_.lwpr_object_));
+      snapshot.version_ = latest_.version_;
+      buffer.back_ = buffer.middle_.exchange(buffer.back_ | Predictor::FRESH, ros::memory_order_acq_rel)
+          & Predictor::INDEX_MASK;
+      ++it;
+    }
+  }
+  catch (lwpr_lib::LWPR_Exception exception)
+  {
+    ROS_ERROR("Problem when publishing LWPR model : %s.", exception.getString());
+    return false;
+  }
+  return true;
+}
+
+bool DoubleBufferedLWPRModel::writeToDisc(const std::string& file_name)
+{
+  return lwpr_model_.writeToDisc(file_name);
+}
+
+DoubleBufferedLWPRModel::PredictorPtr DoubleBufferedLWPRModel::createPredictor()
+{
+  if (!initialized_)
+  {
+    ROS_ERROR("LWPR model is not initialized, cannot create predictor.");
+    return PredictorPtr();
+  }
+
+  boost::mutex::scoped_lock lock(mutex_);
+  boost::shared_ptr<Predictor::Buffer> buffer(new Predictor::Buffer());
+  try
+  {
+    // the predictor starts out with a copy of the latest snapshot in its front buffer
+    buffer->snapshots_[0].lwpr_object_.reset(new LWPR_Object(*latest_.lwpr_object_));
+    buffer->snapshots_[0].version_ = latest_.version_;
+  }
+  catch (lwpr_lib::LWPR_Exception exception)
+  {
+    ROS_ERROR("Could not create LWPR predictor : %s.", exception.getString());
+    return PredictorPtr();
+  }
+  buffer->middle_.store(1, ros::memory_order_release);
+  buffer->back_ = 2;
+  buffers_.push_back(buffer);
+  return PredictorPtr(new Predictor(buffer, lwpr_model_.getCutoff()));
+}
+
+unsigned int DoubleBufferedLWPRModel::getVersion() const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return latest_.version_;
+}
+
+unsigned int DoubleBufferedLWPRModel::getNumPredictors() const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return buffers_.size();
+}
+
+DoubleBufferedLWPRModel::Predictor::Predictor(boost::shared_ptr<Buffer> buffer, const double cutoff) :
+  buffer_(buffer), front_(0), cutoff_(cutoff)
+{
+  int num_input_dimension = buffer_->snapshots_[0].lwpr_object_->nIn();
+  int num_output_dimension = buffer_->snapshots_[0].lwpr_object_->nOut();
+  input_.resize(num_input_dimension);
+  output_.resize(num_output_dimension);
+  confidence_.resize(num_output_dimension);
+}
+
+LWPR_Object& DoubleBufferedLWPRModel::Predictor::acquire()
+{
+  if (buffer_->middle_.load(ros::memory_order_relaxed) & FRESH)
+  {
+    front_ = buffer_->middle_.exchange(front_, ros::memory_order_acq_rel) & INDEX_MASK;
+  }
+  return *buffer_->snapshots_[front_].lwpr_object_;
+}
+
+unsigned int DoubleBufferedLWPRModel::Predictor::getVersion() const
+{
+  return buffer_->snapshots_[front_].version_;
+}
+
+bool DoubleBufferedLWPRModel::Predictor::predict(const double& x, double& y)
+{
+  try
+  {
+    input_[0] = x;
+    output_ = acquire().predict(input_, cutoff_);
+    y = output_[0];
+  }
+  catch (lwpr_lib::LWPR_Exception exception)
+  {
+    ROS_ERROR("Problem when predicting output from LWPR model : %s.", exception.getString());
+    return false;
+  }
+  return true;
+}
+
+bool DoubleBufferedLWPRModel::Predictor::predict(const double& x, double& y, double& conf)
+{
+  try
+  {
+    input_[0] = x;
+    output_ = acquire().predict(input_, confidence_, cutoff_);
+    y = output_[0];
+    conf = confidence_[0];
+  }
+  catch (lwpr_lib::LWPR_Exception exception)
+  {
+    ROS_ERROR("Problem when predicting output from LWPR model : %s.", exception.getString());
+    return false;
+  }
+  return true;
+}
+
+bool DoubleBufferedLWPRModel::Predictor::predict(const std::vector<double>& x, std::vector<double>& y)
+{
+  y.resize(x.size());
+  try
+  {
+    LWPR_Object& lwpr_object = acquire();
+    for (unsigned int i = 0; i < x.size(); ++i)
+    {
+      input_[0] = x[i];
+      output_ = lwpr_object.predict(input_, cutoff_);
+      y[i] = output_[0];
+    }
+  }
+  catch (lwpr_lib::LWPR_Exception exception)
+  {
+    ROS_ERROR("Problem when predicting output from LWPR model : %s.", exception.getString());
+    return false;
+  }
+  return true;
+}
+
+bool DoubleBufferedLWPRModel::Predictor::predict(const std::vector<double>& x, std::vector<double>& y,
+                                                 std::vector<double>& conf)
+{
+  y.resize(x.size());
+  conf.resize(x.size());
+  try
+  {
+    LWPR_Object& lwpr_object = acquire();
+    for (unsigned int i = 0; i < x.size(); ++i)
+    {
+      input_[0] = x[i];
+      output_ = lwpr_object.predict(input_, confidence_, cutoff_);
+      y[i] = output_[0];
+      conf[i] = confidence_[0];
+    }
+  }
+  catch (lwpr_lib::LWPR_Exception exception)
+  {
+    ROS_ERROR("Problem when predicting output from LWPR model : %s.", exception.getString());
+    return false;
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,259 @@
+/*********************************************************************
+  Computational Learning and Motor Control Lab
+  University of Southern California
+  Prof. Stefan Schaal
+ *********************************************************************
+  \remarks		Trains a DoubleBufferedLWPRModel while several threads
+                predict from it and compares every prediction with a
+                plain LWPRModel trained in lockstep.
+
+  \file		double_buffered_lwpr_model_test.cpp
+
+ *********************************************************************/
+
+// system includes
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <gtest/gtest.h>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <ros/ros.h>
+#include <ros/atomic.h>
+
+// local includes
+#include <lwpr/lwpr_model.h>
+#include <lwpr/double_buffered_lwpr_model.h>
+
+using namespace lwpr;
+
+static const int NUM_UPDATES = 2000;
+static const int PUBLISH_INTERVAL = 10;
+static const int NUM_PREDICTORS = 4;
+static const int NUM_QUERIES = 21;
+static const double TOLERANCE = 1e-12;
+
+/*! Predictions of the reference model at the query points, indexed by the version that
+ * publishes the same state.
+ */
+class ReferencePredictions
+{
+public:
+
+  void add(const unsigned int version, const std::vector<double>& predictions)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (predictions_.size() <= version)
+    {
+      predictions_.resize(version + 1);
+    }
+    predictions_[version] = predictions;
+  }
+
+  bool get(const unsigned int version, std::vector<double>& predictions) const
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (version >= predictions_.size() || predictions_[version].empty())
+    {
+      return false;
+    }
+    predictions = predictions_[version];
+    return true;
+  }
+
+private:
+
+  mutable boost::mutex mutex_;
+  std::vector<std::vector<double> > predictions_;
+};
+
+struct PredictorResult
+{
+  PredictorResult() :
+    num_predictions(0), num_failed_predictions(0), num_decreasing_versions(0),
+    num_unknown_versions(0), max_error(0.0), last_version(0) {};
+  int num_predictions;
+  int num_failed_predictions;
+  int num_decreasing_versions;
+  int num_unknown_versions;
+  double max_error;
+  unsigned int last_version;
+};
+
+class DoubleBufferedLWPRModelTest : public testing::Test
+{
+public:
+
+  DoubleBufferedLWPRModelTest() :
+    node_handle_("~"), done_(false)
+  {
+    for (int i = 0; i < NUM_QUERIES; ++i)
+    {
+      queries_.push_back(-1.0 + 2.0 * static_cast<double>(i) / static_cast<double>(NUM_QUERIES - 1));
+    }
+  }
+
+  static void getSample(const int i, double& x, double& y)
+  {
+    x = 2.0 * std::fmod(0.6180339887 * static_cast<double>(i), 1.0) - 1.0;
+    y = std::sin(3.0 * x) + 0.5 * x * x;
+  }
+
+  void addReference(const unsigned int version)
+  {
+    std::vector<double> predictions(queries_.size());
+    for (unsigned int i = 0; i < queries_.size(); ++i)
+    {
+      ASSERT_TRUE(reference_model_.predict(queries_[i], predictions[i]));
+    }
+    references_.add(version, predictions);
+  }
+
+  void compare(const DoubleBufferedLWPRModel::PredictorPtr& predictor,
+               PredictorResult& result)
+  {
+    std::vector<double> predictions;
+    std::vector<double> reference_predictions;
+    if (!predictor->predict(queries_, predictions))
+    {
+      result.num_failed_predictions++;
+      return;
+    }
+    result.num_predictions++;
+    unsigned int version = predictor->getVersion();
+    if (version < result.last_version)
+    {
+      result.num_decreasing_versions++;
+    }
+    result.last_version = version;
+    if (!references_.get(version, reference_predictions))
+    {
+      result.num_unknown_versions++;
+      return;
+    }
+    for (unsigned int i = 0; i < queries_.size(); ++i)
+    {
+      result.max_error = std::max(result.max_error, std::fabs(predictions[i] - reference_predictions[i]));
+    }
+  }
+
+  void predict(DoubleBufferedLWPRModel::PredictorPtr predictor, PredictorResult* result)
+  {
+    while (!done_)
+    {
+      compare(predictor, *result);
+    }
+  }
+
+  /*! Keeps creating predictors and dropping them after a single prediction
+   */
+  void churn(PredictorResult* result)
+  {
+    while (!done_)
+    {
+      DoubleBufferedLWPRModel::PredictorPtr predictor = model_.createPredictor();
+      if (!predictor)
+      {
+        result->num_failed_predictions++;
+        continue;
+      }
+      compare(predictor, *result);
+    }
+  }
+
+  ros::NodeHandle node_handle_;
+  DoubleBufferedLWPRModel model_;
+  LWPRModel reference_model_;
+  std::vector<double> queries_;
+  ReferencePredictions references_;
+  ros::atomic<bool> done_;
+};
+
+TEST_F(DoubleBufferedLWPRModelTest, predictionsMatchReferenceAtSameVersion)
+{
+  ASSERT_TRUE(model_.initialize(node_handle_));
+  ASSERT_TRUE(reference_model_.initialize(node_handle_));
+  ASSERT_EQ(model_.getVersion(), 1u);
+  addReference(1);
+
+  std::vector<DoubleBufferedLWPRModel::PredictorPtr> predictors;
+  std::vector<PredictorResult> results(NUM_PREDICTORS + 1);
+  boost::thread_group threads;
+  for (int p = 0; p < NUM_PREDICTORS; ++p)
+  {
+    predictors.push_back(model_.createPredictor());
+    ASSERT_TRUE(predictors.back());
+    threads.create_thread(boost::bind(&DoubleBufferedLWPRModelTest::predict, this, predictors.back(), &results[p]));
+  }
+  threads.create_thread(boost::bind(&DoubleBufferedLWPRModelTest::churn, this, &results[NUM_PREDICTORS]));
+
+  for (int i = 0; i < NUM_UPDATES; ++i)
+  {
+    double x, y, prediction, reference_prediction;
+    getSample(i, x, y);
+    EXPECT_TRUE(model_.update(x, y, prediction));
+    EXPECT_TRUE(reference_model_.update(x, y, reference_prediction));
+    EXPECT_NEAR(prediction, reference_prediction, TOLERANCE);
+    if ((i + 1) % PUBLISH_INTERVAL == 0)
+    {
+      // the reference has to be known before any predictor can pick up the snapshot
+      addReference(model_.getVersion() + 1);
+      EXPECT_TRUE(model_.publish());
+    }
+  }
+  done_ = true;
+  threads.join_all();
+
+  for (unsigned int p = 0; p < results.size(); ++p)
+  {
+    EXPECT_GT(results[p].num_predictions, 0);
+    EXPECT_EQ(results[p].num_failed_predictions, 0);
+    EXPECT_EQ(results[p].num_decreasing_versions, 0);
+    EXPECT_EQ(results[p].num_unknown_versions, 0);
+    EXPECT_LE(results[p].max_error, TOLERANCE);
+  }
+
+  // every predictor picks up the last snapshot on its next prediction
+  const unsigned int last_version = 1 + NUM_UPDATES / PUBLISH_INTERVAL;
+  EXPECT_EQ(model_.getVersion(), last_version);
+  for (unsigned int p = 0; p < predictors.size(); ++p)
+  {
+    compare(predictors[p], results[p]);
+    EXPECT_EQ(predictors[p]->getVersion(), last_version);
+    EXPECT_LE(results[p].max_error, TOLERANCE);
+  }
+}
+
+TEST_F(DoubleBufferedLWPRModelTest, destroyedPredictorsAreDroppedOnPublish)
+{
+  ASSERT_TRUE(model_.initialize(node_handle_));
+  EXPECT_EQ(model_.getNumPredictors(), 0u);
+
+  DoubleBufferedLWPRModel::PredictorPtr kept = model_.createPredictor();
+  DoubleBufferedLWPRModel::PredictorPtr dropped_1 = model_.createPredictor();
+  DoubleBufferedLWPRModel::PredictorPtr dropped_2 = model_.createPredictor();
+  EXPECT_EQ(model_.getNumPredictors(), 3u);
+
+  dropped_1.reset();
+  dropped_2.reset();
+  EXPECT_EQ(model_.getNumPredictors(), 3u);
+  EXPECT_TRUE(model_.publish());
+  EXPECT_EQ(model_.getNumPredictors(), 1u);
+
+  // the remaining predictor still receives snapshots
+  double y;
+  EXPECT_TRUE(kept->predict(0.0, y));
+  EXPECT_EQ(kept->getVersion(), model_.getVersion());
+
+  kept.reset();
+  EXPECT_TRUE(model_.publish());
+  EXPECT_EQ(model_.getNumPredictors(), 0u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "double_buffered_lwpr_model_test");
+  return RUN_ALL_TESTS();
+}
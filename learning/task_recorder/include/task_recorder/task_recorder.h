@@ -412,17 +412,17 @@ bool TaskRecorder<MessageType, StopServiceType>::resample(std::vector<MessageTyp
     }
   }
 
-  for (int i=0; i<num_vars; ++i)
+  if (use_bspline)
   {
-    if (use_bspline)
+    if (!usc_utilities::resample(input_vector, variables, wave_length, input_querry, variables_resampled, false))
     {
-      if (!usc_utilities::resample(input_vector, variables[i], wave_length, input_querry, variables_resampled[i], false))
-      {
-        ROS_ERROR("Could not resample variables, splining failed.");
-        return false;
-      }
+      ROS_ERROR("Could not resample variables, splining failed.");
+      return false;
     }
-    else
+  }
+  else
+  {
+    for (int i=0; i<num_vars; ++i)
     {
       ROS_VERIFY(usc_utilities::resampleLinear(input_vector, variables[i], input_querry, variables_resampled[i]));
     }
@@ -799,27 +799,27 @@ template<class MessageType>
 
     std::vector<std::vector<double> > variables_resampled;
     variables_resampled.resize(num_vars);
-    for (int i = 0; i < num_vars; ++i)
+    switch(splining_method_)
     {
-      switch(splining_method_)
+      case BSpline:
       {
-        case BSpline:
-        {
-          ROS_VERIFY(usc_utilities::resample(input_vector, variables[i], wave_length, input_querry, variables_resampled[i], false));
-          // log(task_recorder2_utilities::getDataFileName(recorder_io_.prefixed_topic_name_, i), i, input_vector, variables[i], input_querry, variables_resampled[i]);
-          break;
-        }
-        case Linear:
+        // all variables share the time stamps, so the spline system is only set up once
+        ROS_VERIFY(usc_utilities::resample(input_vector, variables, wave_length, input_querry, variables_resampled, false));
+        break;
+      }
+      case Linear:
+      {
+        for (int i = 0; i < num_vars; ++i)
         {
           ROS_VERIFY(usc_utilities::resampleLinearNoBounds(input_vector, variables[i], input_querry, variables_resampled[i]));
           // log(task_recorder2_utilities::getDataFileName(recorder_io_.prefixed_topic_name_, i), i, input_vector, variables[i], input_querry, variables_resampled[i]);
-          break;
-        }
-        default:
-        {
-          ROS_ASSERT_MSG(false, "Unknown sampling method for task recorder with topic >%s<. This should never happen.", recorder_io_.topic_name_.c_str());
-          break;
         }
+        break;
+      }
+      default:
+      {
+        ROS_ASSERT_MSG(false, "Unknown sampling method for task recorder with topic >%s<. This should never happen.", recorder_io_.topic_name_.c_str());
+        break;
       }
     }
 
@@ -16,11 +16,14 @@
 #include <constrained_inverse_kinematics/fk_solver.h>
 #include <constrained_inverse_kinematics/chain.h>
 #include <constrained_inverse_kinematics/InverseKinematicsRequest.h>
+#include <constrained_inverse_kinematics/cost_function_input.h>
 #include <learnable_cost_function/cost_function.h>
 #include <boost/random/variate_generator.hpp>
 #include <boost/random/uniform_01.hpp>
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/function.hpp>
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
 
 namespace constrained_inverse_kinematics
 {
@@ -33,6 +36,7 @@ struct IKSolution
   double cost_function_value;
   bool success;
   int chain_id;
+  int num_iterations; /**< iterations ikLocal needed, for benchmarking */
 
   // slightly hacky since pre_grasp stuff is now handled in IKWrapper
   std::vector<IKSolution> pre_grasp_solutions;
@@ -46,9 +50,41 @@ struct IKSolution
   }
 };
 
+/**
+ * Scratch space of ConstrainedIKSolver::ikLocal(), allocated once per solver. The task space has at most
+ * 6 rows, so the damped JJ^T and its LDLT factorization have fixed maximum sizes and live on the stack.
+ */
+struct IKWorkspace
+{
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, 6, 1> TaskVector;
+  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, 6, 6> TaskMatrix;
+
+  IKWorkspace(int num_joints = 0);
+
+  boost::shared_ptr<CostFunctionInput> cost_function_input;
+  TaskVector error_vector;
+  Eigen::MatrixXd world_jacobian;
+  Eigen::MatrixXd position_jacobian;
+  Eigen::MatrixXd position_jacobian_constraint_frame;
+  Eigen::MatrixXd orientation_jacobian;
+  TaskMatrix JJt;
+  Eigen::LDLT<TaskMatrix> JJt_ldlt;
+  TaskVector task_vector;
+  TaskVector task_solution;
+  Eigen::VectorXd delta_theta;
+  Eigen::VectorXd cost_function_gradient;
+  Eigen::VectorXd null_space_update;
+  std::vector<double> cost_function_weighted_feature_values;
+  KDL::JntArray q_prev;
+};
+
 class ConstrainedIKSolver
 {
 public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
   // chain_id is an arbitrary id that will be sent back in IK solutions
   ConstrainedIKSolver(ros::NodeHandle node_handle, const std::string& root, const std::string& tip, int chain_id);
   virtual ~ConstrainedIKSolver();
@@ -97,6 +133,9 @@ protected:
 
   boost::shared_ptr<boost::variate_generator<boost::mt19937, boost::uniform_01<> > > random_generator_;
 
+  // ikLocal() must not be called from several threads on the same solver
+  mutable IKWorkspace workspace_;
+
 
 };
 
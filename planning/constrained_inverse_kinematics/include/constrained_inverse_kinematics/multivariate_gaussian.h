@@ -62,6 +62,12 @@ public:
   template <typename Derived>
   void sample(Eigen::MatrixBase<Derived>& output);
 
+  /**
+   * Draws one sample per column of output
+   */
+  template <typename Derived>
+  void sampleColumns(Eigen::MatrixBase<Derived>& output);
+
 private:
   Eigen::VectorXd mean_;                /**< Mean of the gaussian distribution */
   Eigen::MatrixXd covariance_cholesky_; /**< Cholesky decomposition (LL^T) of the covariance */
@@ -82,7 +88,7 @@ void MultivariateGaussian::setMeanAndCovariance(const Eigen::MatrixBase<Derived1
   covariance_cholesky_ = covariance.llt().matrixL();
 }
 
-MultivariateGaussian::MultivariateGaussian():
+inline MultivariateGaussian::MultivariateGaussian():
   normal_dist_(0.0,1.0)
 {
   rng_.seed(rand());
@@ -97,6 +103,15 @@ void MultivariateGaussian::sample(Eigen::MatrixBase<Derived>& output)
   output = mean_ + covariance_cholesky_*output;
 }
 
+template <typename Derived>
+void MultivariateGaussian::sampleColumns(Eigen::MatrixBase<Derived>& output)
+{
+  for (int j=0; j<output.cols(); ++j)
+    for (int i=0; i<size_; ++i)
+      output(i,j) = (*gaussian_)();
+  output = (covariance_cholesky_*output).colwise() + mean_;
+}
+
 }
 
 #endif /* MULTIVARIATE_GAUSSIAN_H_ */
@@ -15,13 +15,10 @@
 namespace constrained_inverse_kinematics
 {
 
-struct SampleInfo
-{
-  KDL::JntArray joint_angles;
-  double cost;
-  double probability;
-};
-
+/**
+ * Sampling based IK: all samples of an iteration are drawn at once, clipped at the joint limits,
+ * and their costs are evaluated in parallel (OpenMP), with one FK solver per thread.
+ */
 class StochasticIKSolver
 {
 public:
@@ -45,9 +42,24 @@ private:
   double orientation_cost_weight_;
   double cost_to_probability_h_;
 
+  // the solver stops early once the mean moves less than convergence_tolerance_ (in joint space)
+  // or its cost is below convergence_cost_, both are disabled if <= 0
+  double convergence_tolerance_;
+  double convergence_cost_;
+
+  Eigen::VectorXd joint_lower_limits_;
+  Eigen::VectorXd joint_upper_limits_;
+
+  // per thread:
+  int max_openmp_threads_;
+  std::vector<boost::shared_ptr<const FKSolver> > fk_solvers_;
+  std::vector<KinematicsInfo> kinematics_infos_;
+  std::vector<KDL::JntArray> sample_joint_angles_;
+
   void readParams();
 
-  double computeCost(const KDL::JntArray& q_in, const KDL::Frame& pose_des, KinematicsInfo& kinematics_info);
+  double computeCost(const KDL::JntArray& q_in, const KDL::Frame& pose_des,
+                     const FKSolver& fk_solver, KinematicsInfo& kinematics_info) const;
 
 };
 
@@ -25,6 +25,24 @@ using namespace conversions;
 namespace constrained_inverse_kinematics
 {
 
+IKWorkspace::IKWorkspace(int num_joints):
+    cost_function_input(new CostFunctionInput()),
+    error_vector(6),
+    world_jacobian(6, num_joints),
+    position_jacobian(3, num_joints),
+    position_jacobian_constraint_frame(3, num_joints),
+    orientation_jacobian(3, num_joints),
+    JJt(6, 6),
+    JJt_ldlt(6),
+    task_vector(6),
+    task_solution(6),
+    delta_theta(num_joints),
+    cost_function_gradient(num_joints),
+    null_space_update(num_joints),
+    q_prev(num_joints)
+{
+}
+
 ConstrainedIKSolver::ConstrainedIKSolver(ros::NodeHandle node_handle, const std::string& root, const std::string& tip, int chain_id):
     node_handle_(node_handle),
     chain_id_(chain_id)
@@ -42,6 +60,7 @@ ConstrainedIKSolver::ConstrainedIKSolver(ros::NodeHandle node_handle, const std:
   chain_.reset(new Chain(root, tip));
   default_fk_solver_ = chain_->fk_solver_;
   useDefaultFKSolver();
+  workspace_ = IKWorkspace(chain_->num_joints_);
 
   boost::mt19937 mt19937;
   mt19937.seed(rand());
@@ -83,30 +102,19 @@ bool ConstrainedIKSolver::ikLocal(const InverseKinematicsRequest& ik_request,
            const KDL::JntArray& q_in,
            IKSolution& solution) const
 {
-  KinematicsInfo kinematics_info;
+  IKWorkspace& ws = workspace_;
+  CostFunctionInput& cost_function_input = *ws.cost_function_input;
+  KinematicsInfo& kinematics_info = cost_function_input.kinematics_info_;
   KDL::Frame link_to_tool_frame;
   KDL::Frame desired_tool_frame;
   KDL::Frame tool_frame;
   KDL::Twist twist;
-  boost::shared_ptr<CostFunctionInput> cost_function_input(new CostFunctionInput());
   rosPoseToKdlFrame(ik_request.link_to_tool_pose, link_to_tool_frame);
   rosPoseToKdlFrame(ik_request.desired_tool_pose, desired_tool_frame);
 
-  VectorXd error_vector(6);
-  MatrixXd world_jacobian(6, chain_->num_joints_);
   int num_jacobian_rows=0;
-  MatrixXd position_jacobian(3, chain_->num_joints_);
-  MatrixXd position_jacobian_constraint_frame(3, chain_->num_joints_);
-  MatrixXd orientation_jacobian(3, chain_->num_joints_);
-  MatrixXd JJt(6,6);
-  MatrixXd Jhash(chain_->num_joints_, 6);
-  MatrixXd null_space(chain_->num_joints_, chain_->num_joints_);
-  VectorXd damping = VectorXd::Ones(6) * 1e-4;
-  VectorXd delta_theta(chain_->num_joints_);
-  VectorXd cost_function_gradient;
+  const double damping = 1e-4;
   bool cost_function_state_validity;
-  std::vector<double> cost_function_weighted_feature_values;
-  VectorXd null_space_update;
   double cost_function_value;
   bool converged = false;
 
@@ -114,10 +122,11 @@ bool ConstrainedIKSolver::ikLocal(const InverseKinematicsRequest& ik_request,
   solution.cost_function_value = std::numeric_limits<double>::max();
   solution.success = false;
   solution.joint_angles = q_in;
+  solution.num_iterations = 0;
 
-  KDL::JntArray q_prev = q_in;
   int num_iter=0;
 
+
   boost::shared_ptr<const FKSolver> my_fk_solver = default_fk_solver_;
 
   // constraint handling
@@ -136,7 +145,10 @@ bool ConstrainedIKSolver::ikLocal(const InverseKinematicsRequest& ik_request,
     kdlRotationToEigenMatrix3d(position_constraint_orientation_inverse, position_constraint_orientation_inverse_eigen);
   }
 
-  KDL::JntArray q_out = q_in;
+  KDL::JntArray& q_out = cost_function_input.joint_angles_;
+  q_out = q_in;
+  cost_function_input.chain_ = chain_;
+  cost_function_input.num_dimensions_ = chain_->num_joints_;
 
   int position_start_row, position_end_row, orientation_start_row, orientation_end_row;
   do
@@ -156,8 +168,8 @@ bool ConstrainedIKSolver::ikLocal(const InverseKinematicsRequest& ik_request,
     twist = diff(tool_frame, desired_tool_frame);
 
     // get jacobians
-    my_fk_solver->getPositionJacobian(kinematics_info, tool_frame.p, position_jacobian);
-    my_fk_solver->getOrientationJacobian(kinematics_info, orientation_jacobian);
+    my_fk_solver->getPositionJacobian(kinematics_info, tool_frame.p, ws.position_jacobian);
+    my_fk_solver->getOrientationJacobian(kinematics_info, ws.orientation_jacobian);
 
     num_jacobian_rows = 0;
     position_start_row = num_jacobian_rows;
@@ -169,15 +181,15 @@ bool ConstrainedIKSolver::ikLocal(const InverseKinematicsRequest& ik_request,
       KDL::Vector error_constraint = position_constraint_orientation_inverse * twist.vel;
 
       // rotate the jacobian into constraint frame
-      position_jacobian_constraint_frame = position_constraint_orientation_inverse_eigen * position_jacobian;
+      ws.position_jacobian_constraint_frame.noalias() = position_constraint_orientation_inverse_eigen * ws.position_jacobian;
 
       // now check each dimension for constraint violations
       for (int d=0; d<3; ++d)
       {
         if (fabs(error_constraint(d)) > ik_request.position_constraint_shape.dimensions[d]/2.0)
         {
-          error_vector(num_jacobian_rows) = error_constraint(d);
-          world_jacobian.row(num_jacobian_rows) = position_jacobian_constraint_frame.row(d);
+          ws.error_vector(num_jacobian_rows) = error_constraint(d);
+          ws.world_jacobian.row(num_jacobian_rows) = ws.position_jacobian_constraint_frame.row(d);
           ++num_jacobian_rows;
         }
       }
@@ -186,9 +198,9 @@ bool ConstrainedIKSolver::ikLocal(const InverseKinematicsRequest& ik_request,
     else
     {
       num_jacobian_rows = 3;
-      world_jacobian.block(0, 0, 3, chain_->num_joints_) = position_jacobian;
+      ws.world_jacobian.block(0, 0, 3, chain_->num_joints_) = ws.position_jacobian;
       for (int d=0; d<3; ++d)
-        error_vector(d) = twist.vel(d);
+        ws.error_vector(d) = twist.vel(d);
     }
 
     position_end_row = num_jacobian_rows - 1;
@@ -201,17 +213,17 @@ bool ConstrainedIKSolver::ikLocal(const InverseKinematicsRequest& ik_request,
       {
         if (fabs(twist.rot(d)) > ik_request.orientation_constraint_angular_tolerance[d])
         {
-          error_vector(num_jacobian_rows) = twist.rot(d);
-          world_jacobian.row(num_jacobian_rows) = orientation_jacobian.row(d);
+          ws.error_vector(num_jacobian_rows) = twist.rot(d);
+          ws.world_jacobian.row(num_jacobian_rows) = ws.orientation_jacobian.row(d);
           ++num_jacobian_rows;
         }
       }
     }
     else
     {
-      world_jacobian.block(num_jacobian_rows, 0, 3, chain_->num_joints_) = orientation_jacobian;
+      ws.world_jacobian.block(num_jacobian_rows, 0, 3, chain_->num_joints_) = ws.orientation_jacobian;
       for (int d=0; d<3; ++d)
-        error_vector(d+num_jacobian_rows) = twist.rot(d);
+        ws.error_vector(d+num_jacobian_rows) = twist.rot(d);
       num_jacobian_rows += 3;
     }
 
@@ -221,46 +233,55 @@ bool ConstrainedIKSolver::ikLocal(const InverseKinematicsRequest& ik_request,
     converged = true;
     for (int d=position_start_row; d<=position_end_row; ++d)
     {
-      if (fabs(error_vector(d)) > position_convergence_threshold_)
+      if (fabs(ws.error_vector(d)) > position_convergence_threshold_)
         converged = false;
-      error_vector(d) = usc_utilities::clipAbsoluteValue(error_vector(d), max_translation_error_);
+      ws.error_vector(d) = usc_utilities::clipAbsoluteValue(ws.error_vector(d), max_translation_error_);
     }
     for (int d=orientation_start_row; d<=orientation_end_row; ++d)
     {
-      if (fabs(error_vector(d)) > orientation_convergence_threshold_)
+      if (fabs(ws.error_vector(d)) > orientation_convergence_threshold_)
         converged = false;
-      error_vector(d) = usc_utilities::clipAbsoluteValue(error_vector(d), max_orientation_error_);
+      ws.error_vector(d) = usc_utilities::clipAbsoluteValue(ws.error_vector(d), max_orientation_error_);
     }
 
     //ROS_INFO("Jacobian has %d rows", num_jacobian_rows);
 
-    JJt.topLeftCorner(num_jacobian_rows, num_jacobian_rows) =
-        world_jacobian.topRows(num_jacobian_rows) * world_jacobian.topRows(num_jacobian_rows).transpose();
-    JJt.topLeftCorner(num_jacobian_rows, num_jacobian_rows).diagonal() += damping.head(num_jacobian_rows);
-
-    Jhash.leftCols(num_jacobian_rows) = world_jacobian.topRows(num_jacobian_rows).transpose() *
-        JJt.topLeftCorner(num_jacobian_rows, num_jacobian_rows).inverse();
-
-    null_space = MatrixXd::Identity(chain_->num_joints_, chain_->num_joints_) -
-        Jhash.leftCols(num_jacobian_rows) * world_jacobian.topRows(num_jacobian_rows);
-
-    // prepare input for cost function:
-    cost_function_input->chain_ = chain_;
-    cost_function_input->kinematics_info_ = kinematics_info;
-    cost_function_input->joint_angles_ = q_out;
-    cost_function_input->tool_frame_ = tool_frame;
-    cost_function_input->num_dimensions_ = chain_->num_joints_;
-
     // compute cost function
-    cost_function_->getValueAndGradient(cost_function_input, cost_function_value, true, cost_function_gradient, cost_function_state_validity, cost_function_weighted_feature_values);
-    null_space_update = - null_space * cost_function_gradient;
+    cost_function_input.tool_frame_ = tool_frame;
+    cost_function_->getValueAndGradient(ws.cost_function_input, cost_function_value, true, ws.cost_function_gradient,
+                                        cost_function_state_validity, ws.cost_function_weighted_feature_values);
+
+    // damped least squares step J^T (JJ^T + D)^-1 e, and the null space update -(I - J^T (JJ^T + D)^-1 J) g,
+    // both solved with the same LDLT factorization instead of forming the pseudo-inverse and the projector
+    if (num_jacobian_rows > 0)
+    {
+      const Eigen::Block<MatrixXd> jacobian = ws.world_jacobian.topRows(num_jacobian_rows);
+      ws.JJt.resize(num_jacobian_rows, num_jacobian_rows);
+      ws.JJt.noalias() = jacobian * jacobian.transpose();
+      ws.JJt.diagonal().array() += damping;
+      ws.JJt_ldlt.compute(ws.JJt);
+
+      ws.task_solution = ws.JJt_ldlt.solve(ws.error_vector.head(num_jacobian_rows));
+      ws.delta_theta.noalias() = jacobian.transpose() * ws.task_solution;
+
+      ws.task_vector.resize(num_jacobian_rows);
+      ws.task_vector.noalias() = jacobian * ws.cost_function_gradient;
+      ws.task_solution = ws.JJt_ldlt.solve(ws.task_vector);
+      ws.null_space_update = -ws.cost_function_gradient;
+      ws.null_space_update.noalias() += jacobian.transpose() * ws.task_solution;
+    }
+    else
+    {
+      ws.delta_theta.setZero();
+      ws.null_space_update = -ws.cost_function_gradient;
+    }
 
     // scale null space update down if needed:
-    double max_null_space_update = null_space_update.cwiseAbs().maxCoeff();
+    double max_null_space_update = ws.null_space_update.cwiseAbs().maxCoeff();
     if (max_null_space_update > max_null_space_joint_update_)
     {
       double scale = max_null_space_joint_update_ / max_null_space_update;
-      null_space_update *= scale;
+      ws.null_space_update *= scale;
       //ROS_INFO("scaled null space update by %f", scale);
     }
 
@@ -287,21 +308,21 @@ bool ConstrainedIKSolver::ikLocal(const InverseKinematicsRequest& ik_request,
     //ROS_INFO("converged = %d, cost = %f", converged?1:0, cost_function_value);
 
     // save prev joint values
-    q_prev = q_out;
+    ws.q_prev.data = q_out.data;
 
     // compute update
-    delta_theta = Jhash.leftCols(num_jacobian_rows) * error_vector.head(num_jacobian_rows)
-        + null_space_update;
-    q_out.data += delta_theta;
+    ws.delta_theta += ws.null_space_update;
+    q_out.data += ws.delta_theta;
 
     // clip at joint limits:
     chain_->clipJointAnglesAtLimits(q_out);
-    delta_theta = q_out.data - q_prev.data;
+    ws.delta_theta = q_out.data - ws.q_prev.data;
 
     ++num_iter;
   }
-  while(delta_theta.cwiseAbs().maxCoeff() > min_joint_update_threshold_ && num_iter < max_iterations_);
+  while(ws.delta_theta.cwiseAbs().maxCoeff() > min_joint_update_threshold_ && num_iter < max_iterations_);
 
+  solution.num_iterations = num_iter;
   return solution.success;
 }
 
@@ -158,8 +158,10 @@ bool IKWrapper::ik(const InverseKinematicsRequest& ik_request,
   best_solution.cost_function_value = std::numeric_limits<double>::max();
   best_solution.success = false;
   int num_success = 0;
+  int num_iterations = 0;
   for (int i=0; i<max_random_attempts_; ++i)
   {
+    num_iterations += solutions[i].num_iterations;
     if (!solutions[i].success)
       continue;
     ++num_success;
@@ -171,8 +173,8 @@ bool IKWrapper::ik(const InverseKinematicsRequest& ik_request,
   }
 
   ros::WallDuration duration = ros::WallTime::now() - start_time;
-  ROS_INFO("IK Solver took %f millisecs (success = %d / %d)", duration.toSec()*1000.0,
-           num_success, max_random_attempts_);
+  ROS_INFO("IK Solver took %f millisecs (success = %d / %d, %d iterations)", duration.toSec()*1000.0,
+           num_success, max_random_attempts_, num_iterations);
 
   return best_solution.success;
 }
@@ -13,6 +13,7 @@
 #include <constrained_inverse_kinematics/multivariate_gaussian.h>
 #include <usc_utilities/param_server.h>
 #include <usc_utilities/assert.h>
+#include <omp.h>
 
 namespace constrained_inverse_kinematics
 {
@@ -22,6 +23,23 @@ StochasticIKSolver::StochasticIKSolver(ros::NodeHandle& node_handle, const std::
     chain_(root, tip)
 {
   readParams();
+
+  joint_lower_limits_ = Eigen::VectorXd::Zero(chain_.num_joints_);
+  joint_upper_limits_ = Eigen::VectorXd::Zero(chain_.num_joints_);
+  for (int k=0; k<chain_.num_joints_; ++k)
+  {
+    joint_lower_limits_(k) = chain_.joints_[k]->limits->lower;
+    joint_upper_limits_(k) = chain_.joints_[k]->limits->upper;
+  }
+
+  max_openmp_threads_ = omp_get_max_threads();
+  fk_solvers_.resize(max_openmp_threads_);
+  kinematics_infos_.resize(max_openmp_threads_);
+  sample_joint_angles_.resize(max_openmp_threads_, KDL::JntArray(chain_.num_joints_));
+  for (int i=0; i<max_openmp_threads_; ++i)
+  {
+    fk_solvers_[i] = chain_.fk_solver_->clone();
+  }
 }
 
 StochasticIKSolver::~StochasticIKSolver()
@@ -32,97 +50,89 @@ bool StochasticIKSolver::solve(const KDL::Frame& pose_des,
            const KDL::JntArray& q_in,
            KDL::JntArray& q_out)
 {
-  MultivariateGaussian gaussian;
-  KinematicsInfo kinematics_info;
-  KDL::Frame pose;
-  KDL::Twist error;
+  const int num_joints = chain_.num_joints_;
+  const int num_samples = num_samples_per_iteration_;
 
-  SampleInfo default_sample_info;
-  default_sample_info.joint_angles = q_in;
-  std::vector<SampleInfo> samples;
-  for (int j=0; j<num_samples_per_iteration_; ++j)
-    samples.push_back(default_sample_info);
+  MultivariateGaussian gaussian;
+  // one sample per column
+  Eigen::MatrixXd samples = Eigen::MatrixXd::Zero(num_joints, num_samples);
+  Eigen::MatrixXd centered_samples = samples;
+  Eigen::VectorXd costs = Eigen::VectorXd::Zero(num_samples);
+  Eigen::VectorXd probabilities = Eigen::VectorXd::Zero(num_samples);
 
   KDL::JntArray joint_angles = q_in;
   Eigen::VectorXd prev_mean = joint_angles.data;
-  Eigen::VectorXd diff = prev_mean;
-  Eigen::MatrixXd covariance = Eigen::MatrixXd::Zero(chain_.num_joints_, chain_.num_joints_);
-  for (int k=0; k<chain_.num_joints_; ++k)
+  Eigen::MatrixXd covariance = Eigen::MatrixXd::Zero(num_joints, num_joints);
+  for (int k=0; k<num_joints; ++k)
   {
     covariance(k,k) = noise_stddev_[k]*noise_stddev_[k];
   }
 
   for (int i=0; i<max_iterations_; ++i)
   {
-    double cost = computeCost(joint_angles, pose_des, kinematics_info);
-    ROS_INFO("Iteration %d: cost = %f", i, cost);
-    pose = kinematics_info.link_frames_.back();
-    error = KDL::diff(pose_des, pose);
-    ROS_INFO("Position error = %f, %f, %f", error.vel.data[0], error.vel.data[1], error.vel.data[2]);
-
     gaussian.setMeanAndCovariance(joint_angles.data, covariance);
 
-    for (int j=0; j<num_samples_per_iteration_; ++j)
-    {
-      // add noise and clip
-      gaussian.sample(samples[j].joint_angles.data);
-      for (int k=0; k<chain_.num_joints_; ++k)
-      {
-        if (samples[j].joint_angles(k) > chain_.joints_[k]->limits->upper)
-          samples[j].joint_angles(k) = chain_.joints_[k]->limits->upper;
-        if (samples[j].joint_angles(k) < chain_.joints_[k]->limits->lower)
-          samples[j].joint_angles(k) = chain_.joints_[k]->limits->lower;
-      }
+    // add noise and clip
+    gaussian.sampleColumns(samples);
+    samples = samples.cwiseMax(joint_lower_limits_.replicate(1, num_samples))
+                     .cwiseMin(joint_upper_limits_.replicate(1, num_samples));
 
-      // compute cost
-      samples[j].cost = computeCost(samples[j].joint_angles, pose_des, kinematics_info);
+    // compute costs
+#pragma omp parallel for schedule(dynamic)
+    for (int j=0; j<num_samples; ++j)
+    {
+      int thread_id = omp_get_thread_num();
+      sample_joint_angles_[thread_id].data = samples.col(j);
+      costs(j) = computeCost(sample_joint_angles_[thread_id], pose_des, *fk_solvers_[thread_id], kinematics_infos_[thread_id]);
     }
 
     // map costs to probabilities
-    double max_cost = -std::numeric_limits<double>::max();
-    double min_cost = std::numeric_limits<double>::max();
-    for (int j=0; j<num_samples_per_iteration_; ++j)
-    {
-      if (samples[j].cost > max_cost)
-        max_cost = samples[j].cost;
-      if (samples[j].cost < min_cost)
-        min_cost = samples[j].cost;
-    }
-    double p_sum = 0.0;
-    for (int j=0; j<num_samples_per_iteration_; ++j)
-    {
-      samples[j].probability = exp(-cost_to_probability_h_ * (samples[j].cost - min_cost)/(max_cost - min_cost));
-      p_sum += samples[j].probability;
-    }
+    double min_cost = costs.minCoeff();
+    double cost_range = costs.maxCoeff() - min_cost;
+    if (cost_range < 1e-10)
+      cost_range = 1e-10;
+    probabilities = (-cost_to_probability_h_ / cost_range * (costs.array() - min_cost)).exp();
+    double p_sum = probabilities.sum();
     if (p_sum < 1e-10)
       p_sum = 1e-10; // hacky divide by zero protection
-    for (int j=0; j<num_samples_per_iteration_; ++j)
-      samples[j].probability/=p_sum;
+    probabilities /= p_sum;
 
     // update solution
-    joint_angles.data = Eigen::VectorXd::Zero(chain_.num_joints_);
-    covariance = Eigen::MatrixXd::Zero(chain_.num_joints_, chain_.num_joints_);
-    for (int j=0; j<num_samples_per_iteration_; ++j)
-    {
-      joint_angles.data += samples[j].probability * samples[j].joint_angles.data;
-      diff = samples[j].joint_angles.data - prev_mean;
-      covariance += samples[j].probability * (diff * diff.transpose());
-    }
+    joint_angles.data = samples * probabilities;
+    centered_samples = samples.colwise() - prev_mean;
+    covariance = centered_samples * probabilities.asDiagonal() * centered_samples.transpose();
 
-    //for (int k=0; k<chain_.num_joints_; k++)
+    //for (int k=0; k<num_joints; k++)
     //  covariance(k,k) += 1e-2;
 
+    double step = (joint_angles.data - prev_mean).norm();
     prev_mean = joint_angles.data;
 
+    if (convergence_tolerance_ > 0.0 && step < convergence_tolerance_)
+    {
+      ROS_DEBUG("Converged after %d iterations, step = %f", i+1, step);
+      break;
+    }
+    if (convergence_cost_ > 0.0)
+    {
+      double cost = computeCost(joint_angles, pose_des, *fk_solvers_[0], kinematics_infos_[0]);
+      ROS_DEBUG("Iteration %d: cost = %f", i, cost);
+      if (cost < convergence_cost_)
+      {
+        ROS_DEBUG("Converged after %d iterations, cost = %f", i+1, cost);
+        break;
+      }
+    }
   }
   q_out = joint_angles;
   return true;
 }
 
-double StochasticIKSolver::computeCost(const KDL::JntArray& q_in, const KDL::Frame& pose_des, KinematicsInfo& kinematics_info)
+double StochasticIKSolver::computeCost(const KDL::JntArray& q_in, const KDL::Frame& pose_des,
+                                       const FKSolver& fk_solver, KinematicsInfo& kinematics_info) const
 {
   double cost = 0.0;
-  chain_.fk_solver_->solve(q_in, kinematics_info);
+  fk_solver.solve(q_in, kinematics_info);
   KDL::Frame pose = kinematics_info.link_frames_.back();
   KDL::Twist error = diff(pose_des, pose);
   cost = position_cost_weight_ * dot(error.vel, error.vel);
@@ -139,6 +149,8 @@ void StochasticIKSolver::readParams()
   ROS_VERIFY(usc_utilities::read(node_handle_, "cost_to_probability_h", cost_to_probability_h_));
   ROS_VERIFY(usc_utilities::read(node_handle_, "position_cost_weight", position_cost_weight_));
   ROS_VERIFY(usc_utilities::read(node_handle_, "orientation_cost_weight", orientation_cost_weight_));
+  node_handle_.param("convergence_tolerance", convergence_tolerance_, 0.0);
+  node_handle_.param("convergence_cost", convergence_cost_, 0.0);
 }
 
 }
@@ -24,6 +24,16 @@ public:
                            bool compute_gradient, Eigen::VectorXd& gradient, bool& state_validity,
                            std::vector<double>& weighted_feature_values) = 0;
 
+  /**
+   * Evaluates a batch of inputs: values has one entry per input, gradients (num_inputs x num_dimensions)
+   * and weighted_feature_values (num_inputs x num_feature_values) one row per input. The outputs are
+   * only reallocated if their size changes. The default implementation calls getValueAndGradient()
+   * for every input.
+   */
+  virtual void getValuesAndGradients(const std::vector<boost::shared_ptr<Input const> >& inputs, Eigen::VectorXd& values,
+                                     bool compute_gradients, Eigen::MatrixXd& gradients,
+                                     std::vector<bool>& state_validities, Eigen::MatrixXd& weighted_feature_values);
+
   virtual boost::shared_ptr<CostFunction> clone() = 0;
 
 };
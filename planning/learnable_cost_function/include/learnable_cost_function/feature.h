@@ -32,6 +32,18 @@ public:
   virtual int getNumValues() const = 0;
   virtual void computeValuesAndGradients(boost::shared_ptr<Input const> input, std::vector<double>& feature_values,
                                          bool compute_gradients, std::vector<Eigen::VectorXd>& gradients, bool& state_validity) = 0;
+
+  /**
+   * Evaluates a batch of inputs, e.g. the time steps of a trajectory or a set of IK samples.
+   * feature_values is num_inputs x num_values, gradients holds one num_inputs x num_dimensions matrix
+   * per feature value. The outputs are only reallocated if their size changes, so they can be reused
+   * across calls. The default implementation calls computeValuesAndGradients() for every input,
+   * features that can vectorize their computation should override it.
+   */
+  virtual void computeValuesAndGradientsBatch(const std::vector<boost::shared_ptr<Input const> >& inputs,
+                                              Eigen::MatrixXd& feature_values, bool compute_gradients,
+                                              std::vector<Eigen::MatrixXd>& gradients,
+                                              std::vector<bool>& state_validities);
   virtual std::string getName() const = 0;
   virtual boost::shared_ptr<Feature> clone() const = 0;
 
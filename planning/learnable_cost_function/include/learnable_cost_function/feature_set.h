@@ -20,6 +20,11 @@ struct FeatureInfo
   std::vector<double> weights;
   std::vector<double> values;
   std::vector<Eigen::VectorXd> gradients;
+
+  // scratch space for batch evaluation
+  Eigen::MatrixXd batch_values;
+  std::vector<Eigen::MatrixXd> batch_gradients;
+  std::vector<bool> batch_validities;
 };
 
 class FeatureSet: public Feature
@@ -32,6 +37,10 @@ public:
   virtual int getNumValues() const;
   virtual void computeValuesAndGradients(boost::shared_ptr<Input const> input, std::vector<double>& feature_values,
                                          bool compute_gradients, std::vector<Eigen::VectorXd>& gradients, bool& state_validity);
+  virtual void computeValuesAndGradientsBatch(const std::vector<boost::shared_ptr<Input const> >& inputs,
+                                              Eigen::MatrixXd& feature_values, bool compute_gradients,
+                                              std::vector<Eigen::MatrixXd>& gradients,
+                                              std::vector<bool>& state_validities);
   virtual std::string getName() const;
   virtual boost::shared_ptr<Feature> clone() const;
 
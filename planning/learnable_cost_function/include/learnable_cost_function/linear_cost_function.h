@@ -29,6 +29,10 @@ public:
                            bool compute_gradient, Eigen::VectorXd& gradient, bool& state_validity,
                            std::vector<double>& weighted_feature_values);
 
+  virtual void getValuesAndGradients(const std::vector<boost::shared_ptr<Input const> >& inputs, Eigen::VectorXd& values,
+                                     bool compute_gradients, Eigen::MatrixXd& gradients,
+                                     std::vector<bool>& state_validities, Eigen::MatrixXd& weighted_feature_values);
+
   void clear();
   void addFeaturesAndWeights(std::vector<boost::shared_ptr<Feature> > features,
                              std::vector<double> weights);
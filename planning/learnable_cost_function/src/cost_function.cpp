@@ -0,0 +1,49 @@
+/*
+ * cost_function.cpp
+ *
+ *  Default batch evaluation for cost functions that only implement the single input version
+ */
+
+#include <learnable_cost_function/cost_function.h>
+
+namespace learnable_cost_function
+{
+
+void CostFunction::getValuesAndGradients(const std::vector<boost::shared_ptr<Input const> >& inputs, Eigen::VectorXd& values,
+                                         bool compute_gradients, Eigen::MatrixXd& gradients,
+                                         std::vector<bool>& state_validities, Eigen::MatrixXd& weighted_feature_values)
+{
+  int num_inputs = inputs.size();
+  values.resize(num_inputs);
+  state_validities.resize(num_inputs);
+  if (num_inputs == 0)
+  {
+    // the number of feature values and input dimensions is only known from an evaluation
+    weighted_feature_values.resize(0, 0);
+    if (compute_gradients)
+      gradients.resize(0, 0);
+    return;
+  }
+
+  // scratch space, shared by all inputs of the batch
+  Eigen::VectorXd gradient;
+  std::vector<double> input_weighted_feature_values;
+  for (int n=0; n<num_inputs; ++n)
+  {
+    bool validity;
+    getValueAndGradient(inputs[n], values(n), compute_gradients, gradient, validity, input_weighted_feature_values);
+    state_validities[n] = validity;
+    if (n == 0)
+    {
+      weighted_feature_values.resize(num_inputs, input_weighted_feature_values.size());
+      if (compute_gradients)
+        gradients.resize(num_inputs, gradient.size());
+    }
+    for (unsigned int j=0; j<input_weighted_feature_values.size(); ++j)
+      weighted_feature_values(n, j) = input_weighted_feature_values[j];
+    if (compute_gradients)
+      gradients.row(n) = gradient.transpose();
+  }
+}
+
+}
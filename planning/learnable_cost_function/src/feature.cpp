@@ -0,0 +1,50 @@
+/*
+ * feature.cpp
+ *
+ *  Default batch evaluation for features that only implement the single input version
+ */
+
+#include <learnable_cost_function/feature.h>
+
+namespace learnable_cost_function
+{
+
+void Feature::computeValuesAndGradientsBatch(const std::vector<boost::shared_ptr<Input const> >& inputs,
+                                             Eigen::MatrixXd& feature_values, bool compute_gradients,
+                                             std::vector<Eigen::MatrixXd>& gradients,
+                                             std::vector<bool>& state_validities)
+{
+  int num_inputs = inputs.size();
+  int num_values = getNumValues();
+  feature_values.resize(num_inputs, num_values);
+  state_validities.resize(num_inputs);
+
+  if (compute_gradients)
+  {
+    int num_dimensions = (num_inputs > 0) ? inputs[0]->getNumDimensions() : 0;
+    if ((int)gradients.size() != num_values)
+      gradients.resize(num_values);
+    for (int j=0; j<num_values; ++j)
+      gradients[j].resize(num_inputs, num_dimensions);
+  }
+  if (num_inputs == 0)
+    return;
+
+  // scratch space, shared by all inputs of the batch
+  std::vector<double> values(num_values);
+  std::vector<Eigen::VectorXd> value_gradients(num_values);
+  for (int n=0; n<num_inputs; ++n)
+  {
+    bool validity;
+    computeValuesAndGradients(inputs[n], values, compute_gradients, value_gradients, validity);
+    state_validities[n] = validity;
+    for (int j=0; j<num_values; ++j)
+    {
+      feature_values(n, j) = values[j];
+      if (compute_gradients)
+        gradients[j].row(n) = value_gradients[j].transpose();
+    }
+  }
+}
+
+}
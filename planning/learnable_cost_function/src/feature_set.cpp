@@ -67,6 +67,40 @@ void FeatureSet::computeValuesAndGradients(boost::shared_ptr<Input const> input,
 
 }
 
+void FeatureSet::computeValuesAndGradientsBatch(const std::vector<boost::shared_ptr<Input const> >& inputs,
+                                                Eigen::MatrixXd& feature_values, bool compute_gradients,
+                                                std::vector<Eigen::MatrixXd>& gradients,
+                                                std::vector<bool>& state_validities)
+{
+  int num_inputs = inputs.size();
+  feature_values.resize(num_inputs, num_values_);
+  if (compute_gradients && (int)gradients.size() != num_values_)
+    gradients.resize(num_values_);
+  state_validities.assign(num_inputs, true);
+
+  int index = 0;
+  for (unsigned int i=0; i<features_.size(); ++i)
+  {
+    FeatureInfo& fi = features_[i];
+    fi.feature->computeValuesAndGradientsBatch(inputs, fi.batch_values, compute_gradients,
+                                               fi.batch_gradients, fi.batch_validities);
+    for (int n=0; n<num_inputs; ++n)
+    {
+      if (!fi.batch_validities[n])
+        state_validities[n] = false;
+    }
+    feature_values.middleCols(index, fi.num_values) = fi.batch_values;
+    if (compute_gradients)
+    {
+      for (int j=0; j<fi.num_values; ++j)
+      {
+        gradients[index + j] = fi.batch_gradients[j];
+      }
+    }
+    index += fi.num_values;
+  }
+}
+
 std::string FeatureSet::getName() const
 {
   return "FeatureSet";
@@ -13,6 +13,7 @@ namespace learnable_cost_function
 
 LinearCostFunction::LinearCostFunction()
 {
+  clear();
 }
 
 LinearCostFunction::~LinearCostFunction()
@@ -25,7 +26,7 @@ void LinearCostFunction::getValueAndGradient(boost::shared_ptr<Input const> inpu
 {
   value = 0.0;
   int num_input_dimensions = input->getNumDimensions();
-  gradient = Eigen::VectorXd::Zero(num_input_dimensions);
+  gradient.setZero(num_input_dimensions);
   state_validity = true;
   weighted_feature_values.resize(num_feature_values_);
   int counter = 0;
@@ -53,6 +54,43 @@ void LinearCostFunction::getValueAndGradient(boost::shared_ptr<Input const> inpu
   }
 }
 
+void LinearCostFunction::getValuesAndGradients(const std::vector<boost::shared_ptr<Input const> >& inputs,
+                                               Eigen::VectorXd& values, bool compute_gradients, Eigen::MatrixXd& gradients,
+                                               std::vector<bool>& state_validities, Eigen::MatrixXd& weighted_feature_values)
+{
+  int num_inputs = inputs.size();
+  state_validities.assign(num_inputs, true);
+  weighted_feature_values.resize(num_inputs, num_feature_values_);
+  if (compute_gradients)
+  {
+    int num_input_dimensions = (num_inputs > 0) ? inputs[0]->getNumDimensions() : 0;
+    gradients.setZero(num_inputs, num_input_dimensions);
+  }
+
+  int counter = 0;
+  for (unsigned int i=0; i<features_.size(); ++i)
+  {
+    FeatureInfo& fi = features_[i];
+    fi.feature->computeValuesAndGradientsBatch(inputs, fi.batch_values, compute_gradients,
+                                               fi.batch_gradients, fi.batch_validities);
+    for (int n=0; n<num_inputs; ++n)
+    {
+      if (!fi.batch_validities[n])
+        state_validities[n] = false;
+    }
+    for (int j=0; j<fi.num_values; ++j)
+    {
+      weighted_feature_values.col(counter) = fi.weights[j] * fi.batch_values.col(j);
+      if (compute_gradients)
+      {
+        gradients += fi.weights[j] * fi.batch_gradients[j];
+      }
+      ++counter;
+    }
+  }
+  values = weighted_feature_values.rowwise().sum();
+}
+
 void LinearCostFunction::clear()
 {
   features_.clear();
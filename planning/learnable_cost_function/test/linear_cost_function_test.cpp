@@ -0,0 +1,203 @@
+/*
+ * linear_cost_function_test.cpp
+ *
+ *  Compares the batch evaluation of LinearCostFunction with evaluating every input on its own
+ */
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <learnable_cost_function/linear_cost_function.h>
+
+using namespace learnable_cost_function;
+
+namespace
+{
+
+const int NUM_DIMENSIONS = 7;
+const int NUM_INPUTS = 50;
+
+class TestInput: public Input
+{
+public:
+  Eigen::VectorXd q;
+  int getNumDimensions() const { return q.size(); }
+};
+
+// num_values sinusoids of the sum of the input, invalid if the first dimension is below -0.5
+class TestFeature: public Feature
+{
+public:
+  TestFeature(int num_values): num_values_(num_values) {}
+
+  bool initialize(XmlRpc::XmlRpcValue& config) { return true; }
+  int getNumValues() const { return num_values_; }
+
+  void computeValuesAndGradients(boost::shared_ptr<Input const> input, std::vector<double>& feature_values,
+                                 bool compute_gradients, std::vector<Eigen::VectorXd>& gradients, bool& state_validity)
+  {
+    const TestInput& test_input = static_cast<const TestInput&>(*input);
+    const double sum = test_input.q.sum();
+    feature_values.resize(num_values_);
+    if (compute_gradients)
+      gradients.resize(num_values_);
+    for (int j=0; j<num_values_; ++j)
+    {
+      feature_values[j] = sin((j+1) * sum);
+      if (compute_gradients)
+        gradients[j] = Eigen::VectorXd::Constant(test_input.q.size(), (j+1) * cos((j+1) * sum));
+    }
+    state_validity = test_input.q(0) > -0.5;
+  }
+
+  std::string getName() const { return "TestFeature"; }
+  boost::shared_ptr<Feature> clone() const { return boost::shared_ptr<Feature>(new TestFeature(num_values_)); }
+
+private:
+  int num_values_;
+};
+
+class LinearCostFunctionTest: public testing::Test
+{
+protected:
+  virtual void SetUp()
+  {
+    // a feature set and a plain feature, 6 feature values in total
+    boost::shared_ptr<FeatureSet> feature_set(new FeatureSet());
+    feature_set->addFeature(boost::shared_ptr<Feature>(new TestFeature(2)));
+    feature_set->addFeature(boost::shared_ptr<Feature>(new TestFeature(1)));
+    std::vector<boost::shared_ptr<Feature> > features;
+    features.push_back(feature_set);
+    features.push_back(boost::shared_ptr<Feature>(new TestFeature(3)));
+    std::vector<double> weights;
+    for (int i=0; i<6; ++i)
+      weights.push_back(0.5 + i);
+    cost_function_.addFeaturesAndWeights(features, weights);
+
+    srand(0);
+    for (int n=0; n<NUM_INPUTS; ++n)
+    {
+      boost::shared_ptr<TestInput> input(new TestInput());
+      input->q = Eigen::VectorXd::Random(NUM_DIMENSIONS);
+      inputs_.push_back(input);
+    }
+  }
+
+  void expectMatchesSingleEvaluation(bool compute_gradients, const Eigen::VectorXd& values, const Eigen::MatrixXd& gradients,
+                                     const std::vector<bool>& state_validities, const Eigen::MatrixXd& weighted_feature_values)
+  {
+    ASSERT_EQ(NUM_INPUTS, values.size());
+    ASSERT_EQ(NUM_INPUTS, (int)state_validities.size());
+    ASSERT_EQ(NUM_INPUTS, weighted_feature_values.rows());
+    ASSERT_EQ(6, weighted_feature_values.cols());
+    if (compute_gradients)
+    {
+      ASSERT_EQ(NUM_INPUTS, gradients.rows());
+      ASSERT_EQ(NUM_DIMENSIONS, gradients.cols());
+    }
+
+    int num_invalid = 0;
+    for (int n=0; n<NUM_INPUTS; ++n)
+    {
+      double value;
+      Eigen::VectorXd gradient;
+      bool state_validity;
+      std::vector<double> input_weighted_feature_values;
+      cost_function_.getValueAndGradient(inputs_[n], value, compute_gradients, gradient, state_validity,
+                                         input_weighted_feature_values);
+      EXPECT_NEAR(value, values(n), 1e-12);
+      EXPECT_EQ(state_validity, state_validities[n]);
+      for (int j=0; j<6; ++j)
+        EXPECT_NEAR(input_weighted_feature_values[j], weighted_feature_values(n, j), 1e-12);
+      if (compute_gradients)
+      {
+        for (int i=0; i<NUM_DIMENSIONS; ++i)
+          EXPECT_NEAR(gradient(i), gradients(n, i), 1e-12);
+      }
+      if (!state_validity)
+        ++num_invalid;
+    }
+    // both valid and invalid inputs are covered
+    EXPECT_GT(num_invalid, 0);
+    EXPECT_LT(num_invalid, NUM_INPUTS);
+  }
+
+  LinearCostFunction cost_function_;
+  std::vector<boost::shared_ptr<Input const> > inputs_;
+};
+
+}
+
+TEST_F(LinearCostFunctionTest, batchMatchesSingleEvaluation)
+{
+  Eigen::VectorXd values;
+  Eigen::MatrixXd gradients, weighted_feature_values;
+  std::vector<bool> state_validities;
+
+  // the second evaluation reuses the outputs and the scratch space of the features
+  for (int repetition=0; repetition<2; ++repetition)
+  {
+    cost_function_.getValuesAndGradients(inputs_, values, true, gradients, state_validities, weighted_feature_values);
+    expectMatchesSingleEvaluation(true, values, gradients, state_validities, weighted_feature_values);
+  }
+}
+
+TEST_F(LinearCostFunctionTest, batchWithoutGradients)
+{
+  Eigen::VectorXd values;
+  Eigen::MatrixXd gradients, weighted_feature_values;
+  std::vector<bool> state_validities;
+
+  cost_function_.getValuesAndGradients(inputs_, values, false, gradients, state_validities, weighted_feature_values);
+  expectMatchesSingleEvaluation(false, values, gradients, state_validities, weighted_feature_values);
+
+  // after an evaluation with gradients
+  cost_function_.getValuesAndGradients(inputs_, values, true, gradients, state_validities, weighted_feature_values);
+  cost_function_.getValuesAndGradients(inputs_, values, false, gradients, state_validities, weighted_feature_values);
+  expectMatchesSingleEvaluation(false, values, gradients, state_validities, weighted_feature_values);
+}
+
+TEST_F(LinearCostFunctionTest, defaultBatchMatchesSingleEvaluation)
+{
+  Eigen::VectorXd values;
+  Eigen::MatrixXd gradients, weighted_feature_values;
+  std::vector<bool> state_validities;
+
+  cost_function_.CostFunction::getValuesAndGradients(inputs_, values, true, gradients, state_validities,
+                                                     weighted_feature_values);
+  expectMatchesSingleEvaluation(true, values, gradients, state_validities, weighted_feature_values);
+  cost_function_.CostFunction::getValuesAndGradients(inputs_, values, false, gradients, state_validities,
+                                                     weighted_feature_values);
+  expectMatchesSingleEvaluation(false, values, gradients, state_validities, weighted_feature_values);
+}
+
+TEST_F(LinearCostFunctionTest, emptyBatch)
+{
+  std::vector<boost::shared_ptr<Input const> > no_inputs;
+  Eigen::VectorXd values = Eigen::VectorXd::Ones(3);
+  Eigen::MatrixXd gradients = Eigen::MatrixXd::Ones(3, 3);
+  Eigen::MatrixXd weighted_feature_values = Eigen::MatrixXd::Ones(3, 3);
+  std::vector<bool> state_validities(3, true);
+
+  cost_function_.getValuesAndGradients(no_inputs, values, true, gradients, state_validities, weighted_feature_values);
+  EXPECT_EQ(0, values.size());
+  EXPECT_EQ(0, gradients.rows());
+  EXPECT_EQ(0, weighted_feature_values.rows());
+  EXPECT_TRUE(state_validities.empty());
+
+  values = Eigen::VectorXd::Ones(3);
+  gradients = Eigen::MatrixXd::Ones(3, 3);
+  weighted_feature_values = Eigen::MatrixXd::Ones(3, 3);
+  state_validities.assign(3, true);
+  cost_function_.CostFunction::getValuesAndGradients(no_inputs, values, true, gradients, state_validities,
+                                                     weighted_feature_values);
+  EXPECT_EQ(0, values.size());
+  EXPECT_EQ(0, gradients.rows());
+  EXPECT_EQ(0, weighted_feature_values.rows());
+  EXPECT_TRUE(state_validities.empty());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+/*
+ * quintic_chunk_solver.h
+ *
+ *  Cached solver for the chunk QP of the QuinticOptimizedSplineSmoother
+ */
+
+#ifndef QUINTIC_CHUNK_SOLVER_H_
+#define QUINTIC_CHUNK_SOLVER_H_
+
+#include <quadprog/QuadProg++.hh>
+#include <Eigen/Core>
+#include <vector>
+
+namespace qp_spline_smoother
+{
+
+/**
+ * Cached solver for the quadratic program of one chunk of the QuinticOptimizedSplineSmoother.
+ *
+ * The chunk QP only has equality constraints, so its solution is a linear function of the
+ * position differences and the boundary velocities and accelerations. The cost and constraint
+ * matrices only depend on the time steps of the chunk. initialize() factorizes the KKT system
+ * once and stores the linear map to the interior velocities and accelerations. solve() is then a
+ * matrix-vector product, which can be reused for every joint and for every chunk with the same
+ * time steps (e.g. all chunks of a uniformly sampled trajectory).
+ */
+class QuinticChunkSolver
+{
+public:
+  QuinticChunkSolver();
+  virtual ~QuinticChunkSolver();
+
+  /**
+   * Factorizes the chunk QP for the given time stamps
+   * @param t time stamps of the chunk, relative to the first point
+   * @param length number of points in the chunk (at least 3)
+   * @param velocity_cost, acceleration_cost, jerk_cost weights of the cost function
+   * @return false if the time steps are not positive or the KKT system is (numerically) singular
+   */
+  bool initialize(const double* t, int length, double velocity_cost, double acceleration_cost, double jerk_cost);
+
+  /**
+   * @return true if the solver has been initialized for a chunk with the same time steps
+   */
+  bool matches(const double* t, int length) const;
+
+  /**
+   * Same semantics as QuinticOptimizedSplineSmoother::optimize(): fills in the interior velocities
+   * and accelerations, the boundary ones are kept. Does not modify the solver, so it can be called
+   * from several threads at once.
+   */
+  void solve(const double* x, double* xd, double* xdd) const;
+
+  bool isInitialized() const {return initialized_;};
+  int getLength() const {return length_;};
+
+  /**
+   * Fills the quadratic cost matrix, the variables are [a b c d e] for each spline segment
+   * where x = at^5 + bt^4 + ct^3 + dt^2 + et + f
+   */
+  static void buildQuadraticCost(const double* t, int length, double velocity_cost, double acceleration_cost,
+                                 double jerk_cost, QuadProgPP::Matrix<double>& quad_cost);
+
+  /**
+   * Fills the equality constraint matrix (position, velocity and acceleration continuity between
+   * the segments, plus the boundary velocities and accelerations) in QuadProg++ form CE^T x + ce0 = 0
+   */
+  static void buildEqualities(const double* t, int length, QuadProgPP::Matrix<double>& equalities);
+
+  /**
+   * Fills ce0 of the equality constraints from the positions and the boundary conditions
+   */
+  static void buildEqualityConstants(const double* x, const double* xd, const double* xdd, int length,
+                                     QuadProgPP::Vector<double>& eq_const);
+
+  static int getNumVariables(int length) {return (length - 1) * 5;};
+  static int getNumEqualities(int length) {return (length - 1) * 3 + 2;};
+
+private:
+  bool initialized_;
+  int length_;
+  std::vector<double> dt_;
+
+  /** maps the position differences x[i+1]-x[i] to the interior [xd_1 xdd_1 xd_2 xdd_2 ...] */
+  Eigen::MatrixXd position_map_;
+  /** maps [xd_0 xdd_0 xd_end xdd_end] to the interior [xd_1 xdd_1 xd_2 xdd_2 ...] */
+  Eigen::MatrixXd boundary_map_;
+};
+
+}
+
+#endif /* QUINTIC_CHUNK_SOLVER_H_ */
@@ -11,6 +11,7 @@
 #include <spline_smoother/spline_smoother.h>
 #include <spline_smoother/spline_smoother_utils.h>
 #include <quadprog/QuadProg++.hh>
+#include <qp_spline_smoother/quintic_chunk_solver.h>
 #include <rosbag/bag.h>
 #include <sstream>
 
@@ -41,7 +42,15 @@ private:
   double min_dt_;
   bool logging_;
 
+  /** solve the chunks with a QuinticChunkSolver that is shared by all joints and reused
+   *  across chunks with the same time steps, instead of one QuadProg++ solve per chunk and joint */
+  bool cache_qp_;
+
   bool optimize(const double *x, double *xd, double *xdd, double *t, int length) const;
+  bool optimizeCached(T& trajectory) const;
+  bool getChunk(int last_valid, int size, int& start_point, int& end_point) const;
+  void blendChunk(T& trajectory, int joint, int start_point, int end_point, int last_valid,
+                  const double* xd, const double* xdd) const;
   bool numericalDifferentiation(T& trajectory) const;
   double weightedAvg(double w1, double v1, double w2, double v2) const;
 
@@ -58,6 +67,7 @@ QuinticOptimizedSplineSmoother<T>::QuinticOptimizedSplineSmoother()
   cost_function_weights_[MIN_JERK]=0.0;
   chunk_size_=10;
   min_dt_ = 0.01;
+  cache_qp_ = false;
 }
 
 template<typename T>
@@ -83,11 +93,16 @@ bool QuinticOptimizedSplineSmoother<T>::configure()
   {
     logging_ = filters::FilterBase<T>::params_["logging"];
   }
+  if (filters::FilterBase<T>::params_.find("cache_qp") != filters::FilterBase<T>::params_.end())
+  {
+    cache_qp_ = filters::FilterBase<T>::params_["cache_qp"];
+  }
   ROS_DEBUG("velocity cost = %f", cost_function_weights_[MIN_VEL]);
   ROS_DEBUG("acceleration cost = %f", cost_function_weights_[MIN_ACC]);
   ROS_DEBUG("jerk cost = %f", cost_function_weights_[MIN_JERK]);
   ROS_DEBUG("chunk size = %d", chunk_size_);
   ROS_DEBUG("min_dt = %f", min_dt_);
+  ROS_DEBUG("cache qp = %d", cache_qp_);
   
   for (int i=0; i<NUM_WEIGHTS; ++i)
   {
@@ -186,7 +201,11 @@ bool QuinticOptimizedSplineSmoother<T>::smooth(const T& trajectory_in, T& trajec
   // initialize with numerical differentiation
   numericalDifferentiation(trajectory_out);
 
-  if (size>=3)
+  if (size>=3 && cache_qp_)
+  {
+    qp_success = optimizeCached(trajectory_out);
+  }
+  else if (size>=3)
   {
     // optimize in chunks
 #pragma omp parallel for
@@ -200,26 +219,13 @@ bool QuinticOptimizedSplineSmoother<T>::smooth(const T& trajectory_in, T& trajec
 
       do
       {
-        int start_point = last_valid - chunk_size_/2;
-        if (start_point < 0)
-          start_point = 0;
-        int end_point = start_point + chunk_size_ - 1;
-        if (end_point > size-1)
-          end_point = size-1;
-
-        int num_points = end_point - start_point + 1;
-        if (num_points < 3)
+        int start_point, end_point;
+        if (!getChunk(last_valid, size, start_point, end_point))
         {
-          int diff = 3 - num_points;
-          start_point -= diff;
-          num_points +=diff;
-          if (start_point < 0)
-          {
-            ROS_ERROR("QuinticOptimized: Strange condition occurred that should never happen!");
-            qp_success = false;
-            break;
-          }
+          qp_success = false;
+          break;
         }
+        int num_points = end_point - start_point + 1;
 
         //ROS_INFO("Chunk = %d to %d", start_point, end_point);
 
@@ -235,22 +241,7 @@ bool QuinticOptimizedSplineSmoother<T>::smooth(const T& trajectory_in, T& trajec
         if (!optimize(x, xd, xdd, t, num_points))
           qp_success = false;
         else
-        {
-          for (int i=start_point; i<=end_point; ++i)
-          {
-            double w1=0.0, w2=1.0;
-            if (i<last_valid)
-            {
-              w1 = last_valid-i;
-              w2 = (last_valid-start_point)-w1;
-            }
-            //ROS_INFO("%i - w1=%f, w2=%f", i, w1, w2);
-            trajectory_out.request.trajectory.points[i].velocities[j] =
-                weightedAvg(w1, trajectory_out.request.trajectory.points[i].velocities[j], w2, xd[i-start_point]);
-            trajectory_out.request.trajectory.points[i].accelerations[j] =
-                weightedAvg(w1, trajectory_out.request.trajectory.points[i].accelerations[j], w2, xdd[i-start_point]);
-          }
-        }
+          blendChunk(trajectory_out, j, start_point, end_point, last_valid, xd, xdd);
 
         last_valid = end_point;
 
@@ -274,211 +265,135 @@ bool QuinticOptimizedSplineSmoother<T>::smooth(const T& trajectory_in, T& trajec
 }
 
 template<typename T>
-bool QuinticOptimizedSplineSmoother<T>::optimize(const double *x, double *xd, double *xdd, double *t, int length) const
+bool QuinticOptimizedSplineSmoother<T>::getChunk(int last_valid, int size, int& start_point, int& end_point) const
 {
-   int numSegments = length - 1;
-  int numVars = numSegments * 5;
-  int numEqual = numSegments * 3 + 2;
-  int numInEqual = 0;
-
-  QuadProgPP::Vector<double> vars(numVars);
-  QuadProgPP::Matrix<double> quadCost(numVars, numVars);
-  QuadProgPP::Vector<double> linearCost(numVars);
-  QuadProgPP::Matrix<double> inequalities(numVars, numInEqual);
-  QuadProgPP::Vector<double> ineqConst(numInEqual);
-  QuadProgPP::Matrix<double> equalities(numVars, numEqual);
-  QuadProgPP::Vector<double> eqConst(numEqual);
-
-  // dt and powers of dt
-  QuadProgPP::Matrix<double> dt(numSegments,10);
-  double dx[numSegments];
-
-  for (int i = 0; i < length - 1; i++)
+  start_point = last_valid - chunk_size_/2;
+  if (start_point < 0)
+    start_point = 0;
+  end_point = start_point + chunk_size_ - 1;
+  if (end_point > size-1)
+    end_point = size-1;
+
+  int num_points = end_point - start_point + 1;
+  if (num_points < 3)
   {
-    dt[i][1] = t[i + 1] - t[i];
-    dx[i] = x[i + 1] - x[i];
-    for (int j = 2; j <= 9; j++)
+    int diff = 3 - num_points;
+    start_point -= diff;
+    if (start_point < 0)
     {
-      dt[i][j] = dt[i][j - 1] * dt[i][1];
+      ROS_ERROR("QuinticOptimized: Strange condition occurred that should never happen!");
+      return false;
     }
   }
+  return true;
+}
 
-  // the variables are arranged as [a b c d e] for each spline segment,
-  // where the spline is x = at^5 + bt^4 + ct^3 + dt^2 + et + f
-  // the f can be determined without optimization for each segment (f = x_0)
-
-
-  // zero the quadratic cost matrix and linear cost vector:
-  for (int i = 0; i < numVars; i++)
+template<typename T>
+void QuinticOptimizedSplineSmoother<T>::blendChunk(T& trajectory, int joint, int start_point, int end_point, int last_valid,
+                                                   const double* xd, const double* xdd) const
+{
+  for (int i=start_point; i<=end_point; ++i)
   {
-    for (int j = 0; j < numVars; j++)
+    double w1=0.0, w2=1.0;
+    if (i<last_valid)
     {
-      quadCost[i][j] = 0.0;
+      w1 = last_valid-i;
+      w2 = (last_valid-start_point)-w1;
     }
-    linearCost[i] = 0.0;
+    //ROS_INFO("%i - w1=%f, w2=%f", i, w1, w2);
+    trajectory.request.trajectory.points[i].velocities[joint] =
+        weightedAvg(w1, trajectory.request.trajectory.points[i].velocities[joint], w2, xd[i-start_point]);
+    trajectory.request.trajectory.points[i].accelerations[joint] =
+        weightedAvg(w1, trajectory.request.trajectory.points[i].accelerations[joint], w2, xdd[i-start_point]);
   }
+}
 
-  // construct the quadratic cost matrix:
+template<typename T>
+bool QuinticOptimizedSplineSmoother<T>::optimizeCached(T& trajectory) const
+{
+  int size = trajectory.request.trajectory.points.size();
+  int num_traj = trajectory.request.trajectory.joint_names.size();
 
-  if (cost_function_weights_[MIN_VEL] > 0.0)
-  {
-    double w = cost_function_weights_[MIN_VEL];
-    for (int i = 0; i < numSegments; i++)
-    {
-      int a = i * 5;
-      int b = i * 5 + 1;
-      int c = i * 5 + 2;
-      int d = i * 5 + 3;
-      int e = i * 5 + 4;
-      quadCost[a][a] = (25.0 / 9.0) * dt[i][9] * w;
-      quadCost[a][b] = quadCost[b][a] = (5.0 / 2.0) * dt[i][8] * w;
-      quadCost[a][c] = quadCost[c][a] = ((30.0 / 7.0) / 2.0) * dt[i][7] * w;
-      quadCost[b][b] = (16.0 / 7.0) * dt[i][7] * w;
-      quadCost[a][d] = quadCost[d][a] = ((20.0 / 6.0) / 2.0) * dt[i][6] * w;
-      quadCost[c][b] = quadCost[b][c] = ((24.0 / 6.0) / 2.0) * dt[i][6] * w;
-      quadCost[a][e] = quadCost[e][a] = ((10.0 / 5.0) / 2.0) * dt[i][5] * w;
-      quadCost[b][d] = quadCost[d][b] = ((16.0 / 5.0) / 2.0) * dt[i][5] * w;
-      quadCost[c][c] = (9.0 / 5.0) * dt[i][5] * w;
-      quadCost[b][e] = quadCost[e][b] = ((8.0 / 4.0) / 2.0) * dt[i][4] * w;
-      quadCost[c][d] = quadCost[d][c] = ((12.0 / 4.0) / 2.0) * dt[i][4] * w;
-      quadCost[c][e] = quadCost[e][c] = ((6.0 / 3.0) / 2.0) * dt[i][3] * w;
-      quadCost[d][d] = (4.0 / 3.0) * dt[i][3] * w;
-      quadCost[d][e] = quadCost[e][d] = dt[i][2] * w;
-      quadCost[e][e] = dt[i][1] * w;
-    }
-  }
-  if (cost_function_weights_[MIN_ACC] > 0.0)
+  // all joints share the chunks and their time stamps, so the factorization of a chunk is
+  // computed once and only redone when the time steps change
+  QuinticChunkSolver solver;
+  double t[chunk_size_];
+  int last_valid = 0;
+  int num_factorizations = 0;
+
+  do
   {
-    double w = cost_function_weights_[MIN_ACC];
-    for (int i = 0; i < numSegments; i++)
+    int start_point, end_point;
+    if (!getChunk(last_valid, size, start_point, end_point))
+      return false;
+    int num_points = end_point - start_point + 1;
+
+    for (int i=start_point; i<=end_point; ++i)
     {
-      int a = i * 5;
-      int b = i * 5 + 1;
-      int c = i * 5 + 2;
-      int d = i * 5 + 3;
-      int e = i * 5 + 4;
-      quadCost[a][a] += (400.0 / 7.0) * dt[i][7] * w;
-      quadCost[a][b] += (80.0 / 2.0) * dt[i][6] * w;
-      quadCost[b][a] += (80.0 / 2.0) * dt[i][6] * w;
-      quadCost[b][b] += (144.0 / 5.0) * dt[i][5] * w;
-      quadCost[a][c] += ((240.0 / 5.0) / 2.0) * dt[i][5] * w;
-      quadCost[c][a] += ((240.0 / 5.0) / 2.0) * dt[i][5] * w;
-      quadCost[c][b] += ((144.0 / 4.0) / 2.0) * dt[i][4] * w;
-      quadCost[b][c] += ((144.0 / 4.0) / 2.0) * dt[i][4] * w;
-      quadCost[a][d] += ((80.0 / 4.0) / 2.0) * dt[i][4] * w;
-      quadCost[d][a] += ((80.0 / 4.0) / 2.0) * dt[i][4] * w;
-      quadCost[b][d] += ((48.0 / 3.0) / 2.0) * dt[i][3] * w;
-      quadCost[d][b] += ((48.0 / 3.0) / 2.0) * dt[i][3] * w;
-      quadCost[c][c] += (36.0 / 3.0) * dt[i][3] * w;
-      quadCost[c][d] += ((12.0) / 2.0) * dt[i][2] * w;
-      quadCost[d][c] += ((12.0) / 2.0) * dt[i][2] * w;
-      quadCost[d][d] += (4.0) * dt[i][1] * w;
-      quadCost[e][e] += 10e-10 * w;
+      t[i-start_point] = trajectory.request.trajectory.points[i].time_from_start.toSec() -
+          trajectory.request.trajectory.points[start_point].time_from_start.toSec();
     }
-  }
-  if (cost_function_weights_[MIN_JERK] > 0.0)
-  {
-    double w = cost_function_weights_[MIN_JERK];
-    for (int i = 0; i < numSegments; i++)
+    if (!solver.matches(t, num_points))
     {
-      int a = i * 5;
-      int b = i * 5 + 1;
-      int c = i * 5 + 2;
-      int d = i * 5 + 3;
-      int e = i * 5 + 4;
-      quadCost[a][a] += (720) * dt[i][5] * w;
-      quadCost[a][b] += (720.0 / 2.0) * dt[i][4] * w;
-      quadCost[b][a] += (720.0 / 2.0) * dt[i][4] * w;
-      quadCost[a][c] += ((720.0 / 3.0) / 2.0) * dt[i][3] * w;
-      quadCost[c][a] += ((720.0 / 3.0) / 2.0) * dt[i][3] * w;
-      quadCost[b][b] += (576.0 / 3.0) * dt[i][3] * w;
-      quadCost[c][b] += ((144.0) / 2.0) * dt[i][2] * w;
-      quadCost[b][c] += ((144.0) / 2.0) * dt[i][2] * w;
-      quadCost[c][c] += (36.0) * dt[i][1] * w;
-      quadCost[d][d] += 10e-10 * w;
-      quadCost[e][e] += 10e-10 * w;
+      if (!solver.initialize(t, num_points, cost_function_weights_[MIN_VEL], cost_function_weights_[MIN_ACC],
+                             cost_function_weights_[MIN_JERK]))
+      {
+        ROS_ERROR("QuinticOptimizedSplineSmoother: Quadratic program failed!\n");
+        return false;
+      }
+      ++num_factorizations;
     }
-  }
 
-  // print the quadratic cost matrix:
-  /*printf("Quadcost = \n");
-   for (int i=0; i<numVars; i++)
-   {
-   for (int j=0; j<numVars; j++)
-   {
-   printf("%f\t",quadCost[i][j]);
-   }
-   printf("\n");
-   }*/
-
-  // zero the equalities:
-  for (int i = 0; i < numEqual; i++)
-  {
-    for (int j = 0; j < numVars; j++)
+#pragma omp parallel for
+    for (int j = 0; j < num_traj; ++j)
     {
-      equalities[j][i] = 0.0;
+      double x[chunk_size_];
+      double xd[chunk_size_];
+      double xdd[chunk_size_];
+      for (int i=start_point; i<=end_point; ++i)
+      {
+        x[i-start_point] = trajectory.request.trajectory.points[i].positions[j];
+        xd[i-start_point] = trajectory.request.trajectory.points[i].velocities[j];
+        xdd[i-start_point] = trajectory.request.trajectory.points[i].accelerations[j];
+      }
+      solver.solve(x, xd, xdd);
+      blendChunk(trajectory, j, start_point, end_point, last_valid, xd, xdd);
     }
-    eqConst[i] = 0.0;
+
+    last_valid = end_point;
   }
+  while (last_valid < size-1);
 
-  // construct the equalities:
-  int j = 0;
-  for (int i = 0; i < numSegments; i++)
-  {
-    int a = i * 5;
-    int b = i * 5 + 1;
-    int c = i * 5 + 2;
-    int d = i * 5 + 3;
-    int e = i * 5 + 4;
-    //int aNext = a + 5;
-    //int bNext = b + 5;
-    //int cNext = c + 5;
-    int dNext = d + 5;
-    int eNext = e + 5;
-
-    // end position of the segment:
-    equalities[a][j] = dt[i][5];
-    equalities[b][j] = dt[i][4];
-    equalities[c][j] = dt[i][3];
-    equalities[d][j] = dt[i][2];
-    equalities[e][j] = dt[i][1];
-    eqConst[j] = x[i] - x[i + 1];
-    j++;
-
-    // end velocity of the segment:
-    equalities[a][j] = 5.0 * dt[i][4];
-    equalities[b][j] = 4.0 * dt[i][3];
-    equalities[c][j] = 3.0 * dt[i][2];
-    equalities[d][j] = 2.0 * dt[i][1];
-    equalities[e][j] = 1.0;
-    if (i < numSegments - 1)
-      equalities[eNext][j] = -1.0;
-    else
-      eqConst[j] = -xd[length - 1];
-    j++;
-
-    // end acceleration of the segment:
-    equalities[a][j] = 20.0 * dt[i][3];
-    equalities[b][j] = 12.0 * dt[i][2];
-    equalities[c][j] = 6.0 * dt[i][1];
-    equalities[d][j] = 2.0;
-    if (i < numSegments - 1)
-      equalities[dNext][j] = -2.0;
-    else
-      eqConst[j] = -xdd[length - 1];
-    j++;
+  ROS_DEBUG("QuinticOptimizedSplineSmoother: %d factorizations for %d points", num_factorizations, size);
+  return true;
+}
 
-  }
-  // the extra equalities are for start vel and acc
-  equalities[4][j] = 1.0;
-  eqConst[j] = -xd[0];
-  j++;
+template<typename T>
+bool QuinticOptimizedSplineSmoother<T>::optimize(const double *x, double *xd, double *xdd, double *t, int length) const
+{
+  int numVars = QuinticChunkSolver::getNumVariables(length);
+  int numEqual = QuinticChunkSolver::getNumEqualities(length);
+  int numInEqual = 0;
 
-  equalities[3][j] = 2.0;
-  eqConst[j] = -xdd[0];
-  j++;
+  QuadProgPP::Vector<double> vars(numVars);
+  QuadProgPP::Matrix<double> quadCost(numVars, numVars);
+  QuadProgPP::Vector<double> linearCost(numVars);
+  QuadProgPP::Matrix<double> inequalities(numVars, numInEqual);
+  QuadProgPP::Vector<double> ineqConst(numInEqual);
+  QuadProgPP::Matrix<double> equalities(numVars, numEqual);
+  QuadProgPP::Vector<double> eqConst(numEqual);
 
-  ROS_ASSERT(numEqual == j);
+  // the variables are arranged as [a b c d e] for each spline segment,
+  // where the spline is x = at^5 + bt^4 + ct^3 + dt^2 + et + f
+  // the f can be determined without optimization for each segment (f = x_0)
+  QuinticChunkSolver::buildQuadraticCost(t, length, cost_function_weights_[MIN_VEL], cost_function_weights_[MIN_ACC],
+                                         cost_function_weights_[MIN_JERK], quadCost);
+  for (int i = 0; i < numVars; i++)
+  {
+    linearCost[i] = 0.0;
+  }
+  QuinticChunkSolver::buildEqualities(t, length, equalities);
+  QuinticChunkSolver::buildEqualityConstants(x, xd, xdd, length, eqConst);
 
   // zero the inequalities:
   for (int i = 0; i < numInEqual; i++)
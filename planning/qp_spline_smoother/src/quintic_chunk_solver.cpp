@@ -0,0 +1,363 @@
+/*
+ * quintic_chunk_solver.cpp
+ *
+ *  Cached solver for the chunk QP of the QuinticOptimizedSplineSmoother
+ */
+
+#include <qp_spline_smoother/quintic_chunk_solver.h>
+#include <ros/ros.h>
+#include <Eigen/LU>
+#include <cmath>
+#include <limits>
+
+namespace qp_spline_smoother
+{
+
+static const double TIME_STEP_TOLERANCE = 1e-9;
+static const int NUM_EQUILIBRATION_ITERATIONS = 10;
+static const long double PIVOT_TOLERANCE = std::numeric_limits<long double>::epsilon();
+
+typedef Eigen::Matrix<long double, Eigen::Dynamic, Eigen::Dynamic> MatrixXld;
+typedef Eigen::Matrix<long double, Eigen::Dynamic, 1> VectorXld;
+
+QuinticChunkSolver::QuinticChunkSolver():
+    initialized_(false),
+    length_(0)
+{
+}
+
+QuinticChunkSolver::~QuinticChunkSolver()
+{
+}
+
+bool QuinticChunkSolver::initialize(const double* t, int length, double velocity_cost, double acceleration_cost, double jerk_cost)
+{
+  ROS_ASSERT(length >= 3);
+  initialized_ = false;
+  length_ = length;
+  dt_.resize(length - 1);
+  for (int i = 0; i < length - 1; ++i)
+  {
+    dt_[i] = t[i + 1] - t[i];
+    if (!(dt_[i] > 0.0))
+    {
+      ROS_ERROR("QuinticChunkSolver: time steps have to be positive!");
+      return false;
+    }
+  }
+
+  int num_vars = getNumVariables(length);
+  int num_equal = getNumEqualities(length);
+
+  QuadProgPP::Matrix<double> quad_cost(num_vars, num_vars);
+  QuadProgPP::Matrix<double> equalities(num_vars, num_equal);
+  buildQuadraticCost(t, length, velocity_cost, acceleration_cost, jerk_cost, quad_cost);
+  buildEqualities(t, length, equalities);
+
+  // KKT system of min 0.5 x'Gx s.t. CE'x + ce0 = 0:
+  // [G CE; CE' 0] [x; -lambda] = [0; -ce0]
+  // Mixed cost weights make it badly conditioned even after equilibration. It is only factorized
+  // once per chunk geometry, so this is done in extended precision.
+  int kkt_size = num_vars + num_equal;
+  MatrixXld kkt = MatrixXld::Zero(kkt_size, kkt_size);
+  for (int i = 0; i < num_vars; ++i)
+  {
+    for (int j = 0; j < num_vars; ++j)
+      kkt(i, j) = quad_cost[i][j];
+    for (int j = 0; j < num_equal; ++j)
+    {
+      kkt(i, num_vars + j) = equalities[i][j];
+      kkt(num_vars + j, i) = equalities[i][j];
+    }
+  }
+
+  // the cost entries scale with up to dt^9 while the constraints are O(1), so equilibrate
+  // symmetrically before factorizing: kkt^-1 = S (S kkt S)^-1 S
+  VectorXld scaling = VectorXld::Ones(kkt_size);
+  for (int iteration = 0; iteration < NUM_EQUILIBRATION_ITERATIONS; ++iteration)
+  {
+    VectorXld row_scaling = kkt.cwiseAbs().rowwise().maxCoeff().cwiseSqrt().cwiseInverse();
+    kkt = row_scaling.asDiagonal() * kkt * row_scaling.asDiagonal();
+    scaling = scaling.cwiseProduct(row_scaling);
+  }
+
+  // PartialPivLU does not detect singularity, so reject pivots that are tiny relative to the
+  // largest one, and pivots that are not finite (their sum is then NaN or infinite)
+  Eigen::PartialPivLU<MatrixXld> lu(kkt);
+  VectorXld pivots = lu.matrixLU().diagonal().cwiseAbs();
+  if (!(pivots.sum() < std::numeric_limits<long double>::infinity())
+      || !(pivots.minCoeff() > PIVOT_TOLERANCE * kkt_size * pivots.maxCoeff()))
+  {
+    ROS_ERROR("QuinticChunkSolver: KKT system is singular!");
+    return false;
+  }
+
+  // the kkt matrix is symmetric, so the rows of its inverse that give the interior
+  // e (= xd) and d (= xdd/2) are the solutions for the corresponding unit vectors
+  int num_outputs = 2 * (length - 2);
+  MatrixXld selection = MatrixXld::Zero(kkt_size, num_outputs);
+  for (int i = 1; i < length - 1; ++i)
+  {
+    selection(i * 5 + 4, 2 * (i - 1)) = 1.0;
+    selection(i * 5 + 3, 2 * (i - 1) + 1) = 2.0;
+  }
+  // outputs = -rows^T * ce0
+  MatrixXld rows = scaling.asDiagonal() * lu.solve(scaling.asDiagonal() * selection);
+  Eigen::MatrixXd ce0_map = -rows.bottomRows(num_equal).transpose().cast<double>();
+
+  // ce0 holds x[i] - x[i+1] in every third row. The map is kept on the differences, folding it
+  // into a map on x would cancel large coefficients.
+  position_map_.resize(num_outputs, length - 1);
+  for (int i = 0; i < length - 1; ++i)
+  {
+    position_map_.col(i) = -ce0_map.col(i * 3);
+  }
+
+  // and the negated boundary conditions in the remaining ones
+  int last = (length - 2) * 3;
+  boundary_map_.resize(num_outputs, 4);
+  boundary_map_.col(0) = -ce0_map.col(num_equal - 2);
+  boundary_map_.col(1) = -ce0_map.col(num_equal - 1);
+  boundary_map_.col(2) = -ce0_map.col(last + 1);
+  boundary_map_.col(3) = -ce0_map.col(last + 2);
+
+  initialized_ = true;
+  return true;
+}
+
+bool QuinticChunkSolver::matches(const double* t, int length) const
+{
+  if (!initialized_ || length != length_)
+    return false;
+  for (int i = 0; i < length - 1; ++i)
+  {
+    if (fabs((t[i + 1] - t[i]) - dt_[i]) > TIME_STEP_TOLERANCE * dt_[i])
+      return false;
+  }
+  return true;
+}
+
+void QuinticChunkSolver::solve(const double* x, double* xd, double* xdd) const
+{
+  ROS_ASSERT(initialized_);
+  const double boundary_conditions[4] = {xd[0], xdd[0], xd[length_ - 1], xdd[length_ - 1]};
+  for (int i = 1; i < length_ - 1; ++i)
+  {
+    int r = 2 * (i - 1);
+    double v = 0.0;
+    double a = 0.0;
+    for (int k = 0; k < length_ - 1; ++k)
+    {
+      double dx = x[k + 1] - x[k];
+      v += position_map_(r, k) * dx;
+      a += position_map_(r + 1, k) * dx;
+    }
+    for (int k = 0; k < 4; ++k)
+    {
+      v += boundary_map_(r, k) * boundary_conditions[k];
+      a += boundary_map_(r + 1, k) * boundary_conditions[k];
+    }
+    xd[i] = v;
+    xdd[i] = a;
+  }
+}
+
+void QuinticChunkSolver::buildQuadraticCost(const double* t, int length, double velocity_cost, double acceleration_cost,
+                                            double jerk_cost, QuadProgPP::Matrix<double>& quad_cost)
+{
+  int num_segments = length - 1;
+  int num_vars = getNumVariables(length);
+
+  // dt and powers of dt
+  QuadProgPP::Matrix<double> dt(num_segments, 10);
+  for (int i = 0; i < num_segments; i++)
+  {
+    dt[i][1] = t[i + 1] - t[i];
+    for (int j = 2; j <= 9; j++)
+    {
+      dt[i][j] = dt[i][j - 1] * dt[i][1];
+    }
+  }
+
+  // zero the quadratic cost matrix:
+  for (int i = 0; i < num_vars; i++)
+  {
+    for (int j = 0; j < num_vars; j++)
+    {
+      quad_cost[i][j] = 0.0;
+    }
+  }
+
+  if (velocity_cost > 0.0)
+  {
+    double w = velocity_cost;
+    for (int i = 0; i < num_segments; i++)
+    {
+      int a = i * 5;
+      int b = i * 5 + 1;
+      int c = i * 5 + 2;
+      int d = i * 5 + 3;
+      int e = i * 5 + 4;
+      quad_cost[a][a] = (25.0 / 9.0) * dt[i][9] * w;
+      quad_cost[a][b] = quad_cost[b][a] = (5.0 / 2.0) * dt[i][8] * w;
+      quad_cost[a][c] = quad_cost[c][a] = ((30.0 / 7.0) / 2.0) * dt[i][7] * w;
+      quad_cost[b][b] = (16.0 / 7.0) * dt[i][7] * w;
+      quad_cost[a][d] = quad_cost[d][a] = ((20.0 / 6.0) / 2.0) * dt[i][6] * w;
+      quad_cost[c][b] = quad_cost[b][c] = ((24.0 / 6.0) / 2.0) * dt[i][6] * w;
+      quad_cost[a][e] = quad_cost[e][a] = ((10.0 / 5.0) / 2.0) * dt[i][5] * w;
+      quad_cost[b][d] = quad_cost[d][b] = ((16.0 / 5.0) / 2.0) * dt[i][5] * w;
+      quad_cost[c][c] = (9.0 / 5.0) * dt[i][5] * w;
+      quad_cost[b][e] = quad_cost[e][b] = ((8.0 / 4.0) / 2.0) * dt[i][4] * w;
+      quad_cost[c][d] = quad_cost[d][c] = ((12.0 / 4.0) / 2.0) * dt[i][4] * w;
+      quad_cost[c][e] = quad_cost[e][c] = ((6.0 / 3.0) / 2.0) * dt[i][3] * w;
+      quad_cost[d][d] = (4.0 / 3.0) * dt[i][3] * w;
+      quad_cost[d][e] = quad_cost[e][d] = dt[i][2] * w;
+      quad_cost[e][e] = dt[i][1] * w;
+    }
+  }
+  if (acceleration_cost > 0.0)
+  {
+    double w = acceleration_cost;
+    for (int i = 0; i < num_segments; i++)
+    {
+      int a = i * 5;
+      int b = i * 5 + 1;
+      int c = i * 5 + 2;
+      int d = i * 5 + 3;
+      int e = i * 5 + 4;
+      quad_cost[a][a] += (400.0 / 7.0) * dt[i][7] * w;
+      quad_cost[a][b] += (80.0 / 2.0) * dt[i][6] * w;
+      quad_cost[b][a] += (80.0 / 2.0) * dt[i][6] * w;
+      quad_cost[b][b] += (144.0 / 5.0) * dt[i][5] * w;
+      quad_cost[a][c] += ((240.0 / 5.0) / 2.0) * dt[i][5] * w;
+      quad_cost[c][a] += ((240.0 / 5.0) / 2.0) * dt[i][5] * w;
+      quad_cost[c][b] += ((144.0 / 4.0) / 2.0) * dt[i][4] * w;
+      quad_cost[b][c] += ((144.0 / 4.0) / 2.0) * dt[i][4] * w;
+      quad_cost[a][d] += ((80.0 / 4.0) / 2.0) * dt[i][4] * w;
+      quad_cost[d][a] += ((80.0 / 4.0) / 2.0) * dt[i][4] * w;
+      quad_cost[b][d] += ((48.0 / 3.0) / 2.0) * dt[i][3] * w;
+      quad_cost[d][b] += ((48.0 / 3.0) / 2.0) * dt[i][3] * w;
+      quad_cost[c][c] += (36.0 / 3.0) * dt[i][3] * w;
+      quad_cost[c][d] += ((12.0) / 2.0) * dt[i][2] * w;
+      quad_cost[d][c] += ((12.0) / 2.0) * dt[i][2] * w;
+      quad_cost[d][d] += (4.0) * dt[i][1] * w;
+      quad_cost[e][e] += 10e-10 * w;
+    }
+  }
+  if (jerk_cost > 0.0)
+  {
+    double w = jerk_cost;
+    for (int i = 0; i < num_segments; i++)
+    {
+      int a = i * 5;
+      int b = i * 5 + 1;
+      int c = i * 5 + 2;
+      int d = i * 5 + 3;
+      int e = i * 5 + 4;
+      quad_cost[a][a] += (720) * dt[i][5] * w;
+      quad_cost[a][b] += (720.0 / 2.0) * dt[i][4] * w;
+      quad_cost[b][a] += (720.0 / 2.0) * dt[i][4] * w;
+      quad_cost[a][c] += ((720.0 / 3.0) / 2.0) * dt[i][3] * w;
+      quad_cost[c][a] += ((720.0 / 3.0) / 2.0) * dt[i][3] * w;
+      quad_cost[b][b] += (576.0 / 3.0) * dt[i][3] * w;
+      quad_cost[c][b] += ((144.0) / 2.0) * dt[i][2] * w;
+      quad_cost[b][c] += ((144.0) / 2.0) * dt[i][2] * w;
+      quad_cost[c][c] += (36.0) * dt[i][1] * w;
+      quad_cost[d][d] += 10e-10 * w;
+      quad_cost[e][e] += 10e-10 * w;
+    }
+  }
+}
+
+void QuinticChunkSolver::buildEqualities(const double* t, int length, QuadProgPP::Matrix<double>& equalities)
+{
+  int num_segments = length - 1;
+  int num_vars = getNumVariables(length);
+  int num_equal = getNumEqualities(length);
+
+  // zero the equalities:
+  for (int i = 0; i < num_equal; i++)
+  {
+    for (int j = 0; j < num_vars; j++)
+    {
+      equalities[j][i] = 0.0;
+    }
+  }
+
+  int j = 0;
+  for (int i = 0; i < num_segments; i++)
+  {
+    double dt1 = t[i + 1] - t[i];
+    double dt2 = dt1 * dt1;
+    double dt3 = dt2 * dt1;
+    double dt4 = dt3 * dt1;
+    double dt5 = dt4 * dt1;
+
+    int a = i * 5;
+    int b = i * 5 + 1;
+    int c = i * 5 + 2;
+    int d = i * 5 + 3;
+    int e = i * 5 + 4;
+    int dNext = d + 5;
+    int eNext = e + 5;
+
+    // end position of the segment:
+    equalities[a][j] = dt5;
+    equalities[b][j] = dt4;
+    equalities[c][j] = dt3;
+    equalities[d][j] = dt2;
+    equalities[e][j] = dt1;
+    j++;
+
+    // end velocity of the segment:
+    equalities[a][j] = 5.0 * dt4;
+    equalities[b][j] = 4.0 * dt3;
+    equalities[c][j] = 3.0 * dt2;
+    equalities[d][j] = 2.0 * dt1;
+    equalities[e][j] = 1.0;
+    if (i < num_segments - 1)
+      equalities[eNext][j] = -1.0;
+    j++;
+
+    // end acceleration of the segment:
+    equalities[a][j] = 20.0 * dt3;
+    equalities[b][j] = 12.0 * dt2;
+    equalities[c][j] = 6.0 * dt1;
+    equalities[d][j] = 2.0;
+    if (i < num_segments - 1)
+      equalities[dNext][j] = -2.0;
+    j++;
+  }
+  // the extra equalities are for start vel and acc
+  equalities[4][j] = 1.0;
+  j++;
+  equalities[3][j] = 2.0;
+  j++;
+
+  ROS_ASSERT(num_equal == j);
+}
+
+void QuinticChunkSolver::buildEqualityConstants(const double* x, const double* xd, const double* xdd, int length,
+                                                QuadProgPP::Vector<double>& eq_const)
+{
+  int num_segments = length - 1;
+  int num_equal = getNumEqualities(length);
+  for (int i = 0; i < num_equal; i++)
+  {
+    eq_const[i] = 0.0;
+  }
+
+  for (int i = 0; i < num_segments; i++)
+  {
+    // end position of the segment:
+    eq_const[i * 3] = x[i] - x[i + 1];
+  }
+  // end velocity and acceleration of the last segment
+  eq_const[(num_segments - 1) * 3 + 1] = -xd[length - 1];
+  eq_const[(num_segments - 1) * 3 + 2] = -xdd[length - 1];
+  // start vel and acc
+  eq_const[num_segments * 3] = -xd[0];
+  eq_const[num_segments * 3 + 1] = -xdd[0];
+}
+
+}
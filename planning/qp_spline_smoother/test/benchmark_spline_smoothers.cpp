@@ -0,0 +1,99 @@
+/*
+ * benchmark_spline_smoothers.cpp
+ *
+ * Long horizon benchmark of the QuinticOptimizedSplineSmoother: smooths the same trajectory
+ * once with one QuadProg++ solve per chunk and joint and once with the cached chunk solver,
+ * and reports the run times and the largest difference between the results.
+ *
+ * Usage: benchmark_spline_smoothers [number of points] [number of joints] [time step jitter]
+ */
+
+#include <qp_spline_smoother/quintic_optimized_spline_smoother.h>
+#include <arm_navigation_msgs/FilterJointTrajectoryWithConstraints.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+typedef arm_navigation_msgs::FilterJointTrajectoryWithConstraints Trajectory;
+
+static bool configure(qp_spline_smoother::QuinticOptimizedSplineSmoother<Trajectory>& smoother, bool cache_qp)
+{
+  XmlRpc::XmlRpcValue config;
+  config["name"] = std::string("qp_optimized");
+  config["type"] = std::string("qp_spline_smoother/QuinticOptimizedSplineSmootherFilterJointTrajectoryWithConstraints");
+  config["params"]["velocity_cost"] = 0.0;
+  config["params"]["acceleration_cost"] = 0.0;
+  config["params"]["jerk_cost"] = 1.0;
+  config["params"]["chunk_size"] = 20;
+  config["params"]["cache_qp"] = cache_qp;
+  return ((filters::FilterBase<Trajectory>&)smoother).configure(config);
+}
+
+static double smooth(const qp_spline_smoother::QuinticOptimizedSplineSmoother<Trajectory>& smoother,
+                     const Trajectory& trajectory_in, Trajectory& trajectory_out)
+{
+  ros::WallTime start_time = ros::WallTime::now();
+  if (!smoother.smooth(trajectory_in, trajectory_out))
+  {
+    ROS_ERROR("Smoothing failed.");
+  }
+  return (ros::WallTime::now() - start_time).toSec();
+}
+
+int main(int argc, char** argv)
+{
+  ros::Time::init();
+  int num_points = (argc > 1) ? atoi(argv[1]) : 10000;
+  int num_joints = (argc > 2) ? atoi(argv[2]) : 7;
+  double jitter = (argc > 3) ? atof(argv[3]) : 0.0;
+  const double dt = 0.01;
+
+  Trajectory trajectory;
+  trajectory.request.trajectory.joint_names.resize(num_joints);
+  trajectory.request.trajectory.points.resize(num_points);
+  double t = 0.0;
+  for (int i = 0; i < num_points; ++i)
+  {
+    trajectory_msgs::JointTrajectoryPoint& point = trajectory.request.trajectory.points[i];
+    point.positions.resize(num_joints);
+    point.velocities.resize(num_joints, 0.0);
+    point.accelerations.resize(num_joints, 0.0);
+    for (int j = 0; j < num_joints; ++j)
+    {
+      point.positions[j] = sin(0.7 * (j + 1) * t) + 0.3 * cos(1.3 * t + j);
+    }
+    point.time_from_start = ros::Duration(t);
+    t += dt + jitter * dt * (double)rand() / RAND_MAX;
+  }
+
+  qp_spline_smoother::QuinticOptimizedSplineSmoother<Trajectory> quadprog_smoother;
+  qp_spline_smoother::QuinticOptimizedSplineSmoother<Trajectory> cached_smoother;
+  if (!configure(quadprog_smoother, false) || !configure(cached_smoother, true))
+  {
+    ROS_ERROR("Could not configure smoothers.");
+    return -1;
+  }
+
+  Trajectory quadprog_result, cached_result;
+  double quadprog_time = smooth(quadprog_smoother, trajectory, quadprog_result);
+  double cached_time = smooth(cached_smoother, trajectory, cached_result);
+
+  double max_difference = 0.0;
+  for (int i = 0; i < num_points; ++i)
+  {
+    const trajectory_msgs::JointTrajectoryPoint& p1 = quadprog_result.request.trajectory.points[i];
+    const trajectory_msgs::JointTrajectoryPoint& p2 = cached_result.request.trajectory.points[i];
+    for (int j = 0; j < num_joints; ++j)
+    {
+      max_difference = std::max(max_difference, fabs(p1.velocities[j] - p2.velocities[j]) / std::max(1.0, fabs(p1.velocities[j])));
+      max_difference = std::max(max_difference, fabs(p1.accelerations[j] - p2.accelerations[j]) / std::max(1.0, fabs(p1.accelerations[j])));
+    }
+  }
+
+  printf("%d points, %d joints, time step jitter %.2f\n", num_points, num_joints, jitter);
+  printf("quadprog: %10.4f s\n", quadprog_time);
+  printf("cached:   %10.4f s (%.1fx)\n", cached_time, quadprog_time / cached_time);
+  printf("max relative difference: %g\n", max_difference);
+  return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * test_quintic_chunk_solver.cpp
+ *
+ * Smooths the same trajectories with one QuadProg++ solve per chunk and joint and with the
+ * cached QuinticChunkSolver (cache_qp), and checks that both give the same velocities and
+ * accelerations.
+ */
+
+#include <gtest/gtest.h>
+#include <qp_spline_smoother/quintic_optimized_spline_smoother.h>
+#include <arm_navigation_msgs/FilterJointTrajectoryWithConstraints.h>
+
+#include <cmath>
+#include <cstdlib>
+
+typedef arm_navigation_msgs::FilterJointTrajectoryWithConstraints Trajectory;
+
+static const int NUM_JOINTS = 3;
+static const int CHUNK_SIZE = 10;
+static const double DT = 0.01;
+// QuadProg++ itself is off by up to about 1e-5 on the jerk cost of three point chunks
+static const double TOLERANCE = 1e-4;
+
+// velocity, acceleration and jerk cost
+static const int NUM_COST_WEIGHTS = 5;
+static const double COST_WEIGHTS[NUM_COST_WEIGHTS][3] = {{0.0, 1.0, 0.0},
+                                                         {0.0, 0.0, 1.0},
+                                                         {1.0, 0.0, 0.0},
+                                                         {0.2, 0.5, 1.0},
+                                                         {1.0, 0.0, 0.1}};
+
+static bool configure(qp_spline_smoother::QuinticOptimizedSplineSmoother<Trajectory>& smoother,
+                      const double* cost_weights, bool cache_qp)
+{
+  XmlRpc::XmlRpcValue config;
+  config["name"] = std::string("qp_optimized");
+  config["type"] = std::string("qp_spline_smoother/QuinticOptimizedSplineSmootherFilterJointTrajectoryWithConstraints");
+  config["params"]["velocity_cost"] = cost_weights[0];
+  config["params"]["acceleration_cost"] = cost_weights[1];
+  config["params"]["jerk_cost"] = cost_weights[2];
+  config["params"]["chunk_size"] = CHUNK_SIZE;
+  config["params"]["cache_qp"] = cache_qp;
+  return ((filters::FilterBase<Trajectory>&)smoother).configure(config);
+}
+
+/** every time step is DT plus up to jitter * DT */
+static Trajectory createTrajectory(int num_points, double jitter)
+{
+  Trajectory trajectory;
+  trajectory.request.trajectory.joint_names.resize(NUM_JOINTS);
+  trajectory.request.trajectory.points.resize(num_points);
+  double t = 0.0;
+  for (int i = 0; i < num_points; ++i)
+  {
+    trajectory_msgs::JointTrajectoryPoint& point = trajectory.request.trajectory.points[i];
+    point.positions.resize(NUM_JOINTS);
+    point.velocities.resize(NUM_JOINTS, 0.0);
+    point.accelerations.resize(NUM_JOINTS, 0.0);
+    for (int j = 0; j < NUM_JOINTS; ++j)
+    {
+      point.positions[j] = sin(0.7 * (j + 1) * t) + 0.3 * cos(1.3 * t + j);
+    }
+    point.time_from_start = ros::Duration(t);
+    t += DT + jitter * DT * (double)rand() / RAND_MAX;
+  }
+  return trajectory;
+}
+
+static double relativeDifference(double expected, double actual)
+{
+  return fabs(expected - actual) / std::max(1.0, fabs(expected));
+}
+
+/** smooths the trajectory with both backends for every set of cost weights and compares the results */
+static void expectCachedMatchesQuadProg(const Trajectory& trajectory)
+{
+  int num_points = trajectory.request.trajectory.points.size();
+  for (int w = 0; w < NUM_COST_WEIGHTS; ++w)
+  {
+    qp_spline_smoother::QuinticOptimizedSplineSmoother<Trajectory> quadprog_smoother;
+    qp_spline_smoother::QuinticOptimizedSplineSmoother<Trajectory> cached_smoother;
+    ASSERT_TRUE(configure(quadprog_smoother, COST_WEIGHTS[w], false));
+    ASSERT_TRUE(configure(cached_smoother, COST_WEIGHTS[w], true));
+
+    Trajectory quadprog_result, cached_result;
+    ASSERT_TRUE(quadprog_smoother.smooth(trajectory, quadprog_result));
+    ASSERT_TRUE(cached_smoother.smooth(trajectory, cached_result));
+
+    double max_difference = 0.0;
+    for (int i = 0; i < num_points; ++i)
+    {
+      const trajectory_msgs::JointTrajectoryPoint& p1 = quadprog_result.request.trajectory.points[i];
+      const trajectory_msgs::JointTrajectoryPoint& p2 = cached_result.request.trajectory.points[i];
+      for (int j = 0; j < NUM_JOINTS; ++j)
+      {
+        max_difference = std::max(max_difference, relativeDifference(p1.velocities[j], p2.velocities[j]));
+        max_difference = std::max(max_difference, relativeDifference(p1.accelerations[j], p2.accelerations[j]));
+      }
+    }
+    EXPECT_LT(max_difference, TOLERANCE) << num_points << " points, cost weights " << w;
+  }
+}
+
+TEST(QuinticChunkSolver, matchesQuadProgWithUniformTimeSteps)
+{
+  // a single chunk, and several chunks with a shorter last one
+  expectCachedMatchesQuadProg(createTrajectory(CHUNK_SIZE, 0.0));
+  expectCachedMatchesQuadProg(createTrajectory(57, 0.0));
+}
+
+TEST(QuinticChunkSolver, matchesQuadProgWithJitteredTimeSteps)
+{
+  srand(0);
+  expectCachedMatchesQuadProg(createTrajectory(CHUNK_SIZE, 0.5));
+  expectCachedMatchesQuadProg(createTrajectory(57, 0.5));
+}
+
+TEST(QuinticChunkSolver, matchesQuadProgOnShortTrajectories)
+{
+  srand(0);
+  for (int num_points = 3; num_points <= 4; ++num_points)
+  {
+    expectCachedMatchesQuadProg(createTrajectory(num_points, 0.0));
+    expectCachedMatchesQuadProg(createTrajectory(num_points, 0.5));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::Time::init();
+  return RUN_ALL_TESTS();
+}
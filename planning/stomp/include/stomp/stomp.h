@@ -40,6 +40,7 @@
 #include <ros/ros.h>
 #include <rosbag/bag.h>
 #include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
 
 #include <stomp/covariant_movement_primitive.h>
 #include <stomp/task.h>
@@ -48,6 +49,41 @@
 namespace stomp
 {
 
+/**
+ * Time [s] spent in each stage of a single STOMP iteration. All stages are wall-clock time, except
+ * forward_kinematics and cost_evaluation: they are timed inside every rollout and summed over the
+ * rollouts, which run in parallel OpenMP threads. They are CPU time summed over the threads and can
+ * exceed execute_rollouts. They are only filled in if the task reports them.
+ */
+struct StompIterationTimings
+{
+  StompIterationTimings();
+  void clear();
+  StompIterationTimings& operator+=(const StompIterationTimings& other);
+
+  double generate_rollouts;
+  double execute_rollouts;
+  double forward_kinematics;
+  double cost_evaluation;
+  double update;
+  double noiseless_rollout;
+  double total;
+};
+
+/**
+ * Settings for STOMP::runAnytime
+ */
+struct StompAnytimeParameters
+{
+  StompAnytimeParameters();
+
+  int max_iterations;
+  /** stop once the relative improvement of the best valid cost over the last
+   * convergence_window iterations drops below this value */
+  double convergence_threshold;
+  int convergence_window;
+};
+
 class STOMP
 {
 public:
@@ -75,6 +111,29 @@ public:
 
     bool runUntilValid(int max_iterations, int iterations_after_collision_free);
 
+    /**
+     * Called whenever a valid noiseless trajectory with a lower cost than all previous valid ones is found
+     */
+    typedef boost::function<void (const std::vector<Eigen::VectorXd>& parameters, double cost, int iteration)> ImprovementCallback;
+
+    /**
+     * Iterates until the deadline passes, the cost has converged, or max_iterations is reached.
+     * improvement_callback (may be empty) is invoked as soon as the first valid
+     * trajectory exists and again for every subsequent improvement.
+     * @return true if a valid trajectory was found
+     */
+    bool runAnytime(const ros::WallTime& deadline,
+                    const StompAnytimeParameters& parameters,
+                    ImprovementCallback improvement_callback = ImprovementCallback());
+
+    /**
+     * @return false if no valid noiseless rollout has been found since initialize()
+     */
+    bool getBestValidParameters(std::vector<Eigen::VectorXd>& parameters, double& cost);
+
+    void getLastIterationTimings(StompIterationTimings& timings);
+    void getAccumulatedTimings(StompIterationTimings& timings, int& num_iterations);
+
 private:
 
     bool initialized_;
@@ -102,6 +161,14 @@ private:
 
     bool last_noiseless_rollout_valid_;
 
+    std::vector<Eigen::VectorXd> best_valid_parameters_;
+    double best_valid_cost_;
+    bool found_valid_;
+
+    StompIterationTimings last_iteration_timings_;
+    StompIterationTimings accumulated_timings_;
+    int num_timed_iterations_;
+
     std::vector<std::vector<Eigen::VectorXd> > rollouts_; /**< [num_rollouts][num_dimensions] num_parameters */
     std::vector<std::vector<Eigen::VectorXd> > projected_rollouts_;
     std::vector<Eigen::MatrixXd> parameter_updates_;
@@ -111,6 +111,15 @@ public:
      */
     virtual void onEveryIteration(){};
 
+    /**
+     * Gets the time spent in forward kinematics and in cost (collision) evaluation
+     * since the last call, summed over all rollouts, i.e. over the threads that executed them
+     * @param fk_time [s]
+     * @param cost_time [s]
+     * @return false if the task does not keep timing statistics
+     */
+    virtual bool getExecutionTimings(double& fk_time, double& cost_time){return false;};
+
 };
 
 }
@@ -37,6 +37,9 @@
 // system includes
 #include <cassert>
 #include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 // ros includes
 #include <ros/package.h>
@@ -48,6 +51,39 @@
 namespace stomp
 {
 
+StompIterationTimings::StompIterationTimings()
+{
+  clear();
+}
+
+void StompIterationTimings::clear()
+{
+  generate_rollouts = 0.0;
+  execute_rollouts = 0.0;
+  forward_kinematics = 0.0;
+  cost_evaluation = 0.0;
+  update = 0.0;
+  noiseless_rollout = 0.0;
+  total = 0.0;
+}
+
+StompIterationTimings& StompIterationTimings::operator+=(const StompIterationTimings& other)
+{
+  generate_rollouts += other.generate_rollouts;
+  execute_rollouts += other.execute_rollouts;
+  forward_kinematics += other.forward_kinematics;
+  cost_evaluation += other.cost_evaluation;
+  update += other.update;
+  noiseless_rollout += other.noiseless_rollout;
+  total += other.total;
+  return *this;
+}
+
+StompAnytimeParameters::StompAnytimeParameters()
+: max_iterations(1000), convergence_threshold(0.001), convergence_window(10)
+{
+}
+
 STOMP::STOMP()
 : initialized_(false), policy_iteration_counter_(0)
 {
@@ -92,6 +128,14 @@ bool STOMP::initialize(ros::NodeHandle& node_handle, boost::shared_ptr<stomp::Ta
   tmp_rollout_weighted_features_.resize(max_rollouts_, Eigen::MatrixXd::Zero(num_time_steps_, 1));
 
   best_noiseless_cost_ = std::numeric_limits<double>::max();
+  best_valid_parameters_.clear();
+  best_valid_cost_ = std::numeric_limits<double>::max();
+  found_valid_ = false;
+  last_noiseless_rollout_valid_ = false;
+
+  last_iteration_timings_.clear();
+  accumulated_timings_.clear();
+  num_timed_iterations_ = 0;
 
   return (initialized_ = true);
 }
@@ -137,6 +181,8 @@ void STOMP::clearReusedRollouts()
 
 bool STOMP::doGenRollouts(int iteration_number)
 {
+  ros::WallTime start_time = ros::WallTime::now();
+
   // compute appropriate noise values
   std::vector<double> noise;
   noise.resize(num_dimensions_);
@@ -163,11 +209,13 @@ bool STOMP::doGenRollouts(int iteration_number)
   // overwrite the rollouts with the projected versions
   policy_improvement_.getProjectedRollouts(projected_rollouts_);
 
+  last_iteration_timings_.generate_rollouts = (ros::WallTime::now() - start_time).toSec();
   return true;
 }
 
 bool STOMP::doExecuteRollouts(int iteration_number)
 {
+  ros::WallTime start_time = ros::WallTime::now();
   std::vector<Eigen::VectorXd> gradients;
 #pragma omp parallel for num_threads(num_threads_)
   for (int r=0; r<int(rollouts_.size()); ++r)
@@ -184,6 +232,10 @@ bool STOMP::doExecuteRollouts(int iteration_number)
     ROS_DEBUG("Rollout %d, cost = %lf", r+1, tmp_rollout_cost_[r].sum());
   }
 
+  last_iteration_timings_.execute_rollouts = (ros::WallTime::now() - start_time).toSec();
+  last_iteration_timings_.forward_kinematics = 0.0;
+  last_iteration_timings_.cost_evaluation = 0.0;
+  task_->getExecutionTimings(last_iteration_timings_.forward_kinematics, last_iteration_timings_.cost_evaluation);
   return true;
 }
 
@@ -196,6 +248,8 @@ bool STOMP::doRollouts(int iteration_number)
 
 bool STOMP::doUpdate(int iteration_number)
 {
+  ros::WallTime start_time = ros::WallTime::now();
+
   // TODO: fix this std::vector<>
   std::vector<double> all_costs;
   ROS_VERIFY(policy_improvement_.setRolloutCosts(rollout_costs_, control_cost_weight_, all_costs));
@@ -205,11 +259,14 @@ bool STOMP::doUpdate(int iteration_number)
   ROS_VERIFY(policy_improvement_.getTimeStepWeights(time_step_weights_));
   ROS_VERIFY(policy_->updateParameters(parameter_updates_, time_step_weights_));
 
+  last_iteration_timings_.update = (ros::WallTime::now() - start_time).toSec();
   return true;
 }
 
 bool STOMP::doNoiselessRollout(int iteration_number)
 {
+  ros::WallTime start_time = ros::WallTime::now();
+
   // get a noise-less rollout to check the cost
   std::vector<Eigen::VectorXd> gradients;
   ROS_VERIFY(policy_->getParameters(parameters_));
@@ -226,7 +283,21 @@ bool STOMP::doNoiselessRollout(int iteration_number)
     best_noiseless_parameters_ = parameters_;
     best_noiseless_cost_ = total_cost;
   }
+  if (validity && total_cost < best_valid_cost_)
+  {
+    best_valid_parameters_ = parameters_;
+    best_valid_cost_ = total_cost;
+    found_valid_ = true;
+  }
   last_noiseless_rollout_valid_ = validity;
+
+  last_iteration_timings_.noiseless_rollout = (ros::WallTime::now() - start_time).toSec();
+  double fk_time = 0.0, cost_time = 0.0;
+  if (task_->getExecutionTimings(fk_time, cost_time))
+  {
+    last_iteration_timings_.forward_kinematics += fk_time;
+    last_iteration_timings_.cost_evaluation += cost_time;
+  }
   return true;
 }
 
@@ -234,6 +305,7 @@ bool STOMP::runSingleIteration(const int iteration_number)
 {
   ROS_ASSERT(initialized_);
   policy_iteration_counter_++;
+  ros::WallTime start_time = ros::WallTime::now();
 
   if (write_to_file_)
   {
@@ -252,6 +324,10 @@ bool STOMP::runSingleIteration(const int iteration_number)
     //ROS_VERIFY(writePolicyImprovementStatistics(stats_msg));
   }
 
+  last_iteration_timings_.total = (ros::WallTime::now() - start_time).toSec();
+  accumulated_timings_ += last_iteration_timings_;
+  num_timed_iterations_++;
+
   return true;
 }
 
@@ -302,4 +378,72 @@ bool STOMP::runUntilValid(int max_iterations, int iterations_after_collision_fre
   return success;
 }
 
+bool STOMP::runAnytime(const ros::WallTime& deadline,
+                       const StompAnytimeParameters& parameters,
+                       ImprovementCallback improvement_callback)
+{
+  ROS_ASSERT(parameters.convergence_window > 0);
+
+  // best valid cost after every iteration since the first valid one
+  std::vector<double> valid_cost_history;
+  double last_reported_cost = std::numeric_limits<double>::max();
+
+  for (int i=0; i<parameters.max_iterations; ++i)
+  {
+    if (ros::WallTime::now() >= deadline)
+    {
+      ROS_DEBUG("STOMP: deadline reached after %d iterations", i);
+      break;
+    }
+
+    runSingleIteration(i);
+    task_->onEveryIteration();
+
+    if (!found_valid_)
+      continue;
+
+    if (best_valid_cost_ < last_reported_cost)
+    {
+      last_reported_cost = best_valid_cost_;
+      if (improvement_callback)
+        improvement_callback(best_valid_parameters_, best_valid_cost_, i);
+    }
+
+    valid_cost_history.push_back(best_valid_cost_);
+    int num_history = valid_cost_history.size();
+    if (num_history > parameters.convergence_window)
+    {
+      double old_cost = valid_cost_history[num_history - 1 - parameters.convergence_window];
+      double improvement = (old_cost - best_valid_cost_) / std::max(fabs(old_cost), 1e-10);
+      if (improvement < parameters.convergence_threshold)
+      {
+        ROS_DEBUG("STOMP: converged after %d iterations (relative improvement %f)", i+1, improvement);
+        break;
+      }
+    }
+  }
+
+  return found_valid_;
+}
+
+bool STOMP::getBestValidParameters(std::vector<Eigen::VectorXd>& parameters, double& cost)
+{
+  if (!found_valid_)
+    return false;
+  parameters = best_valid_parameters_;
+  cost = best_valid_cost_;
+  return true;
+}
+
+void STOMP::getLastIterationTimings(StompIterationTimings& timings)
+{
+  timings = last_iteration_timings_;
+}
+
+void STOMP::getAccumulatedTimings(StompIterationTimings& timings, int& num_iterations)
+{
+  timings = accumulated_timings_;
+  num_iterations = num_timed_iterations_;
+}
+
 }
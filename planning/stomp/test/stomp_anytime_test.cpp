@@ -0,0 +1,220 @@
+/*
+ * stomp_anytime_test.cpp
+ *
+ * Runs STOMP::runAnytime on a one dimensional task that pulls the trajectory towards a constant,
+ * and checks that it stops at the deadline, at max_iterations and on convergence, and that it
+ * reports every improvement.
+ */
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include <boost/bind.hpp>
+#include <stomp/stomp.h>
+#include <stomp/task.h>
+#include <stomp/stomp_utils.h>
+
+namespace stomp
+{
+
+static const int NUM_TIME_STEPS = 20;
+static const double TARGET = 0.5;
+
+class ConstantTargetTask: public Task
+{
+public:
+  ConstantTargetTask():
+    rollout_duration_(0.0)
+  {
+  }
+
+  bool initializePolicy()
+  {
+    std::vector<Eigen::MatrixXd> derivative_costs(1, Eigen::MatrixXd::Zero(NUM_TIME_STEPS + 2*TRAJECTORY_PADDING,
+                                                                           NUM_DIFF_RULES));
+    std::vector<Eigen::VectorXd> initial_trajectory(1, Eigen::VectorXd::Zero(NUM_TIME_STEPS + 2*TRAJECTORY_PADDING));
+    derivative_costs[0].col(STOMP_VELOCITY) = Eigen::VectorXd::Ones(NUM_TIME_STEPS + 2*TRAJECTORY_PADDING);
+    initial_trajectory[0].tail(TRAJECTORY_PADDING) = Eigen::VectorXd::Ones(TRAJECTORY_PADDING);
+
+    policy_.reset(new CovariantMovementPrimitive());
+    return policy_->initialize(NUM_TIME_STEPS, 1, 1.0, derivative_costs, initial_trajectory)
+        && policy_->setToMinControlCost();
+  }
+
+  /** every rollout sleeps this long [s], to make the iterations take a known time */
+  void setRolloutDuration(double rollout_duration)
+  {
+    rollout_duration_ = rollout_duration;
+  }
+
+  virtual bool initialize(int num_threads, int num_rollouts)
+  {
+    return true;
+  }
+
+  virtual bool execute(std::vector<Eigen::VectorXd>& parameters,
+                       std::vector<Eigen::VectorXd>& projected_parameters,
+                       Eigen::VectorXd& costs,
+                       Eigen::MatrixXd& weighted_feature_values,
+                       const int iteration_number,
+                       const int rollout_number,
+                       int thread_id,
+                       bool compute_gradients,
+                       std::vector<Eigen::VectorXd>& gradients,
+                       bool& validity)
+  {
+    costs = Eigen::VectorXd::Zero(NUM_TIME_STEPS);
+    for (int t=0; t<NUM_TIME_STEPS; ++t)
+    {
+      double error = parameters[0](t) - TARGET;
+      costs(t) = error * error;
+    }
+    if (rollout_duration_ > 0.0)
+    {
+      ros::WallDuration(rollout_duration_).sleep();
+    }
+    validity = true;
+    return true;
+  }
+
+  virtual bool getPolicy(boost::shared_ptr<stomp::CovariantMovementPrimitive>& policy)
+  {
+    policy = policy_;
+    return true;
+  }
+
+  virtual bool setPolicy(const boost::shared_ptr<stomp::CovariantMovementPrimitive> policy)
+  {
+    policy_ = policy;
+    return true;
+  }
+
+  virtual double getControlCostWeight()
+  {
+    return 0.0001;
+  }
+
+private:
+  boost::shared_ptr<stomp::CovariantMovementPrimitive> policy_;
+  double rollout_duration_;
+};
+
+class StompAnytimeTest: public testing::Test
+{
+public:
+  void SetUp()
+  {
+    srand(0);
+    task_.reset(new ConstantTargetTask());
+    ASSERT_TRUE(task_->initializePolicy());
+    ros::NodeHandle node_handle("~stomp");
+    stomp_.reset(new STOMP());
+    ASSERT_TRUE(stomp_->initialize(node_handle, task_));
+
+    // the relative improvement is never negative, so by default runAnytime never converges
+    parameters_.max_iterations = 100000;
+    parameters_.convergence_threshold = -1.0;
+  }
+
+  void onImprovement(const std::vector<Eigen::VectorXd>& parameters, double cost, int iteration)
+  {
+    improvement_costs_.push_back(cost);
+    improvement_iterations_.push_back(iteration);
+  }
+
+  bool runAnytime(const ros::WallTime& deadline)
+  {
+    return stomp_->runAnytime(deadline, parameters_, boost::bind(&StompAnytimeTest::onImprovement, this, _1, _2, _3));
+  }
+
+  int getNumIterations()
+  {
+    StompIterationTimings timings;
+    int num_iterations;
+    stomp_->getAccumulatedTimings(timings, num_iterations);
+    return num_iterations;
+  }
+
+  boost::shared_ptr<ConstantTargetTask> task_;
+  boost::shared_ptr<STOMP> stomp_;
+  StompAnytimeParameters parameters_;
+  std::vector<double> improvement_costs_;
+  std::vector<int> improvement_iterations_;
+};
+
+TEST_F(StompAnytimeTest, stopsAtDeadline)
+{
+  const double budget = 0.3;
+  // slack for the work outside of the timed iteration (callbacks, onEveryIteration)
+  const double slack = 0.05;
+  task_->setRolloutDuration(0.002);
+
+  ros::WallTime start_time = ros::WallTime::now();
+  EXPECT_TRUE(runAnytime(start_time + ros::WallDuration(budget)));
+  double elapsed = (ros::WallTime::now() - start_time).toSec();
+
+  // the deadline is checked before every iteration, so the last one may overrun it
+  StompIterationTimings last_timings;
+  stomp_->getLastIterationTimings(last_timings);
+  EXPECT_GE(elapsed, budget);
+  EXPECT_LT(elapsed, budget + last_timings.total + slack);
+  EXPECT_GT(getNumIterations(), 1);
+  EXPECT_LT(getNumIterations(), parameters_.max_iterations);
+}
+
+TEST_F(StompAnytimeTest, passedDeadlineRunsNoIteration)
+{
+  EXPECT_FALSE(runAnytime(ros::WallTime::now() - ros::WallDuration(1.0)));
+  EXPECT_EQ(getNumIterations(), 0);
+  EXPECT_TRUE(improvement_costs_.empty());
+
+  std::vector<Eigen::VectorXd> parameters;
+  double cost;
+  EXPECT_FALSE(stomp_->getBestValidParameters(parameters, cost));
+}
+
+TEST_F(StompAnytimeTest, stopsAtMaxIterations)
+{
+  parameters_.max_iterations = 5;
+  EXPECT_TRUE(runAnytime(ros::WallTime::now() + ros::WallDuration(60.0)));
+  EXPECT_EQ(getNumIterations(), 5);
+}
+
+TEST_F(StompAnytimeTest, stopsOnConvergence)
+{
+  // far fewer iterations than fit into the deadline, so stopping early means it has converged
+  parameters_.max_iterations = 2000;
+  parameters_.convergence_threshold = 1e-3;
+  parameters_.convergence_window = 5;
+  EXPECT_TRUE(runAnytime(ros::WallTime::now() + ros::WallDuration(60.0)));
+  EXPECT_GT(getNumIterations(), parameters_.convergence_window);
+  EXPECT_LT(getNumIterations(), parameters_.max_iterations);
+}
+
+TEST_F(StompAnytimeTest, reportsEveryImprovement)
+{
+  parameters_.max_iterations = 50;
+  EXPECT_TRUE(runAnytime(ros::WallTime::now() + ros::WallDuration(60.0)));
+
+  // every rollout is valid, so the first iteration already reports
+  ASSERT_FALSE(improvement_costs_.empty());
+  EXPECT_EQ(improvement_iterations_.front(), 0);
+  for (unsigned int i=1; i<improvement_costs_.size(); ++i)
+  {
+    EXPECT_LT(improvement_costs_[i], improvement_costs_[i-1]);
+    EXPECT_GT(improvement_iterations_[i], improvement_iterations_[i-1]);
+  }
+
+  std::vector<Eigen::VectorXd> parameters;
+  double cost;
+  ASSERT_TRUE(stomp_->getBestValidParameters(parameters, cost));
+  EXPECT_EQ(cost, improvement_costs_.back());
+}
+
+} /* namespace stomp */
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "stomp_anytime_test");
+  return RUN_ALL_TESTS();
+}
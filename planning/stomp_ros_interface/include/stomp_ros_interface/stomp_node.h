@@ -29,6 +29,17 @@ public:
 
 private:
   ros::NodeHandle node_handle_;
+
+  // anytime mode: plan until the allowed planning time runs out or the cost converges,
+  // streaming every improved valid trajectory on trajectory_improvements_pub_
+  bool use_anytime_planning_;
+  double default_planning_time_;
+  stomp::StompAnytimeParameters anytime_parameters_;
+  ros::Publisher trajectory_improvements_pub_;
+
+  void publishImprovement(boost::shared_ptr<StompOptimizationTask> task,
+                          const std::vector<Eigen::VectorXd>& parameters, double cost, int iteration);
+
   boost::shared_ptr<planning_environment::CollisionModelsInterface> collision_models_interface_;
 
   ros::ServiceServer plan_path_service_;
@@ -95,6 +95,11 @@ public:
     std::vector<std::vector<Eigen::VectorXd> > tmp_collision_point_acc_; // [collision_point_index][x/y/z]
 
     boost::shared_ptr<KDL::TreeFkSolverJointPosAxisPartial> fk_solver_;
+
+    // time spent [s] since the last call to getExecutionTimings()
+    double fk_time_;
+    double feature_time_;
+
     void differentiate(double dt);
     void publishMarkers(ros::Publisher& viz_pub, int id, bool noiseless, const std::string& reference_frame);
   };
@@ -111,6 +116,7 @@ public:
   void setControlCostWeight(double w);
 
   virtual void onEveryIteration();
+  virtual bool getExecutionTimings(double& fk_time, double& cost_time);
   void setTrajectoryVizPublisher(ros::Publisher& viz_trajectory_pub);
 
 private:
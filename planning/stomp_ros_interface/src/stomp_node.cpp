@@ -6,6 +6,7 @@
  */
 
 #include <ros/ros.h>
+#include <boost/bind.hpp>
 #include <usc_utilities/param_server.h>
 #include <usc_utilities/assert.h>
 #include <stomp_ros_interface/stomp_node.h>
@@ -34,6 +35,13 @@ bool StompNode::run()
   int max_rollouts;
   ROS_VERIFY(optimizer_task_nh.getParam("max_rollouts", max_rollouts));
 
+  node_handle_.param("use_anytime_planning", use_anytime_planning_, false);
+  node_handle_.param("default_planning_time", default_planning_time_, 5.0);
+  node_handle_.param("anytime_max_iterations", anytime_parameters_.max_iterations, anytime_parameters_.max_iterations);
+  node_handle_.param("anytime_convergence_threshold", anytime_parameters_.convergence_threshold, anytime_parameters_.convergence_threshold);
+  node_handle_.param("anytime_convergence_window", anytime_parameters_.convergence_window, anytime_parameters_.convergence_window);
+  trajectory_improvements_pub_ = node_handle_.advertise<trajectory_msgs::JointTrajectory>("trajectory_improvements", 10);
+
   XmlRpc::XmlRpcValue planning_groups_xml;
   if (!stomp_task_nh.getParam("planning_groups", planning_groups_xml) || planning_groups_xml.getType()!=XmlRpc::XmlRpcValue::TypeArray)
   {
@@ -97,14 +105,41 @@ bool StompNode::plan(arm_navigation_msgs::GetMotionPlan::Request& request,
   ros::NodeHandle stomp_optimizer_nh(node_handle_, "optimizer");
   stomp_->initialize(stomp_optimizer_nh, task);
 
-  // TODO: read these params from server
-  bool success = stomp_->runUntilValid(200, 10);
-
+  bool success = false;
   std::vector<Eigen::VectorXd> best_params;
   double best_cost;
-  stomp_->getBestNoiselessParameters(best_params, best_cost);
+  if (use_anytime_planning_)
+  {
+    double planning_time = request.motion_plan_request.allowed_planning_time.toSec();
+    if (planning_time <= 0.0)
+      planning_time = default_planning_time_;
+    ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(planning_time);
+
+    success = stomp_->runAnytime(deadline, anytime_parameters_,
+                                 boost::bind(&StompNode::publishImprovement, this, task, _1, _2, _3));
+    if (!stomp_->getBestValidParameters(best_params, best_cost))
+      stomp_->getBestNoiselessParameters(best_params, best_cost);
+  }
+  else
+  {
+    // TODO: read these params from server
+    success = stomp_->runUntilValid(200, 10);
+    stomp_->getBestNoiselessParameters(best_params, best_cost);
+  }
   task->parametersToJointTrajectory(best_params, response.trajectory.joint_trajectory);
 
+  stomp::StompIterationTimings timings;
+  int num_iterations;
+  stomp_->getAccumulatedTimings(timings, num_iterations);
+  if (num_iterations > 0)
+  {
+    ROS_INFO("STOMP: %d iterations in %f sec (per iteration: rollouts %f, execution %f (cpu time over all threads: fk %f, cost %f), update %f, noiseless %f)",
+             num_iterations, timings.total,
+             timings.generate_rollouts/num_iterations, timings.execute_rollouts/num_iterations,
+             timings.forward_kinematics/num_iterations, timings.cost_evaluation/num_iterations,
+             timings.update/num_iterations, timings.noiseless_rollout/num_iterations);
+  }
+
   if (!success)
   {
     ROS_ERROR("STOMP: failed to find a collision-free plan");
@@ -117,6 +152,16 @@ bool StompNode::plan(arm_navigation_msgs::GetMotionPlan::Request& request,
   return true;
 }
 
+void StompNode::publishImprovement(boost::shared_ptr<StompOptimizationTask> task,
+                                   const std::vector<Eigen::VectorXd>& parameters, double cost, int iteration)
+{
+  ROS_INFO("STOMP: improved valid trajectory at iteration %d, cost = %f", iteration, cost);
+  trajectory_msgs::JointTrajectory trajectory;
+  task->parametersToJointTrajectory(parameters, trajectory);
+  trajectory.header.stamp = ros::Time::now();
+  trajectory_improvements_pub_.publish(trajectory);
+}
+
 } /* namespace stomp_ros_interface */
 
 int main(int argc, char** argv)
@@ -53,6 +53,8 @@ bool StompOptimizationTask::initialize(int num_threads, int num_rollouts)
   {
     per_rollout_data_[i].collision_models_.reset(new planning_environment::CollisionModels("/robot_description"));
     per_rollout_data_[i].collision_models_->disableCollisionsForNonUpdatedLinks(planning_group_name_, true);
+    per_rollout_data_[i].fk_time_ = 0.0;
+    per_rollout_data_[i].feature_time_ = 0.0;
   }
 
   //noisy_rollout_data_.resize(num_rollouts_);
@@ -319,6 +321,7 @@ void StompOptimizationTask::computeFeatures(std::vector<Eigen::VectorXd>& parame
   std::vector<double> joint_angles(num_dimensions_);
 
   // do all forward kinematics
+  ros::WallTime start_time = ros::WallTime::now();
   validity = true;
   bool state_validity;
   for (int t=0; t<num_time_steps_; ++t)
@@ -335,6 +338,8 @@ void StompOptimizationTask::computeFeatures(std::vector<Eigen::VectorXd>& parame
   }
 
   data->differentiate(dt_);
+  ros::WallTime fk_end_time = ros::WallTime::now();
+  data->fk_time_ += (fk_end_time - start_time).toSec();
 
   // actually compute features
   bool validities[num_time_steps_];
@@ -351,6 +356,7 @@ void StompOptimizationTask::computeFeatures(std::vector<Eigen::VectorXd>& parame
     }
 
   }
+  data->feature_time_ += (ros::WallTime::now() - fk_end_time).toSec();
 
   // print validities
   if (rollout_id == num_rollouts_)
@@ -425,6 +431,20 @@ bool StompOptimizationTask::setPolicy(const boost::shared_ptr<stomp::CovariantMo
   return true;
 }
 
+bool StompOptimizationTask::getExecutionTimings(double& fk_time, double& cost_time)
+{
+  fk_time = 0.0;
+  cost_time = 0.0;
+  for (unsigned int i=0; i<per_rollout_data_.size(); ++i)
+  {
+    fk_time += per_rollout_data_[i].fk_time_;
+    cost_time += per_rollout_data_[i].feature_time_;
+    per_rollout_data_[i].fk_time_ = 0.0;
+    per_rollout_data_[i].feature_time_ = 0.0;
+  }
+  return true;
+}
+
 double StompOptimizationTask::getControlCostWeight()
 {
   return control_cost_weight_;
@@ -18,6 +18,7 @@
 #include <Eigen/Eigen>
 #include <geometry_msgs/Pose.h>
 #include <grasp_template/heightmap_difference.h>
+#include <grasp_template/flat_heightmap.h>
 #include <grasp_template/grasp_template.h>
 #include <grasp_template/grasp_template_params.h>
 
@@ -55,11 +56,25 @@ public:
   DismatchMeasure(const GraspTemplate& templt, const geometry_msgs::Pose& gripper_pose);
   DismatchMeasure(const Heightmap& hm, const geometry_msgs::Pose& templt_pose, const geometry_msgs::Pose& gripper_pose);
 
+  /* restores a measure from precomputed state, masked_templt has the mask already
+   * applied and flat_mask is indexed like getFlatMask() */
+  DismatchMeasure(const GraspTemplate& masked_templt, const geometry_msgs::Pose& gripper_pose,
+      const std::vector<double>& flat_mask);
+
   const GraspTemplate& getLibTemplt() const { return lib_template_;};
   TemplateDissimilarity getScore(const GraspTemplate& sample) const;
   TemplateDissimilarity getScore(const GraspTemplate& sample, const GraspTemplate& lib_templt) const;
   void applyDcMask(GraspTemplate& templt) const;
 
+  /* same results as applyDcMask on a copy of sample followed by getScore(),
+   * the mask is applied on the fly and nothing is copied */
+  TemplateDissimilarity getMaskedScore(const FlatHeightmap& sample) const;
+  TemplateDissimilarity getMaskedScore(const FlatHeightmap& sample, const FlatHeightmap& lib_templt) const;
+  void applyDcMask(FlatHeightmap& templt) const;
+  const FlatHeightmap& getFlatLibTemplt() const { return flat_lib_template_;};
+  const std::vector<double>& getFlatMask() const { return flat_mask_;};
+  const geometry_msgs::Pose& getGripperPose() const { return lib_template_gripper_pose_;};
+
 private:
 
   GraspTemplate lib_template_;
@@ -68,12 +83,22 @@ private:
   double max_dist_;
   std::vector<std::vector<double> > weights_;
 
+  /* flat versions for the copy-free path, indexed like TemplateHeightmap::getGrid() */
+  FlatHeightmap flat_lib_template_;
+  std::vector<double> flat_mask_;
+  double pair_weights_[TS_UNSET + 1][TS_UNSET + 1]; //indexed by TileState, negative if not scored
+
+  void maskTile(unsigned int i, unsigned char& state, double& value) const;
+  TemplateDissimilarity computeScore(const FlatHeightmap& sample, bool mask_sample,
+      const FlatHeightmap& lib_templt) const;
+
   void fillStateStat(const HeightmapDifference& diff, TemplateDissimilarity& score) const;
   void computeMask(std::vector<std::vector<double> >& mask) const;
   void maskTemplate();
   void planeToMask(const Eigen::Vector3d& p, const Eigen::Vector3d& v1, const Eigen::Vector3d& v2, std::vector<
       std::vector<double> >& mask) const;
   void constructClass(const geometry_msgs::Pose& gripper_pose);
+  void constructFromMask();
 };
 
 } //namespace
@@ -0,0 +1,46 @@
+/*********************************************************************
+ Computational Learning and Motor Control Lab
+ University of Southern California
+ Prof. Stefan Schaal
+ *********************************************************************
+ \remarks      Heightmap decoded once into per-tile states and values,
+               laid out like TemplateHeightmap::getGrid(), so that
+               matching does not have to decode or copy templates.
+
+ \file         flat_heightmap.h
+
+ *********************************************************************/
+
+#ifndef FLAT_HEIGHTMAP_H_
+#define FLAT_HEIGHTMAP_H_
+
+#include <vector>
+#include <Eigen/Eigen>
+
+#include <grasp_template/Heightmap.h>
+#include <grasp_template/template_heightmap.h>
+
+namespace grasp_template
+{
+
+struct FlatHeightmap
+{
+public:
+
+  FlatHeightmap();
+  explicit FlatHeightmap(const TemplateHeightmap& hm);
+
+  unsigned int num_tiles_x_, num_tiles_y_;
+  std::vector<double> values_; //as returned by TemplateHeightmap::getGridTile(i, ts)
+  std::vector<unsigned char> states_; //TileState
+
+  void set(const TemplateHeightmap& hm);
+  void set(const Heightmap& hm);
+  unsigned int size() const {return values_.size();};
+
+  /* block averages of the tile heights (empty and unset tiles count as 0) */
+  void getCoarseDescriptor(unsigned int block_size, Eigen::VectorXf& descriptor) const;
+};
+
+} //namespace
+#endif /* FLAT_HEIGHTMAP_H_ */
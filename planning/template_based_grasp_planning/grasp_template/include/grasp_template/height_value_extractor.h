@@ -15,10 +15,14 @@
 #ifndef HEIGHT_VALUE_EXTRACTOR_H_
 #define HEIGHT_VALUE_EXTRACTOR_H_
 
+#include <vector>
+#include <boost/shared_ptr.hpp>
 #include <Eigen/Eigen>
 #include <pcl/point_types.h>
 #include <pcl/point_cloud.h>
 
+#include <grasp_template/point_voxel_index.h>
+
 namespace grasp_template
 {
 
@@ -34,6 +38,12 @@ public:
   Eigen::Matrix<double, 3, Eigen::Dynamic> points_;
 
   void getPointsInROI(std::vector<int>& indices) const;
+  /* same, reusing candidates as scratch space */
+  void getPointsInROI(std::vector<int>& candidates, std::vector<int>& indices) const;
+  /* candidate indices (into the initialization cloud) of points in the prism
+   * |x| <= half_x, |y| <= half_y of the frame that to_prism maps the cloud frame into */
+  void getPointsInPrism(const Eigen::Transform<double, 3, Eigen::Affine>& to_prism,
+      double half_x, double half_y, std::vector<int>& indices) const;
   bool getFogHeight(double& fog_height);
 
   void initialize(const pcl::PointCloud<pcl::PointXYZ>& pc, const Eigen::Vector3d& trans, const Eigen::Quaterniond& rot);
@@ -53,6 +63,13 @@ private:
   Eigen::Vector3d sep_normal_;
   double sep_const_; //sep_normal_ * Xi == sep_const_, Xi in sep-plane
   double roi_threshold_;
+
+  Eigen::Transform<double, 3, Eigen::Affine> from_grid_transform_;
+
+  /* shared between copies, the points never change after initialize() */
+  boost::shared_ptr<const PointVoxelIndex> voxel_index_;
+  std::vector<int> poi_indices_;
+  std::vector<int> candidate_indices_;
 };
 
 } //namespace
@@ -93,6 +93,7 @@ private:
   pcl::PointCloud<pcl::Normal> normals_;
 //  std::string point_cloud_frame_id_;
   HeightValueExtractor img_ss_;
+  std::vector<int> prism_indices_;
 
   bool calculateNormalsFromHullSurface();
   bool calculateConvexHull();
@@ -0,0 +1,59 @@
+/*********************************************************************
+ Computational Learning and Motor Control Lab
+ University of Southern California
+ Prof. Stefan Schaal
+ *********************************************************************
+ \remarks      Sparse voxel index over a fixed point set. Points are
+               grouped by voxel so that range queries only touch the
+               points of voxels that can intersect the query region.
+
+ \file         point_voxel_index.h
+
+ *********************************************************************/
+
+#ifndef POINT_VOXEL_INDEX_H_
+#define POINT_VOXEL_INDEX_H_
+
+#include <vector>
+#include <Eigen/Eigen>
+
+namespace grasp_template
+{
+
+class PointVoxelIndex
+{
+public:
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  PointVoxelIndex();
+
+  void build(const Eigen::Matrix<double, 3, Eigen::Dynamic>& points, double voxel_size);
+
+  /* appends the indices of all points in voxels that may intersect the
+   * prism |x| <= half_x, |y| <= half_y (unbounded in z) of the frame
+   * to_prism maps into; the result is a superset, callers test exactly */
+  void getPointsInPrism(const Eigen::Transform<double, 3, Eigen::Affine>& to_prism,
+      double half_x, double half_y, std::vector<int>& indices) const;
+
+  /* same for the slab |normal * p| < threshold around a plane through the origin */
+  void getPointsNearPlane(const Eigen::Vector3d& normal, double threshold,
+      std::vector<int>& indices) const;
+
+  unsigned int getNumVoxels() const {return voxel_begin_.empty() ? 0 : voxel_begin_.size() - 1;};
+  double getVoxelSize() const {return voxel_size_;};
+
+private:
+
+  double voxel_size_;
+  double half_diagonal_;
+
+  Eigen::Matrix<double, 3, Eigen::Dynamic> voxel_centers_;
+  std::vector<unsigned int> voxel_begin_; //points of voxel v are point_indices_[voxel_begin_[v], voxel_begin_[v+1])
+  std::vector<int> point_indices_;
+
+  void appendVoxel(unsigned int v, std::vector<int>& indices) const;
+};
+
+} //namespace
+#endif /* POINT_VOXEL_INDEX_H_ */
@@ -12,6 +12,9 @@
 
  *********************************************************************/
 
+#include <cassert>
+#include <cmath>
+
 #include <grasp_template/heightmap_difference.h>
 #include <grasp_template/dismatch_measure.h>
 
@@ -150,6 +153,28 @@ DismatchMeasure::DismatchMeasure(const Heightmap& hm, const geometry_msgs::Pose&
   constructClass(gripper_pose);
 }
 
+DismatchMeasure::DismatchMeasure(const GraspTemplate& masked_templt, const geometry_msgs::Pose& gripper_pose,
+                                 const std::vector<double>& flat_mask) :
+  lib_template_(masked_templt)
+{
+  lib_template_gripper_pose_ = gripper_pose;
+
+  const unsigned int num_x = lib_template_.heightmap_.getNumTilesX();
+  const unsigned int num_y = lib_template_.heightmap_.getNumTilesY();
+  assert(flat_mask.size() == num_x * num_y);
+  mask_.resize(num_x);
+  for (unsigned int ix = 0; ix < num_x; ix++)
+  {
+    mask_[ix].resize(num_y);
+    for (unsigned int iy = 0; iy < num_y; iy++)
+    {
+      mask_[ix][iy] = flat_mask[iy * num_x + ix];
+    }
+  }
+
+  constructFromMask();
+}
+
 TemplateDissimilarity DismatchMeasure::getScore(const GraspTemplate& sample) const
 {
   return getScore(sample, lib_template_);
@@ -389,6 +414,121 @@ void DismatchMeasure::applyDcMask(GraspTemplate& templt) const
   }
 }
 
+void DismatchMeasure::applyDcMask(FlatHeightmap& templt) const
+{
+  for (unsigned int i = 0; i < templt.size(); i++)
+  {
+    maskTile(i, templt.states_[i], templt.values_[i]);
+  }
+}
+
+void DismatchMeasure::maskTile(unsigned int i, unsigned char& state, double& value) const
+{
+  /* mirrors applyDcMask and setGridTileDontCare, including the shift to and
+   * from TH_DONT_CARE_ZERO, so that values are bit-identical */
+  const double mask = flat_mask_[i];
+  if (value < mask || value == TemplateHeightmap::TH_EMPTY_TILE || value > 0.1)
+  {
+    if (mask > TemplateHeightmap::TH_DEPTH)
+    {
+      state = TS_DONTCARE;
+      value = (TemplateHeightmap::TH_DONT_CARE_ZERO + TemplateHeightmap::TH_DEPTH)
+          - TemplateHeightmap::TH_DONT_CARE_ZERO;
+    }
+    else if (mask < -TemplateHeightmap::TH_DEPTH)
+    {
+      state = TS_EMPTY;
+      value = TemplateHeightmap::TH_EMPTY_TILE;
+    }
+    else
+    {
+      state = TS_DONTCARE;
+      value = (mask + TemplateHeightmap::TH_DONT_CARE_ZERO) - TemplateHeightmap::TH_DONT_CARE_ZERO;
+    }
+  }
+}
+
+TemplateDissimilarity DismatchMeasure::getMaskedScore(const FlatHeightmap& sample) const
+{
+  return computeScore(sample, true, flat_lib_template_);
+}
+
+TemplateDissimilarity DismatchMeasure::getMaskedScore(const FlatHeightmap& sample,
+                                                      const FlatHeightmap& lib_templt) const
+{
+  return computeScore(sample, true, lib_templt);
+}
+
+TemplateDissimilarity DismatchMeasure::computeScore(const FlatHeightmap& sample, bool mask_sample,
+                                                    const FlatHeightmap& lib_templt) const
+{
+  assert(sample.size() == lib_templt.size());
+
+  TemplateDissimilarity score;
+  score.max_dist_ = max_dist_;
+  unsigned int counts[TS_UNSET + 1][TS_UNSET + 1] = { {0}};
+
+  const unsigned int n = sample.size();
+  if (n == 0)
+  {
+    return score;
+  }
+  const unsigned char* states_1 = &sample.states_[0];
+  const unsigned char* states_2 = &lib_templt.states_[0];
+  const double* values_1 = &sample.values_[0];
+  const double* values_2 = &lib_templt.values_[0];
+
+  /* same per tile logic as HeightmapDifference, fillStateStat and getScore */
+  for (unsigned int i = 0; i < n; i++)
+  {
+    unsigned char s1 = states_1[i];
+    double v1 = values_1[i];
+    if (mask_sample)
+    {
+      maskTile(i, s1, v1);
+    }
+    const unsigned char s2 = states_2[i];
+    double v2 = values_2[i];
+
+    if (s1 == TS_EMPTY)
+    {
+      v1 = 0;
+      if (s2 == TS_DONTCARE)
+        v2 = 0;
+    }
+    if (s2 == TS_EMPTY)
+    {
+      v2 = 0;
+      if (s1 == TS_DONTCARE)
+        v1 = 0;
+    }
+
+    counts[s1][s2]++;
+    const double w = pair_weights_[s1][s2];
+    score.distances_sum_ += w < 0 ? -1 : w * abs(v1 - v2);
+  }
+  score.relevants_ = n;
+
+  score.ss_ = counts[TS_SOLID][TS_SOLID];
+  score.sf_ = counts[TS_SOLID][TS_FOG];
+  score.sd_ = counts[TS_SOLID][TS_DONTCARE];
+  score.st_ = counts[TS_SOLID][TS_TABLE];
+  score.fs_ = counts[TS_FOG][TS_SOLID];
+  score.ff_ = counts[TS_FOG][TS_FOG];
+  score.fd_ = counts[TS_FOG][TS_DONTCARE];
+  score.ft_ = counts[TS_FOG][TS_TABLE];
+  score.ds_ = counts[TS_DONTCARE][TS_SOLID];
+  score.df_ = counts[TS_DONTCARE][TS_FOG];
+  score.dd_ = counts[TS_DONTCARE][TS_DONTCARE];
+  score.dt_ = counts[TS_DONTCARE][TS_TABLE];
+  score.ts_ = counts[TS_TABLE][TS_SOLID];
+  score.tf_ = counts[TS_TABLE][TS_FOG];
+  score.td_ = counts[TS_TABLE][TS_DONTCARE];
+  score.tt_ = counts[TS_TABLE][TS_TABLE];
+
+  return score;
+}
+
 void DismatchMeasure::fillStateStat(const HeightmapDifference& diff, TemplateDissimilarity& score) const
 {
   for (unsigned int i = 0; i < diff.diff_.size(); i++)
@@ -616,7 +756,11 @@ void DismatchMeasure::constructClass(const geometry_msgs::Pose& gripper_pose)
 {
   lib_template_gripper_pose_ = gripper_pose;
   maskTemplate();
+  constructFromMask();
+}
 
+void DismatchMeasure::constructFromMask()
+{
   //apply bounding box cut offs
   max_dist_ = 0;
   for (unsigned int i = 0; i < mask_.size(); i++)
@@ -640,5 +784,35 @@ void DismatchMeasure::constructClass(const geometry_msgs::Pose& gripper_pose)
   weights_[2][1] = weights_[2][2] = weights_[2][3] = 1;
   weights_[3][0] = 1;
   weights_[3][1] = weights_[3][2] = weights_[3][3] = 1;
+
+  /* flat data for getMaskedScore; weights_ is ordered solid, dont care, fog, table */
+  flat_lib_template_.set(lib_template_.heightmap_);
+  const unsigned int num_x = lib_template_.heightmap_.getNumTilesX();
+  const unsigned int num_y = lib_template_.heightmap_.getNumTilesY();
+  flat_mask_.resize(num_x * num_y);
+  for (unsigned int ix = 0; ix < num_x; ix++)
+  {
+    for (unsigned int iy = 0; iy < num_y; iy++)
+    {
+      flat_mask_[iy * num_x + ix] = mask_[ix][iy];
+    }
+  }
+
+  int weight_index[TS_UNSET + 1];
+  weight_index[TS_SOLID] = 0;
+  weight_index[TS_DONTCARE] = 1;
+  weight_index[TS_FOG] = 2;
+  weight_index[TS_TABLE] = 3;
+  weight_index[TS_EMPTY] = weight_index[TS_UNSET] = -1;
+  for (unsigned int i = 0; i <= TS_UNSET; i++)
+  {
+    for (unsigned int j = 0; j <= TS_UNSET; j++)
+    {
+      if (weight_index[i] < 0 || weight_index[j] < 0)
+        pair_weights_[i][j] = -1;
+      else
+        pair_weights_[i][j] = weights_[weight_index[i]][weight_index[j]];
+    }
+  }
 }
 }
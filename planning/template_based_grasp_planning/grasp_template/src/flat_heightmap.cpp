@@ -0,0 +1,76 @@
+/*********************************************************************
+ Computational Learning and Motor Control Lab
+ University of Southern California
+ Prof. Stefan Schaal
+ *********************************************************************
+ \remarks      ...
+
+ \file         flat_heightmap.cpp
+
+ *********************************************************************/
+
+#include <grasp_template/flat_heightmap.h>
+
+using namespace std;
+using namespace Eigen;
+
+namespace grasp_template
+{
+
+FlatHeightmap::FlatHeightmap() :
+  num_tiles_x_(0), num_tiles_y_(0)
+{
+}
+
+FlatHeightmap::FlatHeightmap(const TemplateHeightmap& hm)
+{
+  set(hm);
+}
+
+void FlatHeightmap::set(const TemplateHeightmap& hm)
+{
+  num_tiles_x_ = hm.getNumTilesX();
+  num_tiles_y_ = hm.getNumTilesY();
+
+  const unsigned int n = hm.getGrid().size();
+  values_.resize(n);
+  states_.resize(n);
+  for (unsigned int i = 0; i < n; i++)
+  {
+    TileState ts;
+    values_[i] = hm.getGridTile(i, ts);
+    states_[i] = static_cast<unsigned char> (ts);
+  }
+}
+
+void FlatHeightmap::set(const Heightmap& hm)
+{
+  TemplateHeightmap t(hm.num_tiles_x, hm.num_tiles_y, hm.map_length_x, hm.map_length_y);
+  t.setGrid(hm.heightmap);
+  set(t);
+}
+
+void FlatHeightmap::getCoarseDescriptor(unsigned int block_size, VectorXf& descriptor) const
+{
+  const unsigned int blocks_x = (num_tiles_x_ + block_size - 1) / block_size;
+  const unsigned int blocks_y = (num_tiles_y_ + block_size - 1) / block_size;
+  descriptor = VectorXf::Zero(blocks_x * blocks_y);
+  VectorXf tiles_per_block = VectorXf::Zero(blocks_x * blocks_y);
+
+  for (unsigned int iy = 0; iy < num_tiles_y_; iy++)
+  {
+    for (unsigned int ix = 0; ix < num_tiles_x_; ix++)
+    {
+      const unsigned int i = iy * num_tiles_x_ + ix;
+      const unsigned int b = (iy / block_size) * blocks_x + ix / block_size;
+      tiles_per_block(b) += 1.0f;
+      if (states_[i] != TS_EMPTY && states_[i] != TS_UNSET)
+      {
+        descriptor(b) += static_cast<float> (values_[i]);
+      }
+    }
+  }
+  descriptor = descriptor.cwiseQuotient(tiles_per_block);
+}
+
+} //namespace
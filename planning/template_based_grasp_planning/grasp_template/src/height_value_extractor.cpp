@@ -33,19 +33,56 @@ HeightValueExtractor::HeightValueExtractor()
 
 void HeightValueExtractor::getPointsInROI(vector<int>& indices) const
 {
-  for (int i = 0; i < points_.cols(); i++)
+  vector<int> candidates;
+  getPointsInROI(candidates, indices);
+}
+
+void HeightValueExtractor::getPointsInROI(vector<int>& candidates, vector<int>& indices) const
+{
+  if (voxel_index_ == NULL)
   {
-    if (isPointInRegionOfInterest(points_.col(i)))
+    for (int i = 0; i < points_.cols(); i++)
+    {
+      if (isPointInRegionOfInterest(points_.col(i)))
+      {
+        indices.push_back(i);
+      }
+    }
+    return;
+  }
+
+  /* only test points of voxels close to the roi plane */
+  candidates.clear();
+  voxel_index_->getPointsNearPlane(roi_normal_, roi_threshold_, candidates);
+  for (unsigned int i = 0; i < candidates.size(); i++)
+  {
+    if (isPointInRegionOfInterest(points_.col(candidates[i])))
+    {
+      indices.push_back(candidates[i]);
+    }
+  }
+}
+
+void HeightValueExtractor::getPointsInPrism(const Transform<double, 3, Affine>& to_prism,
+    double half_x, double half_y, vector<int>& indices) const
+{
+  if (voxel_index_ == NULL)
+  {
+    for (int i = 0; i < points_.cols(); i++)
     {
       indices.push_back(i);
     }
+    return;
   }
+
+  voxel_index_->getPointsInPrism(to_prism * from_grid_transform_, half_x, half_y, indices);
 }
 
 bool HeightValueExtractor::getFogHeight(double& fog_height)
 {
-  vector<int> poi_indices;
-  getPointsInROI(poi_indices);
+  vector<int>& poi_indices = poi_indices_;
+  poi_indices.clear();
+  getPointsInROI(candidate_indices_, poi_indices);
   bool is_fog = false;
   int max_index = -1;
   double max_height = -numeric_limits<double>::max();
@@ -81,6 +118,7 @@ bool HeightValueExtractor::getFogHeight(double& fog_height)
 void HeightValueExtractor::initialize(const pcl::PointCloud<pcl::PointXYZ>& pc, const Vector3d& trans, const Quaterniond& rot)
 {
   to_grid_transform_.fromPositionOrientationScale(rot.inverse() * (-trans), rot.inverse(), Vector3d::Ones());
+  from_grid_transform_ = to_grid_transform_.inverse();
   points_.resize(3, pc.points.size());
 
   for (unsigned int i = 0; i < pc.points.size(); i++)
@@ -92,6 +130,17 @@ void HeightValueExtractor::initialize(const pcl::PointCloud<pcl::PointXYZ>& pc,
     p = to_grid_transform_ * p;
     points_.col(i) = p;
   }
+
+  /* voxels a few tiles wide keep the number of voxels small while still
+   * rejecting most points for a single template or bin ray */
+  double voxel_size = GraspTemplateParams::getTemplateWidth() / 4.0;
+  if (voxel_size <= 0)
+  {
+    voxel_size = 0.02;
+  }
+  boost::shared_ptr<PointVoxelIndex> index(new PointVoxelIndex());
+  index->build(points_, voxel_size);
+  voxel_index_ = index;
 }
 
 bool HeightValueExtractor::isPointInRegionOfInterest(const Vector3d& p) const
@@ -177,10 +177,15 @@ bool HeightmapSampling::generateTemplate(GraspTemplate& templt, const Vector3d&
       templt.object_to_template_rotation_, Vector3d::Ones());
   to_templt = to_templt.inverse();
 
-  /* choose points in range for heightmap and set heights */
-  for (PointCloud<PointXYZ>::const_iterator it = point_cloud_->begin(); it != point_cloud_->end(); it++)
+  /* choose points in range for heightmap and set heights, only visiting
+   * points of voxels that intersect the template footprint */
+  prism_indices_.clear();
+  img_ss_.getPointsInPrism(to_templt, templt.heightmap_.getMapLengthX() / 2.0,
+      templt.heightmap_.getMapLengthY() / 2.0, prism_indices_);
+  for (vector<int>::const_iterator i_it = prism_indices_.begin(); i_it != prism_indices_.end(); i_it++)
   {
     /* transform to heightmap frame */
+    const PointXYZ* it = &point_cloud_->points[*i_it];
     Vector3d p(it->x, it->y, it->z);
     p = to_templt * p;
 
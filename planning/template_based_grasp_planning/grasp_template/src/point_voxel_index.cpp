@@ -0,0 +1,116 @@
+/*********************************************************************
+ Computational Learning and Motor Control Lab
+ University of Southern California
+ Prof. Stefan Schaal
+ *********************************************************************
+ \remarks      ...
+
+ \file         point_voxel_index.cpp
+
+ *********************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <grasp_template/point_voxel_index.h>
+
+using namespace std;
+using namespace Eigen;
+
+namespace grasp_template
+{
+
+PointVoxelIndex::PointVoxelIndex() :
+  voxel_size_(0.0), half_diagonal_(0.0)
+{
+}
+
+void PointVoxelIndex::build(const Matrix<double, 3, Dynamic>& points, double voxel_size)
+{
+  voxel_size_ = voxel_size;
+  half_diagonal_ = sqrt(3.0) / 2.0 * voxel_size_;
+  voxel_begin_.clear();
+  point_indices_.clear();
+  voxel_centers_.resize(3, 0);
+
+  const int num_points = points.cols();
+  if (num_points == 0 || voxel_size_ <= 0)
+    return;
+
+  const Vector3d min_corner = points.rowwise().minCoeff();
+  const Vector3d max_corner = points.rowwise().maxCoeff();
+  const long long dim_x = static_cast<long long> ((max_corner.x() - min_corner.x()) / voxel_size_) + 1;
+  const long long dim_y = static_cast<long long> ((max_corner.y() - min_corner.y()) / voxel_size_) + 1;
+
+  /* sort points by linear voxel key */
+  vector<pair<long long, int> > keyed(num_points);
+  for (int i = 0; i < num_points; i++)
+  {
+    const Vector3d rel = (points.col(i) - min_corner) / voxel_size_;
+    const long long ix = static_cast<long long> (rel.x());
+    const long long iy = static_cast<long long> (rel.y());
+    const long long iz = static_cast<long long> (rel.z());
+    keyed[i] = make_pair((iz * dim_y + iy) * dim_x + ix, i);
+  }
+  sort(keyed.begin(), keyed.end());
+
+  /* group into voxels */
+  point_indices_.resize(num_points);
+  vector<long long> keys;
+  for (int i = 0; i < num_points; i++)
+  {
+    if (i == 0 || keyed[i].first != keyed[i - 1].first)
+    {
+      voxel_begin_.push_back(i);
+      keys.push_back(keyed[i].first);
+    }
+    point_indices_[i] = keyed[i].second;
+  }
+  voxel_begin_.push_back(num_points);
+
+  voxel_centers_.resize(3, keys.size());
+  for (unsigned int v = 0; v < keys.size(); v++)
+  {
+    const long long ix = keys[v] % dim_x;
+    const long long iy = (keys[v] / dim_x) % dim_y;
+    const long long iz = keys[v] / (dim_x * dim_y);
+    voxel_centers_.col(v) = min_corner + voxel_size_ * Vector3d(ix + 0.5, iy + 0.5, iz + 0.5);
+  }
+}
+
+void PointVoxelIndex::getPointsInPrism(const Transform<double, 3, Affine>& to_prism,
+    double half_x, double half_y, vector<int>& indices) const
+{
+  const double range_x = half_x + half_diagonal_;
+  const double range_y = half_y + half_diagonal_;
+  for (unsigned int v = 0; v < getNumVoxels(); v++)
+  {
+    const Vector3d c = to_prism * Vector3d(voxel_centers_.col(v));
+    if (std::abs(c.x()) <= range_x && std::abs(c.y()) <= range_y)
+    {
+      appendVoxel(v, indices);
+    }
+  }
+}
+
+void PointVoxelIndex::getPointsNearPlane(const Vector3d& normal, double threshold,
+    vector<int>& indices) const
+{
+  const double range = threshold + half_diagonal_ * normal.norm();
+  for (unsigned int v = 0; v < getNumVoxels(); v++)
+  {
+    if (std::abs(normal.dot(voxel_centers_.col(v))) < range)
+    {
+      appendVoxel(v, indices);
+    }
+  }
+}
+
+void PointVoxelIndex::appendVoxel(unsigned int v, vector<int>& indices) const
+{
+  indices.insert(indices.end(), point_indices_.begin() + voxel_begin_[v],
+      point_indices_.begin() + voxel_begin_[v + 1]);
+}
+
+} //namespace
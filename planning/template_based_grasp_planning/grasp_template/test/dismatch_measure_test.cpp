@@ -0,0 +1,174 @@
+/*********************************************************************
+ Computational Learning and Motor Control Lab
+ University of Southern California
+ Prof. Stefan Schaal
+ *********************************************************************
+ \remarks      Compares the flat, masked scoring of DismatchMeasure with
+               masking a copy of the template followed by getScore().
+
+ \file         dismatch_measure_test.cpp
+
+ *********************************************************************/
+
+#include <cstdlib>
+#include <gtest/gtest.h>
+
+#include <grasp_template/template_heightmap.h>
+#include <grasp_template/flat_heightmap.h>
+#include <grasp_template/grasp_template.h>
+#include <grasp_template/dismatch_measure.h>
+
+using namespace grasp_template;
+
+static const unsigned int NUM_FIXTURES = 50;
+
+/* a template with random tiles of every state */
+static void createTemplate(GraspTemplate& templt)
+{
+  templt.heightmap_ = TemplateHeightmap(TemplateHeightmap::TH_DEFAULT_NUM_TILES_X,
+                                        TemplateHeightmap::TH_DEFAULT_NUM_TILES_Y, 0.2, 0.2);
+  templt.object_to_template_translation_ = Eigen::Vector3d::Zero();
+  templt.object_to_template_rotation_ = Eigen::Quaterniond::Identity();
+  for (unsigned int ix = 0; ix < templt.heightmap_.getNumTilesX(); ix++)
+  {
+    for (unsigned int iy = 0; iy < templt.heightmap_.getNumTilesY(); iy++)
+    {
+      double x, y;
+      templt.heightmap_.gridToWorldCoordinates(ix, iy, x, y);
+      const double value = (rand() % 2000 - 1000) / 10000.0;
+      switch (rand() % 6)
+      {
+        case 0:
+          templt.heightmap_.setGridTileSolid(x, y, value);
+          break;
+        case 1:
+          templt.heightmap_.setGridTileFog(x, y, value);
+          break;
+        case 2:
+          templt.heightmap_.setGridTileEmpty(x, y);
+          break;
+        case 3:
+          templt.heightmap_.setGridTileTable(x, y, value);
+          break;
+        case 4:
+          templt.heightmap_.setGridTileDontCare(x, y, value);
+          break;
+        default:
+          break; //unset
+      }
+    }
+  }
+}
+
+/* the flat scoring is meant to be bit-identical, so no tolerance. distance_sums_ is
+ * not filled by either scoring */
+static void expectEqual(const TemplateDissimilarity& expected, const TemplateDissimilarity& actual)
+{
+  EXPECT_EQ(expected.relevants_, actual.relevants_);
+  EXPECT_EQ(expected.ss_, actual.ss_);
+  EXPECT_EQ(expected.sf_, actual.sf_);
+  EXPECT_EQ(expected.sd_, actual.sd_);
+  EXPECT_EQ(expected.st_, actual.st_);
+  EXPECT_EQ(expected.fs_, actual.fs_);
+  EXPECT_EQ(expected.ff_, actual.ff_);
+  EXPECT_EQ(expected.fd_, actual.fd_);
+  EXPECT_EQ(expected.ft_, actual.ft_);
+  EXPECT_EQ(expected.ds_, actual.ds_);
+  EXPECT_EQ(expected.df_, actual.df_);
+  EXPECT_EQ(expected.dd_, actual.dd_);
+  EXPECT_EQ(expected.dt_, actual.dt_);
+  EXPECT_EQ(expected.ts_, actual.ts_);
+  EXPECT_EQ(expected.tf_, actual.tf_);
+  EXPECT_EQ(expected.td_, actual.td_);
+  EXPECT_EQ(expected.tt_, actual.tt_);
+  EXPECT_EQ(expected.distances_sum_, actual.distances_sum_);
+  EXPECT_EQ(expected.max_dist_, actual.max_dist_);
+  EXPECT_EQ(expected.getScore(), actual.getScore());
+}
+
+class DismatchMeasureTest : public testing::Test
+{
+protected:
+
+  void SetUp()
+  {
+    srand(0);
+  }
+
+  /* library grasps with differently oriented templates and gripper poses, so
+   * that the don't-care mask cuts through the template in different places */
+  static void createLibGrasp(unsigned int k, GraspTemplate& lib, geometry_msgs::Pose& gripper_pose)
+  {
+    createTemplate(lib);
+    lib.object_to_template_rotation_ = Eigen::Quaterniond(
+        Eigen::AngleAxisd(0.3 * k, Eigen::Vector3d(0.2, 1.0, 0.3).normalized()));
+    gripper_pose = geometry_msgs::Pose();
+    gripper_pose.position.z = 0.05 * (k % 5) - 0.1;
+    gripper_pose.orientation.w = 1.0;
+  }
+};
+
+TEST_F(DismatchMeasureTest, maskedScoreMatchesMaskedCopy)
+{
+  for (unsigned int k = 0; k < NUM_FIXTURES; k++)
+  {
+    GraspTemplate lib;
+    geometry_msgs::Pose gripper_pose;
+    createLibGrasp(k, lib, gripper_pose);
+    const DismatchMeasure dm(lib, gripper_pose);
+
+    GraspTemplate sample;
+    createTemplate(sample);
+    GraspTemplate masked_sample = sample;
+    dm.applyDcMask(masked_sample);
+
+    expectEqual(dm.getScore(masked_sample), dm.getMaskedScore(FlatHeightmap(sample.heightmap_)));
+  }
+}
+
+TEST_F(DismatchMeasureTest, maskedScoreMatchesMaskedCopyForOtherTemplate)
+{
+  for (unsigned int k = 0; k < NUM_FIXTURES; k++)
+  {
+    GraspTemplate lib;
+    geometry_msgs::Pose gripper_pose;
+    createLibGrasp(k, lib, gripper_pose);
+    const DismatchMeasure dm(lib, gripper_pose);
+
+    GraspTemplate sample, other;
+    createTemplate(sample);
+    createTemplate(other);
+    GraspTemplate masked_sample = sample;
+    dm.applyDcMask(masked_sample);
+    GraspTemplate masked_other = other;
+    dm.applyDcMask(masked_other);
+
+    FlatHeightmap flat_other(other.heightmap_);
+    dm.applyDcMask(flat_other);
+    expectEqual(dm.getScore(masked_sample, masked_other),
+                dm.getMaskedScore(FlatHeightmap(sample.heightmap_), flat_other));
+  }
+}
+
+TEST_F(DismatchMeasureTest, restoredMeasureScoresLikeOriginal)
+{
+  for (unsigned int k = 0; k < NUM_FIXTURES; k++)
+  {
+    GraspTemplate lib;
+    geometry_msgs::Pose gripper_pose;
+    createLibGrasp(k, lib, gripper_pose);
+    const DismatchMeasure dm(lib, gripper_pose);
+    const DismatchMeasure restored(dm.getLibTemplt(), dm.getGripperPose(), dm.getFlatMask());
+
+    GraspTemplate sample;
+    createTemplate(sample);
+    const FlatHeightmap flat_sample(sample.heightmap_);
+    expectEqual(dm.getMaskedScore(flat_sample), restored.getMaskedScore(flat_sample));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
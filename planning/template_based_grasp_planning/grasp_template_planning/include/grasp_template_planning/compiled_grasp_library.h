@@ -0,0 +1,102 @@
+/*********************************************************************
+ Computational Learning and Motor Control Lab
+ University of Southern California
+ Prof. Stefan Schaal
+ *********************************************************************
+ \remarks      ...
+
+ \file         compiled_grasp_library.h
+
+ *********************************************************************/
+
+#ifndef COMPILED_GRASP_LIBRARY_H_
+#define COMPILED_GRASP_LIBRARY_H_
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <Eigen/StdVector>
+
+#include <grasp_template/dismatch_measure.h>
+#include <grasp_template_planning/GraspAnalysis.h>
+#include <grasp_template_planning/grasp_planning_params.h>
+#include <grasp_template_planning/template_matching.h>
+
+namespace grasp_template_planning
+{
+
+/*
+ * A grasp library with the failures and successes of each library grasp and the
+ * precomputed state of their match handlers in one binary file. The file is
+ * read once and decoded into the match handlers, so planning requests do not
+ * have to parse bags or recompute masks. Feedback is appended to the file in
+ * place.
+ *
+ * File layout (native byte order):
+ *   file header   | magic, version, number of records, end of the last record
+ *   records       | record header, masked grid and mask (library grasps and
+ *                 | successes only), serialized GraspAnalysis, padding to 8 bytes
+ *
+ * Every record header stores the size of its record, the record table is
+ * rebuilt from these on load. Records beyond the end stored in the file
+ * header are ignored, so an interrupted append leaves a valid file. A file with
+ * a record that does not fit its size or cannot be decoded is rejected.
+ */
+class CompiledGraspLibrary : private GraspPlanningParams
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  enum RecordKind
+  {
+    CGL_LIBRARY = 0, CGL_SUCCESS, CGL_FAILURE
+  };
+
+  CompiledGraspLibrary(const std::string& filename);
+
+  /* writes a new file, lib_failures and lib_successes are indexed like lib_grasps */
+  static bool compile(const std::string& filename,
+      const std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> >& lib_grasps,
+      const std::vector<std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > >& lib_failures,
+      const std::vector<std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > >& lib_successes);
+
+  bool load();
+  bool isLoaded() const;
+  const std::string& getFilename() const {return filename_;};
+
+  /* feedback with templates of another size is ignored, as when reading the feedback bags */
+  static bool isValidFeedback(const GraspAnalysis& feedback);
+
+  /* returns -1 if lib_grasp is not part of the library */
+  int findLibGrasp(const GraspAnalysis& lib_grasp) const;
+  bool addFailure(const GraspAnalysis& lib_grasp, const GraspAnalysis& failure);
+  bool addSuccess(const GraspAnalysis& lib_grasp, const GraspAnalysis& success);
+
+  boost::shared_ptr<const std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > getLibGrasps() const;
+  void getSnapshot(
+      boost::shared_ptr<const std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > >& lib_grasps,
+      boost::shared_ptr<const std::vector<std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > >& lib_failures,
+      boost::shared_ptr<const std::vector<std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > >& lib_successes,
+      boost::shared_ptr<const LibraryMatchHandlers>& handlers) const;
+
+private:
+
+  std::string filename_;
+  mutable boost::mutex mutex_;
+
+  /* never modified once published, appending replaces them by extended copies */
+  boost::shared_ptr<const std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > lib_grasps_;
+  boost::shared_ptr<const std::vector<std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > > lib_failures_;
+  boost::shared_ptr<const std::vector<std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > > lib_successes_;
+  boost::shared_ptr<const LibraryMatchHandlers> handlers_;
+
+  bool parse(const unsigned char* data, size_t size);
+  bool append(RecordKind kind, int lib_index, const GraspAnalysis& ana,
+      const grasp_template::DismatchMeasure* handler);
+  static void appendRecord(std::vector<unsigned char>& buffer, RecordKind kind, int lib_index,
+      const GraspAnalysis& ana, const grasp_template::DismatchMeasure* handler);
+};
+
+} //namespace
+#endif /* COMPILED_GRASP_LIBRARY_H_ */
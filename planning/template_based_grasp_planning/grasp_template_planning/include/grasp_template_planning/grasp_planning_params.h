@@ -63,6 +63,10 @@ public:
   double learningLibQualFac() const {return learning_lib_quality_factor_;}
   double learningFailDistFac() const {return learning_fail_distance_factor_;}
   double occlusionPunishmentFac() const {return occlusion_punishment_fac_;};
+  /* number of library grasps matched exactly per candidate, 0 matches against all */
+  int matchingShortlistSize() const {return matching_shortlist_size_;};
+  /* compiled library used instead of the library and feedback bags, empty for none */
+  const std::string& compiledLibraryFile() const {return compiled_library_file_;};
 //  double learningSuccAddDist() const {return learning_success_add_dist_;}
   void getTemplateExtractionPoint(Eigen::Vector3d& delta) const
       {delta = template_extraction_point_;};
@@ -92,7 +96,9 @@ private:
   double learning_lib_quality_factor_, learning_fail_distance_factor_,
 //      learning_success_add_dist_,
 		  occlusion_punishment_fac_;
+  int matching_shortlist_size_;
   std::string frame_gripper_, service_name_image_poll_, rostopic_colored_image_, rostopic_pickup_status_;
+  std::string compiled_library_file_;
   Eigen::Vector3d template_extraction_point_;
 };
 
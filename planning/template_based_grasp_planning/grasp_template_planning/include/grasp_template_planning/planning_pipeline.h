@@ -22,6 +22,7 @@
 #include <grasp_template/grasp_template.h>
 #include <grasp_template/heightmap_sampling.h>
 #include <grasp_template_planning/grasp_demo_library.h>
+#include <grasp_template_planning/compiled_grasp_library.h>
 #include <grasp_template_planning/grasp_pool.h>
 #include <grasp_template_planning/grasp_creator_interface.h>
 #include <grasp_template_planning/grasp_planning_params.h>
@@ -43,6 +44,7 @@ public:
   sensor_msgs::PointCloud2 target_object_;
   boost::shared_ptr<grasp_template::HeightmapSampling> templt_generator_;
   boost::shared_ptr<GraspDemoLibrary> library_;
+  boost::shared_ptr<CompiledGraspLibrary> compiled_library_;
   geometry_msgs::Pose table_frame_;
   GraspLog log_;
   std::string demonstrations_folder_, library_path_, failures_path_, successes_path_, log_data_path_;
@@ -61,6 +63,10 @@ public:
   virtual void createGrasp(const grasp_template::GraspTemplate& templt,
       const GraspAnalysis& lib_grasp, GraspAnalysis& result) const;
   virtual void planGrasps(boost::shared_ptr<TemplateMatching>& pool) const;
+  void loadLibraryFeedback(const std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> >& lib_grasps,
+      std::vector<std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > >& lib_failures,
+      std::vector<std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > >& lib_succs) const;
+  bool compileLibrary(const std::string& filename) const;
   virtual bool logPlannedGrasps(const TemplateMatching& pool, unsigned int max_num_grasps);
   virtual bool logGraspResult(const GraspAnalysis& res_ana, const TemplateMatching& pool, int rank);
   virtual bool writeLogToBag();
@@ -70,6 +76,8 @@ private:
   bool offline_, log_data_;
   std::string target_folder_, target_file_; //defined when planning offline
 
+  bool useCompiledLibrary();
+
   boost::shared_ptr<const std::vector<grasp_template::GraspTemplate, Eigen::aligned_allocator<grasp_template::GraspTemplate> > >
   extractTemplatesParallel() const;
 };
@@ -21,6 +21,7 @@
 
 #include <grasp_template/grasp_template.h>
 #include <grasp_template/dismatch_measure.h>
+#include <grasp_template/flat_heightmap.h>
 #include <grasp_template_planning/grasp_pool.h>
 #include <grasp_template_planning/grasp_creator_interface.h>
 #include <grasp_template_planning/grasp_planning_params.h>
@@ -28,6 +29,32 @@
 namespace grasp_template_planning
 {
 
+class CompiledGraspLibrary;
+
+/* everything TemplateMatching precomputes from the library, does not depend on the
+ * candidates and can therefore be shared between planning requests */
+struct LibraryMatchHandlers
+{
+public:
+
+  std::vector<grasp_template::DismatchMeasure, Eigen::aligned_allocator<grasp_template::DismatchMeasure> > lib_match_handler_;
+  std::vector<std::vector<grasp_template::DismatchMeasure, Eigen::aligned_allocator<grasp_template::DismatchMeasure> >,
+  Eigen::aligned_allocator<std::vector<grasp_template::DismatchMeasure, Eigen::aligned_allocator<grasp_template::DismatchMeasure> > > > lib_succs_match_handler_;
+  /* failures decoded once, as is and masked by the mask of their library grasp */
+  std::vector<std::vector<grasp_template::FlatHeightmap> > flat_failures_;
+  std::vector<std::vector<grasp_template::FlatHeightmap> > flat_masked_failures_;
+
+  /* coarse descriptors for shortlisting, one column per library grasp or success */
+  static const unsigned int DESCRIPTOR_BLOCK_SIZE = 5;
+  Eigen::MatrixXf lib_descriptors_;
+  std::vector<unsigned int> descriptor_to_lib_;
+
+  void addLibGrasp(const grasp_template::DismatchMeasure& lib_handler);
+  void addSuccess(unsigned int lib_index, const grasp_template::DismatchMeasure& succ_handler);
+  void addFailure(unsigned int lib_index, const grasp_template::Heightmap& failure);
+  void computeDescriptors();
+};
+
 class TemplateMatching : public GraspPlanningParams
 {
 public:
@@ -35,6 +62,10 @@ public:
 		  grasp_template::GraspTemplate, Eigen::aligned_allocator<grasp_template::GraspTemplate> > > candidates, boost::shared_ptr<const std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > lib_grasps,
 		                     boost::shared_ptr<const std::vector<std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > > lib_failures,
 		                     boost::shared_ptr<const std::vector<std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > > lib_successes);
+  /* reuses the match handlers of a compiled library instead of building them */
+  TemplateMatching(GraspCreatorInterface const* grasp_creator, boost::shared_ptr<const std::vector<
+		  grasp_template::GraspTemplate, Eigen::aligned_allocator<grasp_template::GraspTemplate> > > candidates,
+		  const CompiledGraspLibrary& library);
 
   virtual ~TemplateMatching(){};
   boost::shared_ptr<const std::vector<grasp_template::GraspTemplate, Eigen::aligned_allocator<grasp_template::GraspTemplate> > > candidates_;
@@ -60,9 +91,8 @@ private:
   boost::shared_ptr<const std::vector<std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > > lib_failures_;
   boost::shared_ptr<const std::vector<std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > > lib_successes_;
 
-  std::vector<grasp_template::DismatchMeasure, Eigen::aligned_allocator<grasp_template::DismatchMeasure> > lib_match_handler_;
-  std::vector<std::vector<grasp_template::DismatchMeasure, Eigen::aligned_allocator<grasp_template::DismatchMeasure> >,
-  Eigen::aligned_allocator<std::vector<grasp_template::DismatchMeasure, Eigen::aligned_allocator<grasp_template::DismatchMeasure> > > > lib_succs_match_handler_;
+  boost::shared_ptr<const LibraryMatchHandlers> handlers_;
+
   std::vector<grasp_template::TemplateDissimilarity> lib_scores_; // alpha_i,Mi
 //  std::vector<std::vector<grasp_template::TemplateDissimilarity> > lib_succ_scores_; // alpha_i,j
   
@@ -80,8 +110,10 @@ private:
 //  void computeLibScore(grasp_template::GraspTemplate& candidate,
 //      grasp_template::TemplateDissimilarity& score, unsigned int index) const;
   void computeLibQuality(unsigned int lib_index);
-  void computeFailScore(unsigned int candidate, unsigned int lib_index,
+  void computeFailScore(const grasp_template::FlatHeightmap& candidate, unsigned int lib_index,
       grasp_template::TemplateDissimilarity& score, int& fail_index) const;
+  void constructClass();
+  void getShortlist(const grasp_template::FlatHeightmap& candidate, std::vector<unsigned int>& libs) const;
   double computeScore(double a, double b, double c, double occlusions) const;
   double computeScore(unsigned int cand) const;
   double getLibOverlay(unsigned int rank) const;
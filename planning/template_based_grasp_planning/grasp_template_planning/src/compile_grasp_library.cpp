@@ -0,0 +1,41 @@
+/*********************************************************************
+ Computational Learning and Motor Control Lab
+ University of Southern California
+ Prof. Stefan Schaal
+ *********************************************************************
+ \remarks      ...
+
+ \file         compile_grasp_library.cpp
+
+ *********************************************************************/
+
+#include <string>
+
+#include <ros/ros.h>
+#include <grasp_template_planning/planning_pipeline.h>
+
+using namespace std;
+using namespace grasp_template_planning;
+
+int main(int argc, char** argv)
+{
+  if (argc < 6)
+  {
+    ROS_ERROR_STREAM("You missed some arguments. The correct call is: " << "compile_grasp_library [grasp_demonstrations_path] "
+          "[grasp_library_file] [failures_path] [successes_path] [compiled_library_file]");
+    return -1;
+  }
+
+  ros::init(argc, argv, "compile_grasp_library");
+  ros::NodeHandle n;
+
+  PlanningPipeline pipeline(argv[1], argv[2], argv[3], argv[4], "");
+  if (!pipeline.compileLibrary(argv[5]))
+  {
+    ROS_ERROR_STREAM("Could not compile grasp library " << argv[2] << " to " << argv[5]);
+    return -1;
+  }
+
+  ROS_INFO("Done compiling grasp library.");
+  return 0;
+}
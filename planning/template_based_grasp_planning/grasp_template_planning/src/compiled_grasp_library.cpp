@@ -0,0 +1,528 @@
+/*********************************************************************
+ Computational Learning and Motor Control Lab
+ University of Southern California
+ Prof. Stefan Schaal
+ *********************************************************************
+ \remarks      ...
+
+ \file         compiled_grasp_library.cpp
+
+ *********************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <stdint.h>
+
+#include <ros/ros.h>
+#include <ros/serialization.h>
+#include <grasp_template/grasp_template.h>
+#include <grasp_template_planning/compiled_grasp_library.h>
+
+using namespace std;
+using namespace grasp_template;
+
+namespace grasp_template_planning
+{
+
+namespace
+{
+
+const char CGL_MAGIC[8] = {'G', 'T', 'P', 'L', 'I', 'B', '\0', '\0'};
+const uint32_t CGL_VERSION = 1;
+
+struct CglFileHeader
+{
+  char magic_[8];
+  uint32_t version_;
+  uint32_t num_records_;
+  uint64_t end_; //offset behind the last complete record
+};
+
+struct CglRecordHeader
+{
+  uint32_t kind_;
+  int32_t lib_index_; //related library grasp, -1 for library grasps
+  uint32_t num_tiles_x_, num_tiles_y_; //0 if the record has no precomputed state
+  double map_length_x_, map_length_y_;
+  double template_pose_[7];
+  double gripper_pose_[7];
+  uint64_t analysis_size_;
+  uint64_t record_size_;
+};
+
+void poseToArray(const geometry_msgs::Pose& pose, double* a)
+{
+  a[0] = pose.position.x;
+  a[1] = pose.position.y;
+  a[2] = pose.position.z;
+  a[3] = pose.orientation.w;
+  a[4] = pose.orientation.x;
+  a[5] = pose.orientation.y;
+  a[6] = pose.orientation.z;
+}
+
+void arrayToPose(const double* a, geometry_msgs::Pose& pose)
+{
+  pose.position.x = a[0];
+  pose.position.y = a[1];
+  pose.position.z = a[2];
+  pose.orientation.w = a[3];
+  pose.orientation.x = a[4];
+  pose.orientation.y = a[5];
+  pose.orientation.z = a[6];
+}
+
+bool isSameLibGrasp(const GraspAnalysis& first, const GraspAnalysis& second)
+{
+  /* the same fields identify the related failure and success bags */
+  return first.demo_filename == second.demo_filename && first.demo_id == second.demo_id;
+}
+
+} //namespace
+
+CompiledGraspLibrary::CompiledGraspLibrary(const string& filename) :
+  filename_(filename)
+{
+}
+
+bool CompiledGraspLibrary::compile(const string& filename,
+    const vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> >& lib_grasps,
+    const vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > >& lib_failures,
+    const vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > >& lib_successes)
+{
+  if (lib_failures.size() != lib_grasps.size() || lib_successes.size() != lib_grasps.size())
+  {
+    ROS_ERROR("grasp_template_planning::CompiledGraspLibrary: Feedback does not match the library grasps.");
+    return false;
+  }
+
+  /* library grasps first, so that every feedback record refers to a known grasp */
+  vector<unsigned char> buffer;
+  unsigned int num_records = 0;
+  for (unsigned int i = 0; i < lib_grasps.size(); i++)
+  {
+    const GraspAnalysis& lib = lib_grasps[i];
+    DismatchMeasure handler(lib.grasp_template, lib.template_pose.pose, lib.gripper_pose.pose);
+    appendRecord(buffer, CGL_LIBRARY, -1, lib, &handler);
+    num_records++;
+  }
+  for (unsigned int i = 0; i < lib_grasps.size(); i++)
+  {
+    for (unsigned int j = 0; j < lib_successes[i].size(); j++)
+    {
+      const GraspAnalysis& succ = lib_successes[i][j];
+      DismatchMeasure handler(succ.grasp_template, succ.template_pose.pose, succ.gripper_pose.pose);
+      appendRecord(buffer, CGL_SUCCESS, i, succ, &handler);
+      num_records++;
+    }
+    for (unsigned int j = 0; j < lib_failures[i].size(); j++)
+    {
+      appendRecord(buffer, CGL_FAILURE, i, lib_failures[i][j], NULL);
+      num_records++;
+    }
+  }
+
+  CglFileHeader header;
+  memcpy(header.magic_, CGL_MAGIC, sizeof(CGL_MAGIC));
+  header.version_ = CGL_VERSION;
+  header.num_records_ = num_records;
+  header.end_ = sizeof(CglFileHeader) + buffer.size();
+
+  FILE* file = fopen(filename.c_str(), "wb");
+  if (file == NULL)
+  {
+    ROS_ERROR_STREAM("grasp_template_planning::CompiledGraspLibrary: Could not open " << filename << " for writing.");
+    return false;
+  }
+  bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+  if (!buffer.empty())
+  {
+    success = success && fwrite(&buffer[0], buffer.size(), 1, file) == 1;
+  }
+  success = fclose(file) == 0 && success;
+
+  if (!success)
+  {
+    ROS_ERROR_STREAM("grasp_template_planning::CompiledGraspLibrary: Could not write " << filename);
+  }
+  return success;
+}
+
+bool CompiledGraspLibrary::load()
+{
+  FILE* file = fopen(filename_.c_str(), "rb");
+  if (file == NULL)
+  {
+    ROS_WARN_STREAM("grasp_template_planning::CompiledGraspLibrary: Could not open " << filename_);
+    return false;
+  }
+
+  /* the whole file is decoded into the match handlers, so read it in one go */
+  vector<unsigned char> data;
+  bool success = fseek(file, 0, SEEK_END) == 0;
+  const long size = success ? ftell(file) : -1;
+  if (size >= static_cast<long> (sizeof(CglFileHeader)))
+  {
+    data.resize(size);
+    success = fseek(file, 0, SEEK_SET) == 0 && fread(&data[0], size, 1, file) == 1;
+  }
+  fclose(file);
+  if (data.empty())
+  {
+    ROS_WARN_STREAM("grasp_template_planning::CompiledGraspLibrary: " << filename_ << " is not a compiled library.");
+    return false;
+  }
+  if (!success)
+  {
+    ROS_WARN_STREAM("grasp_template_planning::CompiledGraspLibrary: Could not read " << filename_);
+    return false;
+  }
+
+  return parse(&data[0], data.size());
+}
+
+bool CompiledGraspLibrary::parse(const unsigned char* data, size_t size)
+{
+  CglFileHeader header;
+  if (size < sizeof(header))
+  {
+    ROS_WARN_STREAM("grasp_template_planning::CompiledGraspLibrary: " << filename_ << " is not a compiled library.");
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic_, CGL_MAGIC, sizeof(CGL_MAGIC)) != 0 || header.version_ != CGL_VERSION
+      || header.end_ < sizeof(header) || header.end_ > size)
+  {
+    ROS_WARN_STREAM("grasp_template_planning::CompiledGraspLibrary: " << filename_
+        << " is not a compiled library of version " << CGL_VERSION);
+    return false;
+  }
+
+  /* collect the record table first, then decode the records in parallel. The header is
+   * committed after its records are written, so every record before end_ has to be complete
+   * and all lengths are validated here rather than while decoding */
+  vector<size_t> offsets;
+  uint64_t offset = sizeof(CglFileHeader);
+  for (unsigned int i = 0; i < header.num_records_; i++)
+  {
+    CglRecordHeader rec;
+    if (header.end_ - offset < sizeof(rec))
+    {
+      ROS_WARN_STREAM("grasp_template_planning::CompiledGraspLibrary: " << filename_ << " is truncated, found "
+          << i << " of " << header.num_records_ << " records.");
+      return false;
+    }
+    memcpy(&rec, data + offset, sizeof(rec));
+
+    const uint64_t num_tiles = static_cast<uint64_t> (rec.num_tiles_x_) * rec.num_tiles_y_;
+    const uint64_t max_size = header.end_ - offset;
+    bool valid = rec.kind_ <= CGL_FAILURE && rec.record_size_ <= max_size
+        && (rec.kind_ == CGL_FAILURE || num_tiles > 0);
+    /* the tile counts end up in the int8 fields of a Heightmap */
+    valid = valid && rec.num_tiles_x_ <= static_cast<uint32_t> (numeric_limits<int8_t>::max())
+        && rec.num_tiles_y_ <= static_cast<uint32_t> (numeric_limits<int8_t>::max());
+    valid = valid && num_tiles <= (max_size - sizeof(rec)) / (2 * sizeof(double));
+    valid = valid && rec.analysis_size_ <= max_size - sizeof(rec) - 2 * num_tiles * sizeof(double);
+    valid = valid && rec.record_size_ >= sizeof(rec) + 2 * num_tiles * sizeof(double) + rec.analysis_size_;
+    if (!valid)
+    {
+      ROS_WARN_STREAM("grasp_template_planning::CompiledGraspLibrary: Record " << i << " of " << filename_
+          << " is corrupt.");
+      return false;
+    }
+    offsets.push_back(offset);
+    offset += rec.record_size_;
+  }
+
+  vector<CglRecordHeader> records(offsets.size());
+  vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > analyses(offsets.size());
+  vector<boost::shared_ptr<DismatchMeasure> > handlers(offsets.size());
+  /* exceptions must not leave the parallel region */
+  vector<char> corrupt(offsets.size(), 0);
+  int i = 0;
+#pragma omp parallel for private(i)
+  for (i = 0; i < static_cast<int> (offsets.size()); i++)
+  {
+    try
+    {
+      const unsigned char* rec_data = data + offsets[i];
+      CglRecordHeader& rec = records[i];
+      memcpy(&rec, rec_data, sizeof(rec));
+      rec_data += sizeof(rec);
+
+      const size_t num_tiles = static_cast<size_t> (rec.num_tiles_x_) * rec.num_tiles_y_;
+      if (num_tiles > 0)
+      {
+        Heightmap hm;
+        hm.num_tiles_x = rec.num_tiles_x_;
+        hm.num_tiles_y = rec.num_tiles_y_;
+        hm.map_length_x = rec.map_length_x_;
+        hm.map_length_y = rec.map_length_y_;
+        hm.heightmap.resize(num_tiles);
+        memcpy(&hm.heightmap[0], rec_data, num_tiles * sizeof(double));
+        rec_data += num_tiles * sizeof(double);
+
+        vector<double> mask(num_tiles);
+        memcpy(&mask[0], rec_data, num_tiles * sizeof(double));
+        rec_data += num_tiles * sizeof(double);
+
+        geometry_msgs::Pose templt_pose, gripper_pose;
+        arrayToPose(rec.template_pose_, templt_pose);
+        arrayToPose(rec.gripper_pose_, gripper_pose);
+        handlers[i].reset(new DismatchMeasure(GraspTemplate(hm, templt_pose), gripper_pose, mask));
+      }
+
+      ros::serialization::IStream stream(const_cast<uint8_t*> (rec_data), rec.analysis_size_);
+      ros::serialization::deserialize(stream, analyses[i]);
+    }
+    catch (const std::exception&)
+    {
+      corrupt[i] = 1;
+    }
+  }
+  for (unsigned int r = 0; r < corrupt.size(); r++)
+  {
+    if (corrupt[r])
+    {
+      ROS_WARN_STREAM("grasp_template_planning::CompiledGraspLibrary: Could not deserialize record " << r
+          << " of " << filename_);
+      return false;
+    }
+  }
+
+  boost::shared_ptr<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > lib_grasps(
+      new vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > ());
+  boost::shared_ptr<vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > > lib_failures(
+      new vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > ());
+  boost::shared_ptr<vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > > lib_successes(
+      new vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > ());
+  boost::shared_ptr<LibraryMatchHandlers> match_handlers(new LibraryMatchHandlers());
+
+  for (unsigned int r = 0; r < records.size(); r++)
+  {
+    const CglRecordHeader& rec = records[r];
+    if (rec.kind_ == CGL_LIBRARY && handlers[r] != NULL)
+    {
+      lib_grasps->push_back(analyses[r]);
+      lib_failures->push_back(vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > ());
+      lib_successes->push_back(vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > ());
+      match_handlers->addLibGrasp(*handlers[r]);
+    }
+    else if (rec.lib_index_ < 0 || rec.lib_index_ >= static_cast<int> (lib_grasps->size()))
+    {
+      ROS_WARN_STREAM("grasp_template_planning::CompiledGraspLibrary: Skipping record " << r
+          << " that refers to unknown library grasp " << rec.lib_index_);
+    }
+    else if (rec.kind_ == CGL_SUCCESS && handlers[r] != NULL)
+    {
+      (*lib_successes)[rec.lib_index_].push_back(analyses[r]);
+      match_handlers->addSuccess(rec.lib_index_, *handlers[r]);
+    }
+    else if (rec.kind_ == CGL_FAILURE)
+    {
+      (*lib_failures)[rec.lib_index_].push_back(analyses[r]);
+      match_handlers->addFailure(rec.lib_index_, analyses[r].grasp_template);
+    }
+  }
+  match_handlers->computeDescriptors();
+
+  boost::mutex::scoped_lock lock(mutex_);
+  lib_grasps_ = lib_grasps;
+  lib_failures_ = lib_failures;
+  lib_successes_ = lib_successes;
+  handlers_ = match_handlers;
+
+  ROS_INFO_STREAM("grasp_template_planning::CompiledGraspLibrary: Loaded " << lib_grasps_->size()
+      << " library grasps from " << filename_);
+  return true;
+}
+
+bool CompiledGraspLibrary::isLoaded() const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return handlers_ != NULL;
+}
+
+int CompiledGraspLibrary::findLibGrasp(const GraspAnalysis& lib_grasp) const
+{
+  boost::shared_ptr<const vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > lib_grasps =
+      getLibGrasps();
+  if (lib_grasps == NULL)
+    return -1;
+
+  for (unsigned int i = 0; i < lib_grasps->size(); i++)
+  {
+    if (isSameLibGrasp((*lib_grasps)[i], lib_grasp))
+      return i;
+  }
+  return -1;
+}
+
+bool CompiledGraspLibrary::isValidFeedback(const GraspAnalysis& feedback)
+{
+  return feedback.grasp_template.heightmap.size() == TemplateHeightmap::TH_DEFAULT_NUM_TILES_X
+      * TemplateHeightmap::TH_DEFAULT_NUM_TILES_X;
+}
+
+bool CompiledGraspLibrary::addFailure(const GraspAnalysis& lib_grasp, const GraspAnalysis& failure)
+{
+  if (!isValidFeedback(failure))
+  {
+    ROS_DEBUG_STREAM("grasp_template_planning::CompiledGraspLibrary: Ignoring failure with template size "
+        << failure.grasp_template.heightmap.size());
+    return true;
+  }
+
+  const int lib_index = findLibGrasp(lib_grasp);
+  if (lib_index < 0)
+    return false;
+
+  return append(CGL_FAILURE, lib_index, failure, NULL);
+}
+
+bool CompiledGraspLibrary::addSuccess(const GraspAnalysis& lib_grasp, const GraspAnalysis& success)
+{
+  if (!isValidFeedback(success))
+  {
+    ROS_DEBUG_STREAM("grasp_template_planning::CompiledGraspLibrary: Ignoring success with template size "
+        << success.grasp_template.heightmap.size());
+    return true;
+  }
+
+  const int lib_index = findLibGrasp(lib_grasp);
+  if (lib_index < 0)
+    return false;
+
+  DismatchMeasure handler(success.grasp_template, success.template_pose.pose, success.gripper_pose.pose);
+  return append(CGL_SUCCESS, lib_index, success, &handler);
+}
+
+boost::shared_ptr<const vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > CompiledGraspLibrary::getLibGrasps() const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return lib_grasps_;
+}
+
+void CompiledGraspLibrary::getSnapshot(
+    boost::shared_ptr<const vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > >& lib_grasps,
+    boost::shared_ptr<const vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > >& lib_failures,
+    boost::shared_ptr<const vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > >& lib_successes,
+    boost::shared_ptr<const LibraryMatchHandlers>& handlers) const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  lib_grasps = lib_grasps_;
+  lib_failures = lib_failures_;
+  lib_successes = lib_successes_;
+  handlers = handlers_;
+}
+
+bool CompiledGraspLibrary::append(RecordKind kind, int lib_index, const GraspAnalysis& ana,
+                                  const DismatchMeasure* handler)
+{
+  vector<unsigned char> buffer;
+  appendRecord(buffer, kind, lib_index, ana, handler);
+
+  boost::mutex::scoped_lock lock(mutex_);
+  if (handlers_ == NULL)
+    return false;
+
+  /* write the record behind the last one, then commit it by updating the file header */
+  FILE* file = fopen(filename_.c_str(), "r+b");
+  if (file == NULL)
+  {
+    ROS_ERROR_STREAM("grasp_template_planning::CompiledGraspLibrary: Could not open " << filename_ << " for appending.");
+    return false;
+  }
+
+  CglFileHeader header;
+  bool success = fread(&header, sizeof(header), 1, file) == 1
+      && memcmp(header.magic_, CGL_MAGIC, sizeof(CGL_MAGIC)) == 0 && header.version_ == CGL_VERSION;
+  success = success && fseek(file, header.end_, SEEK_SET) == 0
+      && fwrite(&buffer[0], buffer.size(), 1, file) == 1 && fflush(file) == 0;
+  if (success)
+  {
+    header.num_records_++;
+    header.end_ += buffer.size();
+    success = fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+  }
+  success = fclose(file) == 0 && success;
+
+  if (!success)
+  {
+    ROS_ERROR_STREAM("grasp_template_planning::CompiledGraspLibrary: Could not append to " << filename_);
+    return false;
+  }
+
+  /* pools created before keep their snapshot */
+  boost::shared_ptr<LibraryMatchHandlers> match_handlers(new LibraryMatchHandlers(*handlers_));
+  if (kind == CGL_SUCCESS)
+  {
+    boost::shared_ptr<vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > > lib_successes(
+        new vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > (*lib_successes_));
+    (*lib_successes)[lib_index].push_back(ana);
+    match_handlers->addSuccess(lib_index, *handler);
+    lib_successes_ = lib_successes;
+  }
+  else
+  {
+    boost::shared_ptr<vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > > lib_failures(
+        new vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > (*lib_failures_));
+    (*lib_failures)[lib_index].push_back(ana);
+    match_handlers->addFailure(lib_index, ana.grasp_template);
+    lib_failures_ = lib_failures;
+  }
+  match_handlers->computeDescriptors();
+  handlers_ = match_handlers;
+
+  return true;
+}
+
+void CompiledGraspLibrary::appendRecord(vector<unsigned char>& buffer, RecordKind kind, int lib_index,
+                                        const GraspAnalysis& ana, const DismatchMeasure* handler)
+{
+  CglRecordHeader rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.kind_ = kind;
+  rec.lib_index_ = lib_index;
+
+  Heightmap masked;
+  if (handler != NULL)
+  {
+    const GraspTemplate& templt = handler->getLibTemplt();
+    templt.heightmap_.toHeightmapMsg(masked);
+    rec.num_tiles_x_ = templt.heightmap_.getNumTilesX();
+    rec.num_tiles_y_ = templt.heightmap_.getNumTilesY();
+    rec.map_length_x_ = templt.heightmap_.getMapLengthX();
+    rec.map_length_y_ = templt.heightmap_.getMapLengthY();
+
+    geometry_msgs::Pose templt_pose;
+    templt.getPose(templt_pose);
+    poseToArray(templt_pose, rec.template_pose_);
+    poseToArray(handler->getGripperPose(), rec.gripper_pose_);
+  }
+  const unsigned int num_tiles = rec.num_tiles_x_ * rec.num_tiles_y_;
+
+  rec.analysis_size_ = ros::serialization::serializationLength(ana);
+  const size_t payload = sizeof(rec) + 2 * num_tiles * sizeof(double) + rec.analysis_size_;
+  rec.record_size_ = (payload + 7) / 8 * 8;
+
+  const size_t begin = buffer.size();
+  buffer.resize(begin + rec.record_size_, 0);
+  unsigned char* rec_data = &buffer[begin];
+  memcpy(rec_data, &rec, sizeof(rec));
+  rec_data += sizeof(rec);
+  if (num_tiles > 0)
+  {
+    memcpy(rec_data, &masked.heightmap[0], num_tiles * sizeof(double));
+    rec_data += num_tiles * sizeof(double);
+    memcpy(rec_data, &handler->getFlatMask()[0], num_tiles * sizeof(double));
+    rec_data += num_tiles * sizeof(double);
+  }
+
+  ros::serialization::OStream stream(rec_data, rec.analysis_size_);
+  ros::serialization::serialize(stream, ana);
+}
+
+} //namespace
@@ -49,6 +49,9 @@ GraspPlanningParams::GraspPlanningParams()
   ros::param::get("~rostopic_colored_image", rostopic_colored_image_);
   ros::param::get("~rostopic_pickup_status", rostopic_pickup_status_);
   ros::param::get("~occlusion_punishment_fac", occlusion_punishment_fac_);
+  matching_shortlist_size_ = 0;
+  ros::param::get("~matching_shortlist_size", matching_shortlist_size_);
+  ros::param::get("~compiled_library_file", compiled_library_file_);
 }
 
 string GraspPlanningParams::createId()
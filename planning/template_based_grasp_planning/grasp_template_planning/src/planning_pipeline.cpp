@@ -35,7 +35,8 @@ namespace grasp_template_planning
 
 PlanningPipeline::PlanningPipeline(const string& demo_path,
     const string& library_path, const string& failures_path,
-    const string& successes_path, const string& log_data_path)
+    const string& successes_path, const string& log_data_path) :
+  offline_(false), log_data_(false)
 {
   demonstrations_folder_ = demo_path;
   library_path_ = library_path;
@@ -176,6 +177,7 @@ bool PlanningPipeline::initialize(const string& object_filename, bool log_data)
 bool PlanningPipeline::initialize(const sensor_msgs::PointCloud2& cluster,
     const geometry_msgs::Pose& table_pose, bool log_data)
 {
+  offline_ = false;
   target_object_ = cluster;
   table_frame_ = table_pose;
   log_data_ = log_data;
@@ -212,7 +214,14 @@ bool PlanningPipeline::initialize(const sensor_msgs::PointCloud2& cluster,
   pcl::fromROSMsg(target_object_, tmp_cloud);
   templt_generator_->initialize(tmp_cloud, table_frame_);
 
-  /* setup library */
+  /* setup library, a compiled library is loaded once and kept between requests
+   * and replaces the library bags, planGrasps() uses it if library_ is not set */
+  if (useCompiledLibrary())
+  {
+    library_.reset();
+    return !compiled_library_->getLibGrasps()->empty();
+  }
+
   library_.reset(new GraspDemoLibrary(demonstrations_folder_, library_path_));
   library_->loadLibrary();
   if (library_->getAnalysisMsgs()->empty())
@@ -221,6 +230,25 @@ bool PlanningPipeline::initialize(const sensor_msgs::PointCloud2& cluster,
   return true;
 }
 
+bool PlanningPipeline::useCompiledLibrary()
+{
+  if (compiledLibraryFile().empty())
+    return false;
+
+  if (compiled_library_ == NULL)
+  {
+    /* do not retry on every request if the file is broken */
+    compiled_library_.reset(new CompiledGraspLibrary(compiledLibraryFile()));
+    if (!compiled_library_->load())
+    {
+      ROS_WARN_STREAM("grasp_template_planning::PlanningPipeline: Could not load compiled library "
+          << compiledLibraryFile() << ", reading library bags instead.");
+    }
+  }
+
+  return compiled_library_->isLoaded();
+}
+
 bool PlanningPipeline::addFailure(const GraspAnalysis& lib_grasp, const GraspAnalysis& failure)
 {
   string filename = failures_path_;
@@ -229,6 +257,11 @@ bool PlanningPipeline::addFailure(const GraspAnalysis& lib_grasp, const GraspAna
   GraspDemoLibrary failure_lib("", filename);
   bool success = failure_lib.addAnalysisToLib(failure);
 
+  if (compiled_library_ != NULL && compiled_library_->isLoaded())
+  {
+    success = compiled_library_->addFailure(lib_grasp, failure) && success;
+  }
+
   return success;
 }
 
@@ -240,6 +273,11 @@ bool PlanningPipeline::addSuccess(const GraspAnalysis& lib_grasp, const GraspAna
   GraspDemoLibrary succ_lib("", filename);
   bool ret_suc = succ_lib.addAnalysisToLib(success);
 
+  if (compiled_library_ != NULL && compiled_library_->isLoaded())
+  {
+    ret_suc = compiled_library_->addSuccess(lib_grasp, success) && ret_suc;
+  }
+
   return ret_suc;
 }
 
@@ -542,12 +580,45 @@ void PlanningPipeline::planGrasps(boost::shared_ptr<TemplateMatching>& pool) con
   ros::Time t_extract = ros::Time::now();
   ros::Duration extract_duration = t_extract - t_start;
 
-  boost::shared_ptr < vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > lib_grasps;
-  lib_grasps.reset(new vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > ());
-  boost::shared_ptr < vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > > lib_failures, lib_succs;
-  lib_failures.reset(new vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > ());
-  lib_succs.reset(new vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > ());
+  ros::Time t_failure_map_creation;
+  if (library_ == NULL)
+  {
+    /* match handlers were precomputed when the library was compiled */
+    ROS_ASSERT(compiled_library_ != NULL && compiled_library_->isLoaded());
+    t_failure_map_creation = ros::Time::now();
+    pool.reset(new TemplateMatching(this, templts, *compiled_library_));
+  }
+  else
+  {
+    boost::shared_ptr < vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > lib_grasps;
+    lib_grasps.reset(new vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > (*(library_->getAnalysisMsgs())));
+    boost::shared_ptr < vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > > lib_failures, lib_succs;
+    lib_failures.reset(new vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > ());
+    lib_succs.reset(new vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > ());
+    loadLibraryFeedback(*lib_grasps, *lib_failures, *lib_succs);
+
+    t_failure_map_creation = ros::Time::now();
+    pool.reset(new TemplateMatching(this, templts, lib_grasps, lib_failures, lib_succs));
+  }
+  ros::Duration failure_map_creation_duration = t_failure_map_creation - t_extract;
+
+  pool->create();
+
+  ros::Time t_pool_creation = ros::Time::now();
+  ros::Duration pool_creation_duration = t_pool_creation - t_failure_map_creation;
 
+  ROS_DEBUG_STREAM("grasp_template_planning::PlanningPipeline: "
+      "Extracting templates took: " << extract_duration);
+  ROS_DEBUG_STREAM("grasp_template_planning::PlanningPipeline: "
+      "Creating failure map took: " << failure_map_creation_duration);
+  ROS_DEBUG_STREAM("grasp_template_planning::PlanningPipeline: "
+      "Generating grasps took: " << pool_creation_duration);
+}
+
+void PlanningPipeline::loadLibraryFeedback(const vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> >& lib_grasps,
+    vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > >& lib_failures,
+    vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > >& lib_succs) const
+{
   ////DEBUG CODE
     int num_erased = 0;
     int num_not_erased = 0;
@@ -556,36 +627,36 @@ void PlanningPipeline::planGrasps(boost::shared_ptr<TemplateMatching>& pool) con
   //	ros::Time threashold_time(1343261576, 160697464);
   ////DEBUG CODE
 
-    *lib_grasps = *(library_->getAnalysisMsgs());
-    for (unsigned int i = 0; i < lib_grasps->size(); i++)
+    lib_failures.clear();
+    lib_succs.clear();
+    for (unsigned int i = 0; i < lib_grasps.size(); i++)
     {
-      lib_failures->push_back(vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > ());
+      lib_failures.push_back(vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > ());
 
     string failures_file = failures_path_;
-    failures_file.append(getRelatedFailureLib((*lib_grasps)[i]));
+    failures_file.append(getRelatedFailureLib(lib_grasps[i]));
     GraspDemoLibrary failure_lib("", failures_file);
     failure_lib.loadLibrary();
 
 //DEBUG CODE
     if (failure_lib.getAnalysisMsgs() != NULL)
-      (*lib_failures)[i] = *(failure_lib.getAnalysisMsgs());
+      lib_failures[i] = *(failure_lib.getAnalysisMsgs());
 ////DEBUG CODE
 
 ////DEBUG CODE
-    for(int fb_lib_id = (*lib_failures)[i].size() - 1; fb_lib_id >= 0; fb_lib_id--)
+    for(int fb_lib_id = lib_failures[i].size() - 1; fb_lib_id >= 0; fb_lib_id--)
     {
     	if(
-//    			(*lib_failures)[i][fb_lib_id].stamp > threashold_time ||
-    			(*lib_failures)[i][fb_lib_id].grasp_template.heightmap.size()
-    			!= grasp_template::TemplateHeightmap::TH_DEFAULT_NUM_TILES_X * grasp_template::TemplateHeightmap::TH_DEFAULT_NUM_TILES_X)
+//    			lib_failures[i][fb_lib_id].stamp > threashold_time ||
+    			!CompiledGraspLibrary::isValidFeedback(lib_failures[i][fb_lib_id]))
     	{
-    		std::cout << "template width is " << (*lib_failures)[i][fb_lib_id].grasp_template.heightmap.size() <<
+    		ROS_DEBUG_STREAM("template width is " << lib_failures[i][fb_lib_id].grasp_template.heightmap.size() <<
     				" != " << grasp_template::TemplateHeightmap::TH_DEFAULT_NUM_TILES_X *
-    				grasp_template::TemplateHeightmap::TH_DEFAULT_NUM_TILES_X << std::endl;
+    				grasp_template::TemplateHeightmap::TH_DEFAULT_NUM_TILES_X);
 
-    		std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> >::iterator lib_iter = (*lib_failures)[i].begin();
+    		std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> >::iterator lib_iter = lib_failures[i].begin();
     		lib_iter += fb_lib_id;
-    		(*lib_failures)[i].erase(lib_iter);
+    		lib_failures[i].erase(lib_iter);
 
     		num_erased++;
     	}
@@ -596,32 +667,31 @@ void PlanningPipeline::planGrasps(boost::shared_ptr<TemplateMatching>& pool) con
     }
 ////DEBUG CODE
 
-	lib_succs->push_back(vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > ());
+	lib_succs.push_back(vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > ());
     string succs_file = successes_path_;
-    succs_file.append(getRelatedSuccessLib((*lib_grasps)[i]));
+    succs_file.append(getRelatedSuccessLib(lib_grasps[i]));
     GraspDemoLibrary succ_lib("", succs_file);
     succ_lib.loadLibrary();
 
 ////DEBUG CODE
     if (succ_lib.getAnalysisMsgs() != NULL)
-      (*lib_succs)[i] = *(succ_lib.getAnalysisMsgs());
+      lib_succs[i] = *(succ_lib.getAnalysisMsgs());
 ////DEBUG CODE
 
 ////DEBUG CODE
-    for(int fb_lib_id = (*lib_succs)[i].size() - 1; fb_lib_id >= 0; fb_lib_id--)
+    for(int fb_lib_id = lib_succs[i].size() - 1; fb_lib_id >= 0; fb_lib_id--)
     {
     	if(
-//    			(*lib_succs)[i][fb_lib_id].stamp > threashold_time ||
-    			(*lib_succs)[i][fb_lib_id].grasp_template.heightmap.size()
-    			!= grasp_template::TemplateHeightmap::TH_DEFAULT_NUM_TILES_X * grasp_template::TemplateHeightmap::TH_DEFAULT_NUM_TILES_X)
+//    			lib_succs[i][fb_lib_id].stamp > threashold_time ||
+    			!CompiledGraspLibrary::isValidFeedback(lib_succs[i][fb_lib_id]))
     	{
-    		std::cout << "template width is" << (*lib_succs)[i][fb_lib_id].grasp_template.heightmap.size() <<
+    		ROS_DEBUG_STREAM("template width is " << lib_succs[i][fb_lib_id].grasp_template.heightmap.size() <<
     				" != " << grasp_template::TemplateHeightmap::TH_DEFAULT_NUM_TILES_X *
-    				grasp_template::TemplateHeightmap::TH_DEFAULT_NUM_TILES_X << std::endl;
+    				grasp_template::TemplateHeightmap::TH_DEFAULT_NUM_TILES_X);
 
-    		std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> >::iterator lib_iter = (*lib_succs)[i].begin();
+    		std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> >::iterator lib_iter = lib_succs[i].begin();
     		lib_iter += fb_lib_id;
-    		(*lib_succs)[i].erase(lib_iter);
+    		lib_succs[i].erase(lib_iter);
 
     		num_erased++;
     	}
@@ -640,21 +710,18 @@ void PlanningPipeline::planGrasps(boost::shared_ptr<TemplateMatching>& pool) con
 		  " and kept " << num_not_erased);
 ////DEBUG CODE
 
-  ros::Time t_failure_map_creation = ros::Time::now();
-  ros::Duration failure_map_creation_duration = t_failure_map_creation - t_extract;
+}
 
-  pool.reset(new TemplateMatching(this, templts, lib_grasps, lib_failures, lib_succs));
-  pool->create();
+bool PlanningPipeline::compileLibrary(const string& filename) const
+{
+  GraspDemoLibrary library(demonstrations_folder_, library_path_);
+  if (!library.loadLibrary() || library.getAnalysisMsgs()->empty())
+    return false;
 
-  ros::Time t_pool_creation = ros::Time::now();
-  ros::Duration pool_creation_duration = t_pool_creation - t_failure_map_creation;
+  vector<vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > lib_failures, lib_succs;
+  loadLibraryFeedback(*library.getAnalysisMsgs(), lib_failures, lib_succs);
 
-  ROS_DEBUG_STREAM("grasp_template_planning::PlanningPipeline: "
-      "Extracting templates took: " << extract_duration);
-  ROS_DEBUG_STREAM("grasp_template_planning::PlanningPipeline: "
-      "Creating failure map took: " << failure_map_creation_duration);
-  ROS_DEBUG_STREAM("grasp_template_planning::PlanningPipeline: "
-      "Generating grasps took: " << pool_creation_duration);
+  return CompiledGraspLibrary::compile(filename, *library.getAnalysisMsgs(), lib_failures, lib_succs);
 }
 
 boost::shared_ptr<const vector<GraspTemplate, Eigen::aligned_allocator<GraspTemplate> > > PlanningPipeline::extractTemplatesParallel() const
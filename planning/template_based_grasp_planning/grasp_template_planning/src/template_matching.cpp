@@ -11,9 +11,12 @@
  \date         April 1, 2012
 
  *********************************************************************/
+#include <algorithm>
+#include <limits>
 #include <Eigen/StdVector>
 
 #include <grasp_template_planning/template_matching.h>
+#include <grasp_template_planning/compiled_grasp_library.h>
 
 using namespace std;
 using namespace grasp_template;
@@ -21,6 +24,27 @@ using namespace grasp_template;
 namespace grasp_template_planning
 {
 
+void LibraryMatchHandlers::addLibGrasp(const DismatchMeasure& lib_handler)
+{
+  lib_match_handler_.push_back(lib_handler);
+  lib_succs_match_handler_.push_back(std::vector<grasp_template::DismatchMeasure, Eigen::aligned_allocator<grasp_template::DismatchMeasure> >());
+  flat_failures_.push_back(vector<FlatHeightmap> ());
+  flat_masked_failures_.push_back(vector<FlatHeightmap> ());
+}
+
+void LibraryMatchHandlers::addSuccess(unsigned int lib_index, const DismatchMeasure& succ_handler)
+{
+  lib_succs_match_handler_[lib_index].push_back(succ_handler);
+}
+
+void LibraryMatchHandlers::addFailure(unsigned int lib_index, const Heightmap& failure)
+{
+  flat_failures_[lib_index].push_back(FlatHeightmap());
+  flat_failures_[lib_index].back().set(failure);
+  flat_masked_failures_[lib_index].push_back(flat_failures_[lib_index].back());
+  lib_match_handler_[lib_index].applyDcMask(flat_masked_failures_[lib_index].back());
+}
+
 TemplateMatching::TemplateMatching(GraspCreatorInterface const* grasp_creator, boost::shared_ptr<const std::vector<
 		  grasp_template::GraspTemplate, Eigen::aligned_allocator<grasp_template::GraspTemplate> > > candidates, boost::shared_ptr<const std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > lib_grasps,
 		                     boost::shared_ptr<const std::vector<std::vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > > > lib_failures,
@@ -32,38 +56,73 @@ TemplateMatching::TemplateMatching(GraspCreatorInterface const* grasp_creator, b
   lib_failures_ = lib_failures;
   lib_successes_ = lib_successes;
 
-  lib_scores_.resize((*candidates_).size());
-  fail_scores_.resize((*candidates_).size());
-  lib_qualities_.resize((*lib_grasps_).size());
-  candidate_to_lib_.resize((*candidates_).size());
-  candidate_to_succ_.resize((*candidates_).size());
-  candidate_to_fail_.resize((*candidates_).size());
-  lib_to_fail_.resize((*lib_grasps_).size());
-
-  lib_match_handler_.clear();
+  boost::shared_ptr<LibraryMatchHandlers> handlers(new LibraryMatchHandlers());
   for (unsigned int i = 0; i < (*lib_grasps_).size(); i++)
   {
     const GraspAnalysis& lib_templt = (*lib_grasps_)[i];
-    lib_match_handler_.push_back(DismatchMeasure(lib_templt.grasp_template, lib_templt.template_pose.pose,
-                                                 lib_templt.gripper_pose.pose));
+    handlers->addLibGrasp(DismatchMeasure(lib_templt.grasp_template, lib_templt.template_pose.pose,
+                                          lib_templt.gripper_pose.pose));
   }
 
-  lib_succs_match_handler_.clear();
-  lib_succ_qualities_.resize((*lib_grasps_).size());
-  lib_succ_to_fail_.resize((*lib_grasps_).size());
   ROS_ASSERT((*lib_grasps_).size() == (*lib_successes_).size());
   for (unsigned int i = 0; i < (*lib_successes_).size(); i++)
   {
-	  lib_succ_qualities_[i].resize((*lib_successes_)[i].size());
-	  lib_succ_to_fail_[i].resize((*lib_successes_)[i].size());
-	  lib_succs_match_handler_.push_back(std::vector<grasp_template::DismatchMeasure, Eigen::aligned_allocator<grasp_template::DismatchMeasure> >());
 	  for(unsigned int j = 0; j < (*lib_successes_)[i].size(); j++)
 	  {
 		  const GraspAnalysis& lib_succ_templt = (*lib_successes_)[i][j];
-		  lib_succs_match_handler_[i].push_back(DismatchMeasure(lib_succ_templt.grasp_template, lib_succ_templt.template_pose.pose,
+		  handlers->addSuccess(i, DismatchMeasure(lib_succ_templt.grasp_template, lib_succ_templt.template_pose.pose,
 				  lib_succ_templt.gripper_pose.pose));
 	  }
   }
+
+  if (lib_failures_ != NULL)
+  {
+    for (unsigned int i = 0; i < (*lib_grasps_).size(); i++)
+    {
+      for (unsigned int j = 0; j < (*lib_failures_)[i].size(); j++)
+      {
+        handlers->addFailure(i, (*lib_failures_)[i][j].grasp_template);
+      }
+    }
+  }
+
+  handlers->computeDescriptors();
+  handlers_ = handlers;
+
+  constructClass();
+}
+
+TemplateMatching::TemplateMatching(GraspCreatorInterface const* grasp_creator, boost::shared_ptr<const std::vector<
+		  grasp_template::GraspTemplate, Eigen::aligned_allocator<grasp_template::GraspTemplate> > > candidates,
+		  const CompiledGraspLibrary& library)
+{
+  grasp_creator_ = grasp_creator;
+  candidates_ = candidates;
+
+  /* take one consistent snapshot, entries appended later do not affect this pool */
+  library.getSnapshot(lib_grasps_, lib_failures_, lib_successes_, handlers_);
+
+  constructClass();
+}
+
+void TemplateMatching::constructClass()
+{
+  lib_scores_.resize((*candidates_).size());
+  fail_scores_.resize((*candidates_).size());
+  lib_qualities_.resize((*lib_grasps_).size());
+  candidate_to_lib_.resize((*candidates_).size());
+  candidate_to_succ_.resize((*candidates_).size());
+  candidate_to_fail_.resize((*candidates_).size());
+  lib_to_fail_.resize((*lib_grasps_).size());
+
+  ROS_ASSERT(handlers_->lib_match_handler_.size() == (*lib_grasps_).size());
+  lib_succ_qualities_.resize((*lib_grasps_).size());
+  lib_succ_to_fail_.resize((*lib_grasps_).size());
+  for (unsigned int i = 0; i < (*lib_grasps_).size(); i++)
+  {
+    lib_succ_qualities_[i].resize(handlers_->lib_succs_match_handler_[i].size());
+    lib_succ_to_fail_[i].resize(handlers_->lib_succs_match_handler_[i].size());
+  }
 }
 
 GraspAnalysis TemplateMatching::getGrasp(unsigned int rank) const
@@ -138,26 +197,45 @@ void TemplateMatching::create()
     computeLibQuality(lib_index);
   }
 
+  /* decode every candidate once instead of copying it for each library entry */
+  vector<FlatHeightmap> flat_candidates((*candidates_).size());
   unsigned int cand = 0;
 #pragma omp parallel for private(cand)
   for (cand = 0; cand < (*candidates_).size(); cand++)
   {
+    flat_candidates[cand].set((*candidates_)[cand].heightmap_);
+  }
+
+#pragma omp parallel for private(cand)
+  for (cand = 0; cand < (*candidates_).size(); cand++)
+  {
+    const FlatHeightmap& sample = flat_candidates[cand];
     TemplateDissimilarity best_cf, best_cl, best_lf;
     double best_m = numeric_limits<double>::max();
     int best_fail_ind = -1;
     unsigned int best_lib_id = 0;
     int best_lib_succ_id = -1;
-    for (unsigned int lib = 0; lib < (*lib_grasps_).size(); lib++)
+
+    vector<unsigned int> libs;
+    getShortlist(sample, libs);
+
+    vector<TemplateDissimilarity> cur_csucss, cur_succf;
+    vector<double> a_succs, c_succs, a_succs_occs, m_succs;
+    for (unsigned int lib_it = 0; lib_it < libs.size(); lib_it++)
     {
-    	const unsigned int num_succs = lib_succs_match_handler_[lib].size();
+      const unsigned int lib = libs[lib_it];
+    	const unsigned int num_succs = handlers_->lib_succs_match_handler_[lib].size();
       TemplateDissimilarity cur_cf, cur_cl, cur_lf;
-      vector<TemplateDissimilarity> cur_csucss(num_succs), cur_succf(num_succs);
+      cur_csucss.resize(num_succs);
+      cur_succf.resize(num_succs);
       double a, b, c, a_occs;
-      vector<double> a_succs(num_succs), c_succs(num_succs), a_succs_occs(num_succs);
+      a_succs.resize(num_succs);
+      c_succs.resize(num_succs);
+      a_succs_occs.resize(num_succs);
 
       //compute m(c, f)
       int cur_fail_index = -1;
-      computeFailScore(cand, lib, cur_cf, cur_fail_index);
+      computeFailScore(sample, lib, cur_cf, cur_fail_index);
       if (cur_fail_index >= 0)
       {
         b = cur_cf.getScore();
@@ -169,12 +247,9 @@ void TemplateMatching::create()
 
       //compute m(c, l)
       {
-        GraspTemplate sample((*candidates_)[cand]);
-        GraspTemplate sample_tmp = sample;
-        const DismatchMeasure& mh = lib_match_handler_[lib];
+        const DismatchMeasure& mh = handlers_->lib_match_handler_[lib];
 
-        mh.applyDcMask(sample_tmp);
-        cur_cl = mh.getScore(sample_tmp);
+        cur_cl = mh.getMaskedScore(sample);
 
         a = cur_cl.getScore();
         a_occs = cur_cl.getAllFog();
@@ -182,11 +257,9 @@ void TemplateMatching::create()
 		  // compute m(c, s_i)
 		  for(unsigned int suc_ind = 0; suc_ind < num_succs; suc_ind++)
 		  {
-			  GraspTemplate sample_tmp_i = sample;;
-			  const DismatchMeasure& mh = lib_succs_match_handler_[lib][suc_ind];
+			  const DismatchMeasure& mh = handlers_->lib_succs_match_handler_[lib][suc_ind];
 
-			  mh.applyDcMask(sample_tmp_i);
-			  cur_csucss[suc_ind] = mh.getScore(sample_tmp_i);
+			  cur_csucss[suc_ind] = mh.getMaskedScore(sample);
 
 			  a_succs[suc_ind] = cur_csucss[suc_ind].getScore();
 			  a_succs_occs[suc_ind] = cur_csucss[suc_ind].getAllFog();
@@ -218,8 +291,7 @@ void TemplateMatching::create()
       }
 
       double m = computeScore(a, b, c, a_occs);
-      vector<double> m_succs(num_succs);
-      m_succs.resize(lib_succs_match_handler_[lib].size());
+      m_succs.resize(num_succs);
       for(unsigned int suc_ind = 0; suc_ind < num_succs; suc_ind++)
       {
     	  m_succs[suc_ind] = computeScore(a_succs[suc_ind], b, c_succs[suc_ind], a_succs_occs[suc_ind]);
@@ -331,11 +403,7 @@ void TemplateMatching::computeLibQuality(unsigned int lib_index)
   {
     for (unsigned int i = 0; i < (*lib_failures_)[lib_index].size(); i++)
     {
-      GraspTemplate f_templt((*lib_failures_)[lib_index][i].grasp_template,
-                             (*lib_failures_)[lib_index][i].template_pose.pose);
-      lib_match_handler_[lib_index].applyDcMask(f_templt);
-
-      TemplateDissimilarity cur = lib_match_handler_[lib_index].getScore(f_templt);
+      TemplateDissimilarity cur = handlers_->lib_match_handler_[lib_index].getMaskedScore(handlers_->flat_failures_[lib_index][i]);
       if (i == 0 || cur.isBetter(cur, closest))
       {
         closest = cur;
@@ -349,7 +417,7 @@ void TemplateMatching::computeLibQuality(unsigned int lib_index)
 
   // Lib succs against Failures
   std::vector<TemplateDissimilarity>& succ_quals =  lib_succ_qualities_[lib_index];
-  std::vector<grasp_template::DismatchMeasure, Eigen::aligned_allocator<grasp_template::DismatchMeasure> >& succ_match_handler = lib_succs_match_handler_[lib_index];
+  const std::vector<grasp_template::DismatchMeasure, Eigen::aligned_allocator<grasp_template::DismatchMeasure> >& succ_match_handler = handlers_->lib_succs_match_handler_[lib_index];
   if (lib_failures_ != NULL)
   {
 	  for(unsigned int i = 0; i < succ_quals.size(); i++)
@@ -359,12 +427,7 @@ void TemplateMatching::computeLibQuality(unsigned int lib_index)
 
 		  for (unsigned int j = 0; j < (*lib_failures_)[lib_index].size(); j++)
 		  {
-			  GraspTemplate f_templt((*lib_failures_)[lib_index][j].grasp_template,
-									 (*lib_failures_)[lib_index][j].template_pose.pose);
-
-			  succ_match_handler[i].applyDcMask(f_templt);
-
-			  TemplateDissimilarity cur = succ_match_handler[i].getScore(f_templt);
+			  TemplateDissimilarity cur = succ_match_handler[i].getMaskedScore(handlers_->flat_failures_[lib_index][j]);
 			  if (j == 0 || cur.isBetter(cur, closest))
 			  {
 				 closest = cur;
@@ -378,23 +441,17 @@ void TemplateMatching::computeLibQuality(unsigned int lib_index)
   }
 }
 
-void TemplateMatching::computeFailScore(unsigned int candidate, unsigned int lib_index, TemplateDissimilarity& score,
-                                        int& fail_index) const
+void TemplateMatching::computeFailScore(const FlatHeightmap& candidate, unsigned int lib_index,
+                                        TemplateDissimilarity& score, int& fail_index) const
 {
-  GraspTemplate sample((*candidates_)[candidate]);
-  lib_match_handler_[lib_index].applyDcMask(sample);
-
   fail_index = -1;
 
   if (lib_failures_ != NULL)
   {
-    for (unsigned int i = 0; i < (*lib_failures_)[lib_index].size(); i++)
+    for (unsigned int i = 0; i < handlers_->flat_masked_failures_[lib_index].size(); i++)
     {
-      GraspTemplate f_templt((*lib_failures_)[lib_index][i].grasp_template,
-                             (*lib_failures_)[lib_index][i].template_pose.pose);
-      lib_match_handler_[lib_index].applyDcMask(f_templt);
-
-      TemplateDissimilarity cur = lib_match_handler_[lib_index].getScore(sample, f_templt);
+      TemplateDissimilarity cur = handlers_->lib_match_handler_[lib_index].getMaskedScore(candidate,
+          handlers_->flat_masked_failures_[lib_index][i]);
       if (i == 0 || cur.isBetter(cur, score))
       {
         score = cur;
@@ -404,6 +461,76 @@ void TemplateMatching::computeFailScore(unsigned int candidate, unsigned int lib
   }
 }
 
+void LibraryMatchHandlers::computeDescriptors()
+{
+  descriptor_to_lib_.clear();
+  vector<Eigen::VectorXf> descriptors;
+  for (unsigned int i = 0; i < lib_match_handler_.size(); i++)
+  {
+    Eigen::VectorXf d;
+    lib_match_handler_[i].getFlatLibTemplt().getCoarseDescriptor(DESCRIPTOR_BLOCK_SIZE, d);
+    descriptors.push_back(d);
+    descriptor_to_lib_.push_back(i);
+
+    for (unsigned int j = 0; j < lib_succs_match_handler_[i].size(); j++)
+    {
+      lib_succs_match_handler_[i][j].getFlatLibTemplt().getCoarseDescriptor(DESCRIPTOR_BLOCK_SIZE, d);
+      descriptors.push_back(d);
+      descriptor_to_lib_.push_back(i);
+    }
+  }
+
+  if (descriptors.empty())
+  {
+    lib_descriptors_.resize(0, 0);
+    return;
+  }
+  lib_descriptors_.resize(descriptors[0].size(), descriptors.size());
+  for (unsigned int i = 0; i < descriptors.size(); i++)
+  {
+    lib_descriptors_.col(i) = descriptors[i];
+  }
+}
+
+void TemplateMatching::getShortlist(const FlatHeightmap& candidate, vector<unsigned int>& libs) const
+{
+  const unsigned int num_libs = (*lib_grasps_).size();
+  const int shortlist_size = matchingShortlistSize();
+  libs.clear();
+  if (shortlist_size <= 0 || static_cast<unsigned int> (shortlist_size) >= num_libs
+      || handlers_->lib_descriptors_.cols() == 0)
+  {
+    for (unsigned int i = 0; i < num_libs; i++)
+    {
+      libs.push_back(i);
+    }
+    return;
+  }
+
+  /* a library grasp is as close as the closest of itself and its successes */
+  Eigen::VectorXf d;
+  candidate.getCoarseDescriptor(LibraryMatchHandlers::DESCRIPTOR_BLOCK_SIZE, d);
+  const Eigen::VectorXf dists = (handlers_->lib_descriptors_.colwise() - d).colwise().squaredNorm().transpose();
+  vector<pair<float, unsigned int> > lib_dists(num_libs, make_pair(numeric_limits<float>::max(), 0));
+  for (unsigned int i = 0; i < num_libs; i++)
+  {
+    lib_dists[i].second = i;
+  }
+  for (unsigned int i = 0; i < handlers_->descriptor_to_lib_.size(); i++)
+  {
+    pair<float, unsigned int>& ld = lib_dists[handlers_->descriptor_to_lib_[i]];
+    ld.first = min(ld.first, dists(i));
+  }
+
+  nth_element(lib_dists.begin(), lib_dists.begin() + shortlist_size, lib_dists.end());
+  for (int i = 0; i < shortlist_size; i++)
+  {
+    libs.push_back(lib_dists[i].second);
+  }
+  /* keep library order so that ties resolve as in the full search */
+  sort(libs.begin(), libs.end());
+}
+
 double TemplateMatching::computeScore(double a, double b, double c, double occlusions) const
 {
   if (b >= 0.0)
@@ -0,0 +1,293 @@
+/*********************************************************************
+ Computational Learning and Motor Control Lab
+ University of Southern California
+ Prof. Stefan Schaal
+ *********************************************************************
+ \remarks      Writes a compiled grasp library, reads it back and compares
+               it with the library it was compiled from, also checks that
+               corrupt files are rejected.
+
+ \file         compiled_grasp_library_test.cpp
+
+ *********************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include <ros/ros.h>
+#include <ros/serialization.h>
+#include <grasp_template/template_heightmap.h>
+#include <grasp_template/flat_heightmap.h>
+#include <grasp_template/dismatch_measure.h>
+#include <grasp_template_planning/compiled_grasp_library.h>
+
+using namespace std;
+using namespace grasp_template;
+using namespace grasp_template_planning;
+
+typedef vector<GraspAnalysis, Eigen::aligned_allocator<GraspAnalysis> > GraspAnalyses;
+
+/* offsets into the file, see CglFileHeader and CglRecordHeader */
+static const size_t FILE_HEADER_SIZE = 24;
+static const size_t ANALYSIS_SIZE_OFFSET = 144;
+
+static const unsigned int NUM_LIB_GRASPS = 3;
+
+class CompiledGraspLibraryTest : public testing::Test
+{
+protected:
+
+  void SetUp()
+  {
+    srand(0);
+    stringstream filename;
+    filename << "/tmp/compiled_grasp_library_test_" << getpid() << ".cgl";
+    filename_ = filename.str();
+
+    lib_failures_.resize(NUM_LIB_GRASPS);
+    lib_successes_.resize(NUM_LIB_GRASPS);
+    for (unsigned int i = 0; i < NUM_LIB_GRASPS; i++)
+    {
+      lib_grasps_.push_back(createAnalysis(i, 0));
+      for (unsigned int j = 0; j <= i; j++)
+      {
+        lib_failures_[i].push_back(createAnalysis(i, 1 + j));
+      }
+      lib_successes_[i].push_back(createAnalysis(i, 10));
+    }
+    probe_ = createAnalysis(NUM_LIB_GRASPS, 0);
+  }
+
+  void TearDown()
+  {
+    remove(filename_.c_str());
+  }
+
+  /* a template with random tiles of every state */
+  static GraspAnalysis createAnalysis(unsigned int lib_index, unsigned int feedback_index)
+  {
+    TemplateHeightmap hm(TemplateHeightmap::TH_DEFAULT_NUM_TILES_X, TemplateHeightmap::TH_DEFAULT_NUM_TILES_Y,
+                         0.2, 0.2);
+    for (unsigned int ix = 0; ix < hm.getNumTilesX(); ix++)
+    {
+      for (unsigned int iy = 0; iy < hm.getNumTilesY(); iy++)
+      {
+        double x, y;
+        hm.gridToWorldCoordinates(ix, iy, x, y);
+        const double value = (rand() % 2000 - 1000) / 10000.0;
+        switch (rand() % 5)
+        {
+          case 0:
+            hm.setGridTileSolid(x, y, value);
+            break;
+          case 1:
+            hm.setGridTileFog(x, y, value);
+            break;
+          case 2:
+            hm.setGridTileEmpty(x, y);
+            break;
+          case 3:
+            hm.setGridTileTable(x, y, value);
+            break;
+          default:
+            hm.setGridTileDontCare(x, y, value);
+        }
+      }
+    }
+
+    GraspAnalysis ana;
+    stringstream id;
+    id << lib_index;
+    ana.demo_id = id.str();
+    ana.demo_filename = "demo_" + id.str() + ".bag";
+    id << "_" << feedback_index;
+    ana.uuid = id.str();
+    ana.grasp_success = feedback_index == 10 ? 1.0 : 0.0;
+    hm.toHeightmapMsg(ana.grasp_template);
+    ana.template_pose.pose.position.z = 0.01 * lib_index;
+    ana.template_pose.pose.orientation.w = 1.0;
+    ana.gripper_pose.pose.position.z = 0.05 * (lib_index % 3) - 0.05;
+    ana.gripper_pose.pose.orientation.w = 1.0;
+    return ana;
+  }
+
+  template<class M>
+  static vector<uint8_t> serialize(const M& msg)
+  {
+    const uint32_t length = ros::serialization::serializationLength(msg);
+    vector<uint8_t> buffer(length);
+    ros::serialization::OStream stream(&buffer[0], length);
+    ros::serialization::serialize(stream, msg);
+    return buffer;
+  }
+
+  static void expectEqual(const GraspAnalyses& expected, const GraspAnalyses& actual)
+  {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (unsigned int i = 0; i < expected.size(); i++)
+    {
+      EXPECT_TRUE(serialize(expected[i]) == serialize(actual[i])) << "analysis " << i << " differs";
+    }
+  }
+
+  static void expectEqual(const DismatchMeasure& expected, const DismatchMeasure& actual, const FlatHeightmap& probe)
+  {
+    EXPECT_TRUE(expected.getFlatMask() == actual.getFlatMask());
+    const TemplateDissimilarity expected_score = expected.getMaskedScore(probe);
+    const TemplateDissimilarity actual_score = actual.getMaskedScore(probe);
+    EXPECT_EQ(expected_score.getScore(), actual_score.getScore());
+    EXPECT_EQ(expected_score.distances_sum_, actual_score.distances_sum_);
+  }
+
+  /* compares a loaded library with lib_grasps_, lib_failures_ and lib_successes_ */
+  void expectEqualToOriginal(const CompiledGraspLibrary& library)
+  {
+    boost::shared_ptr<const GraspAnalyses> lib_grasps;
+    boost::shared_ptr<const vector<GraspAnalyses> > lib_failures, lib_successes;
+    boost::shared_ptr<const LibraryMatchHandlers> handlers;
+    library.getSnapshot(lib_grasps, lib_failures, lib_successes, handlers);
+    ASSERT_TRUE(handlers != NULL);
+
+    expectEqual(lib_grasps_, *lib_grasps);
+    ASSERT_EQ(lib_failures_.size(), lib_failures->size());
+    ASSERT_EQ(lib_successes_.size(), lib_successes->size());
+    for (unsigned int i = 0; i < lib_grasps_.size(); i++)
+    {
+      expectEqual(lib_failures_[i], (*lib_failures)[i]);
+      expectEqual(lib_successes_[i], (*lib_successes)[i]);
+    }
+
+    /* the restored match handlers score like the ones computed from the original */
+    FlatHeightmap probe;
+    probe.set(probe_.grasp_template);
+    ASSERT_EQ(lib_grasps_.size(), handlers->lib_match_handler_.size());
+    ASSERT_EQ(lib_grasps_.size(), handlers->lib_succs_match_handler_.size());
+    ASSERT_EQ(lib_grasps_.size(), handlers->flat_failures_.size());
+    for (unsigned int i = 0; i < lib_grasps_.size(); i++)
+    {
+      const GraspAnalysis& lib = lib_grasps_[i];
+      expectEqual(DismatchMeasure(lib.grasp_template, lib.template_pose.pose, lib.gripper_pose.pose),
+                  handlers->lib_match_handler_[i], probe);
+
+      ASSERT_EQ(lib_successes_[i].size(), handlers->lib_succs_match_handler_[i].size());
+      for (unsigned int j = 0; j < lib_successes_[i].size(); j++)
+      {
+        const GraspAnalysis& succ = lib_successes_[i][j];
+        expectEqual(DismatchMeasure(succ.grasp_template, succ.template_pose.pose, succ.gripper_pose.pose),
+                    handlers->lib_succs_match_handler_[i][j], probe);
+      }
+      EXPECT_EQ(lib_failures_[i].size(), handlers->flat_failures_[i].size());
+    }
+  }
+
+  vector<unsigned char> readFile() const
+  {
+    vector<unsigned char> data;
+    FILE* file = fopen(filename_.c_str(), "rb");
+    if (file == NULL)
+      return data;
+    unsigned char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+      data.insert(data.end(), buffer, buffer + n);
+    }
+    fclose(file);
+    return data;
+  }
+
+  void writeFile(const vector<unsigned char>& data) const
+  {
+    FILE* file = fopen(filename_.c_str(), "wb");
+    ASSERT_TRUE(file != NULL);
+    if (!data.empty())
+    {
+      EXPECT_EQ(1u, fwrite(&data[0], data.size(), 1, file));
+    }
+    fclose(file);
+  }
+
+  bool load() const
+  {
+    CompiledGraspLibrary library(filename_);
+    return library.load();
+  }
+
+  string filename_;
+  GraspAnalyses lib_grasps_;
+  vector<GraspAnalyses> lib_failures_;
+  vector<GraspAnalyses> lib_successes_;
+  GraspAnalysis probe_;
+};
+
+TEST_F(CompiledGraspLibraryTest, roundTrip)
+{
+  ASSERT_TRUE(CompiledGraspLibrary::compile(filename_, lib_grasps_, lib_failures_, lib_successes_));
+  CompiledGraspLibrary library(filename_);
+  ASSERT_TRUE(library.load());
+  expectEqualToOriginal(library);
+}
+
+TEST_F(CompiledGraspLibraryTest, appendedFeedbackIsReadBack)
+{
+  ASSERT_TRUE(CompiledGraspLibrary::compile(filename_, lib_grasps_, lib_failures_, lib_successes_));
+  CompiledGraspLibrary library(filename_);
+  ASSERT_TRUE(library.load());
+
+  const GraspAnalysis failure = createAnalysis(1, 20);
+  const GraspAnalysis success = createAnalysis(2, 10);
+  ASSERT_TRUE(library.addFailure(lib_grasps_[1], failure));
+  ASSERT_TRUE(library.addSuccess(lib_grasps_[2], success));
+  lib_failures_[1].push_back(failure);
+  lib_successes_[2].push_back(success);
+  expectEqualToOriginal(library);
+
+  CompiledGraspLibrary reloaded(filename_);
+  ASSERT_TRUE(reloaded.load());
+  expectEqualToOriginal(reloaded);
+}
+
+TEST_F(CompiledGraspLibraryTest, rejectsCorruptFiles)
+{
+  ASSERT_TRUE(CompiledGraspLibrary::compile(filename_, lib_grasps_, lib_failures_, lib_successes_));
+  const vector<unsigned char> data = readFile();
+  ASSERT_GT(data.size(), FILE_HEADER_SIZE + ANALYSIS_SIZE_OFFSET + sizeof(uint64_t));
+
+  /* shorter than the file header */
+  writeFile(vector<unsigned char> (data.begin(), data.begin() + FILE_HEADER_SIZE / 2));
+  EXPECT_FALSE(load());
+
+  /* truncated behind the end stored in the file header */
+  writeFile(vector<unsigned char> (data.begin(), data.end() - 8));
+  EXPECT_FALSE(load());
+
+  /* the first analysis extends beyond its record */
+  vector<unsigned char> corrupt = data;
+  uint64_t analysis_size = 1 << 30;
+  memcpy(&corrupt[FILE_HEADER_SIZE + ANALYSIS_SIZE_OFFSET], &analysis_size, sizeof(analysis_size));
+  writeFile(corrupt);
+  EXPECT_FALSE(load());
+
+  /* the first analysis is cut short and cannot be deserialized */
+  corrupt = data;
+  analysis_size = 4;
+  memcpy(&corrupt[FILE_HEADER_SIZE + ANALYSIS_SIZE_OFFSET], &analysis_size, sizeof(analysis_size));
+  writeFile(corrupt);
+  EXPECT_FALSE(load());
+
+  writeFile(data);
+  EXPECT_TRUE(load());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "compiled_grasp_library_test");
+  return RUN_ALL_TESTS();
+}
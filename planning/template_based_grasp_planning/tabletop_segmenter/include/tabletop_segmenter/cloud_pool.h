@@ -0,0 +1,80 @@
+/*********************************************************************
+*
+*  Copyright (c) 2012, Max-Plank Institute for Intelligent Systems
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#ifndef _CLOUD_POOL_H_
+#define _CLOUD_POOL_H_
+
+#include <vector>
+
+#include <pcl/point_cloud.h>
+
+namespace tabletop_segmenter {
+
+  //! Recycles point clouds between frames so that their buffers keep their capacity
+  /*! A cloud is handed out again once nobody but the pool holds a pointer to it. */
+  template <typename PointT>
+  class CloudPool
+  {
+  public:
+    typedef pcl::PointCloud<PointT> Cloud;
+    typedef typename Cloud::Ptr CloudPtr;
+
+    //! Returns an empty cloud, allocates a new one only if all clouds are in use
+    CloudPtr acquire()
+    {
+      for (size_t i = 0; i < clouds_.size(); ++i)
+      {
+	if (clouds_[i].unique())
+	{
+	  Cloud &cloud = *clouds_[i];
+	  cloud.points.clear();
+	  cloud.width = 0;
+	  cloud.height = 1;
+	  cloud.is_dense = true;
+	  return clouds_[i];
+	}
+      }
+      clouds_.push_back(CloudPtr(new Cloud()));
+      return clouds_.back();
+    }
+
+    //! Number of clouds allocated so far
+    size_t size() const { return clouds_.size(); }
+
+  private:
+    std::vector<CloudPtr> clouds_;
+  };
+
+}//namespace
+
+#endif
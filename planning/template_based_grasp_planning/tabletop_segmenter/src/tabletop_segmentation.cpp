@@ -34,6 +34,9 @@
 // Author(s): Marius Muja, Matei Ciocarlie
 // Author(s) @ MPI: Jeannette Bohg and Alexander Herzog
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
 
 #include <ros/ros.h>
 #include <rosbag/bag.h>
@@ -60,6 +63,7 @@
 #include <pcl/kdtree/kdtree_flann.h>
 #include <pcl/sample_consensus/method_types.h>
 #include <pcl/sample_consensus/model_types.h>
+#include <pcl/sample_consensus/sac_model_plane.h>
 #include <pcl/segmentation/sac_segmentation.h>
 #include <pcl/filters/project_inliers.h>
 #include <pcl/surface/convex_hull.h>
@@ -72,6 +76,7 @@
 
 #include "tabletop_segmenter/marker_generator.h"
 #include "tabletop_segmenter/utilities.h"
+#include "tabletop_segmenter/cloud_pool.h"
 #include "tabletop_segmenter/TabletopSegmentation.h"
 
 // includes for projecting stereo into same frame
@@ -107,8 +112,12 @@ private:
   ros::Publisher marker_pub_;
   //! Publisher for markers
   ros::Publisher pcd_pub_,pcl_cloud_;
+  //! Publisher for the table in streaming mode
+  ros::Publisher table_pub_;
   //! Service server for object detection
   ros::ServiceServer segmentation_srv_;
+  //! Subscribers for streaming mode
+  ros::Subscriber cloud_sub_, cam_info_sub_;
 
   //! Used to remember the number of markers we publish so we can delete them later
   int num_markers_published_;
@@ -138,6 +147,23 @@ private:
   //! Positive or negative z is closer to the "up" direction in the processing frame?
   double up_direction_;
 
+  //! Whether to segment every incoming cloud with fused filtering, plane tracking and pooled clouds
+  bool streaming_;
+  //! Max distance of a point to the tracked table plane to count as inlier
+  double plane_tracking_threshold_;
+  //! Fraction of the previous inliers the tracked plane has to keep, otherwise RANSAC is run
+  double plane_tracking_min_inlier_ratio_;
+  //! Table plane of the previous frame, empty if there is none
+  pcl::ModelCoefficients tracked_plane_;
+  //! Number of points within plane_tracking_threshold_ of the tracked plane in the previous frame
+  int tracked_plane_inliers_;
+  //! Intermediate clouds recycled between frames in streaming mode
+  CloudPool<Point> cloud_pool_;
+  //! Voxel key and point index of every cropped point, kept to avoid reallocation
+  std::vector<std::pair<uint64_t, int> > voxel_keys_;
+  //! Most recent camera info for streaming mode
+  sensor_msgs::CameraInfo::ConstPtr latest_cam_info_;
+
   //! A tf transform listener
   tf::TransformListener listener_;
 
@@ -149,6 +175,12 @@ private:
   //! Callback for service calls
   bool serviceCallback(TabletopSegmentation::Request &request, TabletopSegmentation::Response &response);
 
+  //! Callback for clouds in streaming mode
+  void cloudCallback(const sensor_msgs::PointCloud2::ConstPtr &cloud);
+
+  //! Callback for camera infos in streaming mode
+  void camInfoCallback(const sensor_msgs::CameraInfo::ConstPtr &cam_info);
+
   //------------------ Individual processing steps -------
 
   //! Converts raw table detection results into a Table message type
@@ -164,6 +196,24 @@ private:
   void publishTablePoints(const sensor_msgs::PointCloud2 &table, 
 			  std_msgs::Header cloud_header);
 
+  //! Crops the cloud to the filter limits in /BASE and downsamples it in one pass over the ROS buffer
+  /*! Both outputs stay in the frame of the input cloud. */
+  bool cropAndDownsample(const sensor_msgs::PointCloud2 &cloud,
+			 pcl::PointCloud<Point> &cropped,
+			 pcl::PointCloud<Point> &downsampled);
+
+  //! Verifies the table plane of the previous frame on the new cloud and refines it
+  bool trackTablePlane(const pcl::PointCloud<Point>::ConstPtr &cloud,
+		       pcl::PointIndices &inliers,
+		       pcl::ModelCoefficients &coefficients);
+
+  //! Remembers a table plane found by RANSAC for tracking in the next frame
+  void resetTrackedPlane(const pcl::PointCloud<Point>::ConstPtr &cloud,
+			 const pcl::ModelCoefficients &coefficients);
+
+  //! Allocates a new cloud, or recycles one from the pool in streaming mode
+  pcl::PointCloud<Point>::Ptr newCloud();
+
   //------------------- Complete processing -----
 
   //! Complete processing for new style point cloud
@@ -219,6 +269,19 @@ public:
     priv_nh_.param<int>("min_cluster_size", min_cluster_size_, 300);
     priv_nh_.param<std::string>("processing_frame", processing_frame_, "");
     priv_nh_.param<double>("up_direction", up_direction_, -1.0);   
+    priv_nh_.param<bool>("streaming", streaming_, false);
+    priv_nh_.param<double>("plane_tracking_threshold", plane_tracking_threshold_, 0.01);
+    priv_nh_.param<double>("plane_tracking_min_inlier_ratio", plane_tracking_min_inlier_ratio_, 0.8);
+    tracked_plane_inliers_ = 0;
+
+    if (streaming_)
+    {
+      table_pub_ = nh_.advertise<Table>("tabletop_table", 10);
+      cam_info_sub_ = nh_.subscribe(nh_.resolveName("/cam_info"), 1, 
+				    &TabletopSegmentor::camInfoCallback, this);
+      cloud_sub_ = nh_.subscribe(nh_.resolveName("cloud_in"), 1, 
+				 &TabletopSegmentor::cloudCallback, this);
+    }
   }
 
   //! Empty stub
@@ -393,6 +456,29 @@ bool TabletopSegmentor::serviceCallback(TabletopSegmentation::Request &request,
   return true;
 }
 
+void TabletopSegmentor::camInfoCallback(const sensor_msgs::CameraInfo::ConstPtr &cam_info)
+{
+  latest_cam_info_ = cam_info;
+}
+
+/*! Segments every cloud as it arrives; results are published instead of returned.
+ */
+void TabletopSegmentor::cloudCallback(const sensor_msgs::PointCloud2::ConstPtr &cloud)
+{
+  if (!latest_cam_info_)
+  {
+    ROS_DEBUG("Tabletop object segmenter: skipping cloud, no camera info received yet");
+    return;
+  }
+
+  TabletopSegmentation::Response response;
+  processCloud(*cloud, *latest_cam_info_, response);
+  clearOldMarkers(cloud->header.frame_id);
+
+  if (response.result == response.SUCCESS || response.result == response.SUCCESS_NO_RGB)
+    table_pub_.publish(response.table);
+}
+
 
 Table TabletopSegmentor::getTable(std_msgs::Header cloud_header,
                                   const tf::Transform &table_plane_trans, 
@@ -679,6 +765,183 @@ getClustersFromPCLCloud (const pcl::PointCloud<PointT> &cloud_objects,
     }
 }
 
+pcl::PointCloud<Point>::Ptr TabletopSegmentor::newCloud()
+{
+  if (streaming_)
+    return cloud_pool_.acquire();
+  return pcl::PointCloud<Point>::Ptr(new pcl::PointCloud<Point> ());
+}
+
+bool TabletopSegmentor::cropAndDownsample(const sensor_msgs::PointCloud2 &cloud,
+					  pcl::PointCloud<Point> &cropped,
+					  pcl::PointCloud<Point> &downsampled)
+{
+  int x_idx = pcl::getFieldIndex(cloud, "x");
+  int y_idx = pcl::getFieldIndex(cloud, "y");
+  int z_idx = pcl::getFieldIndex(cloud, "z");
+  if (x_idx < 0 || y_idx < 0 || z_idx < 0 
+      || cloud.fields[x_idx].datatype != sensor_msgs::PointField::FLOAT32
+      || cloud.fields[y_idx].datatype != sensor_msgs::PointField::FLOAT32
+      || cloud.fields[z_idx].datatype != sensor_msgs::PointField::FLOAT32)
+  {
+    ROS_ERROR("Cloud has no float x, y and z fields");
+    return false;
+  }
+  const uint32_t x_off = cloud.fields[x_idx].offset;
+  const uint32_t y_off = cloud.fields[y_idx].offset;
+  const uint32_t z_off = cloud.fields[z_idx].offset;
+
+  // the filter limits are given in /BASE, only the crop test is done there
+  tf::StampedTransform base_from_cloud;
+  try
+  {
+    if (!listener_.waitForTransform("/BASE", cloud.header.frame_id, cloud.header.stamp, ros::Duration(3.0)))
+    {
+      ROS_ERROR("Timed out waiting for transform from %s to /BASE", cloud.header.frame_id.c_str());
+      return false;
+    }
+    listener_.lookupTransform("/BASE", cloud.header.frame_id, ros::Time(0), base_from_cloud);
+  }
+  catch (tf::TransformException& ex)
+  {
+    ROS_ERROR("Failed to look up transform from %s to /BASE; error %s", 
+	      cloud.header.frame_id.c_str(), ex.what());
+    return false;
+  }
+  const btMatrix3x3 &basis = base_from_cloud.getBasis();
+  const btVector3 &origin = base_from_cloud.getOrigin();
+  float r[3][3], t[3];
+  for (int i = 0; i < 3; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+      r[i][j] = basis[i][j];
+    t[i] = origin[i];
+  }
+
+  const float inv_leaf = 1.0 / plane_detection_voxel_size_;
+  const uint64_t num_y = (uint64_t)((y_filter_max_ - y_filter_min_) * inv_leaf) + 1;
+  const uint64_t num_z = (uint64_t)((z_filter_max_ - z_filter_min_) * inv_leaf) + 1;
+
+  cropped.points.clear();
+  voxel_keys_.clear();
+  for (uint32_t row = 0; row < cloud.height; ++row)
+  {
+    const uint8_t *row_data = &cloud.data[row * cloud.row_step];
+    for (uint32_t col = 0; col < cloud.width; ++col)
+    {
+      const uint8_t *pt_data = row_data + col * cloud.point_step;
+      Point p;
+      memcpy(&p.x, pt_data + x_off, sizeof(float));
+      memcpy(&p.y, pt_data + y_off, sizeof(float));
+      memcpy(&p.z, pt_data + z_off, sizeof(float));
+
+      const float bx = r[0][0] * p.x + r[0][1] * p.y + r[0][2] * p.z + t[0];
+      const float by = r[1][0] * p.x + r[1][1] * p.y + r[1][2] * p.z + t[1];
+      const float bz = r[2][0] * p.x + r[2][1] * p.y + r[2][2] * p.z + t[2];
+      // written such that NaNs fail the test as well
+      if (!(bx >= x_filter_min_ && bx <= x_filter_max_ &&
+	    by >= y_filter_min_ && by <= y_filter_max_ &&
+	    bz >= z_filter_min_ && bz <= z_filter_max_))
+	continue;
+
+      const uint64_t ix = (uint64_t)((bx - x_filter_min_) * inv_leaf);
+      const uint64_t iy = (uint64_t)((by - y_filter_min_) * inv_leaf);
+      const uint64_t iz = (uint64_t)((bz - z_filter_min_) * inv_leaf);
+      voxel_keys_.push_back(std::make_pair((ix * num_y + iy) * num_z + iz, (int)cropped.points.size()));
+      cropped.points.push_back(p);
+    }
+  }
+  cropped.header = cloud.header;
+  cropped.width = cropped.points.size();
+  cropped.height = 1;
+  cropped.is_dense = true;
+
+  // the centroid of a voxel in /BASE maps to the centroid of its points in the cloud frame
+  std::sort(voxel_keys_.begin(), voxel_keys_.end());
+  downsampled.points.clear();
+  size_t first = 0;
+  while (first < voxel_keys_.size())
+  {
+    size_t last = first;
+    Eigen::Vector3f sum(0, 0, 0);
+    while (last < voxel_keys_.size() && voxel_keys_[last].first == voxel_keys_[first].first)
+    {
+      const Point &p = cropped.points[voxel_keys_[last].second];
+      sum += Eigen::Vector3f(p.x, p.y, p.z);
+      ++last;
+    }
+    sum /= (float)(last - first);
+    Point centroid;
+    centroid.x = sum[0];
+    centroid.y = sum[1];
+    centroid.z = sum[2];
+    downsampled.points.push_back(centroid);
+    first = last;
+  }
+  downsampled.header = cloud.header;
+  downsampled.width = downsampled.points.size();
+  downsampled.height = 1;
+  downsampled.is_dense = true;
+
+  return true;
+}
+
+bool TabletopSegmentor::trackTablePlane(const pcl::PointCloud<Point>::ConstPtr &cloud,
+					pcl::PointIndices &inliers,
+					pcl::ModelCoefficients &coefficients)
+{
+  if (tracked_plane_.values.size() != 4 || tracked_plane_.header.frame_id != cloud->header.frame_id)
+    return false;
+
+  pcl::SampleConsensusModelPlane<Point> model(cloud);
+  Eigen::VectorXf previous(4);
+  for (int i = 0; i < 4; ++i)
+    previous[i] = tracked_plane_.values[i];
+
+  std::vector<int> candidates;
+  model.selectWithinDistance(previous, plane_tracking_threshold_, candidates);
+  if ((int)candidates.size() < inlier_threshold_ || 
+      candidates.size() < plane_tracking_min_inlier_ratio_ * tracked_plane_inliers_)
+  {
+    ROS_INFO("Lost track of the table, %d of %d inliers left", (int)candidates.size(), tracked_plane_inliers_);
+    return false;
+  }
+
+  // refine on the new inliers, as RANSAC does with optimized coefficients
+  Eigen::VectorXf refined;
+  model.optimizeModelCoefficients(candidates, previous, refined);
+  model.selectWithinDistance(refined, plane_tracking_threshold_, inliers.indices);
+  if ((int)inliers.indices.size() < inlier_threshold_)
+    return false;
+
+  inliers.header = cloud->header;
+  coefficients.header = cloud->header;
+  coefficients.values.resize(4);
+  for (int i = 0; i < 4; ++i)
+    coefficients.values[i] = refined[i];
+
+  tracked_plane_ = coefficients;
+  tracked_plane_inliers_ = inliers.indices.size();
+  return true;
+}
+
+void TabletopSegmentor::resetTrackedPlane(const pcl::PointCloud<Point>::ConstPtr &cloud,
+					  const pcl::ModelCoefficients &coefficients)
+{
+  pcl::SampleConsensusModelPlane<Point> model(cloud);
+  Eigen::VectorXf plane(4);
+  for (int i = 0; i < 4; ++i)
+    plane[i] = coefficients.values[i];
+
+  // count with the tracking threshold so that frames compare to each other
+  std::vector<int> inliers;
+  model.selectWithinDistance(plane, plane_tracking_threshold_, inliers);
+
+  tracked_plane_ = coefficients;
+  tracked_plane_.header.frame_id = cloud->header.frame_id;
+  tracked_plane_inliers_ = inliers.size();
+}
+
 void TabletopSegmentor::processCloud(const sensor_msgs::PointCloud2 &cloud,
 				     const sensor_msgs::CameraInfo &cam_info,
                                      TabletopSegmentation::Response &response)
@@ -686,20 +949,6 @@ void TabletopSegmentor::processCloud(const sensor_msgs::PointCloud2 &cloud,
 	ROS_INFO("Starting process on new cloud");
 	ROS_INFO("In frame %s", cloud.header.frame_id.c_str());
 
-	sensor_msgs::PointCloud2 transform_cloud;
-
-	//ros::Time time_now;
-	//std::string error_str;
-	//ROS_INFO_STREAM("cloud time = " << cloud.header.stamp << "\n current time = " << ros::Time::now());
-	//listener_.getLatestCommonTime("/XTION_IR", "/BASE",time_now,&error_str);
-	//ROS_INFO_STREAM("Latest common time" << time_now);
-        //cloud.header.stamp
-        sensor_msgs::PointCloud2 local_cloud = cloud;
-        local_cloud.header.stamp = ros::Time(0);
-	ROS_VERIFY(listener_.waitForTransform("/BASE", cloud.header.frame_id, cloud.header.stamp, ros::Duration(3.0)));
-	//ROS_VERIFY(listener_.waitForTransform("/BASE", local_cloud.header.frame_id, local_cloud.header.stamp, ros::Duration(3.0)));
-	ROS_VERIFY(pcl_ros::transformPointCloud("/BASE", local_cloud, transform_cloud, listener_));
-
 	// PCL objects
 	boost::shared_ptr<pcl::search::Search<Point> > normals_tree_, clusters_tree_;
 	pcl::VoxelGrid<Point> grid_, grid_objects_;
@@ -745,84 +994,136 @@ void TabletopSegmentor::processCloud(const sensor_msgs::PointCloud2 &cloud,
 	pcl_cluster_.setSearchMethod (clusters_tree_);
 
 	// Step 1 : Filter, remove NaNs and downsample
-	pcl::PointCloud<Point>::Ptr cloud_ptr(new pcl::PointCloud<Point> ());
-	//pcl::fromROSMsg (cloud, *cloud_ptr); // Changing cloud to /Base transformed cloud
-	pcl::fromROSMsg (transform_cloud, *cloud_ptr); // Changing cloud to /Base transformed cloud
-
-	pcl::PointCloud<Point>::Ptr cloud_filtered_ptr_x(new pcl::PointCloud<Point> ());
-	pcl::PointCloud<Point>::Ptr cloud_filtered_ptr_y(new pcl::PointCloud<Point> ());
-	pcl::PointCloud<Point>::Ptr cloud_filtered_ptr_z(new pcl::PointCloud<Point> ());
-
-	pass_.setInputCloud (cloud_ptr);
-	pass_.filter (*cloud_filtered_ptr_z);
-
-	//filtering x
-	pass_.setFilterFieldName ("x");
-	pass_.setFilterLimits (x_filter_min_, x_filter_max_);
-	pass_.setInputCloud (cloud_filtered_ptr_z);
-	pass_.filter (*cloud_filtered_ptr_x);
-
-	//filtering y
-	pass_.setFilterFieldName ("y");
-	pass_.setFilterLimits (y_filter_min_, y_filter_max_);
-	pass_.setInputCloud (cloud_filtered_ptr_x);
-	pass_.filter (*cloud_filtered_ptr_y);
-
-	ROS_INFO("Step 1 done");
-	if (cloud_filtered_ptr_y->points.size() < (unsigned int)min_cluster_size_)
+	pcl::PointCloud<Point>::Ptr cloud_filtered_ptr_y = newCloud();
+	pcl::PointCloud<Point>::Ptr cloud_downsampled_ptr = newCloud();
+
+	if (streaming_)
 	{
-		ROS_INFO("Filtered cloud only has %ld points", (long int)cloud_filtered_ptr_y->points.size());
-		response.result = response.NO_TABLE;
-		return;
+		if (!cropAndDownsample(cloud, *cloud_filtered_ptr_y, *cloud_downsampled_ptr))
+		{
+			response.result = response.OTHER_ERROR;
+			return;
+		}
+		ROS_INFO("Step 1 done");
+		if (cloud_filtered_ptr_y->points.size() < (unsigned int)min_cluster_size_)
+		{
+			ROS_INFO("Filtered cloud only has %ld points", (long int)cloud_filtered_ptr_y->points.size());
+			response.result = response.NO_TABLE;
+			return;
+		}
+		if (cloud_downsampled_ptr->points.size() < (unsigned int)min_cluster_size_)
+		{
+			ROS_INFO("Downsampled cloud only has %ld points", (long int)cloud_downsampled_ptr->points.size());
+			response.result = response.NO_TABLE;
+			return;
+		}
 	}
-
-	pcl::PointCloud<Point>::Ptr cloud_downsampled_ptr(new pcl::PointCloud<Point> ());
-	grid_.setInputCloud (cloud_filtered_ptr_y);
-	grid_.filter (*cloud_downsampled_ptr);
-	if (cloud_downsampled_ptr->points.size() < (unsigned int)min_cluster_size_)
+	else
 	{
-		ROS_INFO("Downsampled cloud only has %ld points", (long int)cloud_downsampled_ptr->points.size());
-		response.result = response.NO_TABLE;
-		return;
+		sensor_msgs::PointCloud2 transform_cloud;
+
+		//ros::Time time_now;
+		//std::string error_str;
+		//ROS_INFO_STREAM("cloud time = " << cloud.header.stamp << "\n current time = " << ros::Time::now());
+		//listener_.getLatestCommonTime("/XTION_IR", "/BASE",time_now,&error_str);
+		//ROS_INFO_STREAM("Latest common time" << time_now);
+	        //cloud.header.stamp
+	        sensor_msgs::PointCloud2 local_cloud = cloud;
+	        local_cloud.header.stamp = ros::Time(0);
+		ROS_VERIFY(listener_.waitForTransform("/BASE", cloud.header.frame_id, cloud.header.stamp, ros::Duration(3.0)));
+		//ROS_VERIFY(listener_.waitForTransform("/BASE", local_cloud.header.frame_id, local_cloud.header.stamp, ros::Duration(3.0)));
+		ROS_VERIFY(pcl_ros::transformPointCloud("/BASE", local_cloud, transform_cloud, listener_));
+
+		pcl::PointCloud<Point>::Ptr cloud_ptr(new pcl::PointCloud<Point> ());
+		//pcl::fromROSMsg (cloud, *cloud_ptr); // Changing cloud to /Base transformed cloud
+		pcl::fromROSMsg (transform_cloud, *cloud_ptr); // Changing cloud to /Base transformed cloud
+
+		pcl::PointCloud<Point>::Ptr cloud_filtered_ptr_x(new pcl::PointCloud<Point> ());
+		pcl::PointCloud<Point>::Ptr cloud_filtered_ptr_z(new pcl::PointCloud<Point> ());
+
+		pass_.setInputCloud (cloud_ptr);
+		pass_.filter (*cloud_filtered_ptr_z);
+
+		//filtering x
+		pass_.setFilterFieldName ("x");
+		pass_.setFilterLimits (x_filter_min_, x_filter_max_);
+		pass_.setInputCloud (cloud_filtered_ptr_z);
+		pass_.filter (*cloud_filtered_ptr_x);
+
+		//filtering y
+		pass_.setFilterFieldName ("y");
+		pass_.setFilterLimits (y_filter_min_, y_filter_max_);
+		pass_.setInputCloud (cloud_filtered_ptr_x);
+		pass_.filter (*cloud_filtered_ptr_y);
+
+		ROS_INFO("Step 1 done");
+		if (cloud_filtered_ptr_y->points.size() < (unsigned int)min_cluster_size_)
+		{
+			ROS_INFO("Filtered cloud only has %ld points", (long int)cloud_filtered_ptr_y->points.size());
+			response.result = response.NO_TABLE;
+			return;
+		}
+
+		grid_.setInputCloud (cloud_filtered_ptr_y);
+		grid_.filter (*cloud_downsampled_ptr);
+		if (cloud_downsampled_ptr->points.size() < (unsigned int)min_cluster_size_)
+		{
+			ROS_INFO("Downsampled cloud only has %ld points", (long int)cloud_downsampled_ptr->points.size());
+			response.result = response.NO_TABLE;
+			return;
+		}
+
+		ROS_INFO("Transforming PointCloud back into camera frame");
+		// transforming back to original frame
+		ROS_VERIFY(listener_.waitForTransform(cloud.header.frame_id, "/BASE", cloud.header.stamp, ros::Duration(3.0)));
+		ROS_VERIFY(pcl_ros::transformPointCloud(cloud.header.frame_id, *cloud_downsampled_ptr, *cloud_downsampled_ptr,listener_));
+		ROS_VERIFY(pcl_ros::transformPointCloud(cloud.header.frame_id, *cloud_filtered_ptr_y, *cloud_filtered_ptr_y,listener_));
 	}
-
-	ROS_INFO("Transforming PointCloud back into camera frame");
-	// transforming back to original frame
-	ROS_VERIFY(listener_.waitForTransform(cloud.header.frame_id, "/BASE", cloud.header.stamp, ros::Duration(3.0)));
-	ROS_VERIFY(pcl_ros::transformPointCloud(cloud.header.frame_id, *cloud_downsampled_ptr, *cloud_downsampled_ptr,listener_));
-	ROS_VERIFY(pcl_ros::transformPointCloud(cloud.header.frame_id, *cloud_filtered_ptr_y, *cloud_filtered_ptr_y,listener_));
 	ROS_INFO("Publishing Downsampled cloud");
 	cloud_downsampled_ptr->header.frame_id = cloud.header.frame_id;
 	pcl_cloud_.publish(*cloud_downsampled_ptr);
 
 
-	// Step 2 : Estimate normals
-	pcl::PointCloud<pcl::Normal>::Ptr cloud_normals_ptr(new pcl::PointCloud<pcl::Normal> ());
-	n3d_.setInputCloud (cloud_downsampled_ptr);
-	n3d_.compute (*cloud_normals_ptr);
-	ROS_INFO("Step 2 done");
-
-
-	// Step 3 : Perform planar segmentation
 	pcl::PointIndices::Ptr table_inliers_ptr(new pcl::PointIndices ());
 	pcl::ModelCoefficients::Ptr table_coefficients_ptr(new pcl::ModelCoefficients ());
-	seg_.setInputCloud (cloud_downsampled_ptr);
-	seg_.setInputNormals (cloud_normals_ptr);
-	seg_.segment (*table_inliers_ptr, *table_coefficients_ptr);
-
-	if (table_coefficients_ptr->values.size () <=3)
+	// In streaming mode, a table that is still where it was spares normals and RANSAC
+	if (streaming_ && trackTablePlane(cloud_downsampled_ptr, *table_inliers_ptr, *table_coefficients_ptr))
 	{
-		ROS_INFO("Failed to detect table in scan");
-		response.result = response.NO_TABLE;
-		return;
+		ROS_INFO("Tracked table with %d inliers", (int)table_inliers_ptr->indices.size());
 	}
-
-	if ( table_inliers_ptr->indices.size() < (unsigned int)inlier_threshold_)
+	else
 	{
-		ROS_INFO("Plane detection has %d inliers, below min threshold of %d", (int)table_inliers_ptr->indices.size(),
-				inlier_threshold_);
-		response.result = response.NO_TABLE;
-		return;
+		tracked_plane_.values.clear();
+
+		// Step 2 : Estimate normals
+		pcl::PointCloud<pcl::Normal>::Ptr cloud_normals_ptr(new pcl::PointCloud<pcl::Normal> ());
+		n3d_.setInputCloud (cloud_downsampled_ptr);
+		n3d_.compute (*cloud_normals_ptr);
+		ROS_INFO("Step 2 done");
+
+
+		// Step 3 : Perform planar segmentation
+		seg_.setInputCloud (cloud_downsampled_ptr);
+		seg_.setInputNormals (cloud_normals_ptr);
+		seg_.segment (*table_inliers_ptr, *table_coefficients_ptr);
+
+		if (table_coefficients_ptr->values.size () <=3)
+		{
+			ROS_INFO("Failed to detect table in scan");
+			response.result = response.NO_TABLE;
+			return;
+		}
+
+		if ( table_inliers_ptr->indices.size() < (unsigned int)inlier_threshold_)
+		{
+			ROS_INFO("Plane detection has %d inliers, below min threshold of %d", (int)table_inliers_ptr->indices.size(),
+					inlier_threshold_);
+			response.result = response.NO_TABLE;
+			return;
+		}
+
+		if (streaming_)
+			resetTrackedPlane(cloud_downsampled_ptr, *table_coefficients_ptr);
 	}
 
 	ROS_INFO ("[TableObjectDetector::input_callback] Table found with %d inliers: [%f %f %f %f].",
@@ -832,7 +1133,7 @@ void TabletopSegmentor::processCloud(const sensor_msgs::PointCloud2 &cloud,
 	ROS_INFO("Step 3 done");
 
 	// Step 4 : Project the table inliers on the table
-	pcl::PointCloud<Point>::Ptr table_projected_ptr(new pcl::PointCloud<Point> ());
+	pcl::PointCloud<Point>::Ptr table_projected_ptr = newCloud();
 	proj_.setInputCloud (cloud_downsampled_ptr);
 	proj_.setIndices (table_inliers_ptr);
 	proj_.setModelCoefficients (table_coefficients_ptr);
@@ -858,7 +1159,7 @@ void TabletopSegmentor::processCloud(const sensor_msgs::PointCloud2 &cloud,
 		response.result = response.SUCCESS_NO_RGB;
 
 	// ---[ Estimate the convex hull on 3D data
-	pcl::PointCloud<Point>::Ptr table_hull_ptr(new pcl::PointCloud<Point> ());
+	pcl::PointCloud<Point>::Ptr table_hull_ptr = newCloud();
 	std::vector< pcl::Vertices > polygons;
 	//  hull_.setDimension(3);
 	hull_.setInputCloud (table_projected_ptr);
@@ -873,7 +1174,7 @@ void TabletopSegmentor::processCloud(const sensor_msgs::PointCloud2 &cloud,
 	prism_.segment (*cloud_object_indices_ptr);
 
 
-	pcl::PointCloud<Point>::Ptr cloud_objects_ptr(new pcl::PointCloud<Point> ());
+	pcl::PointCloud<Point>::Ptr cloud_objects_ptr = newCloud();
 	pcl::ExtractIndices<Point> extract_object_indices;
 	extract_object_indices.setInputCloud (cloud_filtered_ptr_y);
 	extract_object_indices.setIndices (cloud_object_indices_ptr);
@@ -889,7 +1190,7 @@ void TabletopSegmentor::processCloud(const sensor_msgs::PointCloud2 &cloud,
 
 
 	// ---[ Downsample the points
-	pcl::PointCloud<Point>::Ptr cloud_objects_downsampled_ptr(new pcl::PointCloud<Point> ());
+	pcl::PointCloud<Point>::Ptr cloud_objects_downsampled_ptr = newCloud();
 	grid_objects_.setInputCloud (cloud_objects_ptr);
 	grid_objects_.filter (*cloud_objects_downsampled_ptr);
 
@@ -40,6 +40,10 @@
 #include <ros/ros.h>
 #include <rosbag/bag.h>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <deque>
+#include <utility>
 
 #include <task_manager/task_manager.h>
 #include <task_manager/task.h>
@@ -75,6 +79,8 @@ private:
     int num_dimensions_;
 
     bool write_to_file_;
+    int num_rollout_threads_;
+    bool batch_execution_;
     bool use_cumulative_costs_;
     bool reevaluate_reused_rollouts_;
     std::string filename_prefix_;
@@ -99,12 +105,33 @@ private:
 
     // temporary variables
     Eigen::VectorXd tmp_rollout_cost_;
+    std::vector<Eigen::VectorXd> tmp_thread_rollout_costs_; /**< [num_rollout_threads] */
+
+    /**
+     * Executes rollouts thread_id, thread_id + num_rollout_threads_, ... (only used for reentrant tasks)
+     */
+    void executeRollouts(const int thread_id, const int iteration_number, bool& success);
+
+    /**
+     * Writes the policy of all rollouts once they have been executed (only used for tasks that don't change the policy)
+     */
+    bool writeRolloutPolicies(const int iteration_number);
+
+    // background copies of the rollout policy files (source, destination), the thread is started on first use
+    boost::shared_ptr<boost::thread> file_writer_thread_;
+    boost::mutex file_writer_mutex_;
+    boost::condition_variable file_writer_cond_;
+    std::deque<std::pair<std::string, std::string> > file_copies_;
+    bool file_writer_running_;
+    void fileWriterThread();
+    void waitForFileWriter();
 
     bool readParameters();
 
     int policy_iteration_counter_;
     bool readPolicy(const int iteration_number);
     bool writePolicy(const int iteration_number, bool is_rollout = false, int rollout_id = 0);
+    std::string getRolloutFileName(const int iteration_number, int rollout_id);
 
     bool writePolicyImprovementStatistics(const policy_improvement_loop::PolicyImprovementStatistics& stats_msg);
 
@@ -36,6 +36,7 @@
 
 // system includes
 #include <cassert>
+#include <algorithm>
 
 // ros includes
 #include <ros/package.h>
@@ -45,6 +46,7 @@
 
 #include <task_manager/task_manager.h>
 #include <boost/filesystem.hpp>
+#include <boost/bind.hpp>
 
 using namespace task_manager;
 using namespace task_manager_interface;
@@ -55,13 +57,22 @@ namespace policy_improvement_loop
 const std::string PI_STATISTICS_TOPIC_NAME = std::string("policy_improvement_statistics");
 
 PolicyImprovementLoop::PolicyImprovementLoop()
-    : initialized_(false), policy_iteration_counter_(0)
+    : initialized_(false), num_rollout_threads_(1), batch_execution_(false), file_writer_running_(true), policy_iteration_counter_(0)
 {
   ROS_VERIFY(task_manager_.initialize());
 }
 
 PolicyImprovementLoop::~PolicyImprovementLoop()
 {
+  if (file_writer_thread_)
+  {
+    {
+      boost::mutex::scoped_lock lock(file_writer_mutex_);
+      file_writer_running_ = false;
+      file_writer_cond_.notify_all();
+    }
+    file_writer_thread_->join();
+  }
   task_.reset(); // make sure that the task is deleted before the task_manager_
 }
 
@@ -112,6 +123,20 @@ bool PolicyImprovementLoop::initialize(ros::NodeHandle& node_handle, boost::shar
     rollout_terminal_costs_ = Eigen::VectorXd::Zero(num_rollouts_);
     time_step_weights_.resize(num_dimensions_, Eigen::VectorXd::Zero(num_time_steps_));
 
+    batch_execution_ = task_->supportsBatchExecution();
+    if (batch_execution_ && num_rollout_threads_ > 1)
+    {
+        ROS_INFO("Task executes its rollouts in a batch, ignoring >%i< rollout threads.", num_rollout_threads_);
+        num_rollout_threads_ = 1;
+    }
+    if (num_rollout_threads_ > 1 && !task_->isReentrant())
+    {
+        ROS_WARN("Task is not reentrant, executing rollouts in a single thread instead of >%i<.", num_rollout_threads_);
+        num_rollout_threads_ = 1;
+    }
+    num_rollout_threads_ = std::max(1, std::min(num_rollout_threads_, num_rollouts_));
+    tmp_thread_rollout_costs_.resize(num_rollout_threads_, Eigen::VectorXd::Zero(num_time_steps_));
+
     // create the statistics publisher
     stats_publisher_ = node_handle_.advertise<policy_improvement_loop::PolicyImprovementStatistics>(PI_STATISTICS_TOPIC_NAME, 100);
 
@@ -128,6 +153,7 @@ bool PolicyImprovementLoop::readParameters()
     ROS_VERIFY(usc_utilities::readDoubleArray(node_handle_, "noise_stddev", noise_stddev_));
     ROS_VERIFY(usc_utilities::readDoubleArray(node_handle_, "noise_decay", noise_decay_));
     node_handle_.param("write_to_file", write_to_file_, true); // defaults are sometimes good!
+    node_handle_.param("num_rollout_threads", num_rollout_threads_, 1);
     node_handle_.param("filename_prefix", filename_prefix_, std::string("/tmp/pi"));
     node_handle_.param("use_cumulative_costs", use_cumulative_costs_, true);
     node_handle_.param("reevaluate_reused_rollouts", reevaluate_reused_rollouts_, false);
@@ -166,28 +192,9 @@ bool PolicyImprovementLoop::writePolicy(const int iteration_number, bool is_roll
             ROS_VERIFY(boost::filesystem::create_directories(directory_name));
         }
 
-        separater_pos = file_name.find_last_of(".bag");
-        // ROS_INFO("file_name: %s", file_name.c_str());
-
-        if(separater_pos!=std::string::npos)
-        {
-            std::string rollout_file_name = file_name.substr(0, separater_pos-3);
-            rollout_file_name.append(std::string("_rollout_") + usc_utilities::getString(rollout_id) + std::string(".bag"));
-            // ROS_INFO("Write policy to file %s.", rollout_file_name.c_str());
-            ROS_VERIFY(policy_->writeToFile(rollout_file_name));
-            return true;
-        }
-        else
-        {
-            // we are dealing with a mixed policy
-            std::string rollout_file_name = file_name;
-            rollout_file_name.append(std::string("_rollout_") + usc_utilities::getString(rollout_id) + std::string(".bag"));
-            // ROS_INFO("Write policy to (rollout) file %s.", rollout_file_name.c_str());
-
-            // ROS_INFO("Write policy in directory %s.", directory_name.c_str());
-            ROS_VERIFY(policy_->writeToFile(rollout_file_name));
-            return true;
-        }
+        // ROS_INFO("Write policy to file %s.", getRolloutFileName(iteration_number, rollout_id).c_str());
+        ROS_VERIFY(policy_->writeToFile(getRolloutFileName(iteration_number, rollout_id)));
+        return true;
     }
 
     // TODO: this hack needs to go away after LibraryItem and DMPs like each other
@@ -213,6 +220,124 @@ bool PolicyImprovementLoop::writePolicy(const int iteration_number, bool is_roll
     return true;
 }
 
+std::string PolicyImprovementLoop::getRolloutFileName(const int iteration_number, int rollout_id)
+{
+    std::string file_name = getFileName(iteration_number);
+    size_t separater_pos = file_name.find_last_of(".bag");
+    // ROS_INFO("file_name: %s", file_name.c_str());
+
+    std::string rollout_file_name;
+    if(separater_pos!=std::string::npos)
+    {
+        rollout_file_name = file_name.substr(0, separater_pos-3);
+    }
+    else
+    {
+        // we are dealing with a mixed policy
+        rollout_file_name = file_name;
+    }
+    rollout_file_name.append(std::string("_rollout_") + usc_utilities::getString(rollout_id) + std::string(".bag"));
+    return rollout_file_name;
+}
+
+void PolicyImprovementLoop::executeRollouts(const int thread_id, const int iteration_number, bool& success)
+{
+    success = true;
+    for (int r=thread_id; r<int(rollouts_.size()); r+=num_rollout_threads_)
+    {
+        if (!task_->execute(rollouts_[r], tmp_thread_rollout_costs_[thread_id], rollout_terminal_costs_[r], iteration_number))
+        {
+            ROS_ERROR("Could not execute rollout %d.", r+1);
+            success = false;
+            return;
+        }
+        rollout_costs_.row(r) = tmp_thread_rollout_costs_[thread_id].transpose();
+    }
+}
+
+bool PolicyImprovementLoop::writeRolloutPolicies(const int iteration_number)
+{
+    if (rollouts_.empty())
+    {
+        return true;
+    }
+
+    // every rollout stores the same policy, write it once and copy it in the background
+    if (!writePolicy(iteration_number, true, 0))
+    {
+        return false;
+    }
+    std::string first_rollout_file_name = getRolloutFileName(iteration_number, 0);
+    if (boost::filesystem::is_regular_file(first_rollout_file_name))
+    {
+        // only tasks that execute their rollouts in a batch or in parallel get here
+        if (!file_writer_thread_)
+        {
+            file_writer_thread_.reset(new boost::thread(boost::bind(&PolicyImprovementLoop::fileWriterThread, this)));
+        }
+        boost::mutex::scoped_lock lock(file_writer_mutex_);
+        for (int r=1; r<int(rollouts_.size()); ++r)
+        {
+            file_copies_.push_back(std::make_pair(first_rollout_file_name, getRolloutFileName(iteration_number, r)));
+        }
+        file_writer_cond_.notify_all();
+        return true;
+    }
+
+    // policies that are not stored in a single file
+    for (int r=1; r<int(rollouts_.size()); ++r)
+    {
+        if (!writePolicy(iteration_number, true, r))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PolicyImprovementLoop::fileWriterThread()
+{
+    boost::mutex::scoped_lock lock(file_writer_mutex_);
+    while (true)
+    {
+        while (file_writer_running_ && file_copies_.empty())
+        {
+            file_writer_cond_.wait(lock);
+        }
+        if (file_copies_.empty())
+        {
+            return;
+        }
+
+        std::pair<std::string, std::string> file_copy = file_copies_.front();
+        lock.unlock();
+        try
+        {
+            if (boost::filesystem::exists(file_copy.second))
+            {
+                boost::filesystem::remove(file_copy.second);
+            }
+            boost::filesystem::copy_file(file_copy.first, file_copy.second);
+        }
+        catch (boost::filesystem::filesystem_error& ex)
+        {
+            ROS_ERROR("Could not copy policy file %s to %s: %s", file_copy.first.c_str(), file_copy.second.c_str(), ex.what());
+        }
+        lock.lock();
+        file_copies_.pop_front();
+        file_writer_cond_.notify_all();
+    }
+}
+
+void PolicyImprovementLoop::waitForFileWriter()
+{
+    boost::mutex::scoped_lock lock(file_writer_mutex_);
+    while (!file_copies_.empty())
+    {
+        file_writer_cond_.wait(lock);
+    }
+}
+
 bool PolicyImprovementLoop::runSingleIteration(const int iteration_number)
 {
     ROS_ASSERT(initialized_);
@@ -220,6 +345,8 @@ bool PolicyImprovementLoop::runSingleIteration(const int iteration_number)
 
     if (write_to_file_)
     {
+        // the rollout files of the last iteration may still be copied
+        waitForFileWriter();
         // load new policy if neccessary
         ROS_VERIFY(readPolicy(iteration_number));
     }
@@ -237,16 +364,52 @@ bool PolicyImprovementLoop::runSingleIteration(const int iteration_number)
     // get rollouts and execute them
     ROS_VERIFY(policy_improvement_.getRollouts(rollouts_, noise));
 
-    for (int r=0; r<int(rollouts_.size()); ++r)
+    if (batch_execution_ || num_rollout_threads_ > 1)
     {
-        ROS_VERIFY(task_->execute(rollouts_[r], tmp_rollout_cost_, rollout_terminal_costs_[r], iteration_number));
-        rollout_costs_.row(r) = tmp_rollout_cost_.transpose();
-        ROS_INFO("Rollout %d, cost = %lf", r+1, tmp_rollout_cost_.sum() + rollout_terminal_costs_[r]);
+        if (batch_execution_)
+        {
+            ROS_VERIFY(task_->executeBatch(rollouts_, rollout_costs_, rollout_terminal_costs_, iteration_number));
+        }
+        else
+        {
+            // the task is reentrant, so it doesn't change the policy and all rollouts can run at once
+            std::deque<bool> success(num_rollout_threads_, false);
+            boost::thread_group rollout_threads;
+            for (int t=1; t<num_rollout_threads_; ++t)
+            {
+                rollout_threads.create_thread(boost::bind(&PolicyImprovementLoop::executeRollouts, this, t, iteration_number, boost::ref(success[t])));
+            }
+            executeRollouts(0, iteration_number, success[0]);
+            rollout_threads.join_all();
+            for (int t=0; t<num_rollout_threads_; ++t)
+            {
+                ROS_VERIFY(success[t]);
+            }
+        }
+
+        for (int r=0; r<int(rollouts_.size()); ++r)
+        {
+            ROS_INFO("Rollout %d, cost = %lf", r+1, rollout_costs_.row(r).sum() + rollout_terminal_costs_[r]);
+        }
 
         if (write_to_file_)
         {
-            // store updated policy to disc
-            ROS_VERIFY(writePolicy(iteration_number, true, r));
+            ROS_VERIFY(writeRolloutPolicies(iteration_number));
+        }
+    }
+    else
+    {
+        for (int r=0; r<int(rollouts_.size()); ++r)
+        {
+            ROS_VERIFY(task_->execute(rollouts_[r], tmp_rollout_cost_, rollout_terminal_costs_[r], iteration_number));
+            rollout_costs_.row(r) = tmp_rollout_cost_.transpose();
+            ROS_INFO("Rollout %d, cost = %lf", r+1, tmp_rollout_cost_.sum() + rollout_terminal_costs_[r]);
+
+            if (write_to_file_)
+            {
+                // store updated policy to disc
+                ROS_VERIFY(writePolicy(iteration_number, true, r));
+            }
         }
     }
 
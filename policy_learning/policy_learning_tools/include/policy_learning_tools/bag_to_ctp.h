@@ -17,6 +17,7 @@
 
 #include <ros/ros.h>
 #include <dynamic_movement_primitive_utilities/trajectory_utilities.h>
+#include <usc_utilities/kdl_chain_wrapper.h>
 
 namespace policy_learning_tools
 {
@@ -32,6 +33,11 @@ public:
 
   bool run();
 
+  /**
+   * Converts several bag files with the streaming converter, using up to num_threads threads
+   */
+  bool run(const std::vector<std::string>& input_files, const std::vector<std::string>& output_files, int num_threads);
+
 private:
   std::string abs_bag_file_name_;
   std::string abs_output_bag_file_name_;
@@ -49,6 +55,11 @@ private:
   std::string root_frame_;
   std::string tip_frame_;
 
+  bool streaming_;
+  int num_threads_;
+  bool chain_initialized_;
+  usc_utilities::KDLChainWrapper chain_;
+
   dmp_lib::Trajectory joint_trajectory_;
   dmp_lib::Trajectory cartesian_trajectory_;
   dmp_lib::Trajectory combined_trajectory_;
@@ -66,10 +77,32 @@ private:
                 double start_time,
                 double end_time);
 
-  bool writeToCTP(dmp_lib::Trajectory& trajectory,
-                  const std::string& abs_output_bag_file_name);
+  /**
+   * Creates the output trajectory in a single pass over the bag file. Only every n-th joint state message
+   * between start and end time is deserialized, and its cartesian pose is computed right away, so only
+   * the resampled trajectory is kept in memory.
+   */
+  bool createTrajectoryStreaming(dmp_lib::Trajectory& trajectory,
+                                 const std::string& abs_bag_file_name,
+                                 const std::string& topic_name,
+                                 usc_utilities::KDLChainWrapper::Workspace& workspace) const;
+
+  bool convertStreaming(const std::string& input_file, const std::string& output_file,
+                        usc_utilities::KDLChainWrapper::Workspace& workspace) const;
+
+  /**
+   * Converts files thread_id, thread_id + num_threads, ...
+   */
+  void convertFiles(const int thread_id, const int num_threads,
+                    const std::vector<std::string>& input_files, const std::vector<std::string>& output_files,
+                    bool& success) const;
+
+  bool initializeChain();
+
+  bool writeToCTP(const dmp_lib::Trajectory& trajectory,
+                  const std::string& abs_output_bag_file_name) const;
 
-  bool transformCTP(const std::string& bag_file_name);
+  bool transformCTP(const std::string& bag_file_name) const;
 
   bool parseArguments(int argc, char** argv);
 
@@ -5,8 +5,16 @@
  *      Author: kalakris
  */
 
+#include <deque>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
 #include <policy_learning_tools/bag_to_ctp.h>
 #include <ros/ros.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <sensor_msgs/JointState.h>
 #include <dynamic_movement_primitive_utilities/trajectory_utilities.h>
 #include <usc_utilities/param_server.h>
 #include <usc_utilities/assert.h>
@@ -24,7 +32,7 @@ namespace policy_learning_tools
 {
 
 BagToCTP::BagToCTP(ros::NodeHandle node_handle):
-    node_handle_(node_handle)
+    node_handle_(node_handle), chain_initialized_(false)
 {
   ROS_VERIFY(readParameters());
 }
@@ -59,6 +67,8 @@ bool BagToCTP::readParameters()
   ROS_VERIFY(usc_utilities::read(node_handle_, "use_forces", use_forces_));
   ROS_VERIFY(usc_utilities::read(node_handle_, "root_frame", root_frame_));
   ROS_VERIFY(usc_utilities::read(node_handle_, "tip_frame", tip_frame_));
+  node_handle_.param("streaming", streaming_, false);
+  node_handle_.param("num_threads", num_threads_, std::max(1, (int)boost::thread::hardware_concurrency()));
   return true;
 }
 
@@ -71,6 +81,20 @@ bool BagToCTP::run(const std::string& input_file, const std::string& output_file
 
 int BagToCTP::run(int argc, char** argv)
 {
+  if (node_handle_.hasParam("inputs"))
+  {
+    std::vector<std::string> input_files, output_files;
+    if (!usc_utilities::readStringArraySpaceSeparated(node_handle_, "inputs", input_files)
+        || !usc_utilities::readStringArraySpaceSeparated(node_handle_, "outputs", output_files))
+    {
+      ROS_ERROR("Please specify inputs:=\"<abs_bag_file_paths>\" and outputs:=\"<abs_bag_file_paths>\" as arguments to the launch file.");
+      return 1;
+    }
+    if (!run(input_files, output_files, num_threads_))
+      return 1;
+    return 0;
+  }
+
   if (!parseArguments(argc, argv))
     return 1;
   if (!run())
@@ -78,8 +102,278 @@ int BagToCTP::run(int argc, char** argv)
   return 0;
 }
 
+bool BagToCTP::run(const std::vector<std::string>& input_files, const std::vector<std::string>& output_files, int num_threads)
+{
+  if (input_files.size() != output_files.size())
+  {
+    ROS_ERROR("Number of input files >%i< does not match the number of output files >%i<.", (int)input_files.size(), (int)output_files.size());
+    return false;
+  }
+  if (!initializeChain())
+  {
+    return false;
+  }
+
+  num_threads = std::max(1, std::min(num_threads, (int)input_files.size()));
+  std::deque<bool> success(num_threads, false);
+  boost::thread_group threads;
+  for (int t=1; t<num_threads; ++t)
+  {
+    threads.create_thread(boost::bind(&BagToCTP::convertFiles, this, t, num_threads,
+                                      boost::cref(input_files), boost::cref(output_files), boost::ref(success[t])));
+  }
+  convertFiles(0, num_threads, input_files, output_files, success[0]);
+  threads.join_all();
+
+  bool all_converted = true;
+  for (int t=0; t<num_threads; ++t)
+  {
+    all_converted = all_converted && success[t];
+  }
+  return all_converted;
+}
+
+void BagToCTP::convertFiles(const int thread_id, const int num_threads,
+                            const std::vector<std::string>& input_files, const std::vector<std::string>& output_files,
+                            bool& success) const
+{
+  success = true;
+  usc_utilities::KDLChainWrapper::Workspace workspace;
+  for (int i=thread_id; i<(int)input_files.size(); i+=num_threads)
+  {
+    if (!convertStreaming(input_files[i], output_files[i], workspace))
+    {
+      ROS_ERROR("Could not convert bag file >%s<.", input_files[i].c_str());
+      success = false;
+    }
+  }
+}
+
+bool BagToCTP::initializeChain()
+{
+  if (!use_cartesian_ || chain_initialized_)
+  {
+    return true;
+  }
+  if (!chain_.initialize(root_frame_, tip_frame_))
+  {
+    ROS_ERROR("Could not initialize the chain from >%s< to >%s<.", root_frame_.c_str(), tip_frame_.c_str());
+    return false;
+  }
+  if (chain_.getNumJoints() != (int)joint_names_.size())
+  {
+    ROS_ERROR("Number of joints in the chain >%i< does not correspond to the number of joint names >%i<.",
+              chain_.getNumJoints(), (int)joint_names_.size());
+    return false;
+  }
+  return (chain_initialized_ = true);
+}
+
+bool BagToCTP::convertStreaming(const std::string& input_file, const std::string& output_file,
+                                usc_utilities::KDLChainWrapper::Workspace& workspace) const
+{
+  dmp_lib::Trajectory trajectory;
+  if (!createTrajectoryStreaming(trajectory, input_file, "/joint_states", workspace))
+  {
+    ROS_ERROR("Error creating trajectory from bag file >%s<.", input_file.c_str());
+    return false;
+  }
+
+  ROS_INFO("Saving trajectory of length %d to >%s<.", trajectory.getNumContainedSamples(), output_file.c_str());
+  if (!writeToCTP(trajectory, output_file))
+  {
+    ROS_ERROR("Error writing trajectory to CTP bag file.");
+    return false;
+  }
+  return transformCTP(output_file);
+}
+
+bool BagToCTP::createTrajectoryStreaming(dmp_lib::Trajectory& trajectory,
+                                         const std::string& abs_bag_file_name,
+                                         const std::string& topic_name,
+                                         usc_utilities::KDLChainWrapper::Workspace& workspace) const
+{
+  if (joint_names_.empty())
+  {
+    ROS_ERROR("No variable names provided, cannot create trajectory from bag file.");
+    return false;
+  }
+  ROS_ASSERT(!use_cartesian_ || chain_initialized_);
+
+  std::vector<std::string> variable_names;
+  if (use_joints_)
+  {
+    variable_names = joint_names_;
+  }
+  if (use_cartesian_)
+  {
+    variable_names.push_back("CART_X");
+    variable_names.push_back("CART_Y");
+    variable_names.push_back("CART_Z");
+    variable_names.push_back("CART_QW");
+    variable_names.push_back("CART_QX");
+    variable_names.push_back("CART_QY");
+    variable_names.push_back("CART_QZ");
+  }
+  // zero forces by default
+  if (use_forces_)
+  {
+    variable_names.push_back("FORCE_X");
+    variable_names.push_back("FORCE_Y");
+    variable_names.push_back("FORCE_Z");
+    variable_names.push_back("TORQUE_X");
+    variable_names.push_back("TORQUE_Y");
+    variable_names.push_back("TORQUE_Z");
+  }
+
+  const int num_joints = static_cast<int> (joint_names_.size());
+  int num_input_samples = 0;
+  try
+  {
+    rosbag::Bag bag(abs_bag_file_name, rosbag::bagmode::Read);
+    rosbag::View view(bag, rosbag::TopicQuery(topic_name));
+
+    num_input_samples = view.size();
+    if (num_input_samples < 2)
+    {
+      ROS_ERROR("Too few joint_states messages found to form a trajectory.");
+      return false;
+    }
+
+    // the header stamps are only known once a message is read, so the samples to keep are
+    // chosen based on the mean rate at which the messages have been recorded
+    const double input_trajectory_duration = (view.getEndTime() - view.getBeginTime()).toSec();
+    if (input_trajectory_duration <= 0.0)
+    {
+      ROS_ERROR("Bag file >%s< does not span any time.", abs_bag_file_name.c_str());
+      return false;
+    }
+    const double mean_dt = input_trajectory_duration / (num_input_samples - 1);
+
+    int downsample_factor = 1;
+    int start_index = 0;
+    int num_output_samples = num_input_samples;
+    if (sampling_frequency_ > 0.0)
+    {
+      const double end_time = (end_time_ < 0.0) ? input_trajectory_duration : end_time_;
+      downsample_factor = std::max(1, (int)lrint((1.0 / mean_dt) / sampling_frequency_));
+      start_index = start_time_ / mean_dt;
+      num_output_samples = (end_time - start_time_) / (mean_dt * downsample_factor) + 1;
+    }
+    num_output_samples = std::min(num_output_samples, (num_input_samples - start_index + downsample_factor - 1) / downsample_factor);
+    if (num_output_samples < 1)
+    {
+      ROS_ERROR("No samples between start time >%f< and end time >%f<.", start_time_, end_time_);
+      return false;
+    }
+
+    const bool positions_only = true;
+    if (!trajectory.initialize(variable_names, 1.0 / (mean_dt * downsample_factor), positions_only, num_output_samples))
+    {
+      ROS_ERROR("Could not initialize trajectory with >%i< samples.", num_output_samples);
+      return false;
+    }
+
+    std::vector<double> joint_positions(num_joints, 0.0);
+    std::vector<int> joint_indices(num_joints, -1);
+    std::vector<std::string> message_joint_names;
+    Eigen::VectorXd positions = Eigen::VectorXd::Zero(variable_names.size());
+    KDL::Frame endeffector_frame;
+
+    int index = 0;
+    int next_index = start_index;
+    for (rosbag::View::iterator it = view.begin();
+        it != view.end() && trajectory.getNumContainedSamples() < num_output_samples; ++it, ++index)
+    {
+      if (index != next_index)
+      {
+        continue;
+      }
+      next_index += downsample_factor;
+
+      sensor_msgs::JointState::ConstPtr joint_state = it->instantiate<sensor_msgs::JointState> ();
+      if (joint_state == NULL)
+      {
+        ROS_ERROR("Null message read from file >%s< on topic >%s<.", abs_bag_file_name.c_str(), topic_name.c_str());
+        return false;
+      }
+
+      // the joint order is looked up again only if it changes
+      if (joint_state->name != message_joint_names)
+      {
+        message_joint_names = joint_state->name;
+        for (int i = 0; i < num_joints; ++i)
+        {
+          std::vector<std::string>::const_iterator name = std::find(message_joint_names.begin(), message_joint_names.end(), joint_names_[i]);
+          if (name == message_joint_names.end())
+          {
+            ROS_ERROR("Joint >%s< not found in joint_states message.", joint_names_[i].c_str());
+            return false;
+          }
+          joint_indices[i] = name - message_joint_names.begin();
+        }
+      }
+      for (int i = 0; i < num_joints; ++i)
+      {
+        if (joint_indices[i] >= (int)joint_state->position.size())
+        {
+          ROS_ERROR("joint_states message has no position for joint >%s<.", joint_names_[i].c_str());
+          return false;
+        }
+        joint_positions[i] = joint_state->position[joint_indices[i]];
+      }
+
+      int d = 0;
+      if (use_joints_)
+      {
+        for (int i = 0; i < num_joints; ++i)
+        {
+          positions(d++) = joint_positions[i];
+        }
+      }
+      if (use_cartesian_)
+      {
+        if (!chain_.forwardKinematics(workspace, joint_positions, endeffector_frame))
+        {
+          ROS_ERROR("Could not compute the forward kinematics.");
+          return false;
+        }
+        double qx, qy, qz, qw;
+        endeffector_frame.M.GetQuaternion(qx, qy, qz, qw);
+        positions(d++) = endeffector_frame.p.x();
+        positions(d++) = endeffector_frame.p.y();
+        positions(d++) = endeffector_frame.p.z();
+        positions(d++) = qw;
+        positions(d++) = qx;
+        positions(d++) = qy;
+        positions(d++) = qz;
+      }
+      ROS_VERIFY(trajectory.add(positions));
+    }
+    bag.close();
+  }
+  catch (rosbag::BagException& ex)
+  {
+    ROS_ERROR("Problem when reading from bag file >%s< : %s.", abs_bag_file_name.c_str(), ex.what());
+    return false;
+  }
+
+  ROS_INFO("Kept >%i< of >%i< messages from bag file >%s<.", trajectory.getNumContainedSamples(), num_input_samples, abs_bag_file_name.c_str());
+  return true;
+}
+
 bool BagToCTP::run()
 {
+  if (streaming_)
+  {
+    if (!initializeChain())
+    {
+      return false;
+    }
+    usc_utilities::KDLChainWrapper::Workspace workspace;
+    return convertStreaming(abs_bag_file_name_, abs_output_bag_file_name_, workspace);
+  }
+
   std::vector<ros::Time> time_stamps;
 
   if (!createJointStateTrajectory(joint_trajectory_, time_stamps, joint_names_, abs_bag_file_name_, "/joint_states"))
@@ -293,8 +587,8 @@ bool BagToCTP::downSampleAndChop(dmp_lib::Trajectory& trajectory,
   return true;
 }
 
-bool BagToCTP::writeToCTP(dmp_lib::Trajectory& trajectory,
-                const std::string& abs_output_bag_file_name)
+bool BagToCTP::writeToCTP(const dmp_lib::Trajectory& trajectory,
+                const std::string& abs_output_bag_file_name) const
 {
   int num_samples = trajectory.getNumContainedSamples();
   int num_dimensions = trajectory.getDimension();
@@ -319,7 +613,7 @@ bool BagToCTP::writeToCTP(dmp_lib::Trajectory& trajectory,
   return usc_utilities::FileIO<policy_msgs::CovariantTrajectoryPolicy>::writeToBagFile(ctp_msg, policy_library::CovariantTrajectoryPolicy::TOPIC_NAME, abs_output_bag_file_name);
 }
 
-bool BagToCTP::transformCTP(const std::string& bag_file_name)
+bool BagToCTP::transformCTP(const std::string& bag_file_name) const
 {
   // read CTP from bag file
   policy_library::CovariantTrajectoryPolicy ctp;
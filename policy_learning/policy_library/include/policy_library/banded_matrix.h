@@ -0,0 +1,153 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2010, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Willow Garage nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef BANDED_MATRIX_H_
+#define BANDED_MATRIX_H_
+
+#include <Eigen/Core>
+
+namespace policy_library
+{
+
+/**
+ * Square matrix that is zero outside of num_lower diagonals below and num_upper diagonals above the main diagonal.
+ * Only the band is stored, row by row: data_(i, k) holds element (i, i - num_lower + k).
+ */
+class BandedMatrix
+{
+public:
+    BandedMatrix();
+    BandedMatrix(const int size, const int num_lower, const int num_upper);
+
+    /**
+     * Resizes the matrix and sets all elements to zero
+     * @param size
+     * @param num_lower number of diagonals below the main diagonal
+     * @param num_upper number of diagonals above the main diagonal
+     */
+    void resize(const int size, const int num_lower, const int num_upper);
+
+    int getSize() const;
+    int getNumLower() const;
+    int getNumUpper() const;
+
+    /**
+     * Element access, returns 0 outside of the band
+     */
+    double operator()(const int row, const int col) const;
+
+    /**
+     * Writable element access, (row, col) has to be within the band
+     */
+    double& coeffRef(const int row, const int col);
+
+    /**
+     * Adds value to all elements of the main diagonal
+     */
+    void addDiagonal(const double value);
+
+    /**
+     * Adds weight * matrix^T * matrix, the band of this matrix has to be at least as wide as the one of the product
+     */
+    void addWeightedGram(const BandedMatrix& matrix, const double weight);
+
+    /**
+     * Computes result = this * vector in O(size * bandwidth)
+     */
+    void multiply(const Eigen::VectorXd& vector, Eigen::VectorXd& result) const;
+
+    /**
+     * Extracts the square block starting at (start, start), keeping the band width
+     */
+    void getBlock(const int start, const int size, BandedMatrix& block) const;
+
+    /**
+     * Extracts a (rows x cols) block starting at (row, col) into a dense matrix
+     */
+    void getDenseBlock(const int row, const int col, const int rows, const int cols, Eigen::MatrixXd& block) const;
+
+    void toDense(Eigen::MatrixXd& dense) const;
+
+    /**
+     * Computes the lower triangular factor L = factor with this = L * L^T in O(size * num_lower^2), assuming this
+     * matrix is symmetric (only the lower band is read)
+     * @return false if the matrix is not positive definite
+     */
+    bool choleskyFactorize(BandedMatrix& factor) const;
+
+    /**
+     * Solves (L * L^T) x = b for the factor L computed by choleskyFactorize in O(size * num_lower)
+     */
+    static void choleskySolve(const BandedMatrix& factor, const Eigen::VectorXd& b, Eigen::VectorXd& x);
+
+private:
+    int size_;
+    int num_lower_;
+    int num_upper_;
+    Eigen::MatrixXd data_;
+};
+
+// inline functions follow
+
+inline int BandedMatrix::getSize() const
+{
+    return size_;
+}
+
+inline int BandedMatrix::getNumLower() const
+{
+    return num_lower_;
+}
+
+inline int BandedMatrix::getNumUpper() const
+{
+    return num_upper_;
+}
+
+inline double BandedMatrix::operator()(const int row, const int col) const
+{
+    const int k = col - row + num_lower_;
+    if (k < 0 || k > num_lower_ + num_upper_)
+        return 0.0;
+    return data_(row, k);
+}
+
+inline double& BandedMatrix::coeffRef(const int row, const int col)
+{
+    return data_(row, col - row + num_lower_);
+}
+
+}
+
+#endif /* BANDED_MATRIX_H_ */
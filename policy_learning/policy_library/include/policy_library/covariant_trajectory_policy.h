@@ -39,6 +39,7 @@
 
 #include <ros/ros.h>
 #include <policy_library/policy.h>
+#include <policy_library/banded_matrix.h>
 #include <policy_msgs/CovariantTrajectoryPolicy.h>
 #include <geometry_msgs/Pose.h>
 #include <geometry_msgs/Wrench.h>
@@ -181,6 +182,8 @@ public:
 
 private:
 
+    friend class CovariantTrajectoryPolicyTest;
+
     ros::NodeHandle node_handle_;
 
     std::string file_name_base_;
@@ -201,14 +204,14 @@ private:
     std::vector<int> num_parameters_;
     std::vector<Eigen::MatrixXd> basis_functions_;
     std::vector<Eigen::MatrixXd> control_costs_;
-    std::vector<Eigen::MatrixXd> inv_control_costs_;
-    std::vector<Eigen::MatrixXd> control_costs_all_;
+    std::vector<BandedMatrix> control_cost_factors_;  /**< [num_dimensions] cholesky factors of the free control costs */
+    std::vector<BandedMatrix> control_costs_all_;
 
     std::vector<Eigen::VectorXd> linear_control_costs_;
 
     std::vector<Eigen::VectorXd> parameters_all_;
 
-    std::vector<Eigen::MatrixXd> differentiation_matrices_;
+    std::vector<BandedMatrix> differentiation_matrices_;
 
     geometry_msgs::Pose nominal_start_pose_;
 
@@ -142,6 +142,13 @@ public:
    */
   bool updateParameters(const std::vector<Eigen::MatrixXd>& updates, const std::vector<Eigen::VectorXd>& time_step_weights);
 
+  /*!
+   * Update the policy parameters from the updates of a larger policy, see Policy::updateParametersFrom
+   * @return True on success, otherwise False
+   */
+  bool updateParametersFrom(const std::vector<Eigen::MatrixXd>& updates, const int first_dimension,
+                            const std::vector<Eigen::VectorXd>& time_step_weights);
+
   /*!
    * Get the policy parameters per dimension
    * @param parameters (output) array of parameter vectors
@@ -37,6 +37,8 @@
 #ifndef MIXED_POLICY_H_
 #define MIXED_POLICY_H_
 
+#include <boost/shared_ptr.hpp>
+
 #include <policy_library/policy.h>
 
 namespace policy_library
@@ -44,6 +46,10 @@ namespace policy_library
 
 /**
  * Combines two or more different kinds of policies into a single policy that PolicyImprovement can optimize
+ *
+ * The parameters of all sub-policies are kept in one contiguous buffer, dimension after dimension in the
+ * order of the sub-policies. The buffer is kept in sync whenever the parameters are changed through the
+ * mixed policy, so sub-policies should not be modified directly once they are part of a mixed policy.
  */
 class MixedPolicy: public Policy
 {
@@ -54,6 +60,30 @@ public:
     // functions specific to MixedPolicy:
     bool initialize(std::vector<boost::shared_ptr<Policy> >& policies);
 
+    /**
+     * @return the parameters of all dimensions of all sub-policies, stored contiguously
+     */
+    const Eigen::VectorXd& getParameterBuffer() const;
+
+    /**
+     * Sets the parameters of all sub-policies from a contiguous buffer laid out like getParameterBuffer()
+     * @param parameter_buffer
+     * @return true on success, false on failure
+     */
+    bool setParameterBuffer(const Eigen::VectorXd& parameter_buffer);
+
+    /**
+     * @param dimension
+     * @return view on the parameters of the given dimension in the parameter buffer
+     */
+    Eigen::VectorXd::ConstSegmentReturnType getDimensionParameters(const int dimension) const;
+
+    /**
+     * @param policy_index
+     * @return view on the parameters of all dimensions of the given sub-policy in the parameter buffer
+     */
+    Eigen::VectorXd::ConstSegmentReturnType getPolicyParameters(const int policy_index) const;
+
     // inherited from Policy:
     bool setNumTimeSteps(const int num_time_steps);
     bool getNumTimeSteps(int& num_time_steps);
@@ -94,6 +124,24 @@ private:
     int num_policies_;
     std::vector<boost::shared_ptr<Policy> > policies_;
 
+    /*! first dimension of each sub-policy, num_policies_+1 entries
+     */
+    std::vector<int> dimension_offsets_;
+
+    /*! contiguous parameters of all dimensions and the start of each dimension in it, num_dimensions_+1 entries
+     */
+    Eigen::VectorXd parameter_buffer_;
+    std::vector<int> parameter_offsets_;
+
+    /*! per sub-policy scratch space handed to the sub-policies, reused across calls
+     */
+    std::vector<std::vector<Eigen::VectorXd> > policy_parameters_;
+    std::vector<std::vector<Eigen::MatrixXd> > policy_matrices_;
+
+    bool pullParameters();
+    bool pushParameters();
+    bool getPolicyMatrices(const bool control_costs, std::vector<Eigen::MatrixXd>& matrices);
+
 };
 
 }
@@ -103,6 +103,16 @@ public:
      */
     virtual bool updateParameters(const std::vector<Eigen::MatrixXd>& updates, const std::vector<Eigen::VectorXd>& time_step_weights) = 0;
 
+    /**
+     * Update the policy parameters from the updates of a larger policy (see MixedPolicy), without copying them
+     * The default implementation copies the updates of this policy and calls updateParameters()
+     * @param updates (input) parameter updates per time-step of all dimensions of the larger policy
+     * @param first_dimension (input) index of the first dimension of this policy in updates
+     * @return true on success, false on failure
+     */
+    virtual bool updateParametersFrom(const std::vector<Eigen::MatrixXd>& updates, const int first_dimension,
+                                      const std::vector<Eigen::VectorXd>& time_step_weights);
+
     /**
      * Get the policy parameters per dimension
      * @param parameters (output) array of parameter vectors
@@ -64,6 +64,8 @@ public:
     bool getBasisFunctions(std::vector<Eigen::MatrixXd>& basis_functions);
     bool getControlCosts(std::vector<Eigen::MatrixXd>& control_costs);
     bool updateParameters(const std::vector<Eigen::MatrixXd>& updates, const std::vector<Eigen::VectorXd>& time_step_weights);
+    bool updateParametersFrom(const std::vector<Eigen::MatrixXd>& updates, const int first_dimension,
+                              const std::vector<Eigen::VectorXd>& time_step_weights);
     bool getParameters(std::vector<Eigen::VectorXd>& parameters);
     bool setParameters(const std::vector<Eigen::VectorXd>& parameters);
 
@@ -0,0 +1,203 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2010, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Willow Garage nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <policy_library/banded_matrix.h>
+#include <ros/assert.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace Eigen;
+
+namespace policy_library
+{
+
+BandedMatrix::BandedMatrix()
+: size_(0), num_lower_(0), num_upper_(0)
+{
+}
+
+BandedMatrix::BandedMatrix(const int size, const int num_lower, const int num_upper)
+{
+    resize(size, num_lower, num_upper);
+}
+
+void BandedMatrix::resize(const int size, const int num_lower, const int num_upper)
+{
+    ROS_ASSERT(size >= 0 && num_lower >= 0 && num_upper >= 0);
+    size_ = size;
+    num_lower_ = num_lower;
+    num_upper_ = num_upper;
+    data_ = MatrixXd::Zero(size_, num_lower_ + num_upper_ + 1);
+}
+
+void BandedMatrix::addDiagonal(const double value)
+{
+    data_.col(num_lower_).array() += value;
+}
+
+void BandedMatrix::addWeightedGram(const BandedMatrix& matrix, const double weight)
+{
+    ROS_ASSERT(matrix.size_ == size_);
+    const int bandwidth = matrix.num_lower_ + matrix.num_upper_;
+    ROS_ASSERT(num_lower_ >= bandwidth && num_upper_ >= bandwidth);
+
+    // (M^T M)(j,k) = sum_i M(i,j) M(i,k), row i of M only touches columns i-num_lower to i+num_upper
+    for (int i=0; i<size_; ++i)
+    {
+        const int first = std::max(0, i - matrix.num_lower_);
+        const int last = std::min(size_ - 1, i + matrix.num_upper_);
+        for (int j=first; j<=last; ++j)
+        {
+            const double m_ij = weight * matrix(i, j);
+            for (int k=first; k<=last; ++k)
+            {
+                coeffRef(j, k) += m_ij * matrix(i, k);
+            }
+        }
+    }
+}
+
+void BandedMatrix::multiply(const VectorXd& vector, VectorXd& result) const
+{
+    ROS_ASSERT(vector.size() == size_);
+    result.resize(size_);
+    for (int i=0; i<size_; ++i)
+    {
+        const int first = std::max(0, i - num_lower_);
+        const int last = std::min(size_ - 1, i + num_upper_);
+        double sum = 0.0;
+        for (int j=first; j<=last; ++j)
+        {
+            sum += data_(i, j - i + num_lower_) * vector(j);
+        }
+        result(i) = sum;
+    }
+}
+
+void BandedMatrix::getBlock(const int start, const int size, BandedMatrix& block) const
+{
+    ROS_ASSERT(start >= 0 && start + size <= size_);
+    block.resize(size, num_lower_, num_upper_);
+    block.data_ = data_.block(start, 0, size, num_lower_ + num_upper_ + 1);
+    // remove the elements that reach outside of the block
+    for (int i=0; i<std::min(num_lower_, size); ++i)
+    {
+        block.data_.row(i).head(num_lower_ - i).setZero();
+    }
+    for (int i=std::max(0, size - num_upper_); i<size; ++i)
+    {
+        block.data_.row(i).tail(num_upper_ - (size - 1 - i)).setZero();
+    }
+}
+
+void BandedMatrix::getDenseBlock(const int row, const int col, const int rows, const int cols, MatrixXd& block) const
+{
+    ROS_ASSERT(row >= 0 && row + rows <= size_ && col >= 0 && col + cols <= size_);
+    block = MatrixXd::Zero(rows, cols);
+    for (int i=0; i<rows; ++i)
+    {
+        const int first = std::max(col, row + i - num_lower_);
+        const int last = std::min(col + cols - 1, row + i + num_upper_);
+        for (int j=first; j<=last; ++j)
+        {
+            block(i, j - col) = (*this)(row + i, j);
+        }
+    }
+}
+
+void BandedMatrix::toDense(MatrixXd& dense) const
+{
+    getDenseBlock(0, 0, size_, size_, dense);
+}
+
+bool BandedMatrix::choleskyFactorize(BandedMatrix& factor) const
+{
+    const int p = num_lower_;
+    factor.resize(size_, p, 0);
+    for (int j=0; j<size_; ++j)
+    {
+        double diagonal = (*this)(j, j);
+        for (int k=std::max(0, j - p); k<j; ++k)
+        {
+            diagonal -= factor(j, k) * factor(j, k);
+        }
+        if (diagonal <= 0.0)
+        {
+            return false;
+        }
+        const double l_jj = sqrt(diagonal);
+        factor.coeffRef(j, j) = l_jj;
+
+        for (int i=j+1; i<=std::min(size_ - 1, j + p); ++i)
+        {
+            double value = (*this)(i, j);
+            for (int k=std::max(0, i - p); k<j; ++k)
+            {
+                value -= factor(i, k) * factor(j, k);
+            }
+            factor.coeffRef(i, j) = value / l_jj;
+        }
+    }
+    return true;
+}
+
+void BandedMatrix::choleskySolve(const BandedMatrix& factor, const VectorXd& b, VectorXd& x)
+{
+    const int n = factor.size_;
+    const int p = factor.num_lower_;
+    ROS_ASSERT(factor.num_upper_ == 0);
+    ROS_ASSERT(b.size() == n);
+
+    // L y = b
+    x = b;
+    for (int i=0; i<n; ++i)
+    {
+        for (int k=std::max(0, i - p); k<i; ++k)
+        {
+            x(i) -= factor(i, k) * x(k);
+        }
+        x(i) /= factor(i, i);
+    }
+    // L^T x = y
+    for (int i=n-1; i>=0; --i)
+    {
+        for (int k=i+1; k<=std::min(n - 1, i + p); ++k)
+        {
+            x(i) -= factor(k, i) * x(k);
+        }
+        x(i) /= factor(i, i);
+    }
+}
+
+}
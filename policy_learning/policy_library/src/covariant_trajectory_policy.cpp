@@ -42,6 +42,7 @@
 #include <Eigen/Core>
 #include <Eigen/Core>
 #include <sstream>
+#include <algorithm>
 #include <tf/transform_datatypes.h>
 
 using namespace Eigen;
@@ -154,10 +155,23 @@ bool CovariantTrajectoryPolicy::computeLinearControlCosts()
     linear_control_costs_.resize(num_dimensions_, VectorXd::Zero(num_vars_free_));
     for (int d=0; d<num_dimensions_; ++d)
     {
-        linear_control_costs_[d].transpose() = parameters_all_[d].segment(0, DIFF_RULE_LENGTH-1).transpose() *
-                control_costs_all_[d].block(0, free_vars_start_index_, DIFF_RULE_LENGTH-1, num_vars_free_);
-        linear_control_costs_[d].transpose() += parameters_all_[d].segment(free_vars_end_index_+1, DIFF_RULE_LENGTH-1).transpose() *
-                control_costs_all_[d].block(free_vars_end_index_+1, free_vars_start_index_, DIFF_RULE_LENGTH-1, num_vars_free_);
+        // only the band of the fixed start and goal rows couples them to the free variables
+        const BandedMatrix& cost_all = control_costs_all_[d];
+        for (int i=0; i<DIFF_RULE_LENGTH-1; ++i)
+        {
+            const int start_row = i;
+            const int goal_row = free_vars_end_index_+1+i;
+            for (int j=std::max(free_vars_start_index_, start_row - cost_all.getNumLower());
+                    j<=std::min(free_vars_end_index_, start_row + cost_all.getNumUpper()); ++j)
+            {
+                linear_control_costs_[d](j - free_vars_start_index_) += parameters_all_[d](start_row) * cost_all(start_row, j);
+            }
+            for (int j=std::max(free_vars_start_index_, goal_row - cost_all.getNumLower());
+                    j<=std::min(free_vars_end_index_, goal_row + cost_all.getNumUpper()); ++j)
+            {
+                linear_control_costs_[d](j - free_vars_start_index_) += parameters_all_[d](goal_row) * cost_all(goal_row, j);
+            }
+        }
         linear_control_costs_[d] *= 2.0;
     }
     return true;
@@ -165,10 +179,11 @@ bool CovariantTrajectoryPolicy::computeLinearControlCosts()
 
 bool CovariantTrajectoryPolicy::computeMinControlCostParameters()
 {
+    VectorXd solution;
     for (int d=0; d<num_dimensions_; ++d)
     {
-        parameters_all_[d].segment(free_vars_start_index_, num_vars_free_) =
-                -0.5 * inv_control_costs_[d] * linear_control_costs_[d];
+        BandedMatrix::choleskySolve(control_cost_factors_[d], linear_control_costs_[d], solution);
+        parameters_all_[d].segment(free_vars_start_index_, num_vars_free_) = -0.5 * solution;
     }
 //    for (int d=0; d<num_dimensions_; ++d)
 //    {
@@ -203,21 +218,35 @@ bool CovariantTrajectoryPolicy::initializeCosts()
 
     control_costs_all_.clear();
     control_costs_.clear();
-    inv_control_costs_.clear();
+    control_cost_factors_.clear();
+
+    // the cost is the same for all dimensions, the products of the banded differentiation
+    // matrices have twice their band width
+    const int cost_band_width = 2 * (DIFF_RULE_LENGTH/2);
+    BandedMatrix cost_all(num_vars_all_, cost_band_width, cost_band_width);
+    cost_all.addDiagonal(cost_ridge_factor_);
+    for (int i=0; i<NUM_DIFF_RULES; ++i)
+    {
+        cost_all.addWeightedGram(differentiation_matrices_[i], derivative_costs_[i]);
+    }
+
+    // extract the quadratic cost just for the free variables:
+    BandedMatrix cost_free;
+    cost_all.getBlock(free_vars_start_index_, num_vars_free_, cost_free);
+    BandedMatrix cost_free_factor;
+    if (!cost_free.choleskyFactorize(cost_free_factor))
+    {
+        ROS_ERROR("Control cost matrix is not positive definite.");
+        return false;
+    }
+    MatrixXd dense_cost_free;
+    cost_free.toDense(dense_cost_free);
+
     for (int d=0; d<num_dimensions_; ++d)
     {
-        // construct the quadratic cost matrices (for all variables)
-        MatrixXd cost_all = MatrixXd::Identity(num_vars_all_, num_vars_all_) * cost_ridge_factor_;
-        for (int i=0; i<NUM_DIFF_RULES; ++i)
-        {
-            cost_all += derivative_costs_[i] * (differentiation_matrices_[i].transpose() * differentiation_matrices_[i]);
-        }
         control_costs_all_.push_back(cost_all);
-
-        // extract the quadratic cost just for the free variables:
-        MatrixXd cost_free = cost_all.block(DIFF_RULE_LENGTH-1, DIFF_RULE_LENGTH-1, num_vars_free_, num_vars_free_);
-        control_costs_.push_back(cost_free);
-        inv_control_costs_.push_back(cost_free.inverse());
+        control_costs_.push_back(dense_cost_free);
+        control_cost_factors_.push_back(cost_free_factor);
     }
     return true;
 }
@@ -237,7 +266,7 @@ void CovariantTrajectoryPolicy::createDifferentiationMatrices()
 {
     double multiplier = 1.0;
     differentiation_matrices_.clear();
-    differentiation_matrices_.resize(NUM_DIFF_RULES, MatrixXd::Zero(num_vars_all_, num_vars_all_));
+    differentiation_matrices_.resize(NUM_DIFF_RULES, BandedMatrix(num_vars_all_, DIFF_RULE_LENGTH/2, DIFF_RULE_LENGTH/2));
     for (int d=0; d<NUM_DIFF_RULES; ++d)
     {
         multiplier /= movement_dt_;
@@ -250,7 +279,7 @@ void CovariantTrajectoryPolicy::createDifferentiationMatrices()
                     continue;
                 if (index >= num_vars_all_)
                     continue;
-                differentiation_matrices_[d](i,index) = multiplier * DIFF_RULES[d][j+DIFF_RULE_LENGTH/2];
+                differentiation_matrices_[d].coeffRef(i,index) = multiplier * DIFF_RULES[d][j+DIFF_RULE_LENGTH/2];
             }
         }
         //ROS_INFO_STREAM(differentiation_matrices_[d]);
@@ -283,13 +312,13 @@ bool CovariantTrajectoryPolicy::computeControlCosts(const std::vector<Eigen::Mat
     {
         VectorXd params_all = parameters_all_[d];
         VectorXd costs_all = VectorXd::Zero(num_vars_all_);
+        VectorXd acc_all = VectorXd::Zero(num_vars_all_);
         for (int t=0; t<num_time_steps_; ++t)
         {
             params_all.segment(free_vars_start_index_, num_vars_free_) = parameters[d][t];
-            VectorXd acc_all = VectorXd::Zero(num_vars_all_);
             for (int i=0; i<NUM_DIFF_RULES; ++i)
             {
-                acc_all = differentiation_matrices_[i]*params_all;
+                differentiation_matrices_[i].multiply(params_all, acc_all);
 								// Eigen2
                 // costs_all += weight * derivative_costs_[i] * (acc_all.cwise()*acc_all);
 								// Eigen3
@@ -191,6 +191,12 @@ bool DMPPolicy::getControlCosts(std::vector<MatrixXd>& control_costs)
 }
 
 bool DMPPolicy::updateParameters(const std::vector<MatrixXd>& updates, const std::vector<Eigen::VectorXd>& time_step_weights)
+{
+  return updateParametersFrom(updates, 0, time_step_weights);
+}
+
+bool DMPPolicy::updateParametersFrom(const std::vector<MatrixXd>& updates, const int first_dimension,
+                                     const std::vector<Eigen::VectorXd>& time_step_weights)
 {
   if (!initialized_)
   {
@@ -203,7 +209,7 @@ bool DMPPolicy::updateParameters(const std::vector<MatrixXd>& updates, const std
     ROS_ERROR("Could not get parameter vector. Cannot update parameters of the DMP policy.");
     return false;
   }
-  assert(theta_vectors.size() == updates.size());
+  assert(first_dimension >= 0 && first_dimension + static_cast<int>(theta_vectors.size()) <= static_cast<int>(updates.size()));
 
   std::vector<MatrixXd> basis_functions;
   if (!getBasisFunctions(basis_functions))
@@ -211,16 +217,17 @@ bool DMPPolicy::updateParameters(const std::vector<MatrixXd>& updates, const std
     ROS_ERROR("Could not get basis function matrix. Cannot update parameters of the DMP policy.");
     return false;
   }
-  assert(basis_functions.size() == updates.size());
+  assert(basis_functions.size() == theta_vectors.size());
 
-  for (int d = 0; d < static_cast<int> (updates.size()); d++)
+  for (int d = 0; d < static_cast<int> (theta_vectors.size()); d++)
   {
+    const MatrixXd& update = updates[first_dimension + d];
     int num_rfs = basis_functions[d].cols();
 
-    assert(updates[d].rows() == static_cast<int>(num_time_steps_));
-    assert(updates[d].cols() == static_cast<int>(theta_vectors[d].size()));
-    assert(updates[d].rows() == basis_functions[d].rows());
-    assert(updates[d].cols() == basis_functions[d].cols());
+    assert(update.rows() == static_cast<int>(num_time_steps_));
+    assert(update.cols() == static_cast<int>(theta_vectors[d].size()));
+    assert(update.rows() == basis_functions[d].rows());
+    assert(update.cols() == basis_functions[d].cols());
 
     for (int j = 0; j < num_rfs; j++)
     {
@@ -230,7 +237,7 @@ bool DMPPolicy::updateParameters(const std::vector<MatrixXd>& updates, const std
       {
         double time_weight = num_time_steps_ - i;
         sum_time_weight_times_basis_function_weight += (time_weight * basis_functions[d](i, j));
-        sum_time_weight_times_basis_function_weight_times_update += ((time_weight * basis_functions[d](i, j)) * updates[d](i, j));
+        sum_time_weight_times_basis_function_weight_times_update += ((time_weight * basis_functions[d](i, j)) * update(i, j));
       }
 
       // update the theta vector
@@ -63,17 +63,112 @@ bool MixedPolicy::initialize(std::vector<boost::shared_ptr<Policy> >& policies)
     num_policies_ = policies.size();
     num_dimensions_ = 0;
     num_dimensions_per_policy_.clear();
+    dimension_offsets_.clear();
     for (int p=0; p<num_policies_; ++p)
     {
         int num_dim;
         ROS_VERIFY(policies[p]->getNumDimensions(num_dim));
         num_dimensions_per_policy_.push_back(num_dim);
+        dimension_offsets_.push_back(num_dimensions_);
         num_dimensions_ += num_dim;
     }
+    dimension_offsets_.push_back(num_dimensions_);
+    policy_parameters_.clear();
+    policy_parameters_.resize(num_policies_);
+    policy_matrices_.clear();
+    policy_matrices_.resize(num_policies_);
     ROS_INFO("Initializing mixed policy with %i dimensions.", num_dimensions_);
+    if (!pullParameters())
+    {
+        ROS_ERROR("Could not get the parameters of the sub-policies.");
+        return (initialized_ = false);
+    }
     return (initialized_ = true);
 }
 
+bool MixedPolicy::pullParameters()
+{
+    parameter_offsets_.resize(num_dimensions_ + 1);
+    int num_parameters = 0;
+    for (int p=0; p<num_policies_; ++p)
+    {
+        if (!policies_[p]->getParameters(policy_parameters_[p]))
+        {
+            return false;
+        }
+        ROS_ASSERT((int)policy_parameters_[p].size() == num_dimensions_per_policy_[p]);
+        for (int i=0; i<num_dimensions_per_policy_[p]; ++i)
+        {
+            parameter_offsets_[dimension_offsets_[p] + i] = num_parameters;
+            num_parameters += policy_parameters_[p][i].size();
+        }
+    }
+    parameter_offsets_[num_dimensions_] = num_parameters;
+
+    if (parameter_buffer_.size() != num_parameters)
+    {
+        parameter_buffer_.resize(num_parameters);
+    }
+    for (int p=0; p<num_policies_; ++p)
+    {
+        for (int i=0; i<num_dimensions_per_policy_[p]; ++i)
+        {
+            const int d = dimension_offsets_[p] + i;
+            parameter_buffer_.segment(parameter_offsets_[d], parameter_offsets_[d+1] - parameter_offsets_[d]) = policy_parameters_[p][i];
+        }
+    }
+    return true;
+}
+
+bool MixedPolicy::pushParameters()
+{
+    for (int p=0; p<num_policies_; ++p)
+    {
+        policy_parameters_[p].resize(num_dimensions_per_policy_[p]);
+        for (int i=0; i<num_dimensions_per_policy_[p]; ++i)
+        {
+            policy_parameters_[p][i] = getDimensionParameters(dimension_offsets_[p] + i);
+        }
+        if (!policies_[p]->setParameters(policy_parameters_[p]))
+        {
+            ROS_ERROR("Could not set the parameters of sub-policy %i.", p);
+            return false;
+        }
+    }
+    return true;
+}
+
+const Eigen::VectorXd& MixedPolicy::getParameterBuffer() const
+{
+    ROS_ASSERT(initialized_);
+    return parameter_buffer_;
+}
+
+bool MixedPolicy::setParameterBuffer(const Eigen::VectorXd& parameter_buffer)
+{
+    ROS_ASSERT(initialized_);
+    if (parameter_buffer.size() != parameter_buffer_.size())
+    {
+        ROS_ERROR("Parameter buffer has %i entries, expected %i.", (int)parameter_buffer.size(), (int)parameter_buffer_.size());
+        return false;
+    }
+    parameter_buffer_ = parameter_buffer;
+    return pushParameters();
+}
+
+Eigen::VectorXd::ConstSegmentReturnType MixedPolicy::getDimensionParameters(const int dimension) const
+{
+    ROS_ASSERT(dimension >= 0 && dimension < num_dimensions_);
+    return parameter_buffer_.segment(parameter_offsets_[dimension], parameter_offsets_[dimension+1] - parameter_offsets_[dimension]);
+}
+
+Eigen::VectorXd::ConstSegmentReturnType MixedPolicy::getPolicyParameters(const int policy_index) const
+{
+    ROS_ASSERT(policy_index >= 0 && policy_index < num_policies_);
+    const int start = parameter_offsets_[dimension_offsets_[policy_index]];
+    return parameter_buffer_.segment(start, parameter_offsets_[dimension_offsets_[policy_index+1]] - start);
+}
+
 bool MixedPolicy::setNumTimeSteps(const int num_time_steps)
 {
     ROS_ASSERT(initialized_);
@@ -98,67 +193,69 @@ bool MixedPolicy::getNumDimensions(int& num_dimensions)
 bool MixedPolicy::getNumParameters(std::vector<int>& num_params)
 {
     ROS_ASSERT(initialized_);
-    num_params.clear();
-    std::vector<int> num_p;
-    for (int p=0; p<num_policies_; ++p)
+    num_params.resize(num_dimensions_);
+    for (int d=0; d<num_dimensions_; ++d)
     {
-        num_p.clear();
-        policies_[p]->getNumParameters(num_p);
-        num_params.insert(num_params.end(), num_p.begin(), num_p.end());
+        num_params[d] = parameter_offsets_[d+1] - parameter_offsets_[d];
     }
     return true;
 }
 
-bool MixedPolicy::getBasisFunctions(std::vector<Eigen::MatrixXd>& basis_functions)
+bool MixedPolicy::getPolicyMatrices(const bool control_costs, std::vector<Eigen::MatrixXd>& matrices)
 {
     ROS_ASSERT(initialized_);
-    basis_functions.clear();
-    std::vector<Eigen::MatrixXd> basis_f;
+    matrices.resize(num_dimensions_);
     for (int p=0; p<num_policies_; ++p)
     {
-        basis_f.clear();
-        policies_[p]->getBasisFunctions(basis_f);
-        basis_functions.insert(basis_functions.end(), basis_f.begin(), basis_f.end());
+        bool success = control_costs ? policies_[p]->getControlCosts(policy_matrices_[p])
+                                     : policies_[p]->getBasisFunctions(policy_matrices_[p]);
+        if (!success)
+        {
+            return false;
+        }
+        ROS_ASSERT((int)policy_matrices_[p].size() == num_dimensions_per_policy_[p]);
+        // swapping hands over the storage of the sub-policy matrices without copying them
+        for (int i=0; i<num_dimensions_per_policy_[p]; ++i)
+        {
+            matrices[dimension_offsets_[p] + i].swap(policy_matrices_[p][i]);
+        }
     }
     return true;
 }
 
+bool MixedPolicy::getBasisFunctions(std::vector<Eigen::MatrixXd>& basis_functions)
+{
+    return getPolicyMatrices(false, basis_functions);
+}
+
 bool MixedPolicy::getControlCosts(std::vector<Eigen::MatrixXd>& control_costs)
 {
-    ROS_ASSERT(initialized_);
-    control_costs.clear();
-    std::vector<Eigen::MatrixXd> control_c;
-    for (int p=0; p<num_policies_; ++p)
-    {
-        control_c.clear();
-        policies_[p]->getControlCosts(control_c);
-        control_costs.insert(control_costs.end(), control_c.begin(), control_c.end());
-    }
-    return true;
+    return getPolicyMatrices(true, control_costs);
 }
 
 bool MixedPolicy::updateParameters(const std::vector<Eigen::MatrixXd>& updates, const std::vector<Eigen::VectorXd>& time_step_weights)
 {
-    int start_dimension = 0;
+    ROS_ASSERT(initialized_);
+    ROS_ASSERT((int)updates.size() == num_dimensions_);
     for (int p=0; p<num_policies_; ++p)
     {
-        std::vector<Eigen::MatrixXd> p_updates;
-        p_updates.insert(p_updates.begin(), updates.begin()+start_dimension, updates.begin()+start_dimension+num_dimensions_per_policy_[p]);
-        policies_[p]->updateParameters(p_updates, time_step_weights);
-        start_dimension += num_dimensions_per_policy_[p];
+        // the sub-policies read their updates in place
+        if (!policies_[p]->updateParametersFrom(updates, dimension_offsets_[p], time_step_weights))
+        {
+            ROS_ERROR("Could not update the parameters of sub-policy %i.", p);
+            return false;
+        }
     }
-    return true;
+    return pullParameters();
 }
 
 bool MixedPolicy::getParameters(std::vector<Eigen::VectorXd>& parameters)
 {
     ROS_ASSERT(initialized_);
-    parameters.clear();
-    for (int p=0; p<num_policies_; ++p)
+    parameters.resize(num_dimensions_);
+    for (int d=0; d<num_dimensions_; ++d)
     {
-        std::vector<Eigen::VectorXd> params;
-        policies_[p]->getParameters(params);
-        parameters.insert(parameters.end(), params.begin(), params.end());
+        parameters[d] = getDimensionParameters(d);
     }
     return true;
 }
@@ -166,16 +263,18 @@ bool MixedPolicy::getParameters(std::vector<Eigen::VectorXd>& parameters)
 bool MixedPolicy::setParameters(const std::vector<Eigen::VectorXd>& parameters)
 {
     ROS_ASSERT(initialized_);
-    int start_dimension = 0;
-    for (int p=0; p<num_policies_; ++p)
+    ROS_ASSERT((int)parameters.size() == num_dimensions_);
+    for (int d=0; d<num_dimensions_; ++d)
     {
-        std::vector<Eigen::VectorXd> params;
-        ROS_INFO("MixedPolicy: policy %i has %i dimensions.", p, num_dimensions_per_policy_[p]);
-        params.insert(params.begin(), parameters.begin()+start_dimension, parameters.begin()+start_dimension+num_dimensions_per_policy_[p]);
-        policies_[p]->setParameters(params);
-        start_dimension += num_dimensions_per_policy_[p];
+        const int num_parameters = parameter_offsets_[d+1] - parameter_offsets_[d];
+        if (parameters[d].size() != num_parameters)
+        {
+            ROS_ERROR("MixedPolicy: dimension %i has %i parameters, expected %i.", d, (int)parameters[d].size(), num_parameters);
+            return false;
+        }
+        parameter_buffer_.segment(parameter_offsets_[d], num_parameters) = parameters[d];
     }
-    return true;
+    return pushParameters();
 }
 
 bool MixedPolicy::readFromFile(const std::string& directory_name)
@@ -195,7 +294,7 @@ bool MixedPolicy::readFromFile(const std::string& directory_name)
         ROS_WARN("policies_[%i]->readFromDisc(%s)", i, bag_file_name.c_str());
         ROS_VERIFY(policies_[i]->readFromFile(bag_file_name));
     }
-    return true;
+    return pullParameters();
 }
 
 bool MixedPolicy::writeToFile(const std::string& directory_name)
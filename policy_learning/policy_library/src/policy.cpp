@@ -41,6 +41,20 @@ using namespace Eigen;
 namespace policy_library
 {
 
+bool Policy::updateParametersFrom(const std::vector<Eigen::MatrixXd>& updates, const int first_dimension,
+                                  const std::vector<Eigen::VectorXd>& time_step_weights)
+{
+    int num_dimensions;
+    if (!this->getNumDimensions(num_dimensions) || first_dimension < 0
+            || first_dimension + num_dimensions > int(updates.size()))
+    {
+        return false;
+    }
+    std::vector<Eigen::MatrixXd> policy_updates(updates.begin() + first_dimension,
+                                                updates.begin() + first_dimension + num_dimensions);
+    return updateParameters(policy_updates, time_step_weights);
+}
+
 bool Policy::computeControlCosts(const std::vector<Eigen::MatrixXd>& control_cost_matrices,
                                  const std::vector<std::vector<Eigen::VectorXd> >& parameters,
                                  const double weight, std::vector<Eigen::VectorXd>& control_costs)
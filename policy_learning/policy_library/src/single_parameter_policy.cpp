@@ -119,8 +119,16 @@ bool SingleParameterPolicy::getControlCosts(std::vector<MatrixXd>& control_costs
 }
 
 bool SingleParameterPolicy::updateParameters(const std::vector<MatrixXd>& updates, const std::vector<Eigen::VectorXd>& time_step_weights)
+{
+    ROS_ASSERT(int(updates.size()) == num_dimensions_);
+    return updateParametersFrom(updates, 0, time_step_weights);
+}
+
+bool SingleParameterPolicy::updateParametersFrom(const std::vector<MatrixXd>& updates, const int first_dimension,
+                                                 const std::vector<Eigen::VectorXd>& time_step_weights)
 {
     ROS_ASSERT(initialized_);
+    ROS_ASSERT(first_dimension >= 0 && first_dimension + num_dimensions_ <= int(updates.size()));
     // average the updates with a weight depending on number of time-steps left in the trajectory
     for (int d=0; d<num_dimensions_; ++d)
     {
@@ -130,7 +138,7 @@ bool SingleParameterPolicy::updateParameters(const std::vector<MatrixXd>& update
         {
             double weight = double(num_time_steps_-t);
             update_denom += weight;
-            update += weight * updates[d](t,0);
+            update += weight * updates[first_dimension + d](t,0);
         }
         update /= update_denom;
         parameters_[d](0) += update;
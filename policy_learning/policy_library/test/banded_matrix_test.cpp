@@ -0,0 +1,161 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2010, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include <policy_library/banded_matrix.h>
+#include <policy_library/covariant_trajectory_policy.h>
+#include <Eigen/Core>
+#include <Eigen/LU>
+
+using namespace Eigen;
+
+namespace policy_library
+{
+
+static const int NUM_TIME_STEPS = 100;
+static const int NUM_DIMENSIONS = 2;
+static const double RIDGE_FACTOR = 0.00001;
+
+static double maxError(const MatrixXd& a, const MatrixXd& b)
+{
+    return (a - b).cwiseAbs().maxCoeff() / std::max(1.0, b.cwiseAbs().maxCoeff());
+}
+
+// compares the banded matrices of the policy with the dense products they replace
+class CovariantTrajectoryPolicyTest : public testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        std::vector<double> derivative_costs;
+        derivative_costs.push_back(0.0);
+        derivative_costs.push_back(1.0);
+        derivative_costs.push_back(0.5);
+        ASSERT_TRUE(policy_.initialize(ros::NodeHandle("~"), NUM_TIME_STEPS, NUM_DIMENSIONS, 1.0,
+                                       RIDGE_FACTOR, derivative_costs));
+    }
+
+    void getDenseCosts(MatrixXd& dense_cost_all)
+    {
+        dense_cost_all = MatrixXd::Identity(policy_.num_vars_all_, policy_.num_vars_all_) * RIDGE_FACTOR;
+        for (int i=0; i<NUM_DIFF_RULES; ++i)
+        {
+            MatrixXd differentiation_matrix;
+            policy_.differentiation_matrices_[i].toDense(differentiation_matrix);
+            dense_cost_all += policy_.derivative_costs_[i] * (differentiation_matrix.transpose() * differentiation_matrix);
+        }
+    }
+
+    CovariantTrajectoryPolicy policy_;
+};
+
+TEST_F(CovariantTrajectoryPolicyTest, bandedDifferentiationMatchesDense)
+{
+    VectorXd params = VectorXd::Random(policy_.num_vars_all_);
+    for (int i=0; i<NUM_DIFF_RULES; ++i)
+    {
+        MatrixXd differentiation_matrix;
+        policy_.differentiation_matrices_[i].toDense(differentiation_matrix);
+        VectorXd banded_result;
+        policy_.differentiation_matrices_[i].multiply(params, banded_result);
+        EXPECT_LT(maxError(banded_result, differentiation_matrix * params), 1e-12);
+    }
+}
+
+TEST_F(CovariantTrajectoryPolicyTest, bandedControlCostsMatchDense)
+{
+    const int free_start = policy_.free_vars_start_index_;
+    for (int d=0; d<NUM_DIMENSIONS; ++d)
+    {
+        MatrixXd dense_cost_all;
+        getDenseCosts(dense_cost_all);
+
+        MatrixXd cost_all;
+        policy_.control_costs_all_[d].toDense(cost_all);
+        EXPECT_LT(maxError(cost_all, dense_cost_all), 1e-12);
+
+        MatrixXd dense_cost_free = dense_cost_all.block(free_start, free_start, NUM_TIME_STEPS, NUM_TIME_STEPS);
+        EXPECT_LT(maxError(policy_.control_costs_[d], dense_cost_free), 1e-12);
+
+        MatrixXd coupling;
+        policy_.control_costs_all_[d].getDenseBlock(0, free_start, free_start, NUM_TIME_STEPS, coupling);
+        EXPECT_LT(maxError(coupling, dense_cost_all.block(0, free_start, free_start, NUM_TIME_STEPS)), 1e-12);
+    }
+}
+
+TEST_F(CovariantTrajectoryPolicyTest, linearControlCostsMatchDense)
+{
+    VectorXd start = VectorXd::Random(NUM_DIMENSIONS);
+    VectorXd goal = VectorXd::Random(NUM_DIMENSIONS);
+    ASSERT_TRUE(policy_.setToMinControlCost(start, goal));
+
+    const int free_start = policy_.free_vars_start_index_;
+    for (int d=0; d<NUM_DIMENSIONS; ++d)
+    {
+        MatrixXd dense_cost_all;
+        getDenseCosts(dense_cost_all);
+
+        // only the fixed start and goal variables contribute to the linear costs
+        VectorXd fixed_params = policy_.parameters_all_[d];
+        fixed_params.segment(free_start, NUM_TIME_STEPS).setZero();
+        VectorXd dense_linear_costs = 2.0 * dense_cost_all.middleRows(free_start, NUM_TIME_STEPS) * fixed_params;
+        EXPECT_LT(maxError(policy_.linear_control_costs_[d], dense_linear_costs), 1e-12);
+
+        // minimum control cost solution through the cholesky factor vs. the dense inverse
+        MatrixXd dense_cost_free = dense_cost_all.block(free_start, free_start, NUM_TIME_STEPS, NUM_TIME_STEPS);
+        VectorXd dense_solution = -0.5 * (dense_cost_free.inverse() * dense_linear_costs);
+        EXPECT_LT(maxError(policy_.parameters_all_[d].segment(free_start, NUM_TIME_STEPS), dense_solution), 1e-6);
+        EXPECT_DOUBLE_EQ(start(d), policy_.parameters_all_[d](0));
+        EXPECT_DOUBLE_EQ(goal(d), policy_.parameters_all_[d](policy_.num_vars_all_-1));
+    }
+}
+
+TEST(BandedMatrixTest, rejectsIndefiniteMatrix)
+{
+    BandedMatrix matrix(5, 1, 1);
+    matrix.addDiagonal(1.0);
+    matrix.coeffRef(2, 2) = -1.0;
+    BandedMatrix factor;
+    EXPECT_FALSE(matrix.choleskyFactorize(factor));
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    ros::init(argc, argv, "banded_matrix_test");
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,132 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2010, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <gtest/gtest.h>
+#include <boost/shared_ptr.hpp>
+#include <policy_library/mixed_policy.h>
+#include <policy_library/single_parameter_policy.h>
+
+using namespace policy_library;
+
+static const int NUM_TIME_STEPS = 10;
+
+class MixedPolicyTest : public testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        const int num_dimensions[2] = {2, 3};
+        std::vector<boost::shared_ptr<Policy> > policies;
+        for (int p=0; p<2; ++p)
+        {
+            boost::shared_ptr<SingleParameterPolicy> policy(new SingleParameterPolicy());
+            ASSERT_TRUE(policy->initialize(num_dimensions[p]));
+            ASSERT_TRUE(policy->setNumTimeSteps(NUM_TIME_STEPS));
+            sub_policies_.push_back(policy);
+            policies.push_back(policy);
+        }
+        ASSERT_TRUE(mixed_policy_.initialize(policies));
+        ASSERT_TRUE(mixed_policy_.setNumTimeSteps(NUM_TIME_STEPS));
+    }
+
+    std::vector<boost::shared_ptr<SingleParameterPolicy> > sub_policies_;
+    MixedPolicy mixed_policy_;
+};
+
+TEST_F(MixedPolicyTest, parameterBufferMatchesSubPolicies)
+{
+    std::vector<Eigen::VectorXd> parameters(5, Eigen::VectorXd::Zero(1));
+    for (int d=0; d<5; ++d)
+    {
+        parameters[d](0) = d + 1.0;
+    }
+    ASSERT_TRUE(mixed_policy_.setParameters(parameters));
+
+    const Eigen::VectorXd& buffer = mixed_policy_.getParameterBuffer();
+    ASSERT_EQ(5, buffer.size());
+    for (int d=0; d<5; ++d)
+    {
+        EXPECT_EQ(d + 1.0, buffer(d));
+        EXPECT_EQ(d + 1.0, mixed_policy_.getDimensionParameters(d)(0));
+    }
+    EXPECT_EQ(2, mixed_policy_.getPolicyParameters(0).size());
+    EXPECT_EQ(3, mixed_policy_.getPolicyParameters(1).size());
+    EXPECT_EQ(3.0, mixed_policy_.getPolicyParameters(1)(0));
+
+    std::vector<Eigen::VectorXd> sub_parameters;
+    ASSERT_TRUE(sub_policies_[1]->getParameters(sub_parameters));
+    ASSERT_EQ(3u, sub_parameters.size());
+    EXPECT_EQ(5.0, sub_parameters[2](0));
+
+    Eigen::VectorXd new_buffer = -buffer;
+    ASSERT_TRUE(mixed_policy_.setParameterBuffer(new_buffer));
+    ASSERT_TRUE(sub_policies_[0]->getParameters(sub_parameters));
+    EXPECT_EQ(-2.0, sub_parameters[1](0));
+    std::vector<Eigen::VectorXd> mixed_parameters;
+    ASSERT_TRUE(mixed_policy_.getParameters(mixed_parameters));
+    ASSERT_EQ(5u, mixed_parameters.size());
+    EXPECT_EQ(-4.0, mixed_parameters[3](0));
+
+    EXPECT_FALSE(mixed_policy_.setParameterBuffer(Eigen::VectorXd::Zero(4)));
+}
+
+TEST_F(MixedPolicyTest, updateAndMatrices)
+{
+    std::vector<Eigen::MatrixXd> updates(5, Eigen::MatrixXd::Ones(NUM_TIME_STEPS, 1));
+    updates[4] *= 2.0;
+    std::vector<Eigen::VectorXd> time_step_weights;
+    ASSERT_TRUE(mixed_policy_.updateParameters(updates, time_step_weights));
+    EXPECT_NEAR(1.0, mixed_policy_.getDimensionParameters(0)(0), 1e-12);
+    EXPECT_NEAR(2.0, mixed_policy_.getDimensionParameters(4)(0), 1e-12);
+
+    std::vector<int> num_parameters;
+    ASSERT_TRUE(mixed_policy_.getNumParameters(num_parameters));
+    EXPECT_EQ(std::vector<int>(5, 1), num_parameters);
+
+    std::vector<Eigen::MatrixXd> basis_functions;
+    ASSERT_TRUE(mixed_policy_.getBasisFunctions(basis_functions));
+    ASSERT_EQ(5u, basis_functions.size());
+    EXPECT_EQ(NUM_TIME_STEPS, basis_functions[4].rows());
+
+    std::vector<Eigen::MatrixXd> control_costs;
+    ASSERT_TRUE(mixed_policy_.getControlCosts(control_costs));
+    ASSERT_EQ(5u, control_costs.size());
+    EXPECT_EQ(1, control_costs[2].rows());
+}
+
+int main(int argc, char** argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -38,6 +38,7 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include <ros/assert.h>
 #include <ros/node_handle.h>
 #include <Eigen/Core>
 #include <policy_library/policy.h>
@@ -68,6 +69,44 @@ public:
      */
     virtual bool execute(std::vector<Eigen::VectorXd>& parameters, Eigen::VectorXd& costs, double& terminal_cost, const int iteration_number) = 0;
 
+    /**
+     * Executes the task for all rollouts of an iteration, and returns the costs per rollout and timestep.
+     * The default implementation calls execute() for each rollout, tasks that can share setup across rollouts
+     * or evaluate them together should override it together with supportsBatchExecution().
+     * @param parameters [num_rollouts][num_dimensions] num_parameters - policy parameters of all rollouts
+     * @param costs num_rollouts x num_time_steps, state space cost per rollout and timestep (sized from the first rollout
+     *        if it has too few rows, all rollouts must return the same number of time steps)
+     * @param terminal_costs num_rollouts, terminal cost per rollout (resized if it is too short)
+     * @return
+     */
+    virtual bool executeBatch(std::vector<std::vector<Eigen::VectorXd> >& parameters, Eigen::MatrixXd& costs,
+                              Eigen::VectorXd& terminal_costs, const int iteration_number)
+    {
+        const int num_rollouts = parameters.size();
+        if (terminal_costs.size() < num_rollouts)
+        {
+            terminal_costs.resize(num_rollouts);
+        }
+        Eigen::VectorXd rollout_costs;
+        for (int r=0; r<num_rollouts; ++r)
+        {
+            if (!execute(parameters[r], rollout_costs, terminal_costs(r), iteration_number))
+            {
+                return false;
+            }
+            if (r == 0)
+            {
+                if (costs.rows() < num_rollouts || costs.cols() != rollout_costs.size())
+                {
+                    costs.resize(num_rollouts, rollout_costs.size());
+                }
+            }
+            ROS_ASSERT(rollout_costs.size() == costs.cols());
+            costs.row(r) = rollout_costs.transpose();
+        }
+        return true;
+    }
+
     /**
      * Get the Policy object of this Task
      * @param policy
@@ -89,6 +128,26 @@ public:
      */
     virtual bool getControlCostWeight(double& control_cost_weight) = 0;
 
+    /**
+     * Whether execute() may be called concurrently from several threads (with different parameters and costs).
+     * A reentrant task must not modify its policy in execute()
+     * @return
+     */
+    virtual bool isReentrant()
+    {
+        return false;
+    }
+
+    /**
+     * Whether executeBatch() is implemented by the task and should be used to execute the rollouts of an iteration.
+     * Like a reentrant task, a batch task must not modify its policy while executing rollouts
+     * @return
+     */
+    virtual bool supportsBatchExecution()
+    {
+        return false;
+    }
+
 };
 
 }
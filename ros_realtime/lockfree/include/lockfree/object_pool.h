@@ -55,6 +55,58 @@ struct SPStorage
   uint8_t data[72];
 };
 
+/**
+ * \brief The free callback of an ObjectPool, see ObjectPool::setFreeCallback()
+ */
+struct FreeNotifier
+{
+  typedef void(*Callback)(void* arg, void const* pool);
+
+  FreeNotifier()
+  : callback_(0)
+  , pool_(0)
+  {
+    arg_.store(0);
+  }
+
+  Callback callback_;
+  ros::atomic<void*> arg_; // stored after callback_ with release order, not NULL once the callback is set
+  void const* pool_;
+};
+
+/**
+ * \brief Returns a block to a pool's freelist and then calls the pool's free callback.  The callback is
+ * read first, a garbage collector may delete the pool as soon as the block is back
+ */
+inline void freeAndNotify(FreeList* list, void const* block, const FreeNotifier* notifier)
+{
+  void* arg = notifier->arg_.load(ros::memory_order_acquire);
+  FreeNotifier::Callback callback = notifier->callback_;
+  void const* pool = notifier->pool_;
+
+  list->free(block);
+
+  if (arg)
+  {
+    callback(arg, pool);
+  }
+}
+
+/**
+ * \brief The freelist of shared pointer control blocks of one pool segment.  The allocator reaches the
+ * pool's free callback through it, a pointer of its own would no longer fit the control block into SPStorage
+ */
+struct SPStorageFreeList
+{
+  SPStorageFreeList()
+  : notifier(0)
+  {
+  }
+
+  FreeList freelist;
+  const FreeNotifier* notifier;
+};
+
 template<class T> class SPAllocator;
 
 // specialize for void:
@@ -73,7 +125,7 @@ public:
     typedef SPAllocator<U> other;
   };
 
-  SPAllocator(FreeList* pool, SPStorage* block) throw ()
+  SPAllocator(SPStorageFreeList* pool, SPStorage* block) throw ()
   : block_(block)
   , used_(0)
   , pool_(pool)
@@ -90,12 +142,12 @@ public:
 
   SPStorage* get_block() const { return block_; }
   uint32_t get_used() const { return used_; }
-  FreeList* get_pool() const { return pool_; }
+  SPStorageFreeList* get_pool() const { return pool_; }
 
 private:
   SPStorage* block_;
   uint32_t used_;
-  FreeList* pool_;
+  SPStorageFreeList* pool_;
 };
 
 template<class T>
@@ -116,7 +168,7 @@ public:
     typedef SPAllocator<U> other;
   };
 
-  SPAllocator(FreeList* pool, SPStorage* block) throw ()
+  SPAllocator(SPStorageFreeList* pool, SPStorage* block) throw ()
   : block_(block)
   , used_(0)
   , pool_(pool)
@@ -164,7 +216,9 @@ public:
 
     if (used_ == 0 || used_ < 0)
     {
-      pool_->free(block_);
+      // the control block is released after the object, so this is the free that has to wake a
+      // garbage collector, see ObjectPool::setFreeCallback()
+      freeAndNotify(&pool_->freelist, block_, pool_->notifier);
     }
   }
 
@@ -179,19 +233,25 @@ public:
 
   SPStorage* get_block() const { return block_; }
   int32_t get_used() const { return used_; }
-  FreeList* get_pool() const { return pool_; }
+  SPStorageFreeList* get_pool() const { return pool_; }
 
 private:
   SPStorage* block_;
   int32_t used_;
-  FreeList* pool_;
+  SPStorageFreeList* pool_;
 };
 
 } // namespace detail
 
 /**
- * \brief A fixed-count lock-free pool of the same type of object.  Supports both bare- and shared-pointer
+ * \brief A lock-free pool of the same type of object.  Supports both bare- and shared-pointer
  * allocation
+ *
+ * The pool is made of segments of equal size.  By default it has a single segment and never grows.
+ * A growable pool (see initialize()) requests another segment when the number of free objects drops
+ * below a low-water mark, and a non-realtime thread adds it by calling growIfNeeded().  Allocation
+ * never allocates memory and stays lock-free, it walks the segments published so far.
+ *
  * \param T the object type
  */
 template<typename T>
@@ -210,7 +270,8 @@ class ObjectPool
     {
       if (free_)
       {
-        pool_->free(t);
+        // the control block is still allocated, its release calls the free callback instead
+        pool_->freeWithoutNotify(t);
       }
     }
 
@@ -219,15 +280,34 @@ class ObjectPool
     bool free_;
   };
 
-
+  struct Segment
+  {
+    FreeList freelist;
+    detail::SPStorageFreeList sp_storage;
+  };
 
 public:
+  enum
+  {
+    MAX_SEGMENTS = 32
+  };
+
+  typedef void(*FreeCallback)(void* arg, void const* pool);
+
   /**
    * \brief Default constructor.  Must call initialize() before calling allocate()
    */
   ObjectPool()
   : initialized_(false)
+  , tmpl_(0)
+  , segment_size_(0)
+  , max_segments_(0)
+  , low_water_(0)
+  , grow_callback_(0)
   {
+    segment_count_.store(0);
+    free_notifier_.pool_ = this;
+    grow_callback_arg_.store(0);
   }
 
   /**
@@ -237,39 +317,151 @@ public:
    */
   ObjectPool(uint32_t count, const T& tmpl)
   : initialized_(false)
+  , tmpl_(0)
+  , segment_size_(0)
+  , max_segments_(0)
+  , low_water_(0)
+  , grow_callback_(0)
   {
+    segment_count_.store(0);
+    free_notifier_.pool_ = this;
+    grow_callback_arg_.store(0);
     initialize(count, tmpl);
   }
 
   ~ObjectPool()
   {
-    freelist_.template destructAll<T>();
-    sp_storage_freelist_.template destructAll<detail::SPStorage>();
+    uint32_t count = segment_count_.load();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      segments_[i]->freelist.template destructAll<T>();
+      segments_[i]->sp_storage.freelist.template destructAll<detail::SPStorage>();
+      delete segments_[i];
+    }
+
+    delete tmpl_;
   }
 
   /**
-   * \brief Returns whether or not this ObjectPool has any outstanding allocations
+   * \brief Returns true if neither objects nor shared pointer control blocks are allocated from this
+   * pool, i.e. it may be deleted.  Like FreeList::hasOutstandingAllocations(), whose meaning it
+   * inherits, it returns false while anything is still allocated
    */
   bool hasOutstandingAllocations()
   {
-    return freelist_.hasOutstandingAllocations() || sp_storage_freelist_.hasOutstandingAllocations();
+    bool result = true;
+    uint32_t count = segment_count_.load();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      result = result && segments_[i]->freelist.hasOutstandingAllocations() && segments_[i]->sp_storage.freelist.hasOutstandingAllocations();
+    }
+    return result;
   }
 
   /**
    * \brief initialize the pool.  Only use with the default constructor
-   * \param count The number of objects in the pool
+   * \param count The number of objects in the pool, or in every segment of a growable pool
    * \param tmpl The object template to use to construct the objects
+   * \param max_segments The number of segments the pool may grow to, 1 for a fixed-size pool
+   * \param low_water Another segment is requested once fewer than low_water objects are free
    */
-  void initialize(uint32_t count, const T& tmpl)
+  void initialize(uint32_t count, const T& tmpl, uint32_t max_segments = 1, uint32_t low_water = 0)
   {
     ROS_ASSERT(!initialized_);
-    freelist_.initialize(sizeof(T), count);
-    freelist_.template constructAll<T>(tmpl);
-    sp_storage_freelist_.initialize(sizeof(detail::SPStorage), count);
-    sp_storage_freelist_.template constructAll<detail::SPStorage>();
+    ROS_ASSERT(max_segments >= 1 && max_segments <= MAX_SEGMENTS);
+    segment_size_ = count;
+    max_segments_ = max_segments;
+    low_water_ = low_water;
+    capacity_.store(0);
+    in_use_.store(0);
+    high_water_.store(0);
+    exhaustion_count_.store(0);
+    grow_requested_.store(false);
+
+    if (max_segments_ > 1)
+    {
+      tmpl_ = new T(tmpl);
+    }
+
+    addSegment(tmpl);
     initialized_ = true;
   }
 
+  /**
+   * \brief Adds a segment if one was requested since the last call.  Allocates memory, so it must
+   * only be called from a non-realtime thread, and only from one thread at a time.
+   * \return true if a segment was added
+   */
+  bool growIfNeeded()
+  {
+    if (!grow_requested_.exchange(false))
+    {
+      return false;
+    }
+
+    return grow();
+  }
+
+  /**
+   * \brief Adds a segment unconditionally, same restrictions as growIfNeeded()
+   * \return false if the pool is not growable or already has its maximum number of segments
+   */
+  bool grow()
+  {
+    ROS_ASSERT(initialized_);
+    if (!tmpl_ || segment_count_.load() >= max_segments_)
+    {
+      return false;
+    }
+
+    addSegment(*tmpl_);
+    return true;
+  }
+
+  /**
+   * \brief Sets a function called after an object has been returned to the pool, e.g. to notify a
+   * garbage collector.  For a bare pointer it's called from free(), for a shared pointer once its control
+   * block has been returned as well, which happens after the object.  It's called as callback(arg, this)
+   * from whatever thread frees the object, so it must be realtime-safe.  The pool may already be deleted
+   * when it's called, so the callback must not access it.  May only be set once, and arg must not be NULL
+   */
+  void setFreeCallback(FreeCallback callback, void* arg)
+  {
+    ROS_ASSERT(arg);
+    ROS_ASSERT(!free_notifier_.arg_.load());
+    free_notifier_.callback_ = callback;
+    free_notifier_.arg_.store(arg, ros::memory_order_release);
+  }
+
+  /**
+   * \brief Sets a function called from allocate() when the pool requests another segment, e.g. to
+   * wake the thread that calls growIfNeeded().  It's called as callback(arg, this) once per request,
+   * from the allocating thread, so it must be realtime-safe.  May only be set once, and arg must not be NULL
+   */
+  void setGrowCallback(FreeCallback callback, void* arg)
+  {
+    ROS_ASSERT(arg);
+    ROS_ASSERT(!grow_callback_arg_.load());
+    grow_callback_ = callback;
+    grow_callback_arg_.store(arg, ros::memory_order_release);
+  }
+
+  /**
+   * \brief Returns whether or not a segment has been requested and not yet added
+   */
+  bool isGrowRequested() const { return grow_requested_.load(); }
+
+  /// Returns the number of segments
+  uint32_t getSegmentCount() const { return segment_count_.load(); }
+  /// Returns the number of objects in all segments
+  uint32_t getCapacity() const { return capacity_.load(); }
+  /// Returns the number of objects currently allocated
+  uint32_t getInUse() const { return in_use_.load(); }
+  /// Returns the highest number of objects allocated at the same time
+  uint32_t getHighWater() const { return high_water_.load(); }
+  /// Returns the number of allocations that failed because the pool was empty
+  uint32_t getExhaustionCount() const { return exhaustion_count_.load(); }
+
   /**
    * \brief Allocate a single object from the pool, returning a shared pointer
    * \return An empty shared pointer if there are no objects left in the pool.  Otherwise
@@ -279,7 +471,7 @@ public:
   {
     ROS_ASSERT(initialized_);
 
-    T* item = static_cast<T*>(freelist_.allocate());
+    T* item = allocate();
     if (!item)
     {
       return boost::shared_ptr<T>();
@@ -288,7 +480,7 @@ public:
     boost::shared_ptr<T> ptr = makeShared(item);
     if (!ptr)
     {
-      freelist_.free(item);
+      free(item);
       return boost::shared_ptr<T>();
     }
 
@@ -318,7 +510,7 @@ public:
    */
   T* removeShared(const boost::shared_ptr<T>& t)
   {
-    ROS_ASSERT(freelist_.owns(t.get()));
+    ROS_ASSERT(owns(t.get()));
 
     Deleter* d = boost::get_deleter<Deleter>(t);
     d->free_ = false;
@@ -332,7 +524,7 @@ public:
    */
   T const* removeShared(const boost::shared_ptr<T const>& t)
   {
-    ROS_ASSERT(freelist_.owns(t.get()));
+    ROS_ASSERT(owns(t.get()));
 
     Deleter* d = boost::get_deleter<Deleter>(t);
     d->free_ = false;
@@ -346,7 +538,33 @@ public:
    */
   T* allocate()
   {
-    return static_cast<T*>(freelist_.allocate());
+    uint32_t count = segment_count_.load(ros::memory_order_acquire);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      T* t = static_cast<T*>(segments_[i]->freelist.allocate());
+      if (t)
+      {
+        uint32_t in_use = in_use_.fetch_add(1) + 1;
+        uint32_t high_water = high_water_.load(ros::memory_order_relaxed);
+        while (in_use > high_water && !high_water_.compare_exchange_weak(high_water, in_use))
+        {
+        }
+
+        if (tmpl_ && capacity_.load(ros::memory_order_relaxed) - in_use < low_water_)
+        {
+          requestGrow();
+        }
+
+        return t;
+      }
+    }
+
+    exhaustion_count_.fetch_add(1);
+    if (tmpl_)
+    {
+      requestGrow();
+    }
+    return 0;
   }
 
   /**
@@ -355,7 +573,16 @@ public:
    */
   void free(T const* t)
   {
-    freelist_.free(t);
+    if (!t)
+    {
+      return;
+    }
+
+    Segment* segment = findSegment(t);
+    ROS_ASSERT(segment);
+
+    in_use_.fetch_sub(1);
+    detail::freeAndNotify(&segment->freelist, t, &free_notifier_);
   }
 
   /**
@@ -363,7 +590,7 @@ public:
    */
   bool owns(T const* t)
   {
-    return freelist_.owns(t);
+    return findSegment(t) != 0;
   }
 
   /**
@@ -376,26 +603,101 @@ public:
 
 private:
 
+  void freeWithoutNotify(T const* t)
+  {
+    Segment* segment = findSegment(t);
+    ROS_ASSERT(segment);
+
+    in_use_.fetch_sub(1);
+    segment->freelist.free(t);
+  }
+
+  void requestGrow()
+  {
+    // a full pool can't grow, requesting would only wake the grower on every allocation
+    if (segment_count_.load(ros::memory_order_relaxed) >= max_segments_)
+    {
+      return;
+    }
+
+    if (!grow_requested_.exchange(true))
+    {
+      // published like the free callback, see setGrowCallback()
+      void* arg = grow_callback_arg_.load(ros::memory_order_acquire);
+      if (arg)
+      {
+        grow_callback_(arg, this);
+      }
+    }
+  }
+
+  void addSegment(const T& tmpl)
+  {
+    Segment* segment = new Segment;
+    segment->freelist.initialize(sizeof(T), segment_size_);
+    segment->freelist.template constructAll<T>(tmpl);
+    segment->sp_storage.freelist.initialize(sizeof(detail::SPStorage), segment_size_);
+    segment->sp_storage.freelist.template constructAll<detail::SPStorage>();
+    segment->sp_storage.notifier = &free_notifier_;
+
+    // publish the segment before the count, allocate() only reads segments below the count
+    uint32_t count = segment_count_.load();
+    segments_[count] = segment;
+    segment_count_.store(count + 1, ros::memory_order_release);
+    capacity_.fetch_add(segment_size_);
+  }
+
+  Segment* findSegment(void const* t)
+  {
+    uint32_t count = segment_count_.load(ros::memory_order_acquire);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      if (segments_[i]->freelist.owns(t))
+      {
+        return segments_[i];
+      }
+    }
+
+    return 0;
+  }
+
   template<typename T2>
   boost::shared_ptr<T2> makeSharedImpl(T2* t)
   {
-    ROS_ASSERT(freelist_.owns(t));
+    Segment* segment = findSegment(t);
+    ROS_ASSERT(segment);
 
-    detail::SPStorage* sp_storage = static_cast<detail::SPStorage*>(sp_storage_freelist_.allocate());
+    // the shared_ptr control block comes from the segment that owns the object
+    detail::SPStorage* sp_storage = static_cast<detail::SPStorage*>(segment->sp_storage.freelist.allocate());
 
     if (!sp_storage)
     {
       return boost::shared_ptr<T2>();
     }
 
-    boost::shared_ptr<T2> ptr(t, Deleter(this, sp_storage), detail::SPAllocator<void>(&sp_storage_freelist_, sp_storage));
+    boost::shared_ptr<T2> ptr(t, Deleter(this, sp_storage), detail::SPAllocator<void>(&segment->sp_storage, sp_storage));
     return ptr;
   }
 
   bool initialized_;
 
-  FreeList freelist_;
-  FreeList sp_storage_freelist_;
+  Segment* segments_[MAX_SEGMENTS];
+  ros::atomic_uint32_t segment_count_;
+  T* tmpl_;  // only kept by growable pools
+
+  uint32_t segment_size_;
+  uint32_t max_segments_;
+  uint32_t low_water_;
+
+  ros::atomic_uint32_t capacity_;
+  ros::atomic_uint32_t in_use_;
+  ros::atomic_uint32_t high_water_;
+  ros::atomic_uint32_t exhaustion_count_;
+  ros::atomic_bool grow_requested_;
+
+  detail::FreeNotifier free_notifier_;
+  FreeCallback grow_callback_;
+  ros::atomic<void*> grow_callback_arg_;
 };
 
 } // namespace lockfree
@@ -36,26 +36,46 @@
 #include <lockfree/free_list.h>
 #include <allocators/aligned.h>
 
+#include <cstring>
+
 using namespace ros;
 
 namespace lockfree
 {
 
+namespace
+{
+const uint32_t END = 0xffffffffUL;
+
+atomic_uint32_t g_thread_count(0);
+__thread uint32_t g_thread_id = 0;
+}
+
 FreeList::FreeList()
 : blocks_(0)
 , next_(0)
 , block_size_(0)
 , block_count_(0)
+, depot_next_(0)
+, magazines_(0)
+, magazine_blocks_(0)
+, magazine_size_(0)
+, magazine_count_(0)
 {
 }
 
-FreeList::FreeList(uint32_t block_size, uint32_t block_count)
+FreeList::FreeList(uint32_t block_size, uint32_t block_count, uint32_t magazine_size, uint32_t magazine_count)
 : blocks_(0)
 , next_(0)
 , block_size_(0)
 , block_count_(0)
+, depot_next_(0)
+, magazines_(0)
+, magazine_blocks_(0)
+, magazine_size_(0)
+, magazine_count_(0)
 {
-  initialize(block_size, block_count);
+  initialize(block_size, block_count, magazine_size, magazine_count);
 }
 
 FreeList::~FreeList()
@@ -65,11 +85,28 @@ FreeList::~FreeList()
     next_[i].~atomic_uint32_t();
   }
 
+  if (magazines_)
+  {
+    for (uint32_t i = 0; i < block_count_; ++i)
+    {
+      depot_next_[i].~atomic_uint32_t();
+    }
+
+    for (uint32_t i = 0; i < magazine_count_; ++i)
+    {
+      magazines_[i].~Magazine();
+    }
+
+    allocators::alignedFree(depot_next_);
+    allocators::alignedFree(magazines_);
+    allocators::alignedFree(magazine_blocks_);
+  }
+
   allocators::alignedFree(blocks_);
   allocators::alignedFree(next_);
 }
 
-void FreeList::initialize(uint32_t block_size, uint32_t block_count)
+void FreeList::initialize(uint32_t block_size, uint32_t block_count, uint32_t magazine_size, uint32_t magazine_count)
 {
   ROS_ASSERT(!blocks_);
   ROS_ASSERT(!next_);
@@ -98,21 +135,156 @@ void FreeList::initialize(uint32_t block_size, uint32_t block_count)
       next_[i].store(i + 1);
     }
   }
+
+  depot_head_.store(END);
+
+  if (magazine_size > 0 && magazine_count > 0)
+  {
+    magazine_size_ = magazine_size;
+    magazine_count_ = magazine_count;
+
+    depot_next_ = (atomic_uint32_t*)allocators::alignedMalloc(sizeof(atomic_uint32_t) * block_count, ROSRT_CACHELINE_SIZE);
+    for (uint32_t i = 0; i < block_count_; ++i)
+    {
+      new (depot_next_ + i) atomic_uint32_t(END);
+    }
+
+    // every magazine holds up to two batches, so a thread alternating between allocate() and free()
+    // at a batch boundary does not exchange a batch on every call
+    magazine_blocks_ = (uint32_t*)allocators::alignedMalloc(sizeof(uint32_t) * 2 * magazine_size * magazine_count, ROSRT_CACHELINE_SIZE);
+    magazines_ = (Magazine*)allocators::alignedMalloc(sizeof(Magazine) * magazine_count, ROSRT_CACHELINE_SIZE);
+    for (uint32_t i = 0; i < magazine_count_; ++i)
+    {
+      new (magazines_ + i) Magazine();
+      magazines_[i].owner.store(0);
+      magazines_[i].count.store(0);
+      magazines_[i].blocks = magazine_blocks_ + i * 2 * magazine_size;
+    }
+  }
 }
 
 bool FreeList::hasOutstandingAllocations()
 {
-  return alloc_count_.load() == 0;
+  uint32_t cached = 0;
+  for (uint32_t i = 0; i < magazine_count_; ++i)
+  {
+    cached += magazines_[i].count.load();
+  }
+
+  return alloc_count_.load() - cached == 0;
 }
 
 void* FreeList::allocate()
+{
+  ROS_ASSERT(blocks_);
+
+  Magazine* mag = getMagazine(true);
+  if (mag)
+  {
+    uint32_t count = mag->count.load(memory_order_relaxed);
+    if (count == 0)
+    {
+      count = refillMagazine(*mag);
+      if (count == 0)
+      {
+        return 0;  // Allocation failed
+      }
+    }
+
+    --count;
+    uint32_t index = mag->blocks[count];
+    mag->count.store(count, memory_order_relaxed);
+    return static_cast<void*>(blocks_ + (block_size_ * index));
+  }
+
+  uint32_t index = pop();
+  if (index == END && magazines_)
+  {
+    // the list is empty, but threads with a magazine might have returned whole batches to the depot
+    index = popBatch();
+    if (index != END && next_[index].load() != END)
+    {
+      uint32_t last = next_[index].load();
+      while (next_[last].load() != END)
+      {
+        last = next_[last].load();
+      }
+      push(next_[index].load(), last);
+    }
+  }
+
+  if (index == END)
+  {
+    return 0;  // Allocation failed
+  }
+
+  alloc_count_.fetch_add(1);
+  return static_cast<void*>(blocks_ + (block_size_ * index));
+}
+
+void FreeList::free(void const* mem)
+{
+  if (!mem)
+  {
+    return;
+  }
+
+  uint32_t index = (static_cast<uint8_t const*>(mem) - blocks_) / block_size_;
+
+  ROS_ASSERT(((static_cast<uint8_t const*>(mem) - blocks_) % block_size_) == 0);
+  ROS_ASSERT(owns(mem));
+
+  Magazine* mag = getMagazine(true);
+  if (mag)
+  {
+    uint32_t count = mag->count.load(memory_order_relaxed);
+    if (count == 2 * magazine_size_)
+    {
+      // hand the oldest batch to the depot, the most recently freed blocks are the ones still in cache
+      pushBatch(mag->blocks, magazine_size_);
+      count -= magazine_size_;
+      memmove(mag->blocks, mag->blocks + magazine_size_, sizeof(uint32_t) * count);
+    }
+
+    mag->blocks[count] = index;
+    mag->count.store(count + 1, memory_order_relaxed);
+    return;
+  }
+
+  push(index, index);
+  alloc_count_.fetch_sub(1);
+}
+
+void FreeList::flushMagazine()
+{
+  Magazine* mag = getMagazine(false);
+  if (!mag)
+  {
+    return;
+  }
+
+  uint32_t count = mag->count.load(memory_order_relaxed);
+  if (count > 0)
+  {
+    pushBatch(mag->blocks, count);
+  }
+
+  mag->count.store(0);
+  mag->owner.store(0);
+}
+
+bool FreeList::owns(void const* mem)
+{
+  uint32_t sub = (static_cast<uint8_t const*>(mem) - blocks_);
+  return sub < block_count_ * block_size_;
+}
+
+uint32_t FreeList::pop()
 {
 #if FREE_LIST_DEBUG
   initDebug();
 #endif
 
-  ROS_ASSERT(blocks_);
-
   while (true)
   {
     uint64_t head = head_.load(memory_order_consume);
@@ -129,7 +301,7 @@ void* FreeList::allocate()
 #if FREE_LIST_DEBUG
       debug_->items.push_back(i);
 #endif
-      return 0;  // Allocation failed
+      return END;
     }
 
     FREELIST_DEBUG_YIELD();
@@ -156,8 +328,7 @@ void* FreeList::allocate()
       i.success = 1;
       debug_->items.push_back(i);
 #endif
-      alloc_count_.fetch_add(1);
-      return static_cast<void*>(blocks_ + (block_size_ * getVal(head)));
+      return getVal(head);
     }
 
 #if FREE_LIST_DEBUG
@@ -167,22 +338,12 @@ void* FreeList::allocate()
   }
 }
 
-void FreeList::free(void const* mem)
+void FreeList::push(uint32_t first, uint32_t last)
 {
-  if (!mem)
-  {
-    return;
-  }
-
 #if FREE_LIST_DEBUG
   initDebug();
 #endif
 
-  uint32_t index = (static_cast<uint8_t const*>(mem) - blocks_) / block_size_;
-
-  ROS_ASSERT(((static_cast<uint8_t const*>(mem) - blocks_) % block_size_) == 0);
-  ROS_ASSERT(owns(mem));
-
   while (true)
   {
     // Load head
@@ -198,16 +359,16 @@ void FreeList::free(void const* mem)
     FREELIST_DEBUG_YIELD();
 
     uint64_t new_head = head;
-    // set new head to the index of the block we're currently freeing
-    setVal(new_head, index);
+    // set new head to the first block of the chain we're currently freeing
+    setVal(new_head, first);
     // Increment the tag to avoid ABA
     setTag(new_head, getTag(new_head) + 1);
 
 
     FREELIST_DEBUG_YIELD();
 
-    // Store head as next index for this item
-    next_[index].store(getVal(head));
+    // Store head as next index for the last block of the chain
+    next_[last].store(getVal(head));
 
     FREELIST_DEBUG_YIELD();
 
@@ -222,10 +383,9 @@ void FreeList::free(void const* mem)
     {
 #if FREE_LIST_DEBUG
       i.success = 1;
-      i.addr = blocks_ + (block_size_ * index);
+      i.addr = blocks_ + (block_size_ * first);
       debug_->items.push_back(i);
 #endif
-      alloc_count_.fetch_sub(1);
       return;
     }
 
@@ -236,10 +396,134 @@ void FreeList::free(void const* mem)
   }
 }
 
-bool FreeList::owns(void const* mem)
+uint32_t FreeList::popBatch()
 {
-  uint32_t sub = (static_cast<uint8_t const*>(mem) - blocks_);
-  return sub < block_count_ * block_size_;
+  while (true)
+  {
+    uint64_t head = depot_head_.load(memory_order_consume);
+    if (getVal(head) == END)
+    {
+      return END;
+    }
+
+    uint64_t new_head = depot_next_[getVal(head)].load();
+    setTag(new_head, getTag(head) + 1);
+
+    if (depot_head_.compare_exchange_strong(head, new_head))
+    {
+      return getVal(head);
+    }
+  }
+}
+
+void FreeList::pushBatch(const uint32_t* indices, uint32_t count)
+{
+  // link the batch through next_, it stays linked while it sits in the depot
+  for (uint32_t i = 0; i + 1 < count; ++i)
+  {
+    next_[indices[i]].store(indices[i + 1]);
+  }
+  next_[indices[count - 1]].store(END);
+
+  while (true)
+  {
+    uint64_t head = depot_head_.load(memory_order_consume);
+
+    uint64_t new_head = head;
+    setVal(new_head, indices[0]);
+    setTag(new_head, getTag(head) + 1);
+
+    depot_next_[indices[0]].store(getVal(head));
+
+    if (depot_head_.compare_exchange_strong(head, new_head))
+    {
+      break;
+    }
+  }
+
+  alloc_count_.fetch_sub(count);
+}
+
+uint32_t FreeList::refillMagazine(Magazine& mag)
+{
+  uint32_t count = 0;
+
+  uint32_t index = popBatch();
+  if (index != END)
+  {
+    for (; index != END; index = next_[index].load())
+    {
+      mag.blocks[count++] = index;
+    }
+  }
+  else
+  {
+    // no batch in the depot, take single blocks from the list
+    while (count < magazine_size_)
+    {
+      index = pop();
+      if (index == END)
+      {
+        break;
+      }
+
+      mag.blocks[count++] = index;
+    }
+  }
+
+  if (count > 0)
+  {
+    alloc_count_.fetch_add(count);
+  }
+
+  mag.count.store(count, memory_order_relaxed);
+  return count;
+}
+
+uint32_t FreeList::getThreadId()
+{
+  if (g_thread_id == 0)
+  {
+    g_thread_id = g_thread_count.fetch_add(1) + 1;
+  }
+
+  return g_thread_id;
+}
+
+FreeList::Magazine* FreeList::getMagazine(bool claim)
+{
+  if (!magazines_)
+  {
+    return 0;
+  }
+
+  // probing starts at a per-thread slot, so a thread usually finds its magazine with the first load
+  uint32_t id = getThreadId();
+  uint32_t start = id % magazine_count_;
+  for (uint32_t i = 0; i < magazine_count_; ++i)
+  {
+    Magazine* mag = magazines_ + ((start + i) % magazine_count_);
+    if (mag->owner.load(memory_order_relaxed) == id)
+    {
+      return mag;
+    }
+  }
+
+  if (claim)
+  {
+    for (uint32_t i = 0; i < magazine_count_; ++i)
+    {
+      Magazine* mag = magazines_ + ((start + i) % magazine_count_);
+      uint32_t unowned = 0;
+      if (mag->owner.load(memory_order_relaxed) == 0 && mag->owner.compare_exchange_strong(unowned, id))
+      {
+        return mag;
+      }
+    }
+  }
+
+  // more threads than magazines, use the list directly
+  return 0;
 }
 
 } // namespace lockfree
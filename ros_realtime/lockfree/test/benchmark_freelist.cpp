@@ -0,0 +1,119 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2010, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+/*
+ * Contention benchmark for FreeList: every thread repeatedly allocates a burst of blocks
+ * and frees them again, once through the shared head CAS and once through per-thread magazines.
+ *
+ * Usage: benchmark_freelist [duration per run in seconds] [magazine size]
+ */
+
+#include "lockfree/free_list.h"
+
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include "ros/time.h"
+
+using namespace lockfree;
+
+static const uint32_t BURST = 8;
+
+void benchThread(FreeList& pool, ros::atomic<bool>& done, ros::atomic<uint64_t>& ops, boost::barrier& b)
+{
+  void* blocks[BURST];
+  uint64_t local_ops = 0;
+
+  b.wait();
+
+  while (!done.load(ros::memory_order_relaxed))
+  {
+    for (uint32_t i = 0; i < BURST; ++i)
+    {
+      blocks[i] = pool.allocate();
+    }
+
+    for (uint32_t i = 0; i < BURST; ++i)
+    {
+      if (blocks[i])
+      {
+        pool.free(blocks[i]);
+        local_ops += 2;
+      }
+    }
+  }
+
+  pool.flushMagazine();
+  ops.fetch_add(local_ops);
+}
+
+double run(uint32_t thread_count, uint32_t magazine_size, double duration)
+{
+  FreeList pool(64, thread_count * (BURST + 2 * magazine_size), magazine_size, magazine_size > 0 ? thread_count : 0);
+  ros::atomic<bool> done(false);
+  ros::atomic<uint64_t> ops(0);
+  boost::barrier bar(thread_count + 1);
+  boost::thread_group tg;
+  for (uint32_t i = 0; i < thread_count; ++i)
+  {
+    tg.create_thread(boost::bind(benchThread, boost::ref(pool), boost::ref(done), boost::ref(ops), boost::ref(bar)));
+  }
+
+  bar.wait();
+  ros::WallTime start = ros::WallTime::now();
+  ros::WallDuration(duration).sleep();
+  done.store(true);
+  tg.join_all();
+  double elapsed = (ros::WallTime::now() - start).toSec();
+
+  return ops.load() / elapsed;
+}
+
+int main(int argc, char** argv)
+{
+  double duration = argc > 1 ? atof(argv[1]) : 1.0;
+  uint32_t magazine_size = argc > 2 ? atoi(argv[2]) : 16;
+
+  printf("%8s %20s %20s %8s\n", "threads", "head CAS [Mops/s]", "magazines [Mops/s]", "speedup");
+  for (uint32_t thread_count = 1; thread_count <= 16; thread_count *= 2)
+  {
+    double cas = run(thread_count, 0, duration);
+    double mag = run(thread_count, magazine_size, duration);
+    printf("%8u %20.2f %20.2f %8.2f\n", thread_count, cas * 1e-6, mag * 1e-6, mag / cas);
+  }
+
+  return 0;
+}
@@ -175,6 +175,14 @@ void threadFunc(FreeList& pool, ros::atomic<bool>& done, ros::atomic<bool>& fail
   //ROS_INFO_STREAM("Thread " << boost::this_thread::get_id() << " allocated " << alloc_count << " blocks");
 }
 
+void allocateAll(FreeList& pool, uint32_t& allocated)
+{
+  while (pool.allocate())
+  {
+    ++allocated;
+  }
+}
+
 TEST(FreeList, multipleThreads)
 {
   const uint32_t thread_count = boost::thread::hardware_concurrency() * 2;
@@ -264,6 +272,59 @@ TEST(FreeList, hasOutstandingAllocations)
   ASSERT_TRUE(pool.hasOutstandingAllocations());
 }
 
+TEST(FreeList, magazines)
+{
+  const uint32_t count = 20;
+  FreeList pool(4, count, 4, 2);
+
+  std::vector<uint32_t*> items;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    items.push_back(static_cast<uint32_t*>(pool.allocate()));
+    ASSERT_TRUE(items.back());
+  }
+  ASSERT_FALSE(pool.allocate());
+
+  std::set<uint32_t*> set;
+  set.insert(items.begin(), items.end());
+  EXPECT_EQ(set.size(), count);
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    pool.free(items[i]);
+  }
+  ASSERT_TRUE(pool.hasOutstandingAllocations());
+
+  // blocks cached in this thread's magazine only become available to other threads after a flush
+  pool.flushMagazine();
+  uint32_t allocated = 0;
+  boost::thread t(boost::bind(allocateAll, boost::ref(pool), boost::ref(allocated)));
+  t.join();
+  EXPECT_EQ(allocated, count);
+}
+
+TEST(FreeList, multipleThreadsMagazines)
+{
+  const uint32_t thread_count = boost::thread::hardware_concurrency() * 2;
+  const uint32_t magazine_size = 8;
+  // every magazine can cache up to two batches on top of the blocks its thread holds
+  FreeList pool(4, thread_count * (10 + 2 * magazine_size), magazine_size, thread_count);
+  ros::atomic<bool> done(false);
+  ros::atomic<bool> failed(false);
+  boost::thread_group tg;
+  boost::barrier bar(thread_count);
+  for (uint32_t i = 0; i < thread_count; ++i)
+  {
+    tg.create_thread(boost::bind(threadFunc, boost::ref(pool), boost::ref(done), boost::ref(failed), boost::ref(bar)));
+  }
+
+  ros::WallDuration(5.0).sleep();
+  done.store(true);
+  tg.join_all();
+
+  ASSERT_TRUE(!failed.load());
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -36,6 +36,8 @@
 
 #include "lockfree/object_pool.h"
 
+#include <boost/weak_ptr.hpp>
+
 #include <set>
 
 using namespace lockfree;
@@ -82,6 +84,156 @@ TEST(ObjectPool, multipleElements)
   EXPECT_EQ(set.size(), count);
 }
 
+TEST(ObjectPool, growth)
+{
+  ObjectPool<uint32_t> pool;
+  pool.initialize(4, 5, 3, 1);
+  EXPECT_EQ(pool.getSegmentCount(), 1UL);
+  EXPECT_EQ(pool.getCapacity(), 4UL);
+
+  std::vector<boost::shared_ptr<uint32_t> > items;
+  for (uint32_t i = 0; i < 3; ++i)
+  {
+    items.push_back(pool.allocateShared());
+    ASSERT_TRUE(items.back());
+  }
+  EXPECT_FALSE(pool.isGrowRequested());
+
+  // crossing the low-water mark requests a segment, which only appears once it's grown
+  items.push_back(pool.allocateShared());
+  ASSERT_TRUE(items.back());
+  EXPECT_TRUE(pool.isGrowRequested());
+  ASSERT_FALSE(pool.allocateShared());
+  EXPECT_EQ(pool.getExhaustionCount(), 1UL);
+
+  ASSERT_TRUE(pool.growIfNeeded());
+  EXPECT_FALSE(pool.growIfNeeded());
+  EXPECT_EQ(pool.getSegmentCount(), 2UL);
+  EXPECT_EQ(pool.getCapacity(), 8UL);
+
+  for (uint32_t i = 0; i < 4; ++i)
+  {
+    items.push_back(pool.allocateShared());
+    ASSERT_TRUE(items.back());
+    EXPECT_EQ(*items.back(), 5UL);
+  }
+  EXPECT_EQ(pool.getHighWater(), 8UL);
+  EXPECT_EQ(pool.getInUse(), 8UL);
+
+  ASSERT_TRUE(pool.grow());
+  ASSERT_FALSE(pool.grow());
+  EXPECT_EQ(pool.getSegmentCount(), 3UL);
+
+  std::set<boost::shared_ptr<uint32_t> > set;
+  set.insert(items.begin(), items.end());
+  EXPECT_EQ(set.size(), 8UL);
+
+  set.clear();
+  items.clear();
+  EXPECT_EQ(pool.getInUse(), 0UL);
+  EXPECT_EQ(pool.getHighWater(), 8UL);
+}
+
+static uint32_t g_grow_requests = 0;
+
+void countGrowRequest(void* arg, void const* pool)
+{
+  ++g_grow_requests;
+}
+
+TEST(ObjectPool, growCallback)
+{
+  g_grow_requests = 0;
+  ObjectPool<uint32_t> pool;
+  pool.initialize(2, 5, 2, 1);
+  pool.setGrowCallback(countGrowRequest, &pool);
+
+  boost::shared_ptr<uint32_t> first = pool.allocateShared();
+  EXPECT_EQ(g_grow_requests, 0UL);
+
+  // called once per request, not on every allocation while the request is pending
+  boost::shared_ptr<uint32_t> second = pool.allocateShared();
+  ASSERT_FALSE(pool.allocateShared());
+  EXPECT_EQ(g_grow_requests, 1UL);
+
+  ASSERT_TRUE(pool.growIfNeeded());
+  boost::shared_ptr<uint32_t> third = pool.allocateShared();
+  boost::shared_ptr<uint32_t> fourth = pool.allocateShared();
+  ASSERT_TRUE(fourth);
+
+  // the pool can't grow any further, so nothing is requested
+  ASSERT_FALSE(pool.allocateShared());
+  EXPECT_FALSE(pool.isGrowRequested());
+  EXPECT_EQ(g_grow_requests, 1UL);
+}
+
+TEST(ObjectPool, fixedSizeDoesNotGrow)
+{
+  ObjectPool<uint32_t> pool(1, 5);
+  boost::shared_ptr<uint32_t> item = pool.allocateShared();
+  ASSERT_FALSE(pool.allocateShared());
+  EXPECT_FALSE(pool.growIfNeeded());
+  EXPECT_FALSE(pool.grow());
+  EXPECT_EQ(pool.getSegmentCount(), 1UL);
+}
+
+static uint32_t g_frees = 0;
+static uint32_t g_frees_while_deletable = 0;
+
+void countFree(void* arg, void const* pool)
+{
+  ++g_frees;
+  // a garbage collector checks the pool when it's called, so nothing may be left allocated by then
+  if (static_cast<ObjectPool<uint32_t>*>(arg)->hasOutstandingAllocations())
+  {
+    ++g_frees_while_deletable;
+  }
+}
+
+TEST(ObjectPool, deletableOnlyOnceControlBlockIsFreed)
+{
+  ObjectPool<uint32_t> pool(2, 5);
+  EXPECT_TRUE(pool.hasOutstandingAllocations());
+
+  boost::shared_ptr<uint32_t> item = pool.allocateShared();
+  EXPECT_FALSE(pool.hasOutstandingAllocations());
+
+  // the weak pointer keeps the control block after the object has been returned
+  boost::weak_ptr<uint32_t> weak = item;
+  item.reset();
+  EXPECT_EQ(pool.getInUse(), 0UL);
+  EXPECT_FALSE(pool.hasOutstandingAllocations());
+
+  weak.reset();
+  EXPECT_TRUE(pool.hasOutstandingAllocations());
+}
+
+TEST(ObjectPool, freeCallbackAfterControlBlock)
+{
+  g_frees = 0;
+  g_frees_while_deletable = 0;
+  ObjectPool<uint32_t> pool(2, 5);
+  pool.setFreeCallback(countFree, &pool);
+
+  boost::shared_ptr<uint32_t> item = pool.allocateShared();
+  boost::weak_ptr<uint32_t> weak = item;
+  item.reset();
+  EXPECT_EQ(g_frees, 0UL);
+  weak.reset();
+  EXPECT_EQ(g_frees, 1UL);
+  EXPECT_EQ(g_frees_while_deletable, 1UL);
+
+  item = pool.allocateShared();
+  item.reset();
+  EXPECT_EQ(g_frees, 2UL);
+  EXPECT_EQ(g_frees_while_deletable, 2UL);
+
+  uint32_t* bare = pool.allocate();
+  pool.free(bare);
+  EXPECT_EQ(g_frees, 3UL);
+  EXPECT_EQ(g_frees_while_deletable, 3UL);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -34,11 +34,14 @@
 #include <boost/thread/exceptions.hpp>
 #include <boost/thread/locks.hpp>
 #include <rosrt/detail/mutex.h>
+#include <ros/time.h>
+#include <errno.h>
 
 #ifdef __XENO__
 #include <native/cond.h>
 #else
 #include <boost/thread/condition_variable.hpp>
+#include <time.h>
 #endif
 
 namespace rosrt
@@ -93,6 +96,31 @@ public:
 #endif
   }
 
+  /**
+   * Waits until notified or until timeout has passed.
+   * \return false on timeout
+   */
+  bool timed_wait(boost::unique_lock<mutex>& m, const ros::WallDuration& timeout)
+  {
+#ifdef __XENO__
+    rosrt::mutex::native_handle_type native_mutex = m.mutex()->native_handle();
+    int const res = rt_cond_wait(&cond_, native_mutex, timeout.toNSec());
+    BOOST_VERIFY(!res || res == -ETIMEDOUT);
+    return res != -ETIMEDOUT;
+#else
+    pthread_cond_t* native_cond = cond_.native_handle();
+    pthread_mutex_t* native_mutex = m.mutex()->native_handle();
+    timespec abs_time;
+    clock_gettime(CLOCK_REALTIME, &abs_time);
+    int64_t nsec = abs_time.tv_nsec + timeout.toNSec();
+    abs_time.tv_sec += nsec / 1000000000LL;
+    abs_time.tv_nsec = nsec % 1000000000LL;
+    int const res = pthread_cond_timedwait(native_cond, native_mutex, &abs_time);
+    BOOST_VERIFY(!res || res == ETIMEDOUT);
+    return res != ETIMEDOUT;
+#endif
+  }
+
   template<typename predicate_type>
   void wait(boost::unique_lock<mutex>& m, predicate_type pred)
   {
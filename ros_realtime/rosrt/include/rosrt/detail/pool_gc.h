@@ -54,9 +54,43 @@ void deletePool(void* pool)
   delete ((lockfree::ObjectPool<M>*)pool);
 }
 
+typedef void(*PoolFreeCallback)(void* arg, void const* pool);
+
+template<typename M>
+void setPoolFreeCallback(void* pool, PoolFreeCallback callback, void* arg)
+{
+  ((lockfree::ObjectPool<M>*)pool)->setFreeCallback(callback, arg);
+}
+
+template<typename M>
+void setPoolGrowCallback(void* pool, PoolFreeCallback callback, void* arg)
+{
+  ((lockfree::ObjectPool<M>*)pool)->setGrowCallback(callback, arg);
+}
+
+template<typename M>
+bool growPool(void* pool)
+{
+  return ((lockfree::ObjectPool<M>*)pool)->growIfNeeded();
+}
+
 typedef void(*PoolDeleteFunc)(void* pool);
 typedef bool(*PoolDeletableFunc)(void* pool);
-void addPoolToGC(void* pool, PoolDeleteFunc deleter, PoolDeletableFunc deletable);
+typedef bool(*PoolGrowFunc)(void* pool);
+typedef void(*PoolSetFreeCallbackFunc)(void* pool, PoolFreeCallback callback, void* arg);
+/**
+ * \brief Hands a pool to the gc thread, which deletes it once it has no outstanding allocations.
+ * With set_free_callback the gc thread is told about every object freed to the pool, so it only
+ * checks the pool again after something was freed
+ */
+void addPoolToGC(void* pool, PoolDeleteFunc deleter, PoolDeletableFunc deletable,
+                 PoolSetFreeCallbackFunc set_free_callback = 0);
+/**
+ * \brief Lets the gc thread add segments to a growable pool when it requests them.  The pool must
+ * be handed to addPoolToGC() once it's no longer used.  With set_grow_callback an event driven gc
+ * thread is woken as soon as the pool requests a segment
+ */
+void addPoolToGrower(void* pool, PoolGrowFunc grow, PoolSetFreeCallbackFunc set_grow_callback = 0);
 
 } // namespace detail
 } // namespace rosrt
@@ -45,6 +45,8 @@
 #include <rosrt/detail/mutex.h>
 #include <rosrt/detail/condition_variable.h>
 
+#include <vector>
+
 namespace rosrt
 {
 
@@ -72,22 +74,38 @@ private:
   MWSRQueue<PubItem> queue_;
 };
 
+/**
+ * Publishes queued messages from a pool of threads.  Each thread owns its own queue,
+ * a message goes to the thread selected by its shard, so all messages of one
+ * rosrt::Publisher are published by the same thread and stay in order.
+ */
 class PublisherManager
 {
 public:
   PublisherManager(const InitOptions& ops);
   ~PublisherManager();
-  bool publish(const ros::Publisher& pub, const VoidConstPtr& msg, PublishFunc pub_func, CloneFunc clone_func);
+  bool publish(const ros::Publisher& pub, const VoidConstPtr& msg, PublishFunc pub_func, CloneFunc clone_func,
+               uint32_t shard = 0);
+
+  uint32_t getThreadCount() const { return workers_.size(); }
 
 private:
-  void publishThread();
+  struct Worker
+  {
+    Worker(uint32_t queue_size);
+    ~Worker();
+
+    PublishQueue queue;
+    rosrt::condition_variable cond;
+    rosrt::mutex cond_mutex;
+    ros::atomic<uint32_t> pub_count;
+    rosrt::thread* pub_thread;
+  };
+
+  void publishThread(Worker* worker);
 
-  PublishQueue queue_;
-  rosrt::condition_variable cond_;
-  rosrt::mutex cond_mutex_;
-  ros::atomic<uint32_t> pub_count_;
+  std::vector<Worker*> workers_;
   volatile bool running_;
-  rosrt::thread pub_thread_;
 };
 
 } // namespace detail
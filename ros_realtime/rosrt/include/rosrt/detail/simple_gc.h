@@ -39,7 +39,10 @@
 
 #include <ros/atomic.h>
 #include <lockfree/object_pool.h>
-#include <boost/thread/thread.hpp>
+#include <rosrt/detail/thread.h>
+#include <rosrt/detail/mutex.h>
+#include <rosrt/detail/condition_variable.h>
+#include <ros/time.h>
 
 namespace rosrt
 {
@@ -54,27 +57,50 @@ class SimpleGC
 public:
   typedef void(*DeleteFunc)(void* pool);
   typedef bool(*IsDeletableFunc)(void* pool);
+  typedef bool(*GrowFunc)(void* pool);
+  typedef void(*FreeCallback)(void* arg, void const* pool);
+  typedef void(*SetFreeCallbackFunc)(void* pool, FreeCallback callback, void* arg);
 
   SimpleGC(const InitOptions& ops);
   ~SimpleGC();
 
-  void add(void* pool, DeleteFunc deleter, IsDeletableFunc deletable);
+  void add(void* pool, DeleteFunc deleter, IsDeletableFunc deletable, SetFreeCallbackFunc set_free_callback = 0);
+  void addGrowable(void* pool, GrowFunc grow, SetFreeCallbackFunc set_grow_callback = 0);
+
+  /**
+   * \brief Wakes the gc thread if it's event driven.  Realtime-safe
+   */
+  void notify();
 
 private:
   void gcThread();
 
   volatile bool running_;
+  bool event_driven_;
 
   struct PoolGCItem
   {
     void* pool;
     DeleteFunc deleter;
     IsDeletableFunc is_deletable;
+    GrowFunc grow; // set for growable pools, which use the same queue so they are always registered before they are deleted
+    SetFreeCallbackFunc set_free_callback; // for growable pools, sets the callback for grow requests instead
   };
 
-  boost::thread pool_gc_thread_;
+  static void poolFreed(void* arg, void const* pool);
+  static void growRequested(void* arg, void const* pool);
+
   MWSRQueue<PoolGCItem> pool_gc_queue_;
-  float period_;
+  // pools that freed objects since the gc thread last checked, only filled if event driven
+  MWSRQueue<void const*> dirty_queue_;
+  ros::atomic<bool> dirty_overflow_;
+  ros::WallDuration period_;
+
+  rosrt::mutex cond_mutex_;
+  rosrt::condition_variable cond_;
+  ros::atomic<uint32_t> pending_;
+
+  rosrt::thread pool_gc_thread_;
 };
 
 } // namespace detail
@@ -36,11 +36,16 @@
 #define ROSRT_THREAD_H_
 
 #include <boost/utility.hpp>
+#include <boost/function.hpp>
+#include <ros/console.h>
+#include <sched.h>
 
 #ifdef __XENO__
 #include <native/task.h>
 #else
 #include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <pthread.h>
 #endif
 
 extern "C"
@@ -56,6 +61,11 @@ namespace rosrt
  * Thin wrapper for a "real-time" thread, implementation differs based on platform.
  * Falls back to boost::thread on generic platforms.
  *
+ * The short constructor keeps the original behaviour: Xenomai tasks are pinned to
+ * cpu_id, generic threads run unpinned with default scheduling.  The long one applies
+ * affinity and scheduling on all platforms, a cpu_id < 0 leaves the thread unpinned.
+ * sched_policy is only used on generic platforms (SCHED_OTHER, SCHED_FIFO or SCHED_RR),
+ * Xenomai tasks always run under the Xenomai scheduler with priority sched_priority.
  */
 class thread: boost::noncopyable
 {
@@ -71,18 +81,18 @@ public:
   explicit thread(boost::function<void ()> thread_fn, const char* name="", const int cpu_id=0)
   {
 #ifdef __XENO__
-    thread_fn_ = thread_fn;
-    int error_code;
-    if (error_code = rt_task_spawn(&thread_, name, 0, 0, T_FPU | T_JOINABLE | T_CPU(cpu_id), thread_proxy, &thread_fn_))
-    {
-      ROS_ERROR("rosrt::thread - Couldn't spawn xenomai thread %s, error code = %d", name, error_code);
-    }
-    //thread_proxy(&thread_fn_);
+    start(thread_fn, name, cpu_id, SCHED_OTHER, 0);
 #else
     thread_ = boost::thread(thread_fn);
 #endif
   }
 
+  thread(boost::function<void ()> thread_fn, const char* name, const int cpu_id,
+         const int sched_policy, const int sched_priority)
+  {
+    start(thread_fn, name, cpu_id, sched_policy, sched_priority);
+  }
+
   ~thread()
   {
   }
@@ -95,6 +105,57 @@ public:
     thread_.join();
 #endif
   }
+
+private:
+  void start(boost::function<void ()> thread_fn, const char* name, const int cpu_id,
+             const int sched_policy, const int sched_priority)
+  {
+#ifdef __XENO__
+    thread_fn_ = thread_fn;
+    int mode = T_FPU | T_JOINABLE;
+    if (cpu_id >= 0)
+    {
+      mode |= T_CPU(cpu_id);
+    }
+    int error_code;
+    if (error_code = rt_task_spawn(&thread_, name, 0, sched_priority, mode, thread_proxy, &thread_fn_))
+    {
+      ROS_ERROR("rosrt::thread - Couldn't spawn xenomai thread %s, error code = %d", name, error_code);
+    }
+#else
+    thread_ = boost::thread(boost::bind(&thread::run, thread_fn, std::string(name), cpu_id, sched_policy, sched_priority));
+#endif
+  }
+
+#ifndef __XENO__
+  // applies affinity and scheduling from inside the new thread, before thread_fn runs
+  static void run(boost::function<void ()> thread_fn, std::string name, int cpu_id, int sched_policy, int sched_priority)
+  {
+    if (cpu_id >= 0)
+    {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(cpu_id, &cpus);
+      if (int error_code = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus))
+      {
+        ROS_WARN("rosrt::thread - Couldn't pin thread %s to cpu %d, error code = %d", name.c_str(), cpu_id, error_code);
+      }
+    }
+
+    if (sched_policy != SCHED_OTHER)
+    {
+      sched_param param;
+      param.sched_priority = sched_priority;
+      if (int error_code = pthread_setschedparam(pthread_self(), sched_policy, &param))
+      {
+        ROS_WARN("rosrt::thread - Couldn't set scheduling policy %d, priority %d of thread %s, error code = %d",
+                 sched_policy, sched_priority, name.c_str(), error_code);
+      }
+    }
+
+    thread_fn();
+  }
+#endif
 };
 
 }
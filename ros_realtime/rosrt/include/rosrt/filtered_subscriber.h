@@ -121,7 +121,8 @@ public:
       filtered_pool_->free(latest);
     }
 
-    detail::addPoolToGC((void*)filtered_pool_, detail::deletePool<Filtered>, detail::poolIsDeletable<Filtered>);
+    detail::addPoolToGC((void*)filtered_pool_, detail::deletePool<Filtered>, detail::poolIsDeletable<Filtered>,
+                          detail::setPoolFreeCallback<Filtered>);
   }
 
   /**
@@ -39,6 +39,9 @@
 #include <ros/types.h>
 #include <ros/time.h>
 
+#include <vector>
+#include <sched.h>
+
 namespace rosrt
 {
 
@@ -46,13 +49,29 @@ struct InitOptions
 {
   InitOptions()
   : pubmanager_queue_size(10000)
+  , pubmanager_thread_count(1)
+  , pubmanager_sched_policy(SCHED_OTHER)
+  , pubmanager_sched_priority(0)
   , gc_queue_size(1000)
   , gc_period(0.1)
+  , gc_event_driven(false)
   {}
 
+  /// Size of the queue of each publisher thread
   uint32_t pubmanager_queue_size;
+  /// Number of publisher threads, publishers are distributed over them round-robin
+  uint32_t pubmanager_thread_count;
+  /// CPU of each publisher thread, reused cyclically if shorter than the thread count.  Empty leaves the threads unpinned
+  std::vector<int> pubmanager_cpu_affinity;
+  /// Scheduling policy of the publisher threads (SCHED_OTHER, SCHED_FIFO, SCHED_RR), ignored under Xenomai
+  int pubmanager_sched_policy;
+  /// Scheduling priority of the publisher threads
+  int pubmanager_sched_priority;
   uint32_t gc_queue_size;
+  /// Period of the gc thread, or its longest sleep if gc_event_driven is set
   ros::WallDuration gc_period;
+  /// Wake the gc thread whenever a pool waiting for deletion frees an object, and only check those pools
+  bool gc_event_driven;
 };
 
 void init(const InitOptions& ops = InitOptions());
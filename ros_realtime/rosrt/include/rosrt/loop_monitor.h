@@ -0,0 +1,174 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2010, CLMC Lab, University of Southern California
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#ifndef ROSRT_LOOP_MONITOR_H
+#define ROSRT_LOOP_MONITOR_H
+
+#include <ros/atomic.h>
+#include <ros/ros.h>
+#include <rosrt/publisher.h>
+#include <rosrt/LoopStatistics.h>
+
+#include <boost/thread.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <string>
+#include <vector>
+
+namespace rosrt
+{
+
+/**
+ * \brief Lock-free, fixed-memory cycle time, jitter and deadline instrumentation for a realtime loop.
+ *
+ * The loop calls startCycle() at the beginning and endCycle() at the end of every cycle.  Both only
+ * update counters and histograms and write one entry into a trace ring, they never lock or allocate.
+ * A non-realtime thread collects the data with drain(), or startPublishing() spawns one that publishes
+ * rosrt::LoopStatistics through a rosrt::Publisher, e.g.:
+\verbatim
+LoopMonitor monitor("my_controller", 0.001, 0.0008);
+monitor.startPublishing(nh, "loop_statistics", 10.0);
+while (true)
+{
+  monitor.startCycle();
+  // do work
+  monitor.endCycle();
+  // wait for the next period
+}
+\endverbatim
+ *
+ * startCycle() and endCycle() must be called from the loop thread only.  The allocations of a cycle
+ * are taken from the malloc wrappers (see malloc_wrappers.h), so they are only counted if those are linked.
+ */
+class LoopMonitor
+{
+public:
+  /**
+   * \brief Default constructor.  You must call initialize() before using the monitor
+   */
+  LoopMonitor();
+
+  /**
+   * \brief Constructor with initialization, see initialize()
+   */
+  LoopMonitor(const std::string& name, double nominal_period, double deadline, uint32_t trace_size = 1000,
+              uint32_t histogram_bins = 100);
+  ~LoopMonitor();
+
+  /**
+   * \brief Initialize the monitor.  Only use with the default constructor
+   * \param name Name of the loop, reported in the statistics
+   * \param nominal_period The period the loop is supposed to run at, in seconds
+   * \param deadline A cycle whose execution time exceeds the deadline counts as deadline miss, in seconds
+   * \param trace_size The number of cycles the trace ring holds until it is drained
+   * \param histogram_bins The number of bins of each histogram, the bins cover twice the nominal period
+   */
+  void initialize(const std::string& name, double nominal_period, double deadline, uint32_t trace_size = 1000,
+                  uint32_t histogram_bins = 100);
+
+  /**
+   * \brief Marks the start of a cycle.  Realtime-safe
+   */
+  void startCycle();
+
+  /**
+   * \brief Marks the end of a cycle.  Realtime-safe
+   * \return false if the cycle missed its deadline
+   */
+  bool endCycle();
+
+  /**
+   * \brief Moves the traces recorded since the last call into stats and fills in the counters and
+   * histograms.  Not realtime-safe, only call from one thread at a time
+   */
+  void drain(LoopStatistics& stats);
+
+  /**
+   * \brief Spawns a non-realtime thread that drains the monitor and publishes the statistics at the given rate
+   */
+  void startPublishing(ros::NodeHandle& nh, const std::string& topic, double rate);
+
+  /**
+   * \brief Stops the thread spawned by startPublishing()
+   */
+  void stopPublishing();
+
+private:
+  struct TraceEntry
+  {
+    uint64_t cycle;
+    uint64_t start;
+    uint64_t period;
+    uint64_t execution_time;
+    uint32_t allocations;
+    bool deadline_missed;
+  };
+
+  static uint64_t now();
+  uint32_t getBin(uint64_t duration) const;
+  void publishThread(double rate);
+
+  std::string name_;
+  uint64_t nominal_period_;
+  uint64_t deadline_;
+  uint64_t bin_width_;
+
+  // only touched by the loop thread
+  uint64_t cycle_start_;
+  uint64_t cycle_period_;
+  uint64_t cycle_allocations_;
+
+  // written by the loop thread only, read by drain()
+  ros::atomic<uint64_t> cycles_;
+  ros::atomic<uint64_t> deadline_misses_;
+  ros::atomic<uint64_t> allocations_;
+  ros::atomic<uint64_t> trace_overruns_;
+  uint32_t histogram_bins_;
+  boost::scoped_array<ros::atomic<uint64_t> > period_histogram_;
+  boost::scoped_array<ros::atomic<uint64_t> > execution_time_histogram_;
+
+  // single producer, single consumer ring, a full ring drops new entries
+  std::vector<TraceEntry> trace_;
+  ros::atomic<uint32_t> trace_head_;
+  ros::atomic<uint32_t> trace_tail_;
+
+  volatile bool publishing_;
+  boost::scoped_ptr<boost::thread> publish_thread_;
+  boost::scoped_ptr<Publisher<LoopStatistics> > publisher_;
+};
+
+} // namespace rosrt
+
+#endif // ROSRT_LOOP_MONITOR_H
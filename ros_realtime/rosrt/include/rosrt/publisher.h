@@ -59,6 +59,17 @@ void publishMessage(const ros::Publisher& pub, const VoidConstPtr& msg)
   pub.publish(m);
 }
 
+/**
+ * Publishes by reference, the message is serialized during the call and not referenced
+ * afterwards, even by intraprocess subscribers.  Used for messages that go back to their
+ * pool right after publishing.
+ */
+template<typename M>
+void publishMessageSerialized(const ros::Publisher& pub, const VoidConstPtr& msg)
+{
+  pub.publish(*boost::static_pointer_cast<M const>(msg));
+}
+
 template<typename M>
 VoidConstPtr cloneMessage(const VoidConstPtr& msg)
 {
@@ -68,12 +79,24 @@ VoidConstPtr cloneMessage(const VoidConstPtr& msg)
 }
 
 bool publish(const ros::Publisher& pub, const VoidConstPtr& msg, PublishFunc pub_func, CloneFunc clone_func);
+bool publish(const ros::Publisher& pub, const VoidConstPtr& msg, PublishFunc pub_func, CloneFunc clone_func, uint32_t shard);
+
+/**
+ * \brief Returns a new shard for a publisher, which selects the publisher thread its messages go to
+ */
+uint32_t nextPublisherShard();
 
 template<typename M>
 bool publish(const ros::Publisher& pub, const VoidConstPtr& msg)
 {
   return publish(pub, msg, publishMessage<M>, cloneMessage<M>);
 }
+
+template<typename M>
+bool publish(const ros::Publisher& pub, const VoidConstPtr& msg, uint32_t shard)
+{
+  return publish(pub, msg, publishMessage<M>, cloneMessage<M>, shard);
+}
 } // namespace detail
 
 /**
@@ -91,6 +114,7 @@ public:
    */
   Publisher()
     : pool_(NULL)
+    , shard_(0)
   {
   }
 
@@ -121,7 +145,8 @@ public:
   ~Publisher()
   {
     if (pool_)
-      detail::addPoolToGC((void*)pool_, detail::deletePool<M>, detail::poolIsDeletable<M>);
+      detail::addPoolToGC((void*)pool_, detail::deletePool<M>, detail::poolIsDeletable<M>,
+                          detail::setPoolFreeCallback<M>);
   }
 
   /**
@@ -129,12 +154,20 @@ public:
    * \param pub A ros::Publisher to use to actually publish any messages
    * \param message_pool_size The size of the message pool to provide
    * \param tmpl A template object to intialize all the messages in the message pool with
+   * \param max_pool_segments If > 1, the pool grows by another message_pool_size messages, up to
+   * max_pool_segments times, whenever fewer than a quarter of a segment are left.  Segments are
+   * added by a non-realtime thread, so publish() stays realtime-safe
    */
-  void initialize(const ros::Publisher& pub, uint32_t message_pool_size, const M& tmpl)
+  void initialize(const ros::Publisher& pub, uint32_t message_pool_size, const M& tmpl, uint32_t max_pool_segments = 1)
   {
     pub_ = pub;
+    shard_ = detail::nextPublisherShard();
     pool_ = new lockfree::ObjectPool<M>();
-    pool_->initialize(message_pool_size, tmpl);
+    pool_->initialize(message_pool_size, tmpl, max_pool_segments, message_pool_size / 4);
+    if (max_pool_segments > 1)
+    {
+      detail::addPoolToGrower((void*)pool_, detail::growPool<M>, detail::setPoolGrowCallback<M>);
+    }
   }
 
   /**
@@ -144,10 +177,12 @@ public:
    * \param ros_publisher_queue_size The queue size to pass to NodeHandle::advertise()
    * \param message_pool_size The size of the message pool to provide
    * \param tmpl A template object to intialize all the messages in the message pool with
+   * \param max_pool_segments See initialize() above
    */
-  void initialize(ros::NodeHandle& nh, const std::string& topic, uint32_t ros_publisher_queue_size, uint32_t message_pool_size, const M& tmpl)
+  void initialize(ros::NodeHandle& nh, const std::string& topic, uint32_t ros_publisher_queue_size, uint32_t message_pool_size, const M& tmpl,
+                  uint32_t max_pool_segments = 1)
   {
-    initialize(nh.advertise<M>(topic, ros_publisher_queue_size), message_pool_size, tmpl);
+    initialize(nh.advertise<M>(topic, ros_publisher_queue_size), message_pool_size, tmpl, max_pool_segments);
   }
 
   /**
@@ -155,7 +190,26 @@ public:
    */
   bool publish(const MConstPtr& msg)
   {
-    return detail::publish<M>(pub_, msg);
+    return detail::publish<M>(pub_, msg, shard_);
+  }
+
+  /**
+   * \brief Publish a message obtained from borrow() without copying it.  The publisher thread
+   * serializes this exact object and then drops its reference, so the message returns to the
+   * pool as soon as the caller releases its own.  The message must not be modified after commit().
+   */
+  bool commit(const MConstPtr& msg)
+  {
+    return detail::publish(pub_, msg, detail::publishMessageSerialized<M>, NULL, shard_);
+  }
+
+  /**
+   * \brief Borrow a message from the pool to fill in place and hand to commit().  Returns an
+   * empty pointer if the pool is exhausted
+   */
+  boost::shared_ptr<M> borrow()
+  {
+    return allocate();
   }
 
   /**
@@ -173,9 +227,15 @@ public:
    */
   const ros::Publisher& getPublisher() { return pub_; }
 
+  /**
+   * \brief Returns the message pool, e.g. to read its high water mark and exhaustion count
+   */
+  const lockfree::ObjectPool<M>* getPool() const { return pool_; }
+
 private:
   ros::Publisher pub_;
   lockfree::ObjectPool<M>* pool_;
+  uint32_t shard_;
 };
 
 } // namespace rosrt
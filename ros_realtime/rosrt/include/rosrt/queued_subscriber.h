@@ -0,0 +1,382 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2010, CLMC Lab, University of Southern California
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#ifndef ROSRT_QUEUED_SUBSCRIBER_H
+#define ROSRT_QUEUED_SUBSCRIBER_H
+
+#include <lockfree/object_pool.h>
+#include "detail/pool_gc.h"
+#include "detail/mwsr_queue.h"
+
+#include <ros/atomic.h>
+#include <ros/ros.h>
+#include <rosrt/subscriber.h>
+
+namespace rosrt
+{
+
+/**
+ * \brief A lock-free subscriber that queues every message instead of keeping only the latest one.
+ * Allows you to receive streams of ROS messages inside a realtime thread without losing any.
+ *
+ * Up to queue_depth messages are queued.  A message arriving at a full queue (or when the message
+ * pool is empty) is dropped and counted, see getDropCount().
+ *
+ * The roscpp subscription queue in front of this one is queue_depth deep as well, and its messages are
+ * deserialized into the same pool, so up to 2 * queue_depth pool messages can be waiting to be polled.
+ * The message pool has to be larger than that by the number of polled messages held on to at the same
+ * time, here the 10 of a batch.  Messages are returned oldest first:
+\verbatim
+QueuedSubscriber<Msg> sub(100, 210, nh, "my_topic");
+MsgConstPtr msgs[10];
+while (true)
+{
+  uint32_t count = sub.pollBatch(msgs, 10);
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    // do something with msgs[i]
+    ...
+  }
+}
+\endverbatim
+ *
+ * The poll functions must all be called from the same thread.
+ */
+template<typename M>
+class QueuedSubscriber
+{
+  typedef detail::MWSRQueue<M const*> Queue;
+
+public:
+  /**
+   * \brief Default constructor.  You must call initialize() before doing anything else if you use this constructor.
+   */
+  QueuedSubscriber()
+  : pool_(0)
+  , queue_(0)
+  , pending_(0)
+  , pending_tail_(0)
+  {
+  }
+
+  /**
+   * \brief Constructor with initialization.  Call subscribe() to subscribe to a topic.
+   * \param queue_depth The maximum number of messages waiting to be polled
+   * \param message_pool_size The size of the message pool to use.  Must be larger than 2 * queue_depth,
+   * the difference is the number of polled messages that can be held on to at the same time.
+   */
+  QueuedSubscriber(uint32_t queue_depth, uint32_t message_pool_size)
+  : pool_(0)
+  , queue_(0)
+  , pending_(0)
+  , pending_tail_(0)
+  {
+    initialize(queue_depth, message_pool_size);
+  }
+
+  /**
+   * \brief Constructor with initialization and subscription
+   * \param queue_depth The maximum number of messages waiting to be polled
+   * \param message_pool_size The size of the message pool to use, must be larger than 2 * queue_depth
+   * \param nh The ros::NodeHandle to use to subscribe
+   * \param topic The topic to subscribe on
+   * \param [optional] transport_hints the transport hints to use
+   */
+  QueuedSubscriber(uint32_t queue_depth, uint32_t message_pool_size, ros::NodeHandle& nh, const std::string& topic,
+                   const ros::TransportHints& transport_hints = ros::TransportHints())
+  : pool_(0)
+  , queue_(0)
+  , pending_(0)
+  , pending_tail_(0)
+  {
+    initialize(queue_depth, message_pool_size);
+    subscribe(nh, topic, transport_hints);
+  }
+
+  ~QueuedSubscriber()
+  {
+    // make sure the callback doesn't push anything while the queue is emptied
+    sub_.shutdown();
+
+    if (queue_)
+    {
+      fetch();
+      while (pending_)
+      {
+        typename Queue::Node* node = pending_;
+        pending_ = node->next;
+        pool_->free(node->val);
+        queue_->free(node);
+      }
+
+      delete queue_;
+    }
+
+    if (pool_)
+    {
+      detail::addPoolToGC((void*)pool_, detail::deletePool<M>, detail::poolIsDeletable<M>,
+                          detail::setPoolFreeCallback<M>);
+    }
+  }
+
+  /**
+   * \brief Initialize this subscriber.  Only use with the default constructor.
+   * \param queue_depth The maximum number of messages waiting to be polled
+   * \param message_pool_size The size of the message pool to use, must be larger than 2 * queue_depth
+   */
+  void initialize(uint32_t queue_depth, uint32_t message_pool_size)
+  {
+    ROS_ASSERT(queue_depth > 0);
+    ROS_ASSERT(message_pool_size > 2 * queue_depth);
+    ROS_ASSERT(!pool_);
+    pool_ = new lockfree::ObjectPool<M>();
+    pool_->initialize(message_pool_size, M());
+    queue_ = new Queue(queue_depth);
+    queue_depth_ = queue_depth;
+    received_.store(0);
+    dropped_.store(0);
+  }
+
+  /**
+   * \brief Initialize this subscriber.  Only use with the default constructor.
+   * \param queue_depth The maximum number of messages waiting to be polled
+   * \param message_pool_size The size of the message pool to use, must be larger than 2 * queue_depth
+   * \param nh The ros::NodeHandle to use to subscribe
+   * \param topic The topic to subscribe on
+   * \param [optional] transport_hints the transport hints to use
+   * \return Whether or not we successfully subscribed
+   */
+  bool initialize(uint32_t queue_depth, uint32_t message_pool_size, ros::NodeHandle& nh, const std::string& topic,
+                  const ros::TransportHints& transport_hints = ros::TransportHints())
+  {
+    initialize(queue_depth, message_pool_size);
+    return subscribe(nh, topic, transport_hints);
+  }
+
+  /**
+   * \brief Subscribe to a topic
+   * \param nh The ros::NodeHandle to use to subscribe
+   * \param topic The topic to subscribe on
+   * \param [optional] transport_hints the transport hints to use
+   * \return Whether or not we successfully subscribed
+   */
+  bool subscribe(ros::NodeHandle& nh, const std::string& topic, const ros::TransportHints& transport_hints = ros::TransportHints())
+  {
+    // roscpp queues as many messages as we do, so bursts are not dropped before they reach the callback.
+    // Those messages come from our pool too, which is why it has to hold 2 * queue_depth
+    ros::SubscribeOptions ops;
+#ifdef ROS_NEW_SERIALIZATION_API
+    ops.template init<M>(topic, queue_depth_, boost::bind(&QueuedSubscriber::callback, this, _1), boost::bind(&lockfree::ObjectPool<M>::allocateShared, pool_));
+#else
+    ops.template init<M>(topic, queue_depth_, boost::bind(&QueuedSubscriber::callback, this, _1));
+#endif
+    ops.callback_queue = detail::getSubscriberCallbackQueue();
+    ops.transport_hints = transport_hints;
+    sub_ = nh.subscribe(ops);
+    return (bool)sub_;
+  }
+
+  /**
+   * \brief Retrieve the oldest queued message, or NULL if there is none
+   */
+  boost::shared_ptr<M const> poll()
+  {
+    boost::shared_ptr<M const> msg;
+    pollBatch(&msg, 1);
+    return msg;
+  }
+
+  /**
+   * \brief Retrieve up to max_count queued messages, oldest first
+   * \param msgs Array of at least max_count messages to fill
+   * \param max_count The maximum number of messages to retrieve
+   * \return The number of messages written to msgs
+   */
+  uint32_t pollBatch(boost::shared_ptr<M const>* msgs, uint32_t max_count)
+  {
+    uint32_t count = 0;
+    while (count < max_count)
+    {
+      boost::shared_ptr<M const> msg = pop();
+      if (!msg)
+      {
+        break;
+      }
+
+      msgs[count++] = msg;
+    }
+
+    return count;
+  }
+
+  /**
+   * \brief Retrieve all queued messages, oldest first
+   * \param f Called as f(const boost::shared_ptr<M const>&) for every message
+   * \return The number of messages passed to f
+   */
+  template<typename F>
+  uint32_t pollAll(F f)
+  {
+    uint32_t count = 0;
+    while (true)
+    {
+      boost::shared_ptr<M const> msg = pop();
+      if (!msg)
+      {
+        break;
+      }
+
+      f(msg);
+      ++count;
+    }
+
+    return count;
+  }
+
+  /**
+   * \brief Returns the number of messages queued since initialization
+   */
+  uint32_t getReceivedCount() const { return received_.load(); }
+
+  /**
+   * \brief Returns the number of messages dropped since initialization, because the queue was full
+   * or the message pool empty
+   */
+  uint32_t getDropCount() const { return dropped_.load(); }
+
+private:
+  // moves everything pushed so far behind the messages not yet polled
+  void fetch()
+  {
+    typename Queue::Node* first = queue_->popAll();
+    if (!first)
+    {
+      return;
+    }
+
+    if (pending_)
+    {
+      pending_tail_->next = first;
+    }
+    else
+    {
+      pending_ = first;
+    }
+
+    pending_tail_ = first;
+    while (pending_tail_->next)
+    {
+      pending_tail_ = pending_tail_->next;
+    }
+  }
+
+  boost::shared_ptr<M const> pop()
+  {
+    while (true)
+    {
+      if (!pending_)
+      {
+        fetch();
+        if (!pending_)
+        {
+          return boost::shared_ptr<M const>();
+        }
+      }
+
+      typename Queue::Node* node = pending_;
+      pending_ = node->next;
+      M const* m = node->val;
+      queue_->free(node);
+
+      boost::shared_ptr<M const> ptr = pool_->makeShared(m);
+      if (ptr)
+      {
+        return ptr;
+      }
+
+      pool_->free(m);
+      dropped_.fetch_add(1);
+    }
+  }
+
+  void callback(const boost::shared_ptr<M const>& msg)
+  {
+    M const* m = 0;
+    // If our pool doesn't own this message (due to multiple subscribers on the same topic)
+    // make a copy
+    if (!pool_->owns(msg.get()))
+    {
+      M* copy = pool_->allocate();
+
+      if (!copy)
+      {
+        dropped_.fetch_add(1);
+        return;
+      }
+
+      *copy = *msg;
+      m = copy;
+    }
+    else
+    {
+      m = pool_->removeShared(msg);
+    }
+
+    if (!queue_->push(m))
+    {
+      pool_->free(m);
+      dropped_.fetch_add(1);
+      return;
+    }
+
+    received_.fetch_add(1);
+  }
+
+  lockfree::ObjectPool<M>* pool_;
+  Queue* queue_;
+  uint32_t queue_depth_;
+
+  // popped from queue_ but not polled yet, only touched by the polling thread
+  typename Queue::Node* pending_;
+  typename Queue::Node* pending_tail_;
+
+  ros::atomic<uint32_t> received_;
+  ros::atomic<uint32_t> dropped_;
+
+  ros::Subscriber sub_;
+};
+
+} // namespace rosrt
+
+#endif // ROSRT_QUEUED_SUBSCRIBER_H
@@ -38,7 +38,9 @@
 #include "publisher.h"
 #include "subscriber.h"
 #include "filtered_subscriber.h"
+#include "queued_subscriber.h"
 #include "malloc_wrappers.h"
+#include "loop_monitor.h"
 #include "init.h"
 
 #endif // ROSRT_ROSRT_H
@@ -117,7 +117,8 @@ public:
       pool_->free(latest);
     }
 
-    detail::addPoolToGC((void*)pool_, detail::deletePool<M>, detail::poolIsDeletable<M>);
+    detail::addPoolToGC((void*)pool_, detail::deletePool<M>, detail::poolIsDeletable<M>,
+                          detail::setPoolFreeCallback<M>);
   }
 
   /**
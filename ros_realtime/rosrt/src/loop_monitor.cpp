@@ -0,0 +1,256 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2010, CLMC Lab, University of Southern California
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <rosrt/loop_monitor.h>
+#include <rosrt/malloc_wrappers.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+#ifdef __XENO__
+#include <native/timer.h>
+#else
+#include <time.h>
+#endif
+
+namespace rosrt
+{
+
+LoopMonitor::LoopMonitor()
+: histogram_bins_(0)
+, publishing_(false)
+{
+}
+
+LoopMonitor::LoopMonitor(const std::string& name, double nominal_period, double deadline, uint32_t trace_size,
+                         uint32_t histogram_bins)
+: histogram_bins_(0)
+, publishing_(false)
+{
+  initialize(name, nominal_period, deadline, trace_size, histogram_bins);
+}
+
+LoopMonitor::~LoopMonitor()
+{
+  stopPublishing();
+}
+
+void LoopMonitor::initialize(const std::string& name, double nominal_period, double deadline, uint32_t trace_size,
+                             uint32_t histogram_bins)
+{
+  ROS_ASSERT(histogram_bins_ == 0);
+  ROS_ASSERT(nominal_period > 0.0);
+  ROS_ASSERT(trace_size > 0 && histogram_bins > 0);
+
+  name_ = name;
+  nominal_period_ = (uint64_t)(nominal_period * 1e9);
+  deadline_ = (uint64_t)(deadline * 1e9);
+  histogram_bins_ = histogram_bins;
+  bin_width_ = std::max<uint64_t>(2 * nominal_period_ / histogram_bins, 1);
+
+  cycle_start_ = 0;
+  cycle_period_ = 0;
+  cycle_allocations_ = 0;
+
+  cycles_.store(0);
+  deadline_misses_.store(0);
+  allocations_.store(0);
+  trace_overruns_.store(0);
+
+  period_histogram_.reset(new ros::atomic<uint64_t>[histogram_bins]);
+  execution_time_histogram_.reset(new ros::atomic<uint64_t>[histogram_bins]);
+  for (uint32_t i = 0; i < histogram_bins; ++i)
+  {
+    period_histogram_[i].store(0);
+    execution_time_histogram_[i].store(0);
+  }
+
+  trace_.resize(trace_size);
+  trace_head_.store(0);
+  trace_tail_.store(0);
+}
+
+uint64_t LoopMonitor::now()
+{
+#ifdef __XENO__
+  return rt_timer_tsc2ns(rt_timer_tsc());
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+uint32_t LoopMonitor::getBin(uint64_t duration) const
+{
+  uint64_t bin = duration / bin_width_;
+  return bin < histogram_bins_ ? (uint32_t)bin : histogram_bins_ - 1;
+}
+
+static uint64_t countAllocations(const AllocInfo& info)
+{
+  return info.mallocs + info.callocs + info.reallocs + info.memaligns + info.frees;
+}
+
+void LoopMonitor::startCycle()
+{
+  uint64_t start = now();
+  cycle_period_ = cycle_start_ ? start - cycle_start_ : 0;
+  cycle_start_ = start;
+
+  if (cycle_period_)
+  {
+    ros::atomic<uint64_t>& bin = period_histogram_[getBin(cycle_period_)];
+    bin.store(bin.load(ros::memory_order_relaxed) + 1, ros::memory_order_relaxed);
+  }
+
+  cycle_allocations_ = countAllocations(getThreadAllocInfo());
+}
+
+bool LoopMonitor::endCycle()
+{
+  uint64_t execution_time = now() - cycle_start_;
+  uint64_t allocations = countAllocations(getThreadAllocInfo()) - cycle_allocations_;
+  bool deadline_missed = execution_time > deadline_;
+
+  // single writer, so plain load/store pairs suffice and no CAS is needed
+  ros::atomic<uint64_t>& bin = execution_time_histogram_[getBin(execution_time)];
+  bin.store(bin.load(ros::memory_order_relaxed) + 1, ros::memory_order_relaxed);
+  uint64_t cycle = cycles_.load(ros::memory_order_relaxed);
+  cycles_.store(cycle + 1, ros::memory_order_relaxed);
+  allocations_.store(allocations_.load(ros::memory_order_relaxed) + allocations, ros::memory_order_relaxed);
+  if (deadline_missed)
+  {
+    deadline_misses_.store(deadline_misses_.load(ros::memory_order_relaxed) + 1, ros::memory_order_relaxed);
+  }
+
+  uint32_t head = trace_head_.load(ros::memory_order_relaxed);
+  if (head - trace_tail_.load(ros::memory_order_acquire) < trace_.size())
+  {
+    TraceEntry& entry = trace_[head % trace_.size()];
+    entry.cycle = cycle;
+    entry.start = cycle_start_;
+    entry.period = cycle_period_;
+    entry.execution_time = execution_time;
+    entry.allocations = (uint32_t)allocations;
+    entry.deadline_missed = deadline_missed;
+    trace_head_.store(head + 1, ros::memory_order_release);
+  }
+  else
+  {
+    trace_overruns_.store(trace_overruns_.load(ros::memory_order_relaxed) + 1, ros::memory_order_relaxed);
+  }
+
+  return !deadline_missed;
+}
+
+void LoopMonitor::drain(LoopStatistics& stats)
+{
+  stats.name = name_;
+  stats.nominal_period = nominal_period_ * 1e-9;
+  stats.deadline = deadline_ * 1e-9;
+  stats.cycles = cycles_.load();
+  stats.deadline_misses = deadline_misses_.load();
+  stats.allocations = allocations_.load();
+  stats.trace_overruns = trace_overruns_.load();
+
+  stats.histogram_bin_width = bin_width_ * 1e-9;
+  stats.period_histogram.resize(histogram_bins_);
+  stats.execution_time_histogram.resize(histogram_bins_);
+  for (uint32_t i = 0; i < histogram_bins_; ++i)
+  {
+    stats.period_histogram[i] = period_histogram_[i].load(ros::memory_order_relaxed);
+    stats.execution_time_histogram[i] = execution_time_histogram_[i].load(ros::memory_order_relaxed);
+  }
+
+  uint32_t tail = trace_tail_.load(ros::memory_order_relaxed);
+  uint32_t head = trace_head_.load(ros::memory_order_acquire);
+  stats.traces.resize(head - tail);
+  for (uint32_t i = 0; tail != head; ++tail, ++i)
+  {
+    const TraceEntry& entry = trace_[tail % trace_.size()];
+    LoopTrace& trace = stats.traces[i];
+    trace.cycle = entry.cycle;
+    trace.start = entry.start * 1e-9;
+    trace.period = entry.period * 1e-9;
+    trace.execution_time = entry.execution_time * 1e-9;
+    trace.allocations = entry.allocations;
+    trace.deadline_missed = entry.deadline_missed;
+  }
+  trace_tail_.store(tail, ros::memory_order_release);
+}
+
+void LoopMonitor::startPublishing(ros::NodeHandle& nh, const std::string& topic, double rate)
+{
+  ROS_ASSERT(histogram_bins_ > 0);
+  ROS_ASSERT(!publish_thread_);
+
+  publisher_.reset(new Publisher<LoopStatistics>(nh, topic, 1, 2, LoopStatistics()));
+  publishing_ = true;
+  publish_thread_.reset(new boost::thread(boost::bind(&LoopMonitor::publishThread, this, rate)));
+}
+
+void LoopMonitor::stopPublishing()
+{
+  if (!publish_thread_)
+  {
+    return;
+  }
+
+  publishing_ = false;
+  publish_thread_->join();
+  publish_thread_.reset();
+  publisher_.reset();
+}
+
+void LoopMonitor::publishThread(double rate)
+{
+  while (publishing_)
+  {
+    ros::WallDuration(1.0 / rate).sleep();
+
+    LoopStatisticsPtr stats = publisher_->allocate();
+    if (!stats)
+    {
+      // the previous message is still being published, its traces are picked up next time
+      continue;
+    }
+
+    drain(*stats);
+    publisher_->publish(stats);
+  }
+}
+
+} // namespace rosrt
@@ -42,6 +42,9 @@
 
 #include <boost/thread.hpp>
 
+#include <algorithm>
+#include <cstdio>
+
 #ifdef __XENO__
 #include <native/task.h>
 #endif
@@ -56,6 +59,18 @@ bool publish(const ros::Publisher& pub, const VoidConstPtr& msg, PublishFunc pub
   return detail::getPublisherManager()->publish(pub, msg, pub_func, clone_func);
 }
 
+bool publish(const ros::Publisher& pub, const VoidConstPtr& msg, PublishFunc pub_func, CloneFunc clone_func, uint32_t shard)
+{
+  return detail::getPublisherManager()->publish(pub, msg, pub_func, clone_func, shard);
+}
+
+static ros::atomic<uint32_t> g_next_shard(0);
+
+uint32_t nextPublisherShard()
+{
+  return g_next_shard.fetch_add(1);
+}
+
 PublishQueue::PublishQueue(uint32_t size)
 : queue_(size)
 {
@@ -78,10 +93,18 @@ uint32_t PublishQueue::publishAll()
   MWSRQueue<PubItem>::Node* it = queue_.popAll();
   while (it)
   {
-    // Always clone the message before publishing.  Otherwise, if there's an intraprocess non-realtime subscriber that stores off the messages
-    // it could starve the realtime publisher for messages.
-    VoidConstPtr clone = it->val.clone_func(it->val.msg);
-    it->val.pub_func(it->val.pub, clone);
+    // Clone the message before publishing.  Otherwise, if there's an intraprocess non-realtime subscriber that stores off the messages
+    // it could starve the realtime publisher for messages.  Items without a clone function are published
+    // by a pub_func that serializes the message in place and does not keep it.
+    if (it->val.clone_func)
+    {
+      VoidConstPtr clone = it->val.clone_func(it->val.msg);
+      it->val.pub_func(it->val.pub, clone);
+    }
+    else
+    {
+      it->val.pub_func(it->val.pub, it->val.msg);
+    }
     it->val.msg.reset();
     it->val.pub = ros::Publisher();
     MWSRQueue<PubItem>::Node* tmp = it;
@@ -95,32 +118,70 @@ uint32_t PublishQueue::publishAll()
   return count;
 }
 
+PublisherManager::Worker::Worker(uint32_t queue_size)
+: queue(queue_size)
+, pub_count(0)
+, pub_thread(0)
+{
+}
+
+PublisherManager::Worker::~Worker()
+{
+  delete pub_thread;
+}
+
 PublisherManager::PublisherManager(const InitOptions& ops)
-: queue_(ops.pubmanager_queue_size)
-, pub_count_(0)
-, running_(true)
-, pub_thread_(boost::bind(&PublisherManager::publishThread, this), "rosrt_publisher", 7) // HACK!!! Assigns to CPU 7
+: running_(true)
 {
+  uint32_t thread_count = std::max(ops.pubmanager_thread_count, 1U);
+  workers_.resize(thread_count);
+  for (uint32_t i = 0; i < thread_count; ++i)
+  {
+    workers_[i] = new Worker(ops.pubmanager_queue_size);
+  }
+
+  // threads are only started once all workers exist, so the vector is never modified while they run
+  for (uint32_t i = 0; i < thread_count; ++i)
+  {
+    int cpu_id = -1;
+    if (!ops.pubmanager_cpu_affinity.empty())
+    {
+      cpu_id = ops.pubmanager_cpu_affinity[i % ops.pubmanager_cpu_affinity.size()];
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "rosrt_publisher_%u", i);
+    workers_[i]->pub_thread = new rosrt::thread(boost::bind(&PublisherManager::publishThread, this, workers_[i]), name,
+                                                cpu_id, ops.pubmanager_sched_policy, ops.pubmanager_sched_priority);
+  }
 }
 
 PublisherManager::~PublisherManager()
 {
-  cond_mutex_.lock();
   running_ = false;
-  cond_.notify_one();
-  cond_mutex_.unlock();
-  pub_thread_.join();
+  for (size_t i = 0; i < workers_.size(); ++i)
+  {
+    workers_[i]->cond_mutex.lock();
+    workers_[i]->cond.notify_one();
+    workers_[i]->cond_mutex.unlock();
+  }
+
+  for (size_t i = 0; i < workers_.size(); ++i)
+  {
+    workers_[i]->pub_thread->join();
+    delete workers_[i];
+  }
 }
 
-void PublisherManager::publishThread()
+void PublisherManager::publishThread(Worker* worker)
 {
   while (running_)
   {
     {
-      rosrt::mutex::scoped_lock lock(cond_mutex_);
-      while (running_ && pub_count_.load() == 0)
+      rosrt::mutex::scoped_lock lock(worker->cond_mutex);
+      while (running_ && worker->pub_count.load() == 0)
       {
-        cond_.wait(lock);
+        worker->cond.wait(lock);
       }
 
       if (!running_)
@@ -133,20 +194,22 @@ void PublisherManager::publishThread()
     // publishing doesn't interfere with real-time tasks
     rt_task_set_mode(T_PRIMARY, 0, NULL);
 #endif
-    uint32_t count = queue_.publishAll();
-    pub_count_.fetch_sub(count);
+    uint32_t count = worker->queue.publishAll();
+    worker->pub_count.fetch_sub(count);
   }
 }
 
-bool PublisherManager::publish(const ros::Publisher& pub, const VoidConstPtr& msg, PublishFunc pub_func, CloneFunc clone_func)
+bool PublisherManager::publish(const ros::Publisher& pub, const VoidConstPtr& msg, PublishFunc pub_func, CloneFunc clone_func,
+                               uint32_t shard)
 {
-  if (!queue_.push(pub, msg, pub_func, clone_func))
+  Worker* worker = workers_[shard % workers_.size()];
+  if (!worker->queue.push(pub, msg, pub_func, clone_func))
   {
     return false;
   }
 
-  pub_count_.fetch_add(1);
-  cond_.notify_one();
+  worker->pub_count.fetch_add(1);
+  worker->cond.notify_one();
 
   return true;
 }
@@ -37,6 +37,12 @@
 #include <rosrt/init.h>
 #include <ros/debug.h>
 
+#include <boost/bind.hpp>
+
+#ifdef __XENO__
+#include <native/task.h>
+#endif
+
 namespace rosrt
 {
 namespace detail
@@ -44,61 +50,201 @@ namespace detail
 
 SimpleGC::SimpleGC(const InitOptions& ops)
 : running_(true)
+, event_driven_(ops.gc_event_driven)
 , pool_gc_queue_(ops.gc_queue_size)
-, period_(ops.gc_period.toSec())
+, dirty_queue_(ops.gc_queue_size)
+, dirty_overflow_(false)
+, period_(ops.gc_period)
+, pending_(0)
+, pool_gc_thread_(boost::bind(&SimpleGC::gcThread, this), "rosrt_gc")
 {
-  pool_gc_thread_ = boost::thread(&SimpleGC::gcThread, this);
 }
 
 SimpleGC::~SimpleGC()
 {
+  cond_mutex_.lock();
   running_ = false;
+  cond_.notify_one();
+  cond_mutex_.unlock();
   pool_gc_thread_.join();
 }
 
-void addPoolToGC(void* pool, SimpleGC::DeleteFunc deleter, SimpleGC::IsDeletableFunc deletable)
+void addPoolToGC(void* pool, SimpleGC::DeleteFunc deleter, SimpleGC::IsDeletableFunc deletable,
+                 SimpleGC::SetFreeCallbackFunc set_free_callback)
 {
-  getGC()->add(pool, deleter, deletable);
+  getGC()->add(pool, deleter, deletable, set_free_callback);
 }
 
-void SimpleGC::add(void* pool, DeleteFunc deleter, IsDeletableFunc deletable)
+void addPoolToGrower(void* pool, SimpleGC::GrowFunc grow, SimpleGC::SetFreeCallbackFunc set_grow_callback)
+{
+  getGC()->addGrowable(pool, grow, set_grow_callback);
+}
+
+void SimpleGC::add(void* pool, DeleteFunc deleter, IsDeletableFunc deletable, SetFreeCallbackFunc set_free_callback)
 {
   PoolGCItem i;
   i.pool = pool;
   i.deleter = deleter;
   i.is_deletable = deletable;
+  i.grow = 0;
+  i.set_free_callback = set_free_callback;
+  pool_gc_queue_.push(i);
+  notify();
+}
+
+void SimpleGC::addGrowable(void* pool, GrowFunc grow, SetFreeCallbackFunc set_grow_callback)
+{
+  PoolGCItem i;
+  i.pool = pool;
+  i.deleter = 0;
+  i.is_deletable = 0;
+  i.grow = grow;
+  i.set_free_callback = set_grow_callback;
   pool_gc_queue_.push(i);
+  notify();
+}
+
+void SimpleGC::notify()
+{
+  if (event_driven_)
+  {
+    pending_.fetch_add(1);
+    cond_.notify_one();
+  }
+}
+
+void SimpleGC::poolFreed(void* arg, void const* pool)
+{
+  // the pool may be deleted by now, only its address is used to find its item
+  SimpleGC* gc = static_cast<SimpleGC*>(arg);
+  if (!gc->dirty_queue_.push(pool))
+  {
+    gc->dirty_overflow_.store(true);
+  }
+  gc->notify();
+}
+
+void SimpleGC::growRequested(void* arg, void const* pool)
+{
+  // every growable pool is checked on each wakeup, there is nothing to mark
+  static_cast<SimpleGC*>(arg)->notify();
 }
 
 void SimpleGC::gcThread()
 {
   typedef std::vector<PoolGCItem> V_PoolGCItem;
+  typedef std::vector<bool> V_bool;
   V_PoolGCItem gc_items;
+  V_bool gc_dirty;
+  V_PoolGCItem grow_items;
 
   while (running_)
   {
-    ros::WallDuration(period_).sleep();
+    if (event_driven_)
+    {
+      // notify() doesn't take the mutex, so a wakeup can be missed.  The timeout bounds the delay
+      // that causes, the dirty queue makes sure nothing freed in the meantime is overlooked
+      rosrt::mutex::scoped_lock lock(cond_mutex_);
+      if (running_ && pending_.load() == 0)
+      {
+        cond_.timed_wait(lock, period_);
+      }
+
+      if (!running_)
+      {
+        break;
+      }
+    }
+    else
+    {
+      period_.sleep();
+    }
+
+#ifdef __XENO__
+    // in Xenomai, force a switch to secondary mode here so that
+    // deleting pools doesn't interfere with real-time tasks
+    rt_task_set_mode(T_PRIMARY, 0, NULL);
+#endif
+    pending_.store(0);
 
     {
       MWSRQueue<PoolGCItem>::Node* it = pool_gc_queue_.popAll();
       while (it)
       {
-        gc_items.push_back(it->val);
+        if (it->val.grow)
+        {
+          grow_items.push_back(it->val);
+          // requests made before the callback is set are handled by the grow below
+          if (event_driven_ && it->val.set_free_callback)
+          {
+            it->val.set_free_callback(it->val.pool, &SimpleGC::growRequested, this);
+          }
+        }
+        else
+        {
+          gc_items.push_back(it->val);
+          // checked at least once, objects freed before the callback was set don't notify
+          gc_dirty.push_back(true);
+          if (event_driven_ && it->val.set_free_callback)
+          {
+            it->val.set_free_callback(it->val.pool, &SimpleGC::poolFreed, this);
+          }
+        }
         MWSRQueue<PoolGCItem>::Node* tmp = it;
         it = it->next;
         pool_gc_queue_.free(tmp);
       }
     }
 
+    if (event_driven_)
+    {
+      // addresses of pools that were already deleted match nothing, or at worst a newer pool which then
+      // gets checked once more than necessary
+      MWSRQueue<void const*>::Node* it = dirty_queue_.popAll();
+      while (it)
+      {
+        for (size_t i = 0; i < gc_items.size(); ++i)
+        {
+          if (gc_items[i].pool == it->val)
+          {
+            gc_dirty[i] = true;
+            break;
+          }
+        }
+        MWSRQueue<void const*>::Node* tmp = it;
+        it = it->next;
+        dirty_queue_.free(tmp);
+      }
+
+      if (dirty_overflow_.exchange(false))
+      {
+        gc_dirty.assign(gc_dirty.size(), true);
+      }
+    }
+
     {
       for (size_t i = 0; i < gc_items.size();)
       {
         PoolGCItem& item = gc_items[i];
-        if (item.is_deletable(item.pool))
+        bool check = !event_driven_ || !item.set_free_callback || gc_dirty[i];
+        gc_dirty[i] = false;
+        if (check && item.is_deletable(item.pool))
         {
+          for (size_t j = 0; j < grow_items.size(); ++j)
+          {
+            if (grow_items[j].pool == item.pool)
+            {
+              grow_items[j] = grow_items.back();
+              grow_items.pop_back();
+              break;
+            }
+          }
+
           item.deleter(item.pool);
-          item = gc_items.back();
+          gc_items[i] = gc_items.back();
           gc_items.pop_back();
+          gc_dirty[i] = gc_dirty.back();
+          gc_dirty.pop_back();
         }
         else
         {
@@ -106,6 +252,11 @@ void SimpleGC::gcThread()
         }
       }
     }
+
+    for (size_t i = 0; i < grow_items.size(); ++i)
+    {
+      grow_items[i].grow(grow_items[i].pool);
+    }
   }
 
   {
@@ -127,4 +278,3 @@ void SimpleGC::gcThread()
 
 } // namespace detail
 } // namespace rosrt
-
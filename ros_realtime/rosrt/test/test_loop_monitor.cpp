@@ -0,0 +1,118 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2010, CLMC Lab, University of Southern California
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "rosrt/loop_monitor.h"
+
+#include <ros/time.h>
+
+#include <numeric>
+#include <cstdlib>
+
+using namespace rosrt;
+
+TEST(LoopMonitor, countsCyclesAndAllocations)
+{
+  LoopMonitor monitor("test", 0.001, 0.0005, 100, 10);
+
+  for (uint32_t i = 0; i < 20; ++i)
+  {
+    monitor.startCycle();
+    if (i % 2)
+    {
+      void* volatile mem = malloc(100);
+      free(mem);
+    }
+    ASSERT_TRUE(monitor.endCycle());
+  }
+
+  LoopStatistics stats;
+  monitor.drain(stats);
+  EXPECT_EQ(stats.name, "test");
+  EXPECT_EQ(stats.cycles, 20ULL);
+  EXPECT_EQ(stats.deadline_misses, 0ULL);
+  EXPECT_EQ(stats.allocations, 20ULL);
+  EXPECT_EQ(stats.trace_overruns, 0ULL);
+
+  ASSERT_EQ(stats.traces.size(), 20UL);
+  for (uint32_t i = 0; i < 20; ++i)
+  {
+    EXPECT_EQ(stats.traces[i].cycle, i);
+    EXPECT_EQ(stats.traces[i].allocations, (i % 2) ? 2UL : 0UL);
+  }
+
+  ASSERT_EQ(stats.execution_time_histogram.size(), 10UL);
+  ASSERT_EQ(stats.period_histogram.size(), 10UL);
+  EXPECT_EQ(std::accumulate(stats.execution_time_histogram.begin(), stats.execution_time_histogram.end(), 0ULL), 20ULL);
+  // the first cycle has no period
+  EXPECT_EQ(std::accumulate(stats.period_histogram.begin(), stats.period_histogram.end(), 0ULL), 19ULL);
+
+  // traces are only reported once, counters and histograms accumulate
+  monitor.drain(stats);
+  EXPECT_EQ(stats.traces.size(), 0UL);
+  EXPECT_EQ(stats.cycles, 20ULL);
+}
+
+TEST(LoopMonitor, deadlineMissesAndOverruns)
+{
+  LoopMonitor monitor("test", 0.001, 0.0005, 4, 10);
+
+  for (uint32_t i = 0; i < 6; ++i)
+  {
+    monitor.startCycle();
+    if (i == 1)
+    {
+      ros::WallDuration(0.002).sleep();
+    }
+    EXPECT_EQ(monitor.endCycle(), i != 1);
+  }
+
+  LoopStatistics stats;
+  monitor.drain(stats);
+  EXPECT_EQ(stats.cycles, 6ULL);
+  EXPECT_EQ(stats.deadline_misses, 1ULL);
+  EXPECT_EQ(stats.trace_overruns, 2ULL);
+  ASSERT_EQ(stats.traces.size(), 4UL);
+  EXPECT_TRUE(stats.traces[1].deadline_missed);
+  EXPECT_GE(stats.traces[1].execution_time, 0.002);
+  // execution times beyond the histogram go to the last bin
+  EXPECT_EQ(stats.execution_time_histogram.back(), 1ULL);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -93,6 +93,40 @@ TEST(Publisher, singlePublisher)
   ASSERT_EQ(h.latest->data, 5UL);
 }
 
+TEST(Publisher, borrowCommit)
+{
+  ros::NodeHandle nh;
+
+  // a single message in the pool, every borrow() only succeeds once the previous commit has been published
+  Publisher<std_msgs::UInt32> pub(nh.advertise<std_msgs::UInt32>("test_commit", 0), 1, std_msgs::UInt32());
+
+  Helper h;
+  ros::Subscriber sub = nh.subscribe("test_commit", 0, &Helper::cb, &h);
+
+  for (uint32_t i = 0; i < 10; ++i)
+  {
+    std_msgs::UInt32Ptr msg;
+    while (!(msg = pub.borrow()))
+    {
+      ros::WallDuration(0.001).sleep();
+    }
+
+    resetThreadAllocInfo();
+    msg->data = i;
+    ASSERT_TRUE(pub.commit(msg));
+    ASSERT_EQ(getThreadAllocInfo().total_ops, 0ULL);
+  }
+
+  while (h.count < 10)
+  {
+    ros::WallDuration(0.001).sleep();
+    ros::spinOnce();
+  }
+
+  ASSERT_EQ(h.count, 10UL);
+  ASSERT_EQ(h.latest->data, 9UL);
+}
+
 TEST(Publisher, simpleInitializeCompile)
 {
   ros::NodeHandle nh;
@@ -0,0 +1,231 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2010, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "rosrt/rosrt.h"
+
+#include <ros/ros.h>
+
+#include <std_msgs/UInt32.h>
+
+#include <boost/thread.hpp>
+#include <rosrt/detail/thread.h>
+
+#ifdef __XENO__
+#include <native/task.h>
+#include <sys/mman.h>
+#endif
+
+using namespace rosrt;
+
+static const uint32_t thread_count = 4;
+
+struct OrderHelper
+{
+  OrderHelper()
+  : count(0)
+  , in_order(true)
+  {}
+
+  void cb(const std_msgs::UInt32ConstPtr& msg)
+  {
+    if (msg->data != count)
+    {
+      in_order = false;
+    }
+    ++count;
+  }
+
+  uint32_t count;
+  bool in_order;
+};
+
+// more publishers than publisher threads, messages of each publisher have to arrive in order
+TEST(ShardedPublisher, multiplePublishersKeepOrder)
+{
+  ros::NodeHandle nh;
+
+  static const uint32_t count = 4 * thread_count + 1;
+  static const uint32_t msg_count = 100;
+  Publisher<std_msgs::UInt32> pubs[count];
+
+  OrderHelper helpers[count];
+  ros::Subscriber subs[count];
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    std::stringstream topic;
+    topic << "test_sharded" << i;
+    pubs[i].initialize(nh.advertise<std_msgs::UInt32>(topic.str(), 0), msg_count, std_msgs::UInt32());
+    subs[i] = nh.subscribe(topic.str(), 0, &OrderHelper::cb, &helpers[i]);
+  }
+
+  for (uint32_t j = 0; j < msg_count; ++j)
+  {
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      std_msgs::UInt32Ptr msg = pubs[i].allocate();
+      ASSERT_TRUE(msg);
+      msg->data = j;
+      ASSERT_TRUE(pubs[i].publish(msg));
+    }
+  }
+
+  uint32_t recv_count = 0;
+  while (recv_count < count * msg_count)
+  {
+    ros::spinOnce();
+    ros::WallDuration(0.01).sleep();
+
+    recv_count = 0;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      recv_count += helpers[i].count;
+    }
+  }
+
+  ASSERT_EQ(recv_count, count * msg_count);
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    EXPECT_TRUE(helpers[i].in_order);
+    EXPECT_EQ(helpers[i].count, msg_count);
+  }
+}
+
+void publishThread(Publisher<std_msgs::UInt32>& pub, bool& done)
+{
+  uint32_t data = 0;
+  while (!done)
+  {
+    std_msgs::UInt32Ptr msg = pub.allocate();
+    if (msg)
+    {
+      msg->data = data++;
+      pub.publish(msg);
+#ifdef __XENO__
+      rt_task_yield();
+#endif
+    }
+    else
+    {
+#ifdef __XENO__
+      rt_task_yield();
+      rt_task_sleep(1000000);
+#else
+      ros::WallDuration(0.0001).sleep();
+#endif
+    }
+  }
+}
+
+// real-time threads publishing concurrently into all shards
+TEST(ShardedPublisher, multipleThreadsKeepOrder)
+{
+  ros::NodeHandle nh;
+
+  static const uint32_t count = 2 * thread_count;
+  Publisher<std_msgs::UInt32> pubs[count];
+
+  OrderHelper helpers[count];
+  ros::Subscriber subs[count];
+
+  boost::shared_ptr<rosrt::thread> threads[count];
+
+  bool done = false;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    std::stringstream topic;
+    topic << "test_sharded_threads" << i;
+    pubs[i].initialize(nh.advertise<std_msgs::UInt32>(topic.str(), 0), 100, std_msgs::UInt32());
+    subs[i] = nh.subscribe(topic.str(), 0, &OrderHelper::cb, &helpers[i]);
+  }
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    threads[i].reset(new rosrt::thread(boost::bind(publishThread, boost::ref(pubs[i]), boost::ref(done))));
+  }
+
+  uint32_t recv_count = 0;
+  while (recv_count < count * 10000)
+  {
+    ros::spinOnce();
+
+    recv_count = 0;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+      recv_count += helpers[i].count;
+    }
+
+#ifdef __XENO__
+    rt_task_yield();
+    rt_task_sleep(1000000);
+#else
+    ros::WallDuration(0.01).sleep();
+#endif
+  }
+
+  done = true;
+
+  for (uint32_t i=0; i<count; ++i)
+    threads[i]->join();
+
+  ASSERT_GE(recv_count, count * 10000);
+
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    EXPECT_TRUE(helpers[i].in_order);
+  }
+}
+
+int main(int argc, char** argv)
+{
+#ifdef __XENO__
+  mlockall(MCL_CURRENT | MCL_FUTURE);
+  rt_task_shadow(NULL, "test_rt_publisher_sharded", 1, 0);
+#endif
+
+  ros::init(argc, argv, "test_rt_publisher_sharded");
+  testing::InitGoogleTest(&argc, argv);
+
+  ros::NodeHandle nh;
+  rosrt::InitOptions ops;
+  ops.pubmanager_thread_count = thread_count;
+  rosrt::init(ops);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,206 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2010, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "rosrt/rosrt.h"
+
+#include <ros/ros.h>
+#include <ros/atomic.h>
+
+#include <std_msgs/UInt32.h>
+
+#include <boost/thread.hpp>
+
+#ifdef __XENO__
+#include <native/task.h>
+#include <sys/mman.h>
+#endif
+
+using namespace rosrt;
+
+void publishThread(ros::Publisher& pub, uint32_t count)
+{
+  std_msgs::UInt32 msg;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    msg.data = i;
+    pub.publish(msg);
+    ros::WallDuration(0.0001).sleep();
+  }
+}
+
+// publishes count messages, but never more than window ahead of what has been polled, so neither
+// queue can overflow however the threads are scheduled
+void pacedPublishThread(ros::Publisher& pub, uint32_t count, uint32_t window, ros::atomic<uint32_t>& polled)
+{
+  std_msgs::UInt32 msg;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    ros::WallTime start = ros::WallTime::now();
+    while (i >= polled.load() + window)
+    {
+      // the poller has given up
+      if (ros::WallTime::now() - start > ros::WallDuration(10.0))
+      {
+        return;
+      }
+      ros::WallDuration(0.0001).sleep();
+    }
+
+    msg.data = i;
+    pub.publish(msg);
+  }
+}
+
+struct Counter
+{
+  Counter(uint32_t& count, int32_t& last, bool& in_order)
+  : count_(count)
+  , last_(last)
+  , in_order_(in_order)
+  {}
+
+  void operator()(const std_msgs::UInt32ConstPtr& msg)
+  {
+    in_order_ = in_order_ && (int32_t)msg->data > last_;
+    last_ = msg->data;
+    ++count_;
+  }
+
+  uint32_t& count_;
+  int32_t& last_;
+  bool& in_order_;
+};
+
+TEST(QueuedSubscriber, pollBatchReceivesEveryMessage)
+{
+  ros::NodeHandle nh;
+  ros::Publisher pub = nh.advertise<std_msgs::UInt32>("test_queued", 1000);
+
+  QueuedSubscriber<std_msgs::UInt32> sub(1000, 2010, nh, "test_queued");
+  while (pub.getNumSubscribers() == 0)
+  {
+    ros::WallDuration(0.01).sleep();
+  }
+
+  const uint32_t msg_count = 10000;
+  const uint32_t window = 100;
+  ros::atomic<uint32_t> polled(0);
+  boost::thread t(boost::bind(pacedPublishThread, boost::ref(pub), msg_count, window, boost::ref(polled)));
+
+  resetThreadAllocInfo();
+
+  std_msgs::UInt32ConstPtr msgs[10];
+  uint32_t count = 0;
+  bool in_order = true;
+  ros::WallTime last_received = ros::WallTime::now();
+  while (count < msg_count && ros::WallTime::now() - last_received < ros::WallDuration(10.0))
+  {
+    uint32_t batch = sub.pollBatch(msgs, 10);
+    EXPECT_LE(batch, 10UL);
+    for (uint32_t i = 0; i < batch; ++i)
+    {
+      // every message arrives, in order
+      in_order = in_order && msgs[i]->data == count;
+      ++count;
+    }
+    if (batch > 0)
+    {
+      polled.store(count);
+      last_received = ros::WallTime::now();
+    }
+
+#ifdef  __XENO__
+    rt_task_sleep(1000000);
+#else
+    ros::WallDuration(0.001).sleep();
+#endif
+  }
+
+  t.join();
+
+  ASSERT_EQ(count, msg_count);
+  ASSERT_TRUE(in_order);
+  ASSERT_EQ(getThreadAllocInfo().total_ops, 0UL);
+  ASSERT_EQ(sub.getDropCount(), 0UL);
+  ASSERT_EQ(sub.getReceivedCount(), msg_count);
+}
+
+TEST(QueuedSubscriber, pollAllCountsDrops)
+{
+  ros::NodeHandle nh;
+  ros::Publisher pub = nh.advertise<std_msgs::UInt32>("test_queued_drops", 1000);
+
+  QueuedSubscriber<std_msgs::UInt32> sub(10, 30, nh, "test_queued_drops");
+  while (pub.getNumSubscribers() == 0)
+  {
+    ros::WallDuration(0.01).sleep();
+  }
+
+  // nobody polls while these are published, so everything beyond the queue depth is dropped
+  const uint32_t msg_count = 100;
+  publishThread(pub, msg_count);
+  ros::WallTime start = ros::WallTime::now();
+  while (sub.getDropCount() == 0 && ros::WallTime::now() - start < ros::WallDuration(10.0))
+  {
+    ros::WallDuration(0.01).sleep();
+  }
+
+  uint32_t count = 0;
+  int32_t last = -1;
+  bool in_order = true;
+  ASSERT_EQ(sub.pollAll(Counter(count, last, in_order)), 10UL);
+  ASSERT_EQ(count, 10UL);
+  ASSERT_TRUE(in_order);
+  ASSERT_EQ(sub.getReceivedCount(), 10UL);
+  ASSERT_GT(sub.getDropCount(), 0UL);
+  ASSERT_FALSE(sub.poll());
+}
+
+int main(int argc, char** argv)
+{
+#ifdef __XENO__
+  mlockall(MCL_CURRENT | MCL_FUTURE);
+  rt_task_shadow(NULL, "test_rt_queued_subscriber", 0, 0);
+#endif
+
+  ros::init(argc, argv, "test_rt_queued_subscriber");
+  testing::InitGoogleTest(&argc, argv);
+
+  ros::NodeHandle nh;
+  rosrt::init();
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,223 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2010, CLMC Lab, University of Southern California
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "rosrt/init.h"
+#include "rosrt/detail/simple_gc.h"
+#include "rosrt/detail/pool_gc.h"
+
+#include <ros/time.h>
+
+#include <boost/weak_ptr.hpp>
+
+using namespace rosrt;
+using namespace rosrt::detail;
+
+namespace
+{
+
+// far longer than any wait in these tests, so only a notification can wake the gc thread in time
+const double GC_PERIOD = 30.0;
+const double TIMEOUT = 5.0;
+
+ros::atomic<uint32_t> g_deleted(0);
+
+void deleteAndCount(void* pool)
+{
+  deletePool<uint32_t>(pool);
+  g_deleted.fetch_add(1);
+}
+
+InitOptions eventDrivenOptions()
+{
+  InitOptions ops;
+  ops.gc_event_driven = true;
+  ops.gc_period = ros::WallDuration(GC_PERIOD);
+  return ops;
+}
+
+template<typename Predicate>
+bool waitFor(Predicate predicate)
+{
+  ros::WallTime start = ros::WallTime::now();
+  while (!predicate())
+  {
+    if ((ros::WallTime::now() - start).toSec() > TIMEOUT)
+    {
+      return false;
+    }
+    ros::WallDuration(0.001).sleep();
+  }
+  return true;
+}
+
+bool isDeleted()
+{
+  return g_deleted.load() > 0;
+}
+
+struct AreDeleted
+{
+  AreDeleted(uint32_t count)
+  : count_(count)
+  {}
+
+  bool operator()() const
+  {
+    return g_deleted.load() >= count_;
+  }
+
+  uint32_t count_;
+};
+
+struct HasSegments
+{
+  HasSegments(lockfree::ObjectPool<uint32_t>& pool, uint32_t count)
+  : pool_(pool)
+  , count_(count)
+  {}
+
+  bool operator()() const
+  {
+    return pool_.getSegmentCount() >= count_;
+  }
+
+  lockfree::ObjectPool<uint32_t>& pool_;
+  uint32_t count_;
+};
+
+} // namespace
+
+TEST(SimpleGC, eventDrivenFreeWakesGC)
+{
+  g_deleted.store(0);
+  SimpleGC gc(eventDrivenOptions());
+
+  lockfree::ObjectPool<uint32_t>* pool = new lockfree::ObjectPool<uint32_t>(4, 0);
+  boost::shared_ptr<uint32_t> item = pool->allocateShared();
+  ASSERT_TRUE(item);
+  gc.add(pool, deleteAndCount, poolIsDeletable<uint32_t>, setPoolFreeCallback<uint32_t>);
+
+  // the pool is checked once when it's registered, and is kept alive by the item
+  ros::WallDuration(0.1).sleep();
+  EXPECT_EQ(g_deleted.load(), 0UL);
+
+  ros::WallTime start = ros::WallTime::now();
+  item.reset();
+  ASSERT_TRUE(waitFor(isDeleted));
+  EXPECT_LT((ros::WallTime::now() - start).toSec(), TIMEOUT);
+
+  // later notifications must not delete it again
+  ros::WallDuration(0.1).sleep();
+  EXPECT_EQ(g_deleted.load(), 1UL);
+}
+
+TEST(SimpleGC, eventDrivenWaitsForControlBlocks)
+{
+  const uint32_t count = 8;
+  g_deleted.store(0);
+  SimpleGC gc(eventDrivenOptions());
+
+  std::vector<boost::shared_ptr<uint32_t> > items;
+  std::vector<boost::weak_ptr<uint32_t> > weak_items;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    lockfree::ObjectPool<uint32_t>* pool = new lockfree::ObjectPool<uint32_t>(4, 0);
+    items.push_back(pool->allocateShared());
+    ASSERT_TRUE(items.back());
+    weak_items.push_back(items.back());
+    gc.add(pool, deleteAndCount, poolIsDeletable<uint32_t>, setPoolFreeCallback<uint32_t>);
+  }
+
+  // the weak pointers keep the control blocks, and with them the pools, after the objects are returned
+  items.clear();
+  ros::WallDuration(0.1).sleep();
+  EXPECT_EQ(g_deleted.load(), 0UL);
+
+  // returning the control blocks has to wake the gc thread
+  weak_items.clear();
+  ASSERT_TRUE(waitFor(AreDeleted(count)));
+
+  ros::WallDuration(0.1).sleep();
+  EXPECT_EQ(g_deleted.load(), count);
+}
+
+TEST(SimpleGC, eventDrivenGrowRequestWakesGC)
+{
+  // declared before the gc, so the gc thread is stopped before the pool goes away
+  lockfree::ObjectPool<uint32_t> pool;
+  pool.initialize(4, 0, 3, 1);
+  SimpleGC gc(eventDrivenOptions());
+  gc.addGrowable(&pool, growPool<uint32_t>, setPoolGrowCallback<uint32_t>);
+
+  std::vector<boost::shared_ptr<uint32_t> > items;
+  for (uint32_t i = 0; i < 2; ++i)
+  {
+    items.push_back(pool.allocateShared());
+    ASSERT_TRUE(items.back());
+  }
+  // let the gc thread register the pool, nothing has been requested yet
+  ros::WallDuration(0.1).sleep();
+  EXPECT_EQ(pool.getSegmentCount(), 1UL);
+
+  // crossing the low-water mark requests a segment and has to wake the gc thread
+  for (uint32_t i = 0; i < 2; ++i)
+  {
+    items.push_back(pool.allocateShared());
+    ASSERT_TRUE(items.back());
+  }
+  ASSERT_TRUE(waitFor(HasSegments(pool, 2)));
+
+  for (uint32_t i = 0; i < 4; ++i)
+  {
+    items.push_back(pool.allocateShared());
+    ASSERT_TRUE(items.back());
+  }
+  ASSERT_TRUE(waitFor(HasSegments(pool, 3)));
+  EXPECT_EQ(pool.getCapacity(), 12UL);
+
+  // at the maximum size further allocations don't request anything
+  for (uint32_t i = 0; i < 4; ++i)
+  {
+    items.push_back(pool.allocateShared());
+  }
+  EXPECT_FALSE(pool.isGrowRequested());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
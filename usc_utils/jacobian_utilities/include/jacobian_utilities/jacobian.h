@@ -33,6 +33,11 @@ public:
 
   bool initialize(const std::string& start_link = "BASE", const std::string& end_link = "R_PALM");
 
+  /*!
+   * Initializes from a given chain instead of the robot description
+   */
+  bool initialize(const KDL::Chain& kdl_chain);
+
   bool getJacobian(const Eigen::VectorXd& joint_values, Eigen::MatrixXd& jacobian);
 
   double getManipulabilityMeasure(const Eigen::VectorXd& joint_values);
@@ -44,6 +49,27 @@ public:
 
   void getManipulabilitySqrdPartDerivative(const Eigen::VectorXd& joint_values, double derivative_step, Eigen::VectorXd& part_derivatives);
 
+  /*!
+   * Computes the partial derivatives of the jacobian w.r.t. each joint from the jacobian itself, using the
+   * twist structure of the chain (the jacobian is expressed in the base frame with the reference point at the
+   * end effector, as returned by getJacobian). Needs a single jacobian instead of two per joint.
+   * @param jacobian
+   * @param derivatives derivatives[k] is the derivative of the jacobian w.r.t. joint k
+   */
+  static void getJacobianPartialDerivatives(const Eigen::MatrixXd& jacobian,
+                                            std::vector<Eigen::MatrixXd>& derivatives);
+
+  /*!
+   * Same as getJJTPartialDerivatives but computed analytically, see getJacobianPartialDerivatives
+   */
+  void getJJTPartialDerivativesAnalytic(const Eigen::VectorXd& joint_values,
+                                        std::vector< Eigen::Matrix<double, 6, 6>, Eigen::aligned_allocator<Eigen::Matrix<double, 6, 6> > >& derivatives);
+
+  /*!
+   * Same as getManipulabilitySqrdPartDerivative but computed analytically, see getJacobianPartialDerivatives
+   */
+  void getManipulabilitySqrdPartDerivativeAnalytic(const Eigen::VectorXd& joint_values, Eigen::VectorXd& part_derivatives);
+
 private:
 
   static const double ridge_factor_ = 10e-6;
@@ -65,6 +91,7 @@ private:
   int num_joints_;
 
   Eigen::MatrixXd jacobian_;
+  std::vector<Eigen::MatrixXd> jacobian_derivatives_;
 };
 
 }
@@ -28,8 +28,15 @@ bool Jacobian::initialize(const std::string& start_link, const std::string& end_
 
   ROS_VERIFY(urdf_.initParam("/robot_description"));
   ROS_VERIFY(kdl_parser::treeFromUrdfModel(urdf_, kdl_tree_));
-  ROS_VERIFY(kdl_tree_.getChain(start_link, end_link, kdl_chain_));
+  KDL::Chain kdl_chain;
+  ROS_VERIFY(kdl_tree_.getChain(start_link, end_link, kdl_chain));
 
+  return initialize(kdl_chain);
+}
+
+bool Jacobian::initialize(const KDL::Chain& kdl_chain)
+{
+  kdl_chain_ = kdl_chain;
   num_joints_ = kdl_chain_.getNrOfJoints();
   ROS_DEBUG("using %d joints", num_joints_);
 
@@ -38,6 +45,7 @@ bool Jacobian::initialize(const std::string& start_link, const std::string& end_
   kdl_joint_positions_.resize(num_joints_);
 
   jacobian_ = Eigen::MatrixXd::Zero(6, num_joints_);
+  jacobian_derivatives_.resize(num_joints_, Eigen::MatrixXd::Zero(6, num_joints_));
 
 
   initialized_ = true;
@@ -136,4 +144,81 @@ void Jacobian::getManipulabilitySqrdPartDerivative(const Eigen::VectorXd& joint_
   }
 }
 
+void Jacobian::getJacobianPartialDerivatives(const Eigen::MatrixXd& jacobian,
+                                             std::vector<Eigen::MatrixXd>& derivatives)
+{
+  ROS_ASSERT(jacobian.rows() == 6);
+  const int num_joints = jacobian.cols();
+  derivatives.resize(num_joints);
+
+  // with column i = [v_i; w_i], moving joint k rotates everything after it by w_k and
+  // moves the end effector by v_k (w_k and v_k are zero resp. the axis for prismatic joints):
+  //   dJ_i/dq_k = [w_k x v_i; w_k x w_i]  for k < i
+  //   dJ_i/dq_k = [w_i x v_k; 0]          for k >= i
+  for (int k = 0; k < num_joints; ++k)
+  {
+    derivatives[k].resize(6, num_joints);
+    const Eigen::Vector3d v_k = jacobian.block<3, 1>(0, k);
+    const Eigen::Vector3d w_k = jacobian.block<3, 1>(3, k);
+    for (int i = 0; i < num_joints; ++i)
+    {
+      const Eigen::Vector3d v_i = jacobian.block<3, 1>(0, i);
+      const Eigen::Vector3d w_i = jacobian.block<3, 1>(3, i);
+      if (k < i)
+      {
+        derivatives[k].block<3, 1>(0, i) = w_k.cross(v_i);
+        derivatives[k].block<3, 1>(3, i) = w_k.cross(w_i);
+      }
+      else
+      {
+        derivatives[k].block<3, 1>(0, i) = w_i.cross(v_k);
+        derivatives[k].block<3, 1>(3, i).setZero();
+      }
+    }
+  }
+}
+
+void Jacobian::getJJTPartialDerivativesAnalytic(const Eigen::VectorXd& joint_values,
+                                                std::vector< Eigen::Matrix<double, 6, 6>, Eigen::aligned_allocator<Eigen::Matrix<double, 6, 6> > >& derivatives)
+{
+  ROS_ASSERT(initialized_);
+
+  derivatives.resize(num_joints_);
+
+  getJacobian(joint_values, jacobian_);
+  getJacobianPartialDerivatives(jacobian_, jacobian_derivatives_);
+  for(int i=0; i<num_joints_; i++)
+  {
+    // d(JJT) = dJ JT + J dJT, the second term is the transpose of the first
+    derivatives[i].noalias() = jacobian_derivatives_[i] * jacobian_.transpose();
+    derivatives[i] += derivatives[i].transpose().eval();
+  }
+}
+
+void Jacobian::getManipulabilitySqrdPartDerivativeAnalytic(const Eigen::VectorXd& joint_values, Eigen::VectorXd& part_derivatives)
+{
+  ROS_ASSERT(initialized_);
+
+  //make a vector of the right size
+  part_derivatives = Eigen::VectorXd::Zero(num_joints_);
+
+  Eigen::Matrix<double, 6, 6> inv_JJT, JJT;
+
+  getJacobian(joint_values, jacobian_);
+  getJacobianPartialDerivatives(jacobian_, jacobian_derivatives_);
+
+  //compute the inverse adding some damping
+  JJT = jacobian_ * jacobian_.transpose();
+  inv_JJT = (JJT + ridge_factor_ * Eigen::Matrix<double, 6, 6>::Identity()).inverse();
+  double JJT_det = JJT.determinant();
+
+  Eigen::Matrix<double, 6, 6> JJT_derivative;
+  for(int i=0; i<num_joints_; i++)
+  {
+    JJT_derivative.noalias() = jacobian_derivatives_[i] * jacobian_.transpose();
+    JJT_derivative += JJT_derivative.transpose().eval();
+    part_derivatives[i] = JJT_det * (inv_JJT * JJT_derivative).trace();
+  }
+}
+
 }
@@ -0,0 +1,98 @@
+/*
+ * test_jacobian_derivatives.cpp
+ *
+ *  Checks the analytic partial derivatives of JJT against the finite difference ones
+ */
+
+#include <gtest/gtest.h>
+
+#include <ros/ros.h>
+
+#include <kdl/chain.hpp>
+#include <kdl/segment.hpp>
+#include <kdl/joint.hpp>
+#include <kdl/frames.hpp>
+
+#include <jacobian_utilities/jacobian.h>
+
+typedef std::vector< Eigen::Matrix<double, 6, 6>, Eigen::aligned_allocator<Eigen::Matrix<double, 6, 6> > > JJTDerivatives;
+
+static KDL::Chain getTestChain()
+{
+  // arm like chain with one prismatic joint and an offset tip
+  KDL::Chain chain;
+  chain.addSegment(KDL::Segment(KDL::Joint(KDL::Joint::RotZ), KDL::Frame(KDL::Vector(0.0, 0.0, 0.3))));
+  chain.addSegment(KDL::Segment(KDL::Joint(KDL::Joint::RotY), KDL::Frame(KDL::Rotation::RPY(0.2, 0.0, 0.1), KDL::Vector(0.0, 0.1, 0.4))));
+  chain.addSegment(KDL::Segment(KDL::Joint(KDL::Joint::RotX), KDL::Frame(KDL::Vector(0.05, 0.0, 0.2))));
+  chain.addSegment(KDL::Segment(KDL::Joint(KDL::Joint::TransZ), KDL::Frame(KDL::Vector(0.0, 0.0, 0.1))));
+  chain.addSegment(KDL::Segment(KDL::Joint(KDL::Joint::RotY), KDL::Frame(KDL::Rotation::RPY(-0.3, 0.4, 0.0), KDL::Vector(0.0, 0.0, 0.3))));
+  chain.addSegment(KDL::Segment(KDL::Joint(KDL::Joint::RotZ), KDL::Frame(KDL::Vector(0.0, 0.05, 0.1))));
+  chain.addSegment(KDL::Segment(KDL::Joint(KDL::Joint::RotX), KDL::Frame(KDL::Vector(0.1, 0.0, 0.15))));
+  chain.addSegment(KDL::Segment(KDL::Joint(KDL::Joint::None), KDL::Frame(KDL::Vector(0.0, 0.0, 0.1))));
+  return chain;
+}
+
+TEST(jacobian_utilities, analyticJacobianDerivatives)
+{
+  jacobian_utilities::Jacobian jacobian;
+  ASSERT_TRUE(jacobian.initialize(getTestChain()));
+
+  const int num_joints = 7;
+  Eigen::VectorXd joint_values(num_joints);
+  joint_values << 0.3, -0.7, 1.1, 0.2, 0.5, -1.3, 0.8;
+
+  Eigen::MatrixXd jac;
+  ASSERT_TRUE(jacobian.getJacobian(joint_values, jac));
+  std::vector<Eigen::MatrixXd> jacobian_derivatives;
+  jacobian_utilities::Jacobian::getJacobianPartialDerivatives(jac, jacobian_derivatives);
+  ASSERT_EQ((int)jacobian_derivatives.size(), num_joints);
+
+  const double derivative_step = 1e-6;
+  for (int k = 0; k < num_joints; ++k)
+  {
+    Eigen::VectorXd sample_joints = joint_values;
+    Eigen::MatrixXd jac_p, jac_m;
+    sample_joints[k] += derivative_step;
+    jacobian.getJacobian(sample_joints, jac_p);
+    sample_joints[k] -= 2 * derivative_step;
+    jacobian.getJacobian(sample_joints, jac_m);
+    Eigen::MatrixXd numeric = (jac_p - jac_m) / (2 * derivative_step);
+    EXPECT_LT((numeric - jacobian_derivatives[k]).cwiseAbs().maxCoeff(), 1e-6) << "joint " << k;
+  }
+}
+
+TEST(jacobian_utilities, analyticJJTDerivatives)
+{
+  jacobian_utilities::Jacobian jacobian;
+  ASSERT_TRUE(jacobian.initialize(getTestChain()));
+
+  const int num_joints = 7;
+  Eigen::VectorXd joint_values(num_joints);
+  joint_values << -0.4, 0.9, -0.2, 0.1, -1.0, 0.6, 0.3;
+
+  const double derivative_step = 1e-6;
+  JJTDerivatives numeric, analytic;
+  jacobian.getJJTPartialDerivatives(joint_values, derivative_step, numeric);
+  jacobian.getJJTPartialDerivativesAnalytic(joint_values, analytic);
+  ASSERT_EQ(numeric.size(), analytic.size());
+  for (int k = 0; k < (int)numeric.size(); ++k)
+  {
+    EXPECT_LT((numeric[k] - analytic[k]).cwiseAbs().maxCoeff(), 1e-6) << "joint " << k;
+  }
+
+  Eigen::VectorXd numeric_manipulability, analytic_manipulability;
+  jacobian.getManipulabilitySqrdPartDerivative(joint_values, derivative_step, numeric_manipulability);
+  jacobian.getManipulabilitySqrdPartDerivativeAnalytic(joint_values, analytic_manipulability);
+  ASSERT_EQ(numeric_manipulability.size(), analytic_manipulability.size());
+  for (int k = 0; k < numeric_manipulability.size(); ++k)
+  {
+    EXPECT_NEAR(numeric_manipulability[k], analytic_manipulability[k], 1e-6 * std::max(1.0, fabs(numeric_manipulability[k])));
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "test_jacobian_derivatives");
+  return RUN_ALL_TESTS();
+}
@@ -79,6 +79,26 @@ bool resample(const std::vector<double>& input_vector,
               bool compute_slope,
               bool verbose = false);
 
+/*!
+ * Resamples several variables recorded at the same time stamps. Invalid time stamps are removed once and
+ * the b-spline system is factored once for all of them, only the right hand side is solved per variable.
+ * @param input_vector
+ * @param target_vectors one vector per variable, each of the same size as input_vector
+ * @param cutoff_wave_length
+ * @param input_querry
+ * @param output_vectors one vector per variable
+ * @param compute_slope
+ * @param verbose
+ * @return True on success, otherwise False
+ */
+bool resample(const std::vector<double>& input_vector,
+              const std::vector<std::vector<double> >& target_vectors,
+              const double cutoff_wave_length,
+              const std::vector<double>& input_querry,
+              std::vector<std::vector<double> >& output_vectors,
+              bool compute_slope,
+              bool verbose = false);
+
 /**
  * Given input samples of input_y = f(input_x), calculates output_y = f(output_x) using linear interpolation
  * Assumes that input_x and output_x are sorted!
@@ -176,8 +196,6 @@ inline bool resample(const std::vector<double>& input_vector,
   ROS_ASSERT_MSG(!input_querry.empty(), "Input querry is empty. Cannot resample trajecoty using a bspline.");
   ROS_VERIFY(input_vector.size() == target_vector.size());
 
-  const int num_rows = static_cast<int> (target_vector.size());
-
   // ROS_VERIFY(removeInvalidData(input_vector, target_vector));
   // ###################################################################
   std::vector<double> tmp_input_vector = input_vector;
@@ -206,6 +224,7 @@ inline bool resample(const std::vector<double>& input_vector,
   }
   // ###################################################################
 
+  const int num_rows = static_cast<int> (tmp_target_vector.size());
   double x_vector[num_rows];
   double y_vector[num_rows];
   for (int i = 0; i < num_rows; ++i)
@@ -268,6 +287,92 @@ inline bool resample(const std::vector<double>& input_vector,
   return true;
 }
 
+inline bool resample(const std::vector<double>& input_vector,
+                     const std::vector<std::vector<double> >& target_vectors,
+                     const double cutoff_wave_length,
+                     const std::vector<double>& input_querry,
+                     std::vector<std::vector<double> >& output_vectors,
+                     bool compute_slope,
+                     bool verbose)
+{
+  ROS_ASSERT_MSG(!input_vector.empty(), "Input vector is empty. Cannot resample trajecoty using a bspline.");
+  ROS_ASSERT_MSG(!input_querry.empty(), "Input querry is empty. Cannot resample trajecoty using a bspline.");
+
+  const int num_variables = static_cast<int> (target_vectors.size());
+  const int num_inputs = static_cast<int> (input_vector.size());
+  const int num_samples = static_cast<int> (input_querry.size());
+  output_vectors.resize(num_variables);
+  if (num_variables == 0)
+  {
+    return true;
+  }
+
+  // remove invalid data points in a single pass, the time stamps are the same for all variables
+  std::vector<double> x_vector;
+  std::vector<std::vector<double> > y_vectors(num_variables);
+  x_vector.reserve(num_inputs);
+  for (int j = 0; j < num_variables; ++j)
+  {
+    ROS_VERIFY(static_cast<int> (target_vectors[j].size()) == num_inputs);
+    y_vectors[j].reserve(num_inputs);
+  }
+  for (int i = 0; i < num_inputs; ++i)
+  {
+    if (input_vector[i] >= 1e-6)
+    {
+      x_vector.push_back(input_vector[i]);
+      for (int j = 0; j < num_variables; ++j)
+      {
+        y_vectors[j].push_back(target_vectors[j][i]);
+      }
+    }
+  }
+  const int num_rows = static_cast<int> (x_vector.size());
+  const int invalid_data_counter = num_inputs - num_rows;
+  if (invalid_data_counter > num_rows)
+  {
+    ROS_WARN("Found >%i< invalid data points when resampling the trajectory.", invalid_data_counter);
+  }
+  if (num_rows == 0)
+  {
+    ROS_ERROR("No valid data points left. Cannot resample trajectory using a bspline.");
+    return false;
+  }
+
+  // the domain (and the factorization of the b-spline system) only depends on the time stamps
+  BSpline<double>::Debug(0);
+  BSpline<double> b_spline(&(x_vector[0]), num_rows, &(y_vectors[0][0]), cutoff_wave_length);
+  for (int j = 0; j < num_variables; ++j)
+  {
+    if ((j > 0 && !b_spline.solve(&(y_vectors[j][0]))) || !b_spline.ok())
+    {
+      ROS_ERROR("Could not create b-spline for variable >%i< of >%i< from >%i< valid data points with cutoff >%f<.",
+                j, num_variables, num_rows, cutoff_wave_length);
+      if (verbose)
+      {
+        log(x_vector, "/tmp/bspline_input.txt");
+        log(y_vectors[j], "/tmp/bspline_target.txt");
+        log(input_querry, "/tmp/bspline_querry.txt");
+      }
+      return false;
+    }
+
+    output_vectors[j].resize(num_samples);
+    for (int s = 0; s < num_samples; ++s)
+    {
+      if (compute_slope)
+      {
+        output_vectors[j][s] = b_spline.slope(input_querry[s]);
+      }
+      else
+      {
+        output_vectors[j][s] = b_spline.evaluate(input_querry[s]);
+      }
+    }
+  }
+  return true;
+}
+
 //inline bool resample(const std::vector<ros::Time>& time_stamps,
 //                     const std::vector<std::vector<double> >& values,
 //                     const int num_samples,
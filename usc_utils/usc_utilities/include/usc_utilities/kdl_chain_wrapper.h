@@ -38,7 +38,9 @@
 #define UTILITIES_KDL_CHAIN_WRAPPER_H_
 
 // system includes
+#include <vector>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/tss.hpp>
 
 // ros includes
 #include <ros/ros.h>
@@ -49,6 +51,7 @@
 #include <kdl/chainfksolverpos_recursive.hpp>
 #include <kdl/tree.hpp>
 #include <kdl/chain.hpp>
+#include <kdl/jacobian.hpp>
 
 #include <sensor_msgs/JointState.h>
 
@@ -62,11 +65,33 @@ namespace usc_utilities
  *
  * Hides "mimic" joints from the user.
  *
- * \warning This class is not thread-safe!
+ * Once initialized, the forward kinematics functions can be called from several threads. Each thread
+ * uses its own Workspace, either one passed in explicitly or one that is created on first use.
+ * \warning initialize() is not thread-safe!
  */
 class KDLChainWrapper
 {
 public:
+
+  /**
+   * Scratch space for the forward kinematics of one thread. Holds its own copy of the chain, since KDL
+   * joints cache their last pose. Keeps the link transforms of the last configuration, consecutive
+   * samples only recompute the links after the first joint that changed.
+   */
+  class Workspace
+  {
+  public:
+    Workspace() : num_valid_frames(0) {};
+
+  private:
+    friend class KDLChainWrapper;
+    KDL::Chain chain;
+    KDL::JntArray real_joint_array;
+    KDL::JntArray last_real_joint_array;
+    std::vector<KDL::Frame> link_frames; /**< frame of each segment tip w.r.t. the root */
+    int num_valid_frames;
+  };
+
   KDLChainWrapper();
   virtual ~KDLChainWrapper();
 
@@ -119,6 +144,41 @@ public:
   bool forwardKinematics(const KDL::JntArray& jnt_array, KDL::Frame& frame);
   bool forwardKinematics(const std::vector<double>& jnt_array, KDL::Frame& frame);
 
+  /**
+   * Perform forward kinematics, and optionally compute the jacobian (w.r.t. the non mimic joints,
+   * expressed in the root frame with the reference point at the tip), using the given workspace
+   * @param workspace must not be used by another thread at the same time
+   * @param jnt_array
+   * @param frame
+   * @param jacobian resized if needed, can be NULL
+   * @return
+   */
+  bool forwardKinematics(Workspace& workspace, const std::vector<double>& jnt_array, KDL::Frame& frame,
+                         KDL::Jacobian* jacobian = NULL) const;
+
+  /**
+   * Perform forward kinematics for many joint arrays at once. Consecutive joint arrays share the link
+   * transforms up to the first joint that differs.
+   * @param jnt_arrays
+   * @param frames resized to the number of joint arrays
+   * @return
+   */
+  bool forwardKinematics(const std::vector<std::vector<double> >& jnt_arrays, std::vector<KDL::Frame>& frames) const;
+  bool forwardKinematics(Workspace& workspace, const std::vector<std::vector<double> >& jnt_arrays,
+                         std::vector<KDL::Frame>& frames) const;
+
+  /**
+   * Perform forward kinematics and compute the jacobians for many joint arrays at once
+   * @param jnt_arrays
+   * @param frames resized to the number of joint arrays
+   * @param jacobians resized to the number of joint arrays
+   * @return
+   */
+  bool forwardKinematics(const std::vector<std::vector<double> >& jnt_arrays, std::vector<KDL::Frame>& frames,
+                         std::vector<KDL::Jacobian>& jacobians) const;
+  bool forwardKinematics(Workspace& workspace, const std::vector<std::vector<double> >& jnt_arrays,
+                         std::vector<KDL::Frame>& frames, std::vector<KDL::Jacobian>& jacobians) const;
+
   /**
    * Converts a sensor_msgs::JointState ROS message into a KDL::JntArrayVel object
    * @param joint_state
@@ -164,7 +224,12 @@ private:
   KDL::Tree kdl_tree_;
   KDL::Chain kdl_chain_;
 
-  KDL::JntArray real_joint_array;
+  /** workspace of each thread that doesn't pass its own */
+  mutable boost::thread_specific_ptr<Workspace> thread_workspace_;
+  Workspace& getThreadWorkspace() const;
+  void initWorkspace(Workspace& workspace) const;
+  void updateLinkFrames(Workspace& workspace) const;
+  void computeJacobian(const Workspace& workspace, KDL::Jacobian& jacobian) const;
 
   boost::shared_ptr<KDL::ChainFkSolverVel> jnt_to_pose_vel_solver_;
   boost::shared_ptr<KDL::ChainFkSolverPos> jnt_to_pose_solver_;
@@ -175,13 +240,15 @@ private:
   std::map<std::string, int> joint_name_to_index_;
 
   std::vector<JointInfo> mimic_joints_;
+  std::vector<int> segment_to_real_joint_index_; /**< -1 for fixed segments */
+  std::vector<int> real_joint_to_segment_index_;
 
   int num_real_joints_;
   int num_joints_;      /**< num total joints excluding mimic joints */
   int num_mimic_joints_;
 
-  void jointArrayToRealJointArray(const std::vector<double>& joint_array, KDL::JntArray& real_joint_array);
-  void jointArrayToRealJointArray(const KDL::JntArray& joint_array, KDL::JntArray& real_joint_array);
+  void jointArrayToRealJointArray(const std::vector<double>& joint_array, KDL::JntArray& real_joint_array) const;
+  void jointArrayToRealJointArray(const KDL::JntArray& joint_array, KDL::JntArray& real_joint_array) const;
 
   int getRealJointIndex(std::string& name);
 
@@ -43,7 +43,8 @@
 namespace usc_utilities
 {
 
-KDLChainWrapper::KDLChainWrapper()
+KDLChainWrapper::KDLChainWrapper() :
+  initialized_(false)
 {
 }
 
@@ -105,8 +106,6 @@ bool KDLChainWrapper::initialize(const std::string& root_frame, const std::strin
     return false;
   }
 
-  real_joint_array.resize(num_real_joints_);
-
   return (initialized_ = true);
 }
 
@@ -169,6 +168,8 @@ void KDLChainWrapper::createJointNameMappings()
 {
   real_joint_names_.clear();
   real_joint_name_to_index_.clear();
+  segment_to_real_joint_index_.clear();
+  real_joint_to_segment_index_.clear();
 
   int joint_number=0;
   for (int i=0; i<int(kdl_chain_.segments.size()); ++i)
@@ -180,10 +181,15 @@ void KDLChainWrapper::createJointNameMappings()
       std::string name = segment.getJoint().getName();
       real_joint_names_.push_back(name);
       real_joint_name_to_index_.insert(std::make_pair(name, joint_number));
-
+      segment_to_real_joint_index_.push_back(joint_number);
+      real_joint_to_segment_index_.push_back(i);
 
       ++joint_number;
     }
+    else
+    {
+      segment_to_real_joint_index_.push_back(-1);
+    }
   }
 }
 
@@ -218,15 +224,148 @@ bool KDLChainWrapper::forwardKinematics(const sensor_msgs::JointState& joint_sta
 bool KDLChainWrapper::forwardKinematics(const KDL::JntArray& jnt_array, KDL::Frame& frame)
 {
   ROS_ASSERT(initialized_);
-  jointArrayToRealJointArray(jnt_array, real_joint_array);
-  return (jnt_to_pose_solver_->JntToCart(real_joint_array, frame) >= 0);
+  Workspace& workspace = getThreadWorkspace();
+  jointArrayToRealJointArray(jnt_array, workspace.real_joint_array);
+  updateLinkFrames(workspace);
+  frame = workspace.link_frames.empty() ? KDL::Frame::Identity() : workspace.link_frames.back();
+  return true;
 }
 
 bool KDLChainWrapper::forwardKinematics(const std::vector<double>& jnt_array, KDL::Frame& frame)
 {
   ROS_ASSERT(initialized_);
-  jointArrayToRealJointArray(jnt_array, real_joint_array);
-  return (jnt_to_pose_solver_->JntToCart(real_joint_array, frame) >= 0);
+  return forwardKinematics(getThreadWorkspace(), jnt_array, frame);
+}
+
+bool KDLChainWrapper::forwardKinematics(Workspace& workspace, const std::vector<double>& jnt_array, KDL::Frame& frame,
+                                        KDL::Jacobian* jacobian) const
+{
+  ROS_ASSERT(initialized_);
+  if (static_cast<int>(workspace.link_frames.size()) != static_cast<int>(kdl_chain_.segments.size()))
+  {
+    initWorkspace(workspace);
+  }
+  jointArrayToRealJointArray(jnt_array, workspace.real_joint_array);
+  updateLinkFrames(workspace);
+  frame = workspace.link_frames.empty() ? KDL::Frame::Identity() : workspace.link_frames.back();
+  if (jacobian)
+  {
+    computeJacobian(workspace, *jacobian);
+  }
+  return true;
+}
+
+bool KDLChainWrapper::forwardKinematics(const std::vector<std::vector<double> >& jnt_arrays,
+                                        std::vector<KDL::Frame>& frames) const
+{
+  return forwardKinematics(getThreadWorkspace(), jnt_arrays, frames);
+}
+
+bool KDLChainWrapper::forwardKinematics(Workspace& workspace, const std::vector<std::vector<double> >& jnt_arrays,
+                                        std::vector<KDL::Frame>& frames) const
+{
+  frames.resize(jnt_arrays.size());
+  for (int i=0; i<int(jnt_arrays.size()); ++i)
+  {
+    if (!forwardKinematics(workspace, jnt_arrays[i], frames[i]))
+      return false;
+  }
+  return true;
+}
+
+bool KDLChainWrapper::forwardKinematics(const std::vector<std::vector<double> >& jnt_arrays,
+                                        std::vector<KDL::Frame>& frames, std::vector<KDL::Jacobian>& jacobians) const
+{
+  return forwardKinematics(getThreadWorkspace(), jnt_arrays, frames, jacobians);
+}
+
+bool KDLChainWrapper::forwardKinematics(Workspace& workspace, const std::vector<std::vector<double> >& jnt_arrays,
+                                        std::vector<KDL::Frame>& frames, std::vector<KDL::Jacobian>& jacobians) const
+{
+  frames.resize(jnt_arrays.size());
+  jacobians.resize(jnt_arrays.size());
+  for (int i=0; i<int(jnt_arrays.size()); ++i)
+  {
+    if (!forwardKinematics(workspace, jnt_arrays[i], frames[i], &jacobians[i]))
+      return false;
+  }
+  return true;
+}
+
+KDLChainWrapper::Workspace& KDLChainWrapper::getThreadWorkspace() const
+{
+  Workspace* workspace = thread_workspace_.get();
+  if (!workspace)
+  {
+    workspace = new Workspace();
+    thread_workspace_.reset(workspace);
+  }
+  if (static_cast<int>(workspace->link_frames.size()) != static_cast<int>(kdl_chain_.segments.size()))
+  {
+    initWorkspace(*workspace);
+  }
+  return *workspace;
+}
+
+void KDLChainWrapper::initWorkspace(Workspace& workspace) const
+{
+  workspace.chain = kdl_chain_;
+  workspace.real_joint_array.resize(num_real_joints_);
+  workspace.last_real_joint_array.resize(num_real_joints_);
+  workspace.link_frames.resize(kdl_chain_.segments.size());
+  workspace.num_valid_frames = 0;
+}
+
+void KDLChainWrapper::updateLinkFrames(Workspace& workspace) const
+{
+  // the link transforms before the first joint that changed are still valid
+  int first_segment = workspace.num_valid_frames;
+  for (int i=0; i<num_real_joints_ && real_joint_to_segment_index_[i] < first_segment; ++i)
+  {
+    if (workspace.real_joint_array(i) != workspace.last_real_joint_array(i))
+    {
+      first_segment = real_joint_to_segment_index_[i];
+    }
+  }
+
+  const int num_segments = static_cast<int>(kdl_chain_.segments.size());
+  KDL::Frame frame = (first_segment > 0) ? workspace.link_frames[first_segment - 1] : KDL::Frame::Identity();
+  for (int s=first_segment; s<num_segments; ++s)
+  {
+    const int joint_index = segment_to_real_joint_index_[s];
+    frame = frame * workspace.chain.segments[s].pose(joint_index >= 0 ? workspace.real_joint_array(joint_index) : 0.0);
+    workspace.link_frames[s] = frame;
+  }
+  workspace.num_valid_frames = num_segments;
+  workspace.last_real_joint_array = workspace.real_joint_array;
+}
+
+void KDLChainWrapper::computeJacobian(const Workspace& workspace, KDL::Jacobian& jacobian) const
+{
+  if (static_cast<int>(jacobian.columns()) != num_joints_)
+  {
+    jacobian.resize(num_joints_);
+  }
+  jacobian.data.setZero();
+
+  const KDL::Vector tip = workspace.link_frames.empty() ? KDL::Vector::Zero() : workspace.link_frames.back().p;
+  for (int i=0; i<num_real_joints_; ++i)
+  {
+    // same as KDL::ChainJntToJacSolver: the segment twist w.r.t. its tip, rotated into the root frame and
+    // moved to the chain tip. Mimic joints add to the column of the joint they mimic
+    const int s = real_joint_to_segment_index_[i];
+    const KDL::Rotation rotation = (s > 0) ? workspace.link_frames[s - 1].M : KDL::Rotation::Identity();
+    KDL::Twist twist = rotation * workspace.chain.segments[s].twist(workspace.real_joint_array(i), 1.0);
+    twist = twist.RefPoint(tip - workspace.link_frames[s].p);
+
+    const int column = mimic_joints_[i].mimic_joint;
+    const double multiplier = mimic_joints_[i].multiplier;
+    for (int k=0; k<3; ++k)
+    {
+      jacobian.data(k, column) += multiplier * twist.vel(k);
+      jacobian.data(k + 3, column) += multiplier * twist.rot(k);
+    }
+  }
 }
 
 /*bool KDLChainWrapper::jointStateMsgToJntArrayVel(const sensor_msgs::JointState& joint_state, KDL::JntArrayVel& jnt_array_vel) const
@@ -297,7 +436,7 @@ int KDLChainWrapper::getRealJointIndex(std::string& name)
   return it->second;
 }
 
-void KDLChainWrapper::jointArrayToRealJointArray(const std::vector<double>& joint_array, KDL::JntArray& real_joint_array)
+void KDLChainWrapper::jointArrayToRealJointArray(const std::vector<double>& joint_array, KDL::JntArray& real_joint_array) const
 {
   ROS_ASSERT(int(joint_array.size()) == num_joints_);
   ROS_ASSERT(int(real_joint_array.rows()) == num_real_joints_);
@@ -308,7 +447,7 @@ void KDLChainWrapper::jointArrayToRealJointArray(const std::vector<double>& join
   }
 }
 
-void KDLChainWrapper::jointArrayToRealJointArray(const KDL::JntArray& joint_array, KDL::JntArray& real_joint_array)
+void KDLChainWrapper::jointArrayToRealJointArray(const KDL::JntArray& joint_array, KDL::JntArray& real_joint_array) const
 {
   ROS_ASSERT(int(joint_array.rows()) == num_joints_);
   ROS_ASSERT(int(real_joint_array.rows()) == num_real_joints_);
@@ -0,0 +1,117 @@
+/*********************************************************************
+  Computational Learning and Motor Control Lab
+  University of Southern California
+  Prof. Stefan Schaal
+ *********************************************************************
+  \remarks		Compares the multi-variable resample, which factors the
+                b-spline system once, with resampling every variable on
+                its own.
+
+  \file		bspline_test.cpp
+
+ *********************************************************************/
+
+// system includes
+#include <cmath>
+#include <vector>
+
+// local includes
+#include <gtest/gtest.h>
+#include <usc_utilities/bspline.h>
+
+using namespace usc_utilities;
+
+static const int NUM_INPUTS = 500;
+static const int NUM_QUERRIES = 300;
+static const int NUM_VARIABLES = 20;
+static const double CUTOFF_WAVE_LENGTH = 0.3;
+
+/*!
+ * Slightly irregular time stamps, invalid_stamps of them are zero and have to be removed
+ */
+static void createInput(const int invalid_stamps,
+                        std::vector<double>& input_vector,
+                        std::vector<std::vector<double> >& target_vectors,
+                        std::vector<double>& input_querry)
+{
+  input_vector.resize(NUM_INPUTS);
+  for (int i = 0; i < NUM_INPUTS; ++i)
+  {
+    input_vector[i] = 0.001 + i * 0.01 + 0.002 * sin(static_cast<double> (i));
+  }
+  for (int k = 0; k < invalid_stamps; ++k)
+  {
+    input_vector[5 + 37 * k] = 0.0;
+  }
+
+  target_vectors.resize(NUM_VARIABLES);
+  for (int j = 0; j < NUM_VARIABLES; ++j)
+  {
+    target_vectors[j].resize(NUM_INPUTS);
+    for (int i = 0; i < NUM_INPUTS; ++i)
+    {
+      target_vectors[j][i] = sin(0.1 * j + input_vector[i] * (1 + j % 7)) + 0.01 * cos(37.0 * i);
+    }
+  }
+
+  input_querry.resize(NUM_QUERRIES);
+  for (int s = 0; s < NUM_QUERRIES; ++s)
+  {
+    input_querry[s] = 0.05 + s * 0.016;
+  }
+}
+
+/*!
+ * The multi-variable resample is meant to be bit-identical to resampling one variable at a time
+ */
+static void expectEqualToSingleResample(const int invalid_stamps, const bool compute_slope)
+{
+  std::vector<double> input_vector;
+  std::vector<std::vector<double> > target_vectors;
+  std::vector<double> input_querry;
+  createInput(invalid_stamps, input_vector, target_vectors, input_querry);
+
+  std::vector<std::vector<double> > output_vectors;
+  ASSERT_TRUE(resample(input_vector, target_vectors, CUTOFF_WAVE_LENGTH, input_querry, output_vectors, compute_slope));
+  ASSERT_EQ(static_cast<int>(output_vectors.size()), NUM_VARIABLES);
+
+  for (int j = 0; j < NUM_VARIABLES; ++j)
+  {
+    std::vector<double> output_vector;
+    ASSERT_TRUE(resample(input_vector, target_vectors[j], CUTOFF_WAVE_LENGTH, input_querry, output_vector, compute_slope));
+    ASSERT_EQ(output_vectors[j].size(), output_vector.size());
+    for (int s = 0; s < NUM_QUERRIES; ++s)
+    {
+      EXPECT_EQ(output_vectors[j][s], output_vector[s]) << "variable " << j << ", querry " << s;
+    }
+  }
+}
+
+TEST(UscUtilitiesBSpline, resampleVariablesEqualsSingleResample)
+{
+  expectEqualToSingleResample(0, false);
+}
+
+TEST(UscUtilitiesBSpline, resampleVariablesEqualsSingleResampleSlope)
+{
+  expectEqualToSingleResample(0, true);
+}
+
+TEST(UscUtilitiesBSpline, resampleVariablesRemovesInvalidData)
+{
+  expectEqualToSingleResample(3, false);
+  expectEqualToSingleResample(3, true);
+}
+
+TEST(UscUtilitiesBSpline, resampleNoVariables)
+{
+  std::vector<double> input_vector;
+  std::vector<std::vector<double> > target_vectors;
+  std::vector<double> input_querry;
+  createInput(0, input_vector, target_vectors, input_querry);
+  target_vectors.clear();
+
+  std::vector<std::vector<double> > output_vectors(2);
+  EXPECT_TRUE(resample(input_vector, target_vectors, CUTOFF_WAVE_LENGTH, input_querry, output_vectors, false));
+  EXPECT_TRUE(output_vectors.empty());
+}
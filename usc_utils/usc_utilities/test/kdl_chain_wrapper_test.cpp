@@ -0,0 +1,230 @@
+/*********************************************************************
+  Computational Learning and Motor Control Lab
+  University of Southern California
+  Prof. Stefan Schaal
+ *********************************************************************
+  \remarks		Compares the forward kinematics and jacobians of the
+                KDLChainWrapper with the KDL solvers on the chain in
+                test/kdl_chain_wrapper_test.urdf
+
+  \file		kdl_chain_wrapper_test.cpp
+
+ *********************************************************************/
+
+// system includes
+#include <cstdlib>
+#include <vector>
+#include <string>
+#include <gtest/gtest.h>
+
+#include <kdl/chainfksolverpos_recursive.hpp>
+#include <kdl/chainjnttojacsolver.hpp>
+
+// local includes
+#include <usc_utilities/kdl_chain_wrapper.h>
+
+using namespace usc_utilities;
+
+static const std::string ROOT_FRAME = "base_link";
+static const std::string TIP_FRAME = "tip_link";
+static const std::string MIMIC_JOINT = "joint_2_mimic";
+static const std::string MIMICKED_JOINT = "joint_2";
+static const double MIMIC_MULTIPLIER = 0.5;
+static const double MIMIC_OFFSET = 0.1;
+static const double TOLERANCE = 1e-10;
+
+class KDLChainWrapperTest : public testing::Test
+{
+protected:
+
+  virtual void SetUp()
+  {
+    ASSERT_TRUE(wrapper_.initialize(ROOT_FRAME, TIP_FRAME));
+    wrapper_.getChain(chain_);
+    wrapper_.getJointNames(joint_names_);
+    ASSERT_EQ(3, wrapper_.getNumJoints());
+    ASSERT_EQ(4, static_cast<int>(chain_.getNrOfJoints()));
+
+    // column of the wrapper jacobian and multiplier of each real joint
+    for (unsigned int s = 0; s < chain_.getNrOfSegments(); ++s)
+    {
+      const KDL::Joint& joint = chain_.getSegment(s).getJoint();
+      if (joint.getType() == KDL::Joint::None)
+        continue;
+      const bool is_mimic = (joint.getName() == MIMIC_JOINT);
+      const int column = getJointIndex(is_mimic ? MIMICKED_JOINT : joint.getName());
+      ASSERT_GE(column, 0);
+      real_joint_columns_.push_back(column);
+      real_joint_multipliers_.push_back(is_mimic ? MIMIC_MULTIPLIER : 1.0);
+      real_joint_offsets_.push_back(is_mimic ? MIMIC_OFFSET : 0.0);
+    }
+  }
+
+  int getJointIndex(const std::string& name) const
+  {
+    for (int i = 0; i < static_cast<int>(joint_names_.size()); ++i)
+    {
+      if (joint_names_[i] == name)
+        return i;
+    }
+    return -1;
+  }
+
+  /* samples where consecutive joint arrays only differ in the later joints, so that the wrapper
+   * reuses the link transforms of the previous sample */
+  void createSamples(std::vector<std::vector<double> >& jnt_arrays) const
+  {
+    srand48(0);
+    std::vector<double> jnt_array(joint_names_.size(), 0.0);
+    jnt_arrays.clear();
+    for (int i = 0; i < 30; ++i)
+    {
+      const int first_changed = i % static_cast<int>(jnt_array.size());
+      for (int j = first_changed; j < static_cast<int>(jnt_array.size()); ++j)
+      {
+        jnt_array[j] = drand48() - 0.5;
+      }
+      jnt_arrays.push_back(jnt_array);
+      // repeated sample, nothing changed
+      if (i % 7 == 0)
+        jnt_arrays.push_back(jnt_array);
+    }
+  }
+
+  void computeExpected(const std::vector<double>& jnt_array, KDL::Frame& frame, KDL::Jacobian& jacobian) const
+  {
+    KDL::JntArray real_jnt_array(chain_.getNrOfJoints());
+    for (unsigned int i = 0; i < real_jnt_array.rows(); ++i)
+    {
+      real_jnt_array(i) = real_joint_offsets_[i] + real_joint_multipliers_[i] * jnt_array[real_joint_columns_[i]];
+    }
+
+    KDL::ChainFkSolverPos_recursive fk_solver(chain_);
+    ASSERT_GE(fk_solver.JntToCart(real_jnt_array, frame), 0);
+
+    KDL::ChainJntToJacSolver jac_solver(chain_);
+    KDL::Jacobian real_jacobian(chain_.getNrOfJoints());
+    ASSERT_GE(jac_solver.JntToJac(real_jnt_array, real_jacobian), 0);
+
+    // mimic joints add to the column of the joint they mimic
+    jacobian.resize(joint_names_.size());
+    jacobian.data.setZero();
+    for (unsigned int i = 0; i < real_jnt_array.rows(); ++i)
+    {
+      jacobian.data.col(real_joint_columns_[i]) += real_joint_multipliers_[i] * real_jacobian.data.col(i);
+    }
+  }
+
+  void expectEqual(const KDL::Frame& expected, const KDL::Frame& frame) const
+  {
+    EXPECT_TRUE(KDL::Equal(expected, frame, TOLERANCE));
+  }
+
+  void expectEqual(const KDL::Jacobian& expected, const KDL::Jacobian& jacobian) const
+  {
+    ASSERT_EQ(expected.columns(), jacobian.columns());
+    EXPECT_TRUE(expected.data.isApprox(jacobian.data, TOLERANCE));
+  }
+
+  KDLChainWrapper wrapper_;
+  KDL::Chain chain_;
+  std::vector<std::string> joint_names_;
+  std::vector<int> real_joint_columns_;
+  std::vector<double> real_joint_multipliers_;
+  std::vector<double> real_joint_offsets_;
+};
+
+TEST_F(KDLChainWrapperTest, hidesMimicJoint)
+{
+  EXPECT_EQ(-1, getJointIndex(MIMIC_JOINT));
+  EXPECT_GE(getJointIndex(MIMICKED_JOINT), 0);
+}
+
+TEST_F(KDLChainWrapperTest, forwardKinematics)
+{
+  std::vector<std::vector<double> > jnt_arrays;
+  createSamples(jnt_arrays);
+
+  for (unsigned int i = 0; i < jnt_arrays.size(); ++i)
+  {
+    KDL::Frame expected_frame;
+    KDL::Jacobian expected_jacobian;
+    computeExpected(jnt_arrays[i], expected_frame, expected_jacobian);
+
+    KDL::Frame frame;
+    EXPECT_TRUE(wrapper_.forwardKinematics(jnt_arrays[i], frame));
+    expectEqual(expected_frame, frame);
+
+    KDL::JntArray kdl_jnt_array(jnt_arrays[i].size());
+    for (unsigned int j = 0; j < jnt_arrays[i].size(); ++j)
+      kdl_jnt_array(j) = jnt_arrays[i][j];
+    EXPECT_TRUE(wrapper_.forwardKinematics(kdl_jnt_array, frame));
+    expectEqual(expected_frame, frame);
+  }
+}
+
+TEST_F(KDLChainWrapperTest, forwardKinematicsWithWorkspace)
+{
+  std::vector<std::vector<double> > jnt_arrays;
+  createSamples(jnt_arrays);
+
+  KDLChainWrapper::Workspace workspace;
+  for (unsigned int i = 0; i < jnt_arrays.size(); ++i)
+  {
+    KDL::Frame expected_frame;
+    KDL::Jacobian expected_jacobian;
+    computeExpected(jnt_arrays[i], expected_frame, expected_jacobian);
+
+    KDL::Frame frame;
+    KDL::Jacobian jacobian;
+    EXPECT_TRUE(wrapper_.forwardKinematics(workspace, jnt_arrays[i], frame, &jacobian));
+    expectEqual(expected_frame, frame);
+    expectEqual(expected_jacobian, jacobian);
+
+    EXPECT_TRUE(wrapper_.forwardKinematics(workspace, jnt_arrays[i], frame));
+    expectEqual(expected_frame, frame);
+  }
+}
+
+TEST_F(KDLChainWrapperTest, batchForwardKinematics)
+{
+  std::vector<std::vector<double> > jnt_arrays;
+  createSamples(jnt_arrays);
+
+  std::vector<KDL::Frame> expected_frames(jnt_arrays.size());
+  std::vector<KDL::Jacobian> expected_jacobians(jnt_arrays.size());
+  for (unsigned int i = 0; i < jnt_arrays.size(); ++i)
+  {
+    computeExpected(jnt_arrays[i], expected_frames[i], expected_jacobians[i]);
+  }
+
+  std::vector<KDL::Frame> frames;
+  std::vector<KDL::Jacobian> jacobians;
+
+  EXPECT_TRUE(wrapper_.forwardKinematics(jnt_arrays, frames));
+  ASSERT_EQ(jnt_arrays.size(), frames.size());
+  for (unsigned int i = 0; i < jnt_arrays.size(); ++i)
+    expectEqual(expected_frames[i], frames[i]);
+
+  EXPECT_TRUE(wrapper_.forwardKinematics(jnt_arrays, frames, jacobians));
+  ASSERT_EQ(jnt_arrays.size(), frames.size());
+  ASSERT_EQ(jnt_arrays.size(), jacobians.size());
+  for (unsigned int i = 0; i < jnt_arrays.size(); ++i)
+  {
+    expectEqual(expected_frames[i], frames[i]);
+    expectEqual(expected_jacobians[i], jacobians[i]);
+  }
+
+  KDLChainWrapper::Workspace workspace;
+  EXPECT_TRUE(wrapper_.forwardKinematics(workspace, jnt_arrays, frames));
+  for (unsigned int i = 0; i < jnt_arrays.size(); ++i)
+    expectEqual(expected_frames[i], frames[i]);
+
+  // the workspace still holds the link transforms of the last sample
+  EXPECT_TRUE(wrapper_.forwardKinematics(workspace, jnt_arrays, frames, jacobians));
+  for (unsigned int i = 0; i < jnt_arrays.size(); ++i)
+  {
+    expectEqual(expected_frames[i], frames[i]);
+    expectEqual(expected_jacobians[i], jacobians[i]);
+  }
+}